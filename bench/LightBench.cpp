@@ -0,0 +1,45 @@
+#include <benchmark/benchmark.h>
+
+#include "bench/SyntheticWorlds.h"
+#include "core/JobSystem.h"
+#include "world/LightEngine.h"
+
+// Light propagation: whole chunks as they are generated, and the incremental update after a block edit
+
+namespace {
+    void BM_LightChunk(benchmark::State &state) {
+        const auto world = static_cast<SyntheticWorld>(state.range(0));
+        Chunk chunk({0, 0});
+        FillSyntheticChunk(world, chunk);
+        for (auto _: state)
+            LightEngine::LightChunk(chunk);
+        state.SetItemsProcessed(state.iterations());
+        state.SetLabel(GetSyntheticWorldName(world));
+    }
+
+    // A glowstone placed on the ground in the middle of the world and taken away again; two edits per iteration
+    void BM_LightEdit(benchmark::State &state) {
+        const auto world = static_cast<SyntheticWorld>(state.range(0));
+        const std::unique_ptr<World> pWorld = BuildSyntheticWorld(world, 2);
+        JobSystem jobSystem(1);
+        LightEngine lightEngine(*pWorld, jobSystem);
+        std::vector<SectionPos> changed;
+
+        int y = Chunk::HEIGHT - 1;
+        while (y > 0 && pWorld->GetBlock(8, y - 1, 8) == BLOCK_AIR)
+            --y;
+        for (auto _: state) {
+            pWorld->SetBlock(8, y, 8, BLOCK_GLOWSTONE);
+            lightEngine.Update();
+            pWorld->SetBlock(8, y, 8, BLOCK_AIR);
+            lightEngine.Update();
+            changed.clear();
+            pWorld->TakeChangedSections(changed);
+        }
+        state.SetItemsProcessed(state.iterations() * 2);
+        state.SetLabel(GetSyntheticWorldName(world));
+    }
+}
+
+BENCHMARK(BM_LightChunk)->DenseRange(0, SYNTHETIC_WORLD_COUNT - 1)->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_LightEdit)->DenseRange(0, SYNTHETIC_WORLD_COUNT - 1)->Unit(benchmark::kMicrosecond);
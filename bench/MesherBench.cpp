@@ -0,0 +1,47 @@
+#include <benchmark/benchmark.h>
+
+#include "bench/SyntheticWorlds.h"
+#include "core/LinearArena.h"
+#include "render/ChunkMesher.h"
+
+// Greedy meshing of one section with its neighbourhood, per synthetic world and level of detail
+
+namespace {
+    // Top of the flat and checkerboard worlds' ground, inside the caves: every world shows faces here
+    constexpr int SECTION_Y = 3;
+
+    void BM_MeshSection(benchmark::State &state) {
+        const auto world = static_cast<SyntheticWorld>(state.range(0));
+        const int lod = static_cast<int>(state.range(1));
+        auto section = std::make_unique<SectionNeighborhood>();
+        section->Gather(*BuildSyntheticWorld(world, 1), 0, SECTION_Y, 0);
+
+        LinearArena &arena = GetThreadArena();
+        size_t vertexCount = 0;
+        for (auto _: state) {
+            const LinearArena::Scope scratch(arena);
+            ChunkMesh mesh(&arena);
+            MeshSectionLod(*section, lod, mesh);
+            vertexCount = mesh.vertices.size();
+            benchmark::DoNotOptimize(mesh.indices.data());
+        }
+        state.SetItemsProcessed(state.iterations());
+        state.counters["vertices"] = static_cast<double>(vertexCount);
+        state.SetLabel(GetSyntheticWorldName(world));
+    }
+
+    void BM_GatherNeighborhood(benchmark::State &state) {
+        const auto world = static_cast<SyntheticWorld>(state.range(0));
+        const std::unique_ptr<World> pWorld = BuildSyntheticWorld(world, 1);
+        auto section = std::make_unique<SectionNeighborhood>();
+        for (auto _: state) {
+            section->Gather(*pWorld, 0, SECTION_Y, 0);
+            benchmark::DoNotOptimize(section->blocks.data());
+        }
+        state.SetItemsProcessed(state.iterations());
+        state.SetLabel(GetSyntheticWorldName(world));
+    }
+}
+
+BENCHMARK(BM_MeshSection)->ArgsProduct({benchmark::CreateDenseRange(0, SYNTHETIC_WORLD_COUNT - 1, 1), {0, 1, 2}});
+BENCHMARK(BM_GatherNeighborhood)->DenseRange(0, SYNTHETIC_WORLD_COUNT - 1);
@@ -0,0 +1,49 @@
+#include <benchmark/benchmark.h>
+
+#include <vector>
+
+#include "world/Noise.h"
+
+// Noise grids as the terrain generator asks for them, once per instruction set the build and CPU support
+
+namespace {
+    constexpr NoiseSettings SETTINGS{.seed = 1337, .frequency = 0.01f, .octaves = 4};
+
+    const NoiseKernels *GetKernels(benchmark::State &state) {
+        const auto level = static_cast<NoiseSimdLevel>(state.range(0));
+        const NoiseKernels *pKernels = GetNoiseKernels(level);
+        if (!pKernels)
+            state.SkipWithError("Not supported on this CPU or build");
+        state.SetLabel(GetNoiseSimdLevelName(level));
+        return pKernels;
+    }
+
+    // One chunk's height map
+    void BM_Noise2DGrid(benchmark::State &state) {
+        const NoiseKernels *pKernels = GetKernels(state);
+        std::vector<float> out(16 * 16);
+        int x0 = 0;
+        for (auto _: state) {
+            pKernels->grid2D(SETTINGS, x0, 0, 16, 16, out.data());
+            benchmark::DoNotOptimize(out.data());
+            x0 += 16;
+        }
+        state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(out.size()));
+    }
+
+    // One section of density
+    void BM_Noise3DGrid(benchmark::State &state) {
+        const NoiseKernels *pKernels = GetKernels(state);
+        std::vector<float> out(16 * 16 * 16);
+        int x0 = 0;
+        for (auto _: state) {
+            pKernels->grid3D(SETTINGS, x0, 0, 0, 16, 16, 16, out.data());
+            benchmark::DoNotOptimize(out.data());
+            x0 += 16;
+        }
+        state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(out.size()));
+    }
+}
+
+BENCHMARK(BM_Noise2DGrid)->DenseRange(NOISE_SIMD_SCALAR, NOISE_SIMD_NEON);
+BENCHMARK(BM_Noise3DGrid)->DenseRange(NOISE_SIMD_SCALAR, NOISE_SIMD_NEON);
@@ -0,0 +1,100 @@
+#include <benchmark/benchmark.h>
+
+#include "bench/SyntheticWorlds.h"
+#include "world/ChunkSerializer.h"
+
+// Block get/set on palette storage and the region file form of chunks, per synthetic world
+
+namespace {
+    // A section from the middle of the world's blocks
+    constexpr int SECTION_Y = 2;
+
+    ChunkSection GetSection(const SyntheticWorld world) {
+        Chunk chunk({0, 0});
+        FillSyntheticChunk(world, chunk);
+        const ChunkSection *pSection = chunk.GetSection(SECTION_Y);
+        return pSection ? *pSection : ChunkSection();
+    }
+
+    void BM_SectionGet(benchmark::State &state) {
+        const auto world = static_cast<SyntheticWorld>(state.range(0));
+        const ChunkSection section = GetSection(world);
+        for (auto _: state) {
+            uint32_t sum = 0;
+            for (int i = 0; i < ChunkSection::VOLUME; ++i)
+                sum += section.GetBlock(i);
+            benchmark::DoNotOptimize(sum);
+        }
+        state.SetItemsProcessed(state.iterations() * ChunkSection::VOLUME);
+        state.SetLabel(GetSyntheticWorldName(world));
+    }
+
+    // Writes the section's blocks one by one into an empty section, growing its palette as it goes
+    void BM_SectionSet(benchmark::State &state) {
+        const auto world = static_cast<SyntheticWorld>(state.range(0));
+        BlockId blocks[ChunkSection::VOLUME];
+        GetSection(world).Decode(blocks);
+        for (auto _: state) {
+            ChunkSection section;
+            for (int i = 0; i < ChunkSection::VOLUME; ++i)
+                section.SetBlock(i, blocks[i]);
+            benchmark::DoNotOptimize(section.GetNonAirCount());
+        }
+        state.SetItemsProcessed(state.iterations() * ChunkSection::VOLUME);
+        state.SetLabel(GetSyntheticWorldName(world));
+    }
+
+    void BM_SectionDecode(benchmark::State &state) {
+        const auto world = static_cast<SyntheticWorld>(state.range(0));
+        const ChunkSection section = GetSection(world);
+        BlockId blocks[ChunkSection::VOLUME];
+        for (auto _: state) {
+            section.Decode(blocks);
+            benchmark::DoNotOptimize(blocks);
+        }
+        state.SetItemsProcessed(state.iterations() * ChunkSection::VOLUME);
+        state.SetLabel(GetSyntheticWorldName(world));
+    }
+
+    // Serialized and LZ4 compressed, as saved to region files
+    void BM_RegionCompress(benchmark::State &state) {
+        const auto world = static_cast<SyntheticWorld>(state.range(0));
+        Chunk chunk({0, 0});
+        FillSyntheticChunk(world, chunk);
+        std::vector<uint8_t> serialized, payload;
+        for (auto _: state) {
+            SerializeChunk(chunk, serialized);
+            CompressChunkPayload(serialized.data(), serialized.size(), payload);
+            benchmark::DoNotOptimize(payload.data());
+        }
+        state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * serialized.size()));
+        state.counters["ratio"] = static_cast<double>(serialized.size()) / static_cast<double>(payload.size());
+        state.SetLabel(GetSyntheticWorldName(world));
+    }
+
+    void BM_RegionDecompress(benchmark::State &state) {
+        const auto world = static_cast<SyntheticWorld>(state.range(0));
+        Chunk source({0, 0});
+        FillSyntheticChunk(world, source);
+        std::vector<uint8_t> serialized, payload;
+        SerializeChunk(source, serialized);
+        CompressChunkPayload(serialized.data(), serialized.size(), payload);
+
+        Chunk chunk({0, 0});
+        for (auto _: state) {
+            if (!DecompressChunkPayload(payload.data(), payload.size(), serialized) ||
+                !DeserializeChunk(serialized.data(), serialized.size(), chunk)) {
+                state.SkipWithError("Payload did not load back");
+                break;
+            }
+        }
+        state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * serialized.size()));
+        state.SetLabel(GetSyntheticWorldName(world));
+    }
+}
+
+BENCHMARK(BM_SectionGet)->DenseRange(0, SYNTHETIC_WORLD_COUNT - 1);
+BENCHMARK(BM_SectionSet)->DenseRange(0, SYNTHETIC_WORLD_COUNT - 1);
+BENCHMARK(BM_SectionDecode)->DenseRange(0, SYNTHETIC_WORLD_COUNT - 1);
+BENCHMARK(BM_RegionCompress)->DenseRange(0, SYNTHETIC_WORLD_COUNT - 1);
+BENCHMARK(BM_RegionDecompress)->DenseRange(0, SYNTHETIC_WORLD_COUNT - 1);
@@ -0,0 +1,83 @@
+#include "bench/SyntheticWorlds.h"
+
+#include "core/JobSystem.h"
+#include "world/LightEngine.h"
+#include "world/Noise.h"
+
+namespace {
+    constexpr int FLAT_HEIGHT = 64;
+    constexpr int CAVE_HEIGHT = 96;
+    constexpr int CHECKERBOARD_HEIGHT = 64;
+    // Caves where the noise is above this
+    constexpr float CAVE_THRESHOLD = 0.3f;
+    constexpr NoiseSettings CAVE_NOISE{.seed = 7, .frequency = 0.04f, .octaves = 2};
+}
+
+const char *GetSyntheticWorldName(const SyntheticWorld world) {
+    switch (world) {
+        case SYNTHETIC_WORLD_FLAT:
+            return "flat";
+        case SYNTHETIC_WORLD_CAVES:
+            return "caves";
+        case SYNTHETIC_WORLD_CHECKERBOARD:
+            return "checkerboard";
+        default:
+            return "unknown";
+    }
+}
+
+void FillSyntheticChunk(const SyntheticWorld world, Chunk &chunk) {
+    const int x0 = chunk.GetPos().x * ChunkSection::SIZE;
+    const int z0 = chunk.GetPos().z * ChunkSection::SIZE;
+    switch (world) {
+        case SYNTHETIC_WORLD_FLAT:
+            for (int y = 0; y < FLAT_HEIGHT; ++y) {
+                const BlockId id = y == FLAT_HEIGHT - 1 ? BLOCK_GRASS : y >= FLAT_HEIGHT - 4 ? BLOCK_DIRT : BLOCK_STONE;
+                for (int z = 0; z < ChunkSection::SIZE; ++z)
+                    for (int x = 0; x < ChunkSection::SIZE; ++x)
+                        chunk.SetBlock(x, y, z, id);
+            }
+            break;
+        case SYNTHETIC_WORLD_CAVES: {
+            float noise[ChunkSection::VOLUME];
+            for (int sy = 0; sy < CAVE_HEIGHT / ChunkSection::SIZE; ++sy) {
+                Noise3DGrid(CAVE_NOISE, x0, sy * ChunkSection::SIZE, z0, ChunkSection::SIZE, ChunkSection::SIZE,
+                            ChunkSection::SIZE, noise);
+                BlockId blocks[ChunkSection::VOLUME];
+                for (int i = 0; i < ChunkSection::VOLUME; ++i)
+                    blocks[i] = noise[i] > CAVE_THRESHOLD ? BLOCK_AIR : BLOCK_STONE;
+                chunk.GetOrCreateSection(sy).Assign(blocks);
+            }
+            break;
+        }
+        case SYNTHETIC_WORLD_CHECKERBOARD:
+            for (int y = 0; y < CHECKERBOARD_HEIGHT; ++y)
+                for (int z = 0; z < ChunkSection::SIZE; ++z)
+                    for (int x = 0; x < ChunkSection::SIZE; ++x)
+                        if (((x0 + x) ^ y ^ (z0 + z)) & 1)
+                            chunk.SetBlock(x, y, z, BLOCK_STONE);
+            break;
+        default:
+            break;
+    }
+    chunk.Compact();
+}
+
+std::unique_ptr<World> BuildSyntheticWorld(const SyntheticWorld world, const int radius) {
+    auto pWorld = std::make_unique<World>();
+    JobSystem jobSystem(1);
+    LightEngine lightEngine(*pWorld, jobSystem);
+    for (int z = -radius; z <= radius; ++z) {
+        for (int x = -radius; x <= radius; ++x) {
+            auto chunk = std::make_unique<Chunk>(ChunkPos{x, z});
+            FillSyntheticChunk(world, *chunk);
+            LightEngine::LightChunk(*chunk);
+            pWorld->InsertChunk(std::move(chunk));
+            lightEngine.QueueChunk({x, z});
+        }
+    }
+    lightEngine.Update();
+    std::vector<SectionPos> changed;
+    pWorld->TakeChangedSections(changed);
+    return pWorld;
+}
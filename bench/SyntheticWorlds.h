@@ -0,0 +1,24 @@
+#pragma once
+
+#include <memory>
+
+#include "world/World.h"
+
+// Fixed worlds the microbenchmarks run on, the same on every machine
+enum SyntheticWorld {
+    // Stone, dirt and grass layers up to y 64: few blocks, one palette entry per section
+    SYNTHETIC_WORLD_FLAT,
+    // Solid stone up to y 96 riddled with noise caves, closest to generated terrain underground
+    SYNTHETIC_WORLD_CAVES,
+    // Stone and air alternating in every direction up to y 64: the worst case for meshing and light
+    SYNTHETIC_WORLD_CHECKERBOARD,
+    SYNTHETIC_WORLD_COUNT
+};
+
+const char *GetSyntheticWorldName(SyntheticWorld world);
+
+// Fills a chunk of the world in isolation, without light
+void FillSyntheticChunk(SyntheticWorld world, Chunk &chunk);
+
+// Chunks from -radius to radius on both axes, lit including across chunk borders
+std::unique_ptr<World> BuildSyntheticWorld(SyntheticWorld world, int radius);
@@ -0,0 +1,78 @@
+# Compares a benchmark result with a baseline, both written by PlusCraft --benchmark.
+# Fails when a metric got worse by more than TOLERANCE percent. Without a baseline the result is copied there and
+# the check passes: delete the baseline to take the next run as the new one.
+#   cmake -DRESULT=<file> -DBASELINE=<file> [-DTOLERANCE=<percent>] -P CompareBenchmark.cmake
+cmake_minimum_required(VERSION 3.19)
+
+if (NOT DEFINED RESULT OR NOT DEFINED BASELINE)
+    message(FATAL_ERROR "Usage: cmake -DRESULT=<file> -DBASELINE=<file> [-DTOLERANCE=<percent>] -P ${CMAKE_SCRIPT_MODE_FILE}")
+endif ()
+if (NOT DEFINED TOLERANCE)
+    set(TOLERANCE 10)
+endif ()
+if (NOT EXISTS "${RESULT}")
+    message(FATAL_ERROR "No benchmark result at ${RESULT}")
+endif ()
+if (NOT EXISTS "${BASELINE}")
+    configure_file("${RESULT}" "${BASELINE}" COPYONLY)
+    message(WARNING "No baseline yet, saved this run as ${BASELINE}")
+    return()
+endif ()
+
+file(READ "${RESULT}" result)
+file(READ "${BASELINE}" baseline)
+
+string(JSON resultAdapter GET "${result}" adapter)
+string(JSON baselineAdapter GET "${baseline}" adapter)
+if (NOT resultAdapter STREQUAL baselineAdapter)
+    message(WARNING "Baseline is from ${baselineAdapter}, this run from ${resultAdapter}")
+endif ()
+
+# CMake only does integer math: fixed point numbers are turned into thousandths
+function(to_milli value out)
+    if (value MATCHES "^([0-9]+)\\.([0-9]*)$")
+        string(SUBSTRING "${CMAKE_MATCH_2}000" 0 3 fraction)
+        math(EXPR milli "${CMAKE_MATCH_1} * 1000 + ${fraction}")
+    else ()
+        math(EXPR milli "${value} * 1000")
+    endif ()
+    set(${out} ${milli} PARENT_SCOPE)
+endfunction()
+
+set(failed FALSE)
+# direction is LOWER when smaller is better
+function(check name direction)
+    string(JSON resultValue GET "${result}" ${ARGN})
+    string(JSON baselineValue GET "${baseline}" ${ARGN})
+    to_milli(${resultValue} r)
+    to_milli(${baselineValue} b)
+    if (direction STREQUAL "LOWER")
+        math(EXPR limit "${b} * (100 + ${TOLERANCE})")
+        math(EXPR scaled "${r} * 100")
+        if (scaled GREATER limit)
+            set(worse TRUE)
+        endif ()
+    else ()
+        math(EXPR limit "${b} * (100 - ${TOLERANCE})")
+        math(EXPR scaled "${r} * 100")
+        if (scaled LESS limit)
+            set(worse TRUE)
+        endif ()
+    endif ()
+    if (worse)
+        message(STATUS "REGRESSED ${name}: ${resultValue}, baseline ${baselineValue}")
+        set(failed TRUE PARENT_SCOPE)
+    else ()
+        message(STATUS "ok        ${name}: ${resultValue}, baseline ${baselineValue}")
+    endif ()
+endfunction()
+
+check("frame time p50 (ms)" LOWER frameTimeMs p50)
+check("frame time p99 (ms)" LOWER frameTimeMs p99)
+check("chunks per second" HIGHER chunksPerSecond)
+check("sections meshed per second" HIGHER sectionsMeshedPerSecond)
+check("peak GPU memory (bytes)" LOWER gpuMemoryBytes peak)
+
+if (failed)
+    message(FATAL_ERROR "Benchmark regressed by more than ${TOLERANCE}% against ${BASELINE}")
+endif ()
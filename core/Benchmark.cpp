@@ -0,0 +1,101 @@
+#include "core/Benchmark.h"
+
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <numeric>
+
+#include <spdlog/spdlog.h>
+#include <spdlog/sinks/basic_file_sink.h>
+
+namespace {
+    // Sideways sway of the path, blocks and radians per second, so it crosses chunks at every angle
+    constexpr float SWAY = 48.f;
+    constexpr float SWAY_RATE = 0.15f;
+
+    // Nearest rank
+    float Percentile(const std::vector<float> &sorted, const uint32_t perMille) {
+        if (sorted.empty())
+            return 0.f;
+        return sorted[std::min(sorted.size() - 1, sorted.size() * perMille / 1000)];
+    }
+
+    std::string EscapeJson(const std::string &s) {
+        std::string escaped;
+        for (const char c: s) {
+            if (c == '"' || c == '\\')
+                escaped += '\\';
+            if (static_cast<unsigned char>(c) >= 0x20)
+                escaped += c;
+        }
+        return escaped;
+    }
+}
+
+Benchmark::Camera Benchmark::GetCamera() const {
+    const float t = std::max(0.f, m_time - m_settings.warmup);
+    Camera camera;
+    camera.x = SWAY * std::sin(t * SWAY_RATE);
+    camera.y = m_settings.height;
+    camera.z = m_settings.speed * t;
+    // Facing along the path
+    camera.yaw = std::atan2(-SWAY * SWAY_RATE * std::cos(t * SWAY_RATE), m_settings.speed);
+    return camera;
+}
+
+void Benchmark::AddFrame(const float frameSeconds, const Counters &counters) {
+    if (IsFinished())
+        return;
+    if (m_time < m_settings.warmup) {
+        m_first = counters;
+    } else {
+        m_frameTimes.push_back(frameSeconds * 1000.f);
+        m_last = counters;
+        m_peakGpuMemory = std::max(m_peakGpuMemory, counters.gpuMemory);
+    }
+    m_time += frameSeconds;
+}
+
+bool Benchmark::WriteResults(const std::string &path, const RunInfo &info) const {
+    std::vector<float> sorted = m_frameTimes;
+    std::sort(sorted.begin(), sorted.end());
+    const double total = std::accumulate(sorted.begin(), sorted.end(), 0.0) / 1000.0;
+    const double mean = sorted.empty() ? 0.0 : total * 1000.0 / static_cast<double>(sorted.size());
+    const double seconds = std::max(total, 1e-3);
+    const double chunksPerSecond = static_cast<double>(m_last.chunksGenerated - m_first.chunksGenerated) / seconds;
+    const double sectionsPerSecond = static_cast<double>(m_last.sectionsMeshed - m_first.sectionsMeshed) / seconds;
+
+    spdlog::info("Benchmark: {} frames, {:.2f} ms mean, {:.2f} p50, {:.2f} p99, {:.0f} chunks/s, {:.0f} sections/s",
+                 sorted.size(), mean, Percentile(sorted, 500), Percentile(sorted, 990), chunksPerSecond,
+                 sectionsPerSecond);
+
+    std::shared_ptr<spdlog::logger> out;
+    try {
+        out = spdlog::basic_logger_st("benchmark", path, true);
+    } catch (const spdlog::spdlog_ex &e) {
+        spdlog::error("Benchmark: failed to open {}: {}", path, e.what());
+        return false;
+    }
+    out->set_pattern("%v");
+    out->info("{}", "{");
+    out->info("  \"device\": \"{}\",", EscapeJson(info.device));
+    out->info("  \"adapter\": \"{}\",", EscapeJson(info.adapter));
+    out->info("  \"width\": {},", info.width);
+    out->info("  \"height\": {},", info.height);
+    out->info("  \"seed\": {},", info.seed);
+    out->info("  \"seconds\": {:.3f},", total);
+    out->info("  \"frames\": {},", sorted.size());
+    out->info("  \"frameTimeMs\": {{\"mean\": {:.3f}, \"p50\": {:.3f}, \"p90\": {:.3f}, \"p99\": {:.3f}, "
+              "\"p999\": {:.3f}, \"max\": {:.3f}}},",
+              mean, Percentile(sorted, 500), Percentile(sorted, 900), Percentile(sorted, 990),
+              Percentile(sorted, 999), sorted.empty() ? 0.f : sorted.back());
+    out->info("  \"chunksPerSecond\": {:.1f},", chunksPerSecond);
+    out->info("  \"sectionsMeshedPerSecond\": {:.1f},", sectionsPerSecond);
+    out->info("  \"gpuMemoryBytes\": {{\"last\": {}, \"peak\": {}}}", m_last.gpuMemory, m_peakGpuMemory);
+    out->info("{}", "}");
+    out->flush();
+    spdlog::drop("benchmark");
+
+    spdlog::info("Benchmark: wrote {}", path);
+    return true;
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Scripted performance run: the camera flies a fixed path while frame times and chunk and mesh throughput are
+// recorded, which are written out as JSON to compare against a baseline (cmake/CompareBenchmark.cmake).
+// The path only depends on the time into the run, so with a fixed seed every run streams and draws the same world.
+// Frames are only recorded once the warm-up is over, the camera holds still at the start until then.
+class Benchmark {
+public:
+    struct Settings {
+        // Seconds
+        float warmup = 5.f;
+        float duration = 60.f;
+        // Blocks per second along the path
+        float speed = 24.f;
+        float height = 110.f;
+    };
+
+    // Running totals, sampled every frame
+    struct Counters {
+        uint64_t chunksGenerated = 0;
+        uint64_t sectionsMeshed = 0;
+        // Bytes
+        uint64_t gpuMemory = 0;
+    };
+
+    struct Camera {
+        float x = 0.f, y = 0.f, z = 0.f;
+        // Radians around Y, 0 looks down +Z
+        float yaw = 0.f;
+    };
+
+    // Written along with the results
+    struct RunInfo {
+        std::string device, adapter;
+        uint32_t width = 0, height = 0;
+        int32_t seed = 0;
+    };
+
+    explicit Benchmark(const Settings &settings) : m_settings(settings) {}
+
+    // Where the camera is at the current time into the run
+    Camera GetCamera() const;
+
+    // Once per frame, with how long it took
+    void AddFrame(float frameSeconds, const Counters &counters);
+    bool IsFinished() const { return m_time >= m_settings.warmup + m_settings.duration; }
+
+    // Logs a summary too; false when the file could not be written
+    bool WriteResults(const std::string &path, const RunInfo &info) const;
+
+private:
+    Settings m_settings;
+    // Seconds into the run
+    float m_time = 0.f;
+    // Milliseconds, recorded frames only
+    std::vector<float> m_frameTimes;
+    Counters m_first, m_last;
+    uint64_t m_peakGpuMemory = 0;
+};
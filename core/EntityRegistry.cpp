@@ -0,0 +1,177 @@
+#include "core/EntityRegistry.h"
+
+#include <algorithm>
+#include <bit>
+#include <cassert>
+#include <cstring>
+#include <mutex>
+#include <new>
+
+namespace {
+    constexpr std::align_val_t CHUNK_ALIGNMENT{64};
+
+    std::mutex g_componentMutex;
+    ComponentInfo g_componentInfos[MAX_COMPONENT_TYPES];
+    uint32_t g_componentCount = 0;
+
+    uint32_t AlignUp(const uint32_t value, const uint32_t alignment) {
+        return (value + alignment - 1) / alignment * alignment;
+    }
+}
+
+ComponentId RegisterComponentType(const uint32_t size, const uint32_t alignment) {
+    std::lock_guard lock(g_componentMutex);
+    assert(g_componentCount < MAX_COMPONENT_TYPES && "Too many component types for ComponentMask");
+    g_componentInfos[g_componentCount] = {size, alignment};
+    return g_componentCount++;
+}
+
+const ComponentInfo &GetComponentInfo(const ComponentId id) {
+    // Written once before the id is handed out, never changed after
+    return g_componentInfos[id];
+}
+
+void Archetype::ChunkDeleter::operator()(std::byte *pData) const {
+    ::operator delete[](pData, CHUNK_ALIGNMENT);
+}
+
+Archetype::Archetype(const ComponentMask mask) : m_mask(mask) {
+    uint32_t rowBytes = sizeof(Entity);
+    for (ComponentMask bits = mask; bits != 0; bits &= bits - 1)
+        rowBytes += GetComponentInfo(static_cast<ComponentId>(std::countr_zero(bits))).size;
+
+    // Start from the capacity ignoring padding and back off until the aligned arrays fit
+    for (m_chunkCapacity = std::max(1u, CHUNK_BYTES / rowBytes); m_chunkCapacity > 1; --m_chunkCapacity) {
+        uint32_t offset = m_chunkCapacity * sizeof(Entity);
+        for (ComponentMask bits = mask; bits != 0; bits &= bits - 1) {
+            const ComponentInfo &info = GetComponentInfo(static_cast<ComponentId>(std::countr_zero(bits)));
+            offset = AlignUp(offset, info.alignment) + m_chunkCapacity * info.size;
+        }
+        if (offset <= CHUNK_BYTES)
+            break;
+    }
+
+    uint32_t offset = m_chunkCapacity * sizeof(Entity);
+    for (ComponentMask bits = mask; bits != 0; bits &= bits - 1) {
+        const auto id = static_cast<ComponentId>(std::countr_zero(bits));
+        const ComponentInfo &info = GetComponentInfo(id);
+        offset = AlignUp(offset, info.alignment);
+        m_offsets[id] = offset;
+        offset += m_chunkCapacity * info.size;
+    }
+}
+
+uint32_t Archetype::GetChunkSize(const size_t chunk) const {
+    // The last chunk may be a spare one, see Remove()
+    const size_t begin = chunk * m_chunkCapacity;
+    return begin < m_size ? static_cast<uint32_t>(std::min<size_t>(m_chunkCapacity, m_size - begin)) : 0;
+}
+
+Entity *Archetype::GetEntities(const size_t chunk) const {
+    return reinterpret_cast<Entity *>(m_chunks[chunk].get());
+}
+
+void *Archetype::GetArray(const size_t chunk, const ComponentId id) const {
+    return Has(id) ? m_chunks[chunk].get() + m_offsets[id] : nullptr;
+}
+
+void *Archetype::GetComponent(const uint32_t row, const ComponentId id) const {
+    if (!Has(id))
+        return nullptr;
+    const uint32_t chunk = row / m_chunkCapacity, index = row % m_chunkCapacity;
+    return m_chunks[chunk].get() + m_offsets[id] + static_cast<size_t>(index) * GetComponentInfo(id).size;
+}
+
+uint32_t Archetype::Push(const Entity entity) {
+    const uint32_t row = m_size;
+    if (row / m_chunkCapacity == m_chunks.size())
+        m_chunks.emplace_back(static_cast<std::byte *>(::operator new[](CHUNK_BYTES, CHUNK_ALIGNMENT)));
+    GetEntities(row / m_chunkCapacity)[row % m_chunkCapacity] = entity;
+    ++m_size;
+    return row;
+}
+
+Entity Archetype::Remove(const uint32_t row) {
+    const uint32_t last = --m_size;
+    Entity moved;
+    if (row != last) {
+        const uint32_t lastChunk = last / m_chunkCapacity, lastIndex = last % m_chunkCapacity;
+        moved = GetEntities(lastChunk)[lastIndex];
+        GetEntities(row / m_chunkCapacity)[row % m_chunkCapacity] = moved;
+        for (ComponentMask bits = m_mask; bits != 0; bits &= bits - 1) {
+            const auto id = static_cast<ComponentId>(std::countr_zero(bits));
+            std::memcpy(GetComponent(row, id), GetComponent(last, id), GetComponentInfo(id).size);
+        }
+    }
+    // One spare chunk is kept past the last row, so churn at a chunk boundary does not allocate every time
+    if (m_chunks.size() > 1 && m_size <= (m_chunks.size() - 2) * m_chunkCapacity)
+        m_chunks.pop_back();
+    return moved;
+}
+
+void EntityRegistry::Destroy(const Entity entity) {
+    if (!IsAlive(entity))
+        return;
+    Location &location = m_locations[entity.index];
+    Unplace(location.archetype, location.row);
+    location.alive = false;
+    ++location.generation;
+    m_freeIndices.push_back(entity.index);
+    --m_entityCount;
+}
+
+bool EntityRegistry::IsAlive(const Entity entity) const {
+    return entity.index < m_locations.size() && m_locations[entity.index].alive &&
+           m_locations[entity.index].generation == entity.generation;
+}
+
+Entity EntityRegistry::AllocateEntity() {
+    uint32_t index;
+    if (!m_freeIndices.empty()) {
+        index = m_freeIndices.back();
+        m_freeIndices.pop_back();
+    } else {
+        index = static_cast<uint32_t>(m_locations.size());
+        m_locations.emplace_back();
+    }
+    m_locations[index].alive = true;
+    ++m_entityCount;
+    return {index, m_locations[index].generation};
+}
+
+uint32_t EntityRegistry::GetOrCreateArchetype(const ComponentMask mask) {
+    const auto [it, inserted] = m_archetypeIndices.try_emplace(mask, static_cast<uint32_t>(m_archetypes.size()));
+    if (inserted)
+        m_archetypes.push_back(std::make_unique<Archetype>(mask));
+    return it->second;
+}
+
+void EntityRegistry::Place(const Entity entity, const uint32_t archetype) {
+    Location &location = m_locations[entity.index];
+    location.archetype = archetype;
+    location.row = m_archetypes[archetype]->Push(entity);
+}
+
+void EntityRegistry::Unplace(const uint32_t archetype, const uint32_t row) {
+    const Entity moved = m_archetypes[archetype]->Remove(row);
+    if (moved.IsValid())
+        m_locations[moved.index].row = row;
+}
+
+void EntityRegistry::Move(const Entity entity, const ComponentMask mask) {
+    const Location from = m_locations[entity.index];
+    if (m_archetypes[from.archetype]->GetMask() == mask)
+        return;
+
+    const uint32_t to = GetOrCreateArchetype(mask);
+    // Looked up after GetOrCreateArchetype(), which may grow the archetype list
+    const Archetype &source = *m_archetypes[from.archetype];
+    const Archetype &target = *m_archetypes[to];
+    Place(entity, to);
+    const uint32_t row = m_locations[entity.index].row;
+    for (ComponentMask bits = source.GetMask() & mask; bits != 0; bits &= bits - 1) {
+        const auto id = static_cast<ComponentId>(std::countr_zero(bits));
+        std::memcpy(target.GetComponent(row, id), source.GetComponent(from.row, id), GetComponentInfo(id).size);
+    }
+    Unplace(from.archetype, from.row);
+}
@@ -0,0 +1,236 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <tuple>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+#include "core/JobSystem.h"
+
+// Index into the registry plus the generation of that index, so a handle to a destroyed entity never
+// resolves to the entity that reused its index
+struct Entity {
+    static constexpr uint32_t INVALID_INDEX = ~0u;
+
+    uint32_t index = INVALID_INDEX;
+    uint32_t generation = 0;
+
+    bool IsValid() const { return index != INVALID_INDEX; }
+    bool operator==(const Entity &) const = default;
+};
+
+using ComponentId = uint32_t;
+// One bit per component type
+using ComponentMask = uint64_t;
+constexpr uint32_t MAX_COMPONENT_TYPES = 64;
+
+struct ComponentInfo {
+    uint32_t size = 0;
+    uint32_t alignment = 0;
+};
+
+// Ids are handed out on first use; thread-safe
+ComponentId RegisterComponentType(uint32_t size, uint32_t alignment);
+const ComponentInfo &GetComponentInfo(ComponentId id);
+
+// Components are plain data: archetypes move them around with memcpy and never run constructors or destructors
+template<typename T>
+ComponentId GetComponentId() {
+    static_assert(std::is_trivially_copyable_v<T> && std::is_trivially_destructible_v<T>,
+                  "Components must be plain data");
+    static const ComponentId id = RegisterComponentType(sizeof(T), alignof(T));
+    return id;
+}
+
+template<typename... Ts>
+ComponentMask GetComponentMask() {
+    return ((ComponentMask{1} << GetComponentId<Ts>()) | ... | ComponentMask{0});
+}
+
+// All entities with exactly one set of components. Rows are stored in fixed-size chunks, every component in an
+// array of its own within the chunk (struct of arrays), so a system touching two components streams through
+// just those two arrays. Rows are dense: every chunk but the last is full, removal moves the last row into the hole.
+class Archetype {
+public:
+    static constexpr uint32_t CHUNK_BYTES = 16 << 10;
+
+    explicit Archetype(ComponentMask mask);
+
+    Archetype(const Archetype &) = delete;
+    Archetype &operator=(const Archetype &) = delete;
+
+    ComponentMask GetMask() const { return m_mask; }
+    bool Has(const ComponentId id) const { return (m_mask >> id) & 1; }
+
+    uint32_t GetSize() const { return m_size; }
+    uint32_t GetChunkCapacity() const { return m_chunkCapacity; }
+    size_t GetChunkCount() const { return m_chunks.size(); }
+    uint32_t GetChunkSize(size_t chunk) const;
+
+    Entity *GetEntities(size_t chunk) const;
+    void *GetArray(size_t chunk, ComponentId id) const;
+    template<typename T>
+    T *GetArray(const size_t chunk) const { return static_cast<T *>(GetArray(chunk, GetComponentId<T>())); }
+
+    void *GetComponent(uint32_t row, ComponentId id) const;
+
+    // Appends a row with uninitialized components and returns it
+    uint32_t Push(Entity entity);
+    // Moves the last row into row; returns the entity that moved, invalid when row was the last one
+    Entity Remove(uint32_t row);
+
+private:
+    struct ChunkDeleter {
+        void operator()(std::byte *pData) const;
+    };
+
+    ComponentMask m_mask;
+    uint32_t m_chunkCapacity = 0;
+    // Byte offset of every component's array within a chunk, the entity array comes first
+    uint32_t m_offsets[MAX_COMPONENT_TYPES] = {};
+    std::vector<std::unique_ptr<std::byte[], ChunkDeleter>> m_chunks;
+    uint32_t m_size = 0;
+};
+
+// Archetype based entity-component store.
+// Not thread-safe: structural changes (Create, Destroy, Add, Remove) must not overlap any other call.
+// ParallelForEach() splits the iteration by chunk, systems may then write the components they iterate.
+class EntityRegistry {
+public:
+    EntityRegistry() = default;
+
+    EntityRegistry(const EntityRegistry &) = delete;
+    EntityRegistry &operator=(const EntityRegistry &) = delete;
+
+    template<typename... Ts>
+    Entity Create(const Ts &... components) {
+        const Entity entity = AllocateEntity();
+        const uint32_t archetype = GetOrCreateArchetype(GetComponentMask<Ts...>());
+        Place(entity, archetype);
+        (Assign(entity, components), ...);
+        return entity;
+    }
+
+    void Destroy(Entity entity);
+    bool IsAlive(Entity entity) const;
+
+    // nullptr when the entity is dead or lacks the component; invalidated by structural changes
+    template<typename T>
+    T *Get(const Entity entity) const {
+        if (!IsAlive(entity))
+            return nullptr;
+        const Location &location = m_locations[entity.index];
+        return static_cast<T *>(m_archetypes[location.archetype]->GetComponent(location.row, GetComponentId<T>()));
+    }
+
+    template<typename T>
+    bool Has(const Entity entity) const { return Get<T>(entity) != nullptr; }
+
+    // Adding a component the entity has overwrites it
+    template<typename T>
+    void Add(const Entity entity, const T &component) {
+        if (!IsAlive(entity))
+            return;
+        const ComponentMask mask = m_archetypes[m_locations[entity.index].archetype]->GetMask();
+        Move(entity, mask | GetComponentMask<T>());
+        Assign(entity, component);
+    }
+
+    template<typename T>
+    void Remove(const Entity entity) {
+        if (!IsAlive(entity))
+            return;
+        const ComponentMask mask = m_archetypes[m_locations[entity.index].archetype]->GetMask();
+        Move(entity, mask & ~GetComponentMask<T>());
+    }
+
+    // fn(Entity, Ts &...) for every entity that has all of Ts
+    template<typename... Ts, typename Fn>
+    void ForEach(Fn &&fn) const {
+        const ComponentMask mask = GetComponentMask<Ts...>();
+        for (const auto &pArchetype: m_archetypes) {
+            if ((pArchetype->GetMask() & mask) != mask)
+                continue;
+            for (size_t chunk = 0; chunk < pArchetype->GetChunkCount(); ++chunk)
+                ForEachInChunk<Ts...>(*pArchetype, chunk, fn);
+        }
+    }
+
+    // Like ForEach, chunks are spread over the job system; fn must only touch the entity it is given
+    template<typename... Ts, typename Fn>
+    void ParallelForEach(JobSystem &jobSystem, Fn &&fn) const {
+        const ComponentMask mask = GetComponentMask<Ts...>();
+        std::vector<std::pair<const Archetype *, size_t>> chunks;
+        for (const auto &pArchetype: m_archetypes) {
+            if ((pArchetype->GetMask() & mask) != mask)
+                continue;
+            for (size_t chunk = 0; chunk < pArchetype->GetChunkCount(); ++chunk)
+                chunks.emplace_back(pArchetype.get(), chunk);
+        }
+        // A single chunk is not worth the hand-off
+        if (chunks.size() <= 1) {
+            for (const auto &[pArchetype, chunk]: chunks)
+                ForEachInChunk<Ts...>(*pArchetype, chunk, fn);
+            return;
+        }
+        const auto *pChunks = chunks.data();
+        jobSystem.ParallelFor(static_cast<uint32_t>(chunks.size()), 1, [pChunks, &fn](uint32_t begin, uint32_t end) {
+            for (uint32_t i = begin; i < end; ++i)
+                ForEachInChunk<Ts...>(*pChunks[i].first, pChunks[i].second, fn);
+        });
+    }
+
+    template<typename... Ts>
+    size_t Count() const {
+        const ComponentMask mask = GetComponentMask<Ts...>();
+        size_t count = 0;
+        for (const auto &pArchetype: m_archetypes) {
+            if ((pArchetype->GetMask() & mask) == mask)
+                count += pArchetype->GetSize();
+        }
+        return count;
+    }
+
+    size_t GetEntityCount() const { return m_entityCount; }
+    size_t GetArchetypeCount() const { return m_archetypes.size(); }
+
+private:
+    struct Location {
+        uint32_t archetype = 0;
+        uint32_t row = 0;
+        uint32_t generation = 0;
+        bool alive = false;
+    };
+
+    template<typename... Ts, typename Fn>
+    static void ForEachInChunk(const Archetype &archetype, const size_t chunk, Fn &fn) {
+        const uint32_t size = archetype.GetChunkSize(chunk);
+        const Entity *pEntities = archetype.GetEntities(chunk);
+        const auto arrays = std::make_tuple(archetype.GetArray<Ts>(chunk)...);
+        for (uint32_t i = 0; i < size; ++i)
+            std::apply([&](Ts *... pArrays) { fn(pEntities[i], pArrays[i]...); }, arrays);
+    }
+
+    template<typename T>
+    void Assign(const Entity entity, const T &component) {
+        *Get<T>(entity) = component;
+    }
+
+    Entity AllocateEntity();
+    uint32_t GetOrCreateArchetype(ComponentMask mask);
+    void Place(Entity entity, uint32_t archetype);
+    // Removes the row, fixing up the location of the entity moved into it
+    void Unplace(uint32_t archetype, uint32_t row);
+    // Copies the components both archetypes have, the new ones are left uninitialized
+    void Move(Entity entity, ComponentMask mask);
+
+    std::vector<Location> m_locations;
+    std::vector<uint32_t> m_freeIndices;
+    size_t m_entityCount = 0;
+
+    std::vector<std::unique_ptr<Archetype>> m_archetypes;
+    std::unordered_map<ComponentMask, uint32_t> m_archetypeIndices;
+};
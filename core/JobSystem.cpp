@@ -0,0 +1,134 @@
+#include "core/JobSystem.h"
+
+
+namespace {
+    thread_local int t_workerIndex = -1;
+}
+
+JobSystem::JobSystem(unsigned threadCount) {
+    if (threadCount == 0)
+        threadCount = std::max(1u, std::thread::hardware_concurrency() - 1);
+
+    m_queues.reserve(threadCount);
+    for (unsigned i = 0; i < threadCount; ++i)
+        m_queues.push_back(std::make_unique<WorkerQueue>());
+
+    m_threads.reserve(threadCount);
+    for (unsigned i = 0; i < threadCount; ++i)
+        m_threads.emplace_back(&JobSystem::WorkerMain, this, i);
+}
+
+JobSystem::~JobSystem() {
+    WaitIdle();
+    {
+        std::lock_guard lock(m_sleepMutex);
+        m_stop = true;
+    }
+    m_wakeCondition.notify_all();
+    for (auto &thread: m_threads)
+        thread.join();
+}
+
+int JobSystem::GetWorkerIndex() {
+    return t_workerIndex;
+}
+
+void JobSystem::Submit(Job job) {
+    const int worker = t_workerIndex;
+    const unsigned index = worker >= 0
+                               ? static_cast<unsigned>(worker)
+                               : m_nextQueue.fetch_add(1, std::memory_order_relaxed) % m_queues.size();
+
+    m_pending.fetch_add(1, std::memory_order_relaxed);
+    {
+        std::lock_guard lock(m_queues[index]->mutex);
+        m_queues[index]->jobs.push_back(std::move(job));
+    }
+    m_queued.fetch_add(1, std::memory_order_release);
+
+    // Taking the lock orders this notify after a worker's predicate check, so the wakeup can't be lost
+    { std::lock_guard lock(m_sleepMutex); }
+    m_wakeCondition.notify_one();
+}
+
+void JobSystem::Submit(Job job, JobCounter &counter) {
+    counter.m_count.fetch_add(1, std::memory_order_relaxed);
+    Submit([job = std::move(job), &counter] {
+        job();
+        counter.m_count.fetch_sub(1, std::memory_order_release);
+    });
+}
+
+void JobSystem::Wait(const JobCounter &counter) {
+    const unsigned index = t_workerIndex >= 0 ? static_cast<unsigned>(t_workerIndex) : 0;
+    while (!counter.IsDone()) {
+        if (!TryRunOne(index))
+            std::this_thread::yield();
+    }
+}
+
+bool JobSystem::TryPop(const unsigned index, Job &job) {
+    auto &queue = *m_queues[index];
+    std::lock_guard lock(queue.mutex);
+    if (queue.jobs.empty())
+        return false;
+    job = std::move(queue.jobs.back());
+    queue.jobs.pop_back();
+    return true;
+}
+
+bool JobSystem::TrySteal(const unsigned thief, Job &job) {
+    const auto count = static_cast<unsigned>(m_queues.size());
+    for (unsigned i = 1; i < count; ++i) {
+        auto &queue = *m_queues[(thief + i) % count];
+        std::unique_lock lock(queue.mutex, std::try_to_lock);
+        if (!lock.owns_lock() || queue.jobs.empty())
+            continue;
+        job = std::move(queue.jobs.front());
+        queue.jobs.pop_front();
+        return true;
+    }
+    return false;
+}
+
+bool JobSystem::TryRunOne(const unsigned index) {
+    Job job;
+    if (!TryPop(index, job) && !TrySteal(index, job))
+        return false;
+
+    m_queued.fetch_sub(1, std::memory_order_relaxed);
+    job();
+    if (m_pending.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        { std::lock_guard lock(m_sleepMutex); }
+        m_idleCondition.notify_all();
+    }
+    return true;
+}
+
+void JobSystem::WorkerMain(const unsigned index) {
+    t_workerIndex = static_cast<int>(index);
+    while (true) {
+        if (TryRunOne(index))
+            continue;
+
+        std::unique_lock lock(m_sleepMutex);
+        m_wakeCondition.wait(lock, [this] {
+            return m_stop || m_queued.load(std::memory_order_acquire) > 0;
+        });
+        if (m_stop)
+            return;
+    }
+}
+
+void JobSystem::WaitIdle() {
+    // Outside threads steal starting from queue 0, workers start from their own
+    const unsigned index = t_workerIndex >= 0 ? static_cast<unsigned>(t_workerIndex) : 0;
+    while (m_pending.load(std::memory_order_acquire) > 0) {
+        if (TryRunOne(index))
+            continue;
+        std::unique_lock lock(m_sleepMutex);
+        m_idleCondition.wait(lock, [this] {
+            return m_pending.load(std::memory_order_acquire) == 0 || m_queued.load(std::memory_order_acquire) > 0;
+        });
+    }
+}
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Counts outstanding jobs of a group, so a caller can wait for just that group
+class JobCounter {
+public:
+    bool IsDone() const { return m_count.load(std::memory_order_acquire) == 0; }
+
+private:
+    friend class JobSystem;
+    std::atomic<int> m_count{0};
+};
+
+// Work-stealing thread pool.
+// Every worker owns a deque: it pushes and pops its own jobs at the back (LIFO, cache-warm)
+// and steals from the front of the other workers' deques when it runs dry.
+// Jobs submitted from non-worker threads are spread round-robin.
+class JobSystem {
+public:
+    using Job = std::function<void()>;
+
+    // 0 threads means one per hardware thread, minus the main thread
+    explicit JobSystem(unsigned threadCount = 0);
+    ~JobSystem();
+
+    JobSystem(const JobSystem &) = delete;
+    JobSystem &operator=(const JobSystem &) = delete;
+
+    void Submit(Job job);
+    void Submit(Job job, JobCounter &counter);
+
+    // Block until the jobs are done, the calling thread runs queued jobs meanwhile
+    void Wait(const JobCounter &counter);
+    void WaitIdle();
+
+    // Runs fn(begin, end) over [0, count) split into ranges of at most batchSize, returns when all are done
+    template<typename Fn>
+    void ParallelFor(const uint32_t count, const uint32_t batchSize, Fn &&fn) {
+        JobCounter counter;
+        for (uint32_t begin = 0; begin < count; begin += batchSize) {
+            const uint32_t end = std::min(count, begin + batchSize);
+            Submit([&fn, begin, end] { fn(begin, end); }, counter);
+        }
+        Wait(counter);
+    }
+
+    unsigned GetThreadCount() const { return static_cast<unsigned>(m_threads.size()); }
+
+    // Index of the calling worker thread, -1 when called from any other thread
+    static int GetWorkerIndex();
+
+private:
+    struct WorkerQueue {
+        std::mutex mutex;
+        std::deque<Job> jobs;
+    };
+
+    void WorkerMain(unsigned index);
+    bool TryPop(unsigned index, Job &job);
+    bool TrySteal(unsigned thief, Job &job);
+    bool TryRunOne(unsigned index);
+
+    std::vector<std::unique_ptr<WorkerQueue>> m_queues;
+    std::vector<std::thread> m_threads;
+
+    std::atomic<unsigned> m_nextQueue{0};
+    std::atomic<int> m_queued{0};   // jobs sitting in queues
+    std::atomic<int> m_pending{0};  // queued + running
+
+    std::mutex m_sleepMutex;
+    std::condition_variable m_wakeCondition;
+    std::condition_variable m_idleCondition;
+    bool m_stop = false;
+};
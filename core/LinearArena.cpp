@@ -0,0 +1,98 @@
+#include "core/LinearArena.h"
+
+#include <algorithm>
+#include <mutex>
+
+namespace {
+    struct ArenaRegistry {
+        std::mutex mutex;
+        std::vector<const LinearArena *> arenas;
+    };
+
+    // Never destroyed, threads may exit after static destruction began
+    ArenaRegistry &GetRegistry() {
+        static auto *pRegistry = new ArenaRegistry;
+        return *pRegistry;
+    }
+
+    struct RegisteredArena {
+        LinearArena arena;
+
+        RegisteredArena() {
+            ArenaRegistry &registry = GetRegistry();
+            std::lock_guard lock(registry.mutex);
+            registry.arenas.push_back(&arena);
+        }
+
+        ~RegisteredArena() {
+            ArenaRegistry &registry = GetRegistry();
+            std::lock_guard lock(registry.mutex);
+            std::erase(registry.arenas, &arena);
+        }
+    };
+}
+
+LinearArena::LinearArena(const size_t blockSize) : m_blockSize(blockSize) {
+}
+
+void LinearArena::AddBlock(const size_t size) {
+    m_blocks.push_back({std::make_unique<std::byte[]>(size), size});
+    m_capacity.fetch_add(size, std::memory_order_relaxed);
+}
+
+void *LinearArena::Allocate(const size_t size, const size_t alignment) {
+    for (;; ++m_block, m_offset = 0) {
+        if (m_block == m_blocks.size())
+            AddBlock(std::max(m_blockSize, size + alignment));
+
+        const Block &block = m_blocks[m_block];
+        const auto base = reinterpret_cast<uintptr_t>(block.pData.get());
+        const size_t offset = (base + m_offset + alignment - 1) / alignment * alignment - base;
+        if (offset + size <= block.size) {
+            m_offset = offset + size;
+            UpdateUsed();
+            return block.pData.get() + offset;
+        }
+    }
+}
+
+void LinearArena::Rewind(const Marker marker) {
+    m_block = marker.block;
+    m_offset = marker.offset;
+    // Nothing is live any more, the blocks can be merged
+    if (m_block == 0 && m_offset == 0 && m_blocks.size() > 1) {
+        const size_t total = m_capacity.load(std::memory_order_relaxed);
+        m_blocks.clear();
+        m_capacity.store(0, std::memory_order_relaxed);
+        AddBlock(total);
+    }
+    UpdateUsed();
+}
+
+void LinearArena::UpdateUsed() {
+    // Blocks before the current one count as full, whatever they had left at their end
+    size_t used = m_offset;
+    for (size_t i = 0; i < m_block && i < m_blocks.size(); ++i)
+        used += m_blocks[i].size;
+    m_used.store(used, std::memory_order_relaxed);
+    if (used > m_peak.load(std::memory_order_relaxed))
+        m_peak.store(used, std::memory_order_relaxed);
+}
+
+LinearArena &GetThreadArena() {
+    thread_local RegisteredArena registered;
+    return registered.arena;
+}
+
+ThreadArenaStats GetThreadArenaStats() {
+    ArenaRegistry &registry = GetRegistry();
+    std::lock_guard lock(registry.mutex);
+    ThreadArenaStats stats;
+    for (const LinearArena *pArena: registry.arenas) {
+        ++stats.threads;
+        stats.used += pArena->GetUsed();
+        stats.capacity += pArena->GetCapacity();
+        stats.peak = std::max(stats.peak, pArena->GetPeak());
+    }
+    return stats;
+}
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <memory_resource>
+#include <vector>
+
+// Bump allocator for scratch memory that dies all at once, at the end of a job or a frame.
+// Memory comes from blocks that are kept across resets; a reset back to the start merges them into one block of
+// their total size, so after warming up every job or frame runs out of a single block and never touches the heap.
+// Deallocation is a no-op. Usable as a std::pmr::memory_resource, e.g. for std::pmr::vector.
+// Not thread-safe, every thread has its own arena (GetThreadArena()); the stats may be read from any thread.
+class LinearArena final : public std::pmr::memory_resource {
+public:
+    struct Marker {
+        size_t block = 0;
+        size_t offset = 0;
+    };
+
+    // Rewinds the arena to where it was when the scope began; scopes nest
+    class Scope {
+    public:
+        explicit Scope(LinearArena &arena) : m_arena(arena), m_marker(arena.GetMarker()) {}
+        ~Scope() { m_arena.Rewind(m_marker); }
+
+        Scope(const Scope &) = delete;
+        Scope &operator=(const Scope &) = delete;
+
+    private:
+        LinearArena &m_arena;
+        Marker m_marker;
+    };
+
+    explicit LinearArena(size_t blockSize = 256 << 10);
+
+    LinearArena(const LinearArena &) = delete;
+    LinearArena &operator=(const LinearArena &) = delete;
+
+    void *Allocate(size_t size, size_t alignment = alignof(std::max_align_t));
+    // Uninitialized storage for count objects
+    template<typename T>
+    T *AllocateArray(const size_t count) { return static_cast<T *>(Allocate(count * sizeof(T), alignof(T))); }
+
+    Marker GetMarker() const { return {m_block, m_offset}; }
+    // Everything allocated after the marker is released
+    void Rewind(Marker marker);
+    void Reset() { Rewind({}); }
+
+    size_t GetUsed() const { return m_used.load(std::memory_order_relaxed); }
+    size_t GetPeak() const { return m_peak.load(std::memory_order_relaxed); }
+    size_t GetCapacity() const { return m_capacity.load(std::memory_order_relaxed); }
+
+private:
+    struct Block {
+        std::unique_ptr<std::byte[]> pData;
+        size_t size = 0;
+    };
+
+    void *do_allocate(size_t bytes, size_t alignment) override { return Allocate(bytes, alignment); }
+    void do_deallocate(void *, size_t, size_t) override {}
+    bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override { return this == &other; }
+
+    void AddBlock(size_t size);
+    void UpdateUsed();
+
+    size_t m_blockSize;
+    std::vector<Block> m_blocks;
+    // Position of the next allocation
+    size_t m_block = 0;
+    size_t m_offset = 0;
+
+    std::atomic<size_t> m_used{0};
+    std::atomic<size_t> m_peak{0};
+    std::atomic<size_t> m_capacity{0};
+};
+
+// Arena of the calling thread, e.g. for a job's scratch memory under a LinearArena::Scope.
+// The render thread resets its own once per frame, allocations without a scope on it live until then
+LinearArena &GetThreadArena();
+
+struct ThreadArenaStats {
+    uint32_t threads = 0;
+    // Summed over every thread
+    size_t used = 0;
+    size_t capacity = 0;
+    // Highest usage any one thread has reached
+    size_t peak = 0;
+};
+
+ThreadArenaStats GetThreadArenaStats();
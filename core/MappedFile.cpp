@@ -0,0 +1,157 @@
+#include "core/MappedFile.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::~MappedFile() {
+    Close();
+}
+
+#ifdef _WIN32
+
+bool MappedFile::Open(const std::string &path) {
+    Close();
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, nullptr, OPEN_ALWAYS,
+                              FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+        return false;
+    m_file = file;
+    return Remap();
+}
+
+void MappedFile::Close() {
+    Unmap();
+    if (m_file) {
+        CloseHandle(m_file);
+        m_file = nullptr;
+    }
+}
+
+bool MappedFile::IsOpen() const {
+    return m_file != nullptr;
+}
+
+bool MappedFile::Write(const uint64_t offset, const void *data, const size_t size) {
+    OVERLAPPED overlapped{};
+    overlapped.Offset = static_cast<DWORD>(offset);
+    overlapped.OffsetHigh = static_cast<DWORD>(offset >> 32);
+    DWORD written = 0;
+    return WriteFile(m_file, data, static_cast<DWORD>(size), &written, &overlapped) && written == size;
+}
+
+bool MappedFile::Remap() {
+    Unmap();
+    const uint64_t size = GetFileSize();
+    // Empty files cannot be mapped
+    if (size == 0)
+        return true;
+    m_mapping = CreateFileMappingA(m_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (!m_mapping)
+        return false;
+    m_pData = static_cast<const uint8_t *>(MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0));
+    if (!m_pData) {
+        Unmap();
+        return false;
+    }
+    m_mappedSize = size;
+    return true;
+}
+
+void MappedFile::Unmap() {
+    if (m_pData)
+        UnmapViewOfFile(m_pData);
+    if (m_mapping)
+        CloseHandle(m_mapping);
+    m_pData = nullptr;
+    m_mapping = nullptr;
+    m_mappedSize = 0;
+}
+
+void MappedFile::Sync() {
+    FlushFileBuffers(m_file);
+}
+
+uint64_t MappedFile::GetFileSize() const {
+    LARGE_INTEGER size{};
+    if (!m_file || !GetFileSizeEx(m_file, &size))
+        return 0;
+    return static_cast<uint64_t>(size.QuadPart);
+}
+
+#else
+
+bool MappedFile::Open(const std::string &path) {
+    Close();
+    m_fd = open(path.c_str(), O_RDWR | O_CREAT, 0644);
+    if (m_fd < 0)
+        return false;
+    return Remap();
+}
+
+void MappedFile::Close() {
+    Unmap();
+    if (m_fd >= 0) {
+        close(m_fd);
+        m_fd = -1;
+    }
+}
+
+bool MappedFile::IsOpen() const {
+    return m_fd >= 0;
+}
+
+bool MappedFile::Write(uint64_t offset, const void *data, size_t size) {
+    const auto *bytes = static_cast<const uint8_t *>(data);
+    while (size > 0) {
+        const ssize_t written = pwrite(m_fd, bytes, size, static_cast<off_t>(offset));
+        if (written <= 0)
+            return false;
+        bytes += written;
+        offset += static_cast<uint64_t>(written);
+        size -= static_cast<size_t>(written);
+    }
+    return true;
+}
+
+bool MappedFile::Remap() {
+    Unmap();
+    const uint64_t size = GetFileSize();
+    if (size == 0)
+        return true;
+    void *pData = mmap(nullptr, size, PROT_READ, MAP_SHARED, m_fd, 0);
+    if (pData == MAP_FAILED)
+        return false;
+    m_pData = static_cast<const uint8_t *>(pData);
+    m_mappedSize = size;
+    return true;
+}
+
+void MappedFile::Unmap() {
+    if (m_pData)
+        munmap(const_cast<uint8_t *>(m_pData), m_mappedSize);
+    m_pData = nullptr;
+    m_mappedSize = 0;
+}
+
+void MappedFile::Sync() {
+#ifdef __APPLE__
+    fsync(m_fd);
+#else
+    fdatasync(m_fd);
+#endif
+}
+
+uint64_t MappedFile::GetFileSize() const {
+    struct stat info{};
+    if (m_fd < 0 || fstat(m_fd, &info) != 0)
+        return 0;
+    return static_cast<uint64_t>(info.st_size);
+}
+
+#endif
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// File opened for positional writes and mapped read-only into memory.
+// Reads go straight through the mapping; writes use pwrite/WriteFile, which the OS keeps coherent with it.
+// The mapping covers the file size at the last Remap(), so call it after writes that grow the file.
+// Not synchronized: callers keep writes to a region of the file apart from reads of it.
+class MappedFile {
+public:
+    MappedFile() = default;
+    ~MappedFile();
+
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    // Creates the file when missing
+    bool Open(const std::string &path);
+    void Close();
+    bool IsOpen() const;
+
+    bool Write(uint64_t offset, const void *data, size_t size);
+    // Maps the whole file as it is now
+    bool Remap();
+    // Makes written data durable
+    void Sync();
+
+    const uint8_t *GetData() const { return m_pData; }
+    // Size of the mapping, not of the file
+    uint64_t GetMappedSize() const { return m_mappedSize; }
+    uint64_t GetFileSize() const;
+
+private:
+    void Unmap();
+
+#ifdef _WIN32
+    void *m_file = nullptr;
+    void *m_mapping = nullptr;
+#else
+    int m_fd = -1;
+#endif
+    const uint8_t *m_pData = nullptr;
+    uint64_t m_mappedSize = 0;
+};
@@ -0,0 +1,109 @@
+#include "core/ObjectPool.h"
+
+#include <algorithm>
+
+namespace {
+    struct PoolRegistry {
+        std::mutex mutex;
+        std::vector<const FixedPool *> pools;
+    };
+
+    // Never destroyed, pools owned by other statics may outlive it otherwise
+    PoolRegistry &GetRegistry() {
+        static auto *pRegistry = new PoolRegistry;
+        return *pRegistry;
+    }
+}
+
+FixedPool::FixedPool(const char *name, const size_t slotSize, const size_t alignment, const size_t slotsPerBlock)
+    : m_name(name), m_alignment(std::max(alignment, alignof(FreeSlot))), m_slotsPerBlock(std::max<size_t>(1, slotsPerBlock)) {
+    // Every slot is aligned and can hold a free list link
+    m_slotSize = (std::max(slotSize, sizeof(FreeSlot)) + m_alignment - 1) / m_alignment * m_alignment;
+
+    PoolRegistry &registry = GetRegistry();
+    std::lock_guard lock(registry.mutex);
+    registry.pools.push_back(this);
+}
+
+FixedPool::~FixedPool() {
+    {
+        PoolRegistry &registry = GetRegistry();
+        std::lock_guard lock(registry.mutex);
+        std::erase(registry.pools, this);
+    }
+    for (void *pBlock: m_blocks)
+        ::operator delete(pBlock, std::align_val_t{m_alignment});
+}
+
+void FixedPool::AddBlock() {
+    auto *pBlock = static_cast<std::byte *>(::operator new(m_slotSize * m_slotsPerBlock, std::align_val_t{m_alignment}));
+    m_blocks.push_back(pBlock);
+    // Linked back to front, so slots are handed out in address order
+    for (size_t i = m_slotsPerBlock; i-- > 0;) {
+        auto *pSlot = reinterpret_cast<FreeSlot *>(pBlock + i * m_slotSize);
+        pSlot->pNext = m_pFree;
+        m_pFree = pSlot;
+    }
+}
+
+void *FixedPool::Allocate() {
+    std::lock_guard lock(m_mutex);
+    if (!m_pFree)
+        AddBlock();
+    FreeSlot *pSlot = m_pFree;
+    m_pFree = pSlot->pNext;
+    m_peak = std::max(m_peak, ++m_live);
+    return pSlot;
+}
+
+void FixedPool::Free(void *pSlot) {
+    if (!pSlot)
+        return;
+    std::lock_guard lock(m_mutex);
+    auto *pFree = static_cast<FreeSlot *>(pSlot);
+    pFree->pNext = m_pFree;
+    m_pFree = pFree;
+    --m_live;
+}
+
+FixedPool::Stats FixedPool::GetStats() const {
+    std::lock_guard lock(m_mutex);
+    return {m_name, m_slotSize, m_live, m_peak, m_blocks.size() * m_slotsPerBlock};
+}
+
+std::vector<FixedPool::Stats> GetFixedPoolStats() {
+    PoolRegistry &registry = GetRegistry();
+    std::lock_guard lock(registry.mutex);
+    std::vector<FixedPool::Stats> stats;
+    for (const FixedPool *pPool: registry.pools)
+        stats.push_back(pPool->GetStats());
+    return stats;
+}
+
+SizeClassPool::SizeClassPool(const char *name, const size_t maxSize, const size_t bytesPerBlock,
+                             std::pmr::memory_resource *pUpstream)
+    : m_maxSize(maxSize), m_pUpstream(pUpstream) {
+    for (size_t size = MIN_SIZE; size <= maxSize; size *= 2)
+        m_pools.push_back(std::make_unique<FixedPool>(name, size, alignof(std::max_align_t), bytesPerBlock / size));
+}
+
+FixedPool *SizeClassPool::GetPool(const size_t bytes, const size_t alignment) const {
+    if (bytes > m_maxSize || alignment > alignof(std::max_align_t))
+        return nullptr;
+    size_t index = 0;
+    while ((MIN_SIZE << index) < bytes)
+        ++index;
+    return index < m_pools.size() ? m_pools[index].get() : nullptr;
+}
+
+void *SizeClassPool::do_allocate(const size_t bytes, const size_t alignment) {
+    FixedPool *pPool = GetPool(bytes, alignment);
+    return pPool ? pPool->Allocate() : m_pUpstream->allocate(bytes, alignment);
+}
+
+void SizeClassPool::do_deallocate(void *p, const size_t bytes, const size_t alignment) {
+    if (FixedPool *pPool = GetPool(bytes, alignment))
+        pPool->Free(p);
+    else
+        m_pUpstream->deallocate(p, bytes, alignment);
+}
@@ -0,0 +1,111 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <memory_resource>
+#include <mutex>
+#include <new>
+#include <utility>
+#include <vector>
+
+// Allocator of fixed-size slots for objects that come and go all session long.
+// Slots are carved from blocks of slotsPerBlock; freed slots go on a free list and are handed out again before
+// another block is allocated. Blocks are only returned when the pool is destroyed, so memory stays at the peak
+// instead of churning and fragmenting the heap. Thread-safe.
+class FixedPool {
+public:
+    struct Stats {
+        const char *name = "";
+        size_t slotSize = 0;
+        size_t live = 0;
+        size_t peak = 0;
+        size_t capacity = 0;
+    };
+
+    FixedPool(const char *name, size_t slotSize, size_t alignment, size_t slotsPerBlock);
+    ~FixedPool();
+
+    FixedPool(const FixedPool &) = delete;
+    FixedPool &operator=(const FixedPool &) = delete;
+
+    void *Allocate();
+    void Free(void *pSlot);
+
+    Stats GetStats() const;
+
+private:
+    struct FreeSlot {
+        FreeSlot *pNext;
+    };
+
+    void AddBlock();
+
+    const char *m_name;
+    size_t m_slotSize;
+    size_t m_alignment;
+    size_t m_slotsPerBlock;
+
+    mutable std::mutex m_mutex;
+    std::vector<void *> m_blocks;
+    FreeSlot *m_pFree = nullptr;
+    size_t m_live = 0;
+    size_t m_peak = 0;
+};
+
+// Stats of every pool alive, in creation order
+std::vector<FixedPool::Stats> GetFixedPoolStats();
+
+// FixedPool holding objects of one type
+template<typename T>
+class ObjectPool {
+public:
+    explicit ObjectPool(const char *name, const size_t slotsPerBlock = 64)
+        : m_pool(name, sizeof(T), alignof(T), slotsPerBlock) {}
+
+    template<typename... Args>
+    T *Create(Args &&... args) {
+        void *pSlot = m_pool.Allocate();
+        try {
+            return new(pSlot) T(std::forward<Args>(args)...);
+        } catch (...) {
+            m_pool.Free(pSlot);
+            throw;
+        }
+    }
+
+    void Destroy(T *pObject) {
+        if (!pObject)
+            return;
+        pObject->~T();
+        m_pool.Free(pObject);
+    }
+
+    FixedPool::Stats GetStats() const { return m_pool.GetStats(); }
+
+private:
+    FixedPool m_pool;
+};
+
+// memory_resource over FixedPools of power-of-two slot sizes, for containers whose storage comes and goes with
+// the objects that own them. Requests are rounded up to the next size class; ones over maxSize or over-aligned
+// go to the upstream resource. Thread-safe; every size class reports its stats under name.
+class SizeClassPool : public std::pmr::memory_resource {
+public:
+    SizeClassPool(const char *name, size_t maxSize, size_t bytesPerBlock,
+                  std::pmr::memory_resource *pUpstream = std::pmr::new_delete_resource());
+
+private:
+    static constexpr size_t MIN_SIZE = 16;
+
+    FixedPool *GetPool(size_t bytes, size_t alignment) const;
+
+    void *do_allocate(size_t bytes, size_t alignment) override;
+    void do_deallocate(void *p, size_t bytes, size_t alignment) override;
+    bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override { return this == &other; }
+
+    size_t m_maxSize;
+    std::pmr::memory_resource *m_pUpstream;
+    // MIN_SIZE << i
+    std::vector<std::unique_ptr<FixedPool>> m_pools;
+};
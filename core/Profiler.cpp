@@ -0,0 +1,155 @@
+#include "core/Profiler.h"
+
+#include <algorithm>
+#include <cstring>
+#include <functional>
+#include <thread>
+
+#include <spdlog/spdlog.h>
+#include <spdlog/sinks/basic_file_sink.h>
+
+namespace {
+    // GPU events get their own row in the trace
+    constexpr uint32_t GPU_TRACE_THREAD = 0;
+
+    uint32_t CurrentTraceThread() {
+        return static_cast<uint32_t>(std::hash<std::thread::id>{}(std::this_thread::get_id()) % 100000) + 1;
+    }
+}
+
+Profiler &Profiler::Get() {
+    static Profiler profiler;
+    return profiler;
+}
+
+uint32_t Profiler::RegisterScope(const char *name, const ProfileTrack track) {
+    std::lock_guard lock(m_registerMutex);
+    const uint32_t count = m_scopeCount.load(std::memory_order_relaxed);
+    for (uint32_t i = 0; i < count; ++i) {
+        if (std::strcmp(m_scopes[i].name, name) == 0)
+            return i;
+    }
+    if (count == MAX_SCOPES) {
+        spdlog::error("Profiler: more than {} scopes, '{}' is not timed", MAX_SCOPES, name);
+        return INVALID_SCOPE;
+    }
+    m_scopes[count].name = name;
+    m_scopes[count].track = track;
+    m_scopeCount.store(count + 1, std::memory_order_release);
+    return count;
+}
+
+void Profiler::BeginFrame() {
+    m_frameStart = Clock::now();
+}
+
+void Profiler::EndFrame() {
+    const auto frameTime = std::chrono::duration<float, std::milli>(Clock::now() - m_frameStart).count();
+    m_frameHistory[m_historyCursor] = frameTime;
+
+    const uint32_t count = GetScopeCount();
+    for (uint32_t i = 0; i < count; ++i) {
+        const uint64_t ns = m_scopes[i].frameNs.exchange(0, std::memory_order_relaxed);
+        m_scopes[i].history[m_historyCursor] = static_cast<float>(ns) * 1e-6f;
+    }
+
+    m_historyCursor = (m_historyCursor + 1) % HISTORY_FRAMES;
+    m_historyCount = std::min(m_historyCount + 1, HISTORY_FRAMES);
+    ++m_frameNumber;
+
+    if (IsCapturing() && --m_captureFramesLeft == 0) {
+        m_capturing.store(false, std::memory_order_relaxed);
+        WriteTrace();
+    }
+}
+
+void Profiler::Record(const uint32_t scope, const Clock::time_point start, const Clock::time_point end) {
+    if (scope == INVALID_SCOPE)
+        return;
+    const auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+    m_scopes[scope].frameNs.fetch_add(static_cast<uint64_t>(std::max<int64_t>(ns, 0)), std::memory_order_relaxed);
+
+    if (!IsCapturing())
+        return;
+    TraceEvent event{};
+    event.scope = scope;
+    event.thread = m_scopes[scope].track == PROFILE_TRACK_GPU ? GPU_TRACE_THREAD : CurrentTraceThread();
+    event.startUs = std::chrono::duration_cast<std::chrono::microseconds>(start - m_epoch).count();
+    event.durationUs = std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
+    std::lock_guard lock(m_traceMutex);
+    m_traceEvents.push_back(event);
+}
+
+void Profiler::CaptureTrace(const uint32_t frameCount, const std::string &path) {
+    if (IsCapturing() || frameCount == 0)
+        return;
+    {
+        std::lock_guard lock(m_traceMutex);
+        m_traceEvents.clear();
+    }
+    m_tracePath = path;
+    m_captureFramesLeft = frameCount;
+    m_capturing.store(true, std::memory_order_relaxed);
+    spdlog::info("Profiler: capturing {} frames to {}", frameCount, path);
+}
+
+Profiler::Stats Profiler::GetStats(const uint32_t scope) const {
+    return ComputeStats(m_scopes[scope].history);
+}
+
+Profiler::Stats Profiler::GetFrameStats() const {
+    return ComputeStats(m_frameHistory);
+}
+
+Profiler::Stats Profiler::ComputeStats(const std::array<float, HISTORY_FRAMES> &history) const {
+    Stats stats;
+    if (m_historyCount == 0)
+        return stats;
+
+    stats.last = history[(m_historyCursor + HISTORY_FRAMES - 1) % HISTORY_FRAMES];
+
+    // The ring is only partially filled during the first frames
+    std::array<float, HISTORY_FRAMES> sorted{};
+    std::copy_n(history.begin(), m_historyCount, sorted.begin());
+    const auto end = sorted.begin() + m_historyCount;
+    const auto p50 = sorted.begin() + m_historyCount / 2;
+    const auto p99 = sorted.begin() + std::min(m_historyCount - 1, m_historyCount * 99 / 100);
+    std::nth_element(sorted.begin(), p50, end);
+    stats.p50 = *p50;
+    std::nth_element(sorted.begin(), p99, end);
+    stats.p99 = *p99;
+    stats.max = *std::max_element(sorted.begin(), end);
+    return stats;
+}
+
+void Profiler::WriteTrace() {
+    std::vector<TraceEvent> events;
+    {
+        std::lock_guard lock(m_traceMutex);
+        events.swap(m_traceEvents);
+    }
+
+    std::shared_ptr<spdlog::logger> trace;
+    try {
+        trace = spdlog::basic_logger_st("trace", m_tracePath, true);
+    } catch (const spdlog::spdlog_ex &e) {
+        spdlog::error("Profiler: failed to open {}: {}", m_tracePath, e.what());
+        return;
+    }
+    trace->set_pattern("%v");
+
+    trace->info("{}", "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+    trace->info("{{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":{},\"args\":{{\"name\":\"GPU\"}}}}",
+                GPU_TRACE_THREAD);
+    for (const TraceEvent &event: events) {
+        const Scope &scope = m_scopes[event.scope];
+        trace->info(",{{\"name\":\"{}\",\"cat\":\"{}\",\"ph\":\"X\",\"ts\":{},\"dur\":{},\"pid\":0,\"tid\":{}}}",
+                    scope.name, scope.track == PROFILE_TRACK_GPU ? "gpu" : "cpu",
+                    event.startUs, event.durationUs, event.thread);
+    }
+    trace->info("{}", "]}");
+    trace->flush();
+    spdlog::drop("trace");
+
+    spdlog::info("Profiler: wrote {} events to {}", events.size(), m_tracePath);
+}
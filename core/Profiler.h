@@ -0,0 +1,117 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+enum ProfileTrack {
+    PROFILE_TRACK_CPU,
+    PROFILE_TRACK_GPU
+};
+
+// Frame timing profiler.
+// Scopes are registered once by name and accumulate their time per frame from any thread; EndFrame() moves the
+// totals into a fixed ring of frames which the percentile stats are computed over.
+// While a capture runs every sample is also kept as an event and written as Chrome trace JSON
+// (chrome://tracing, ui.perfetto.dev) once the capture ends.
+class Profiler {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    static constexpr uint32_t MAX_SCOPES = 64;
+    static constexpr uint32_t HISTORY_FRAMES = 256;
+    static constexpr uint32_t INVALID_SCOPE = ~0u;
+
+    // Milliseconds
+    struct Stats {
+        double last = 0.0;
+        double p50 = 0.0;
+        double p99 = 0.0;
+        double max = 0.0;
+    };
+
+    static Profiler &Get();
+
+    // Returns the existing id when the name is already registered
+    uint32_t RegisterScope(const char *name, ProfileTrack track = PROFILE_TRACK_CPU);
+
+    void BeginFrame();
+    void EndFrame();
+
+    // Thread-safe
+    void Record(uint32_t scope, Clock::time_point start, Clock::time_point end);
+
+    // Chrome trace of the next frameCount frames
+    void CaptureTrace(uint32_t frameCount, const std::string &path);
+    bool IsCapturing() const { return m_capturing.load(std::memory_order_relaxed); }
+
+    uint32_t GetScopeCount() const { return m_scopeCount.load(std::memory_order_acquire); }
+    const char *GetScopeName(uint32_t scope) const { return m_scopes[scope].name; }
+    ProfileTrack GetScopeTrack(uint32_t scope) const { return m_scopes[scope].track; }
+
+    Stats GetStats(uint32_t scope) const;
+    Stats GetFrameStats() const;
+    uint64_t GetFrameNumber() const { return m_frameNumber; }
+    Clock::time_point GetFrameStart() const { return m_frameStart; }
+
+private:
+    Profiler() = default;
+
+    struct Scope {
+        const char *name = nullptr;
+        ProfileTrack track = PROFILE_TRACK_CPU;
+        std::atomic<uint64_t> frameNs{0};
+        std::array<float, HISTORY_FRAMES> history{};
+    };
+
+    struct TraceEvent {
+        uint32_t scope;
+        uint32_t thread;
+        int64_t startUs;
+        int64_t durationUs;
+    };
+
+    Stats ComputeStats(const std::array<float, HISTORY_FRAMES> &history) const;
+    void WriteTrace();
+
+    std::array<Scope, MAX_SCOPES> m_scopes;
+    std::atomic<uint32_t> m_scopeCount{0};
+    std::mutex m_registerMutex;
+
+    std::array<float, HISTORY_FRAMES> m_frameHistory{};
+    uint32_t m_historyCursor = 0;
+    uint32_t m_historyCount = 0;
+    uint64_t m_frameNumber = 0;
+    Clock::time_point m_frameStart;
+    const Clock::time_point m_epoch = Clock::now();
+
+    std::atomic<bool> m_capturing{false};
+    uint32_t m_captureFramesLeft = 0;
+    std::string m_tracePath;
+    std::mutex m_traceMutex;
+    std::vector<TraceEvent> m_traceEvents;
+};
+
+class ProfileScope {
+public:
+    explicit ProfileScope(const uint32_t scope) : m_scope(scope), m_start(Profiler::Clock::now()) {}
+    ~ProfileScope() { Profiler::Get().Record(m_scope, m_start, Profiler::Clock::now()); }
+
+    ProfileScope(const ProfileScope &) = delete;
+    ProfileScope &operator=(const ProfileScope &) = delete;
+
+private:
+    uint32_t m_scope;
+    Profiler::Clock::time_point m_start;
+};
+
+#define PROFILE_CONCAT_IMPL(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_IMPL(a, b)
+// Times the rest of the enclosing block, name must be a string literal
+#define PROFILE_SCOPE(name)                                                                                  \
+    static const uint32_t PROFILE_CONCAT(s_profileScope, __LINE__) = Profiler::Get().RegisterScope(name);    \
+    const ProfileScope PROFILE_CONCAT(profileScope, __LINE__)(PROFILE_CONCAT(s_profileScope, __LINE__))
@@ -0,0 +1,89 @@
+#include "core/RangeAllocator.h"
+
+#include <cassert>
+
+RangeAllocator::RangeAllocator(const uint32_t capacity) {
+    Grow(capacity);
+}
+
+void RangeAllocator::AddFreeBlock(const uint32_t offset, const uint32_t size) {
+    m_freeByOffset.emplace(offset, size);
+    m_freeBySize.emplace(size, offset);
+}
+
+void RangeAllocator::RemoveFreeBlock(const std::map<uint32_t, uint32_t>::iterator it) {
+    auto [first, last] = m_freeBySize.equal_range(it->second);
+    for (; first != last; ++first) {
+        if (first->second == it->first) {
+            m_freeBySize.erase(first);
+            break;
+        }
+    }
+    m_freeByOffset.erase(it);
+}
+
+uint32_t RangeAllocator::TakeFromBlock(const std::map<uint32_t, uint32_t>::iterator it, const uint32_t size) {
+    const uint32_t offset = it->first, blockSize = it->second;
+    RemoveFreeBlock(it);
+    if (blockSize > size)
+        AddFreeBlock(offset + size, blockSize - size);
+    m_used += size;
+    return offset;
+}
+
+uint32_t RangeAllocator::Allocate(const uint32_t size) {
+    if (size == 0)
+        return INVALID_OFFSET;
+    const auto bySize = m_freeBySize.lower_bound(size);
+    if (bySize == m_freeBySize.end())
+        return INVALID_OFFSET;
+    return TakeFromBlock(m_freeByOffset.find(bySize->second), size);
+}
+
+uint32_t RangeAllocator::AllocateBelow(const uint32_t size, const uint32_t limit) {
+    if (size == 0)
+        return INVALID_OFFSET;
+    for (auto it = m_freeByOffset.begin(); it != m_freeByOffset.end() && it->first + size <= limit; ++it) {
+        if (it->second >= size)
+            return TakeFromBlock(it, size);
+    }
+    return INVALID_OFFSET;
+}
+
+void RangeAllocator::Free(uint32_t offset, uint32_t size) {
+    if (size == 0)
+        return;
+    assert(offset + size <= m_capacity);
+    m_used -= size;
+
+    // Merge with the following and the preceding free block
+    auto next = m_freeByOffset.lower_bound(offset);
+    if (next != m_freeByOffset.end() && next->first == offset + size) {
+        size += next->second;
+        RemoveFreeBlock(next);
+        next = m_freeByOffset.lower_bound(offset);
+    }
+    if (next != m_freeByOffset.begin()) {
+        const auto prev = std::prev(next);
+        if (prev->first + prev->second == offset) {
+            offset = prev->first;
+            size += prev->second;
+            RemoveFreeBlock(prev);
+        }
+    }
+    AddFreeBlock(offset, size);
+}
+
+void RangeAllocator::Grow(const uint32_t newCapacity) {
+    if (newCapacity <= m_capacity)
+        return;
+    const uint32_t oldCapacity = m_capacity;
+    m_capacity = newCapacity;
+    // Free() counts the new space as released, compensate so m_used stays the same
+    m_used += newCapacity - oldCapacity;
+    Free(oldCapacity, newCapacity - oldCapacity);
+}
+
+uint32_t RangeAllocator::GetLargestFreeBlock() const {
+    return m_freeBySize.empty() ? 0 : m_freeBySize.rbegin()->first;
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+
+// Free-list sub-allocator for a linear range of elements (bytes, vertices, indices...).
+// Free blocks are indexed both by offset, to coalesce neighbours on free, and by size, for best-fit allocation.
+class RangeAllocator {
+public:
+    static constexpr uint32_t INVALID_OFFSET = ~0u;
+
+    explicit RangeAllocator(uint32_t capacity = 0);
+
+    // Best-fit, returns INVALID_OFFSET when no free block is large enough
+    uint32_t Allocate(uint32_t size);
+
+    // Lowest free block that fits entirely below limit, used to compact allocations towards the start
+    uint32_t AllocateBelow(uint32_t size, uint32_t limit);
+
+    void Free(uint32_t offset, uint32_t size);
+
+    // Appends free space at the end
+    void Grow(uint32_t newCapacity);
+
+    uint32_t GetCapacity() const { return m_capacity; }
+    uint32_t GetUsed() const { return m_used; }
+    uint32_t GetLargestFreeBlock() const;
+    size_t GetFreeBlockCount() const { return m_freeByOffset.size(); }
+
+private:
+    void AddFreeBlock(uint32_t offset, uint32_t size);
+    void RemoveFreeBlock(std::map<uint32_t, uint32_t>::iterator it);
+    uint32_t TakeFromBlock(std::map<uint32_t, uint32_t>::iterator it, uint32_t size);
+
+    std::map<uint32_t, uint32_t> m_freeByOffset;       // offset -> size
+    std::multimap<uint32_t, uint32_t> m_freeBySize;    // size -> offset
+    uint32_t m_capacity = 0;
+    uint32_t m_used = 0;
+};
@@ -0,0 +1,229 @@
+#include "core/Socket.h"
+
+#include <algorithm>
+#include <utility>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#else
+#include <arpa/inet.h>
+#include <cerrno>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+
+namespace {
+    using Handle = SOCKET;
+
+    // First use starts Winsock for the rest of the process
+    bool StartNetworking() {
+        static const bool started = [] {
+            WSADATA data;
+            return WSAStartup(MAKEWORD(2, 2), &data) == 0;
+        }();
+        return started;
+    }
+
+    bool WouldBlock() {
+        return WSAGetLastError() == WSAEWOULDBLOCK;
+    }
+
+    void CloseSocket(const Handle handle) {
+        closesocket(handle);
+    }
+
+    bool SetNonBlocking(const Handle handle) {
+        u_long enabled = 1;
+        return ioctlsocket(handle, FIONBIO, &enabled) == 0;
+    }
+}
+
+int64_t Socket::Send(const Buffer *buffers, const size_t count) {
+    constexpr size_t MAX_BUFFERS = 64;
+    WSABUF wsaBuffers[MAX_BUFFERS];
+    const size_t used = std::min(count, MAX_BUFFERS);
+    for (size_t i = 0; i < used; ++i) {
+        wsaBuffers[i].buf = static_cast<CHAR *>(const_cast<void *>(buffers[i].data));
+        wsaBuffers[i].len = static_cast<ULONG>(buffers[i].size);
+    }
+    DWORD sent = 0;
+    if (WSASend(static_cast<Handle>(m_handle), wsaBuffers, static_cast<DWORD>(used), &sent, 0, nullptr, nullptr) != 0)
+        return WouldBlock() ? 0 : -1;
+    return sent;
+}
+
+int64_t Socket::Receive(void *data, const size_t size) {
+    const int received = recv(static_cast<Handle>(m_handle), static_cast<char *>(data), static_cast<int>(size), 0);
+    if (received < 0)
+        return WouldBlock() ? 0 : -1;
+    return received == 0 ? -1 : received;
+}
+
+#else
+
+namespace {
+    using Handle = int;
+
+    bool StartNetworking() {
+        return true;
+    }
+
+    bool WouldBlock() {
+        return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+    }
+
+    void CloseSocket(const Handle handle) {
+        close(handle);
+    }
+
+    bool SetNonBlocking(const Handle handle) {
+        const int flags = fcntl(handle, F_GETFL, 0);
+        return flags >= 0 && fcntl(handle, F_SETFL, flags | O_NONBLOCK) == 0;
+    }
+}
+
+int64_t Socket::Send(const Buffer *buffers, const size_t count) {
+    constexpr size_t MAX_BUFFERS = 64;
+    iovec vectors[MAX_BUFFERS];
+    const size_t used = std::min(count, MAX_BUFFERS);
+    for (size_t i = 0; i < used; ++i) {
+        vectors[i].iov_base = const_cast<void *>(buffers[i].data);
+        vectors[i].iov_len = buffers[i].size;
+    }
+    msghdr message{};
+    message.msg_iov = vectors;
+    message.msg_iovlen = used;
+    // A peer that went away must not kill the process with SIGPIPE
+#ifdef MSG_NOSIGNAL
+    const ssize_t sent = sendmsg(m_handle, &message, MSG_NOSIGNAL);
+#else
+    const ssize_t sent = sendmsg(m_handle, &message, 0);
+#endif
+    if (sent < 0)
+        return WouldBlock() ? 0 : -1;
+    return sent;
+}
+
+int64_t Socket::Receive(void *data, const size_t size) {
+    const ssize_t received = recv(m_handle, data, size, 0);
+    if (received < 0)
+        return WouldBlock() ? 0 : -1;
+    return received == 0 ? -1 : received;
+}
+
+#endif
+
+Socket::Socket(const intptr_t handle) : m_handle(handle) {}
+
+Socket::~Socket() {
+    Close();
+}
+
+Socket::Socket(Socket &&other) noexcept : m_handle(std::exchange(other.m_handle, INVALID)) {}
+
+Socket &Socket::operator=(Socket &&other) noexcept {
+    if (this != &other) {
+        Close();
+        m_handle = std::exchange(other.m_handle, INVALID);
+    }
+    return *this;
+}
+
+Socket Socket::Listen(const uint16_t port) {
+    if (!StartNetworking())
+        return {};
+    Socket socket(static_cast<intptr_t>(::socket(AF_INET, SOCK_STREAM, IPPROTO_TCP)));
+    if (!socket.IsOpen())
+        return {};
+
+    // A restarted server must not wait for the old connections to time out before it can bind again
+    const int reuse = 1;
+    setsockopt(static_cast<Handle>(socket.m_handle), SOL_SOCKET, SO_REUSEADDR, reinterpret_cast<const char *>(&reuse),
+               sizeof(reuse));
+
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_ANY);
+    address.sin_port = htons(port);
+    if (bind(static_cast<Handle>(socket.m_handle), reinterpret_cast<const sockaddr *>(&address), sizeof(address)) != 0 ||
+        listen(static_cast<Handle>(socket.m_handle), SOMAXCONN) != 0 || !SetNonBlocking(static_cast<Handle>(socket.m_handle)))
+        return {};
+    return socket;
+}
+
+Socket Socket::Connect(const std::string &host, const uint16_t port) {
+    if (!StartNetworking())
+        return {};
+    addrinfo hints{};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_protocol = IPPROTO_TCP;
+    addrinfo *pResults = nullptr;
+    if (getaddrinfo(host.c_str(), std::to_string(port).c_str(), &hints, &pResults) != 0)
+        return {};
+
+    Socket socket;
+    for (const addrinfo *pResult = pResults; pResult && !socket.IsOpen(); pResult = pResult->ai_next) {
+        Socket candidate(static_cast<intptr_t>(::socket(pResult->ai_family, pResult->ai_socktype, pResult->ai_protocol)));
+        if (candidate.IsOpen() &&
+            connect(static_cast<Handle>(candidate.m_handle), pResult->ai_addr, static_cast<int>(pResult->ai_addrlen)) == 0)
+            socket = std::move(candidate);
+    }
+    freeaddrinfo(pResults);
+    if (socket.IsOpen() && !socket.Configure())
+        socket.Close();
+    return socket;
+}
+
+Socket Socket::Accept() {
+    if (!IsOpen())
+        return {};
+    Socket socket(static_cast<intptr_t>(accept(static_cast<Handle>(m_handle), nullptr, nullptr)));
+    if (socket.IsOpen() && !socket.Configure())
+        socket.Close();
+    return socket;
+}
+
+bool Socket::Configure() {
+    const int noDelay = 1;
+    setsockopt(static_cast<Handle>(m_handle), IPPROTO_TCP, TCP_NODELAY, reinterpret_cast<const char *>(&noDelay),
+               sizeof(noDelay));
+    return SetNonBlocking(static_cast<Handle>(m_handle));
+}
+
+void Socket::Close() {
+    if (IsOpen())
+        CloseSocket(static_cast<Handle>(m_handle));
+    m_handle = INVALID;
+}
+
+bool Socket::IsOpen() const {
+    return m_handle != INVALID;
+}
+
+std::string Socket::GetPeerName() const {
+    sockaddr_storage address{};
+    socklen_t size = sizeof(address);
+    if (!IsOpen() || getpeername(static_cast<Handle>(m_handle), reinterpret_cast<sockaddr *>(&address), &size) != 0)
+        return "unknown";
+    char host[INET6_ADDRSTRLEN] = {};
+    uint16_t port = 0;
+    if (address.ss_family == AF_INET) {
+        const auto &ipv4 = reinterpret_cast<const sockaddr_in &>(address);
+        inet_ntop(AF_INET, &ipv4.sin_addr, host, sizeof(host));
+        port = ntohs(ipv4.sin_port);
+    } else if (address.ss_family == AF_INET6) {
+        const auto &ipv6 = reinterpret_cast<const sockaddr_in6 &>(address);
+        inet_ntop(AF_INET6, &ipv6.sin6_addr, host, sizeof(host));
+        port = ntohs(ipv6.sin6_port);
+    }
+    return std::string(host) + ":" + std::to_string(port);
+}
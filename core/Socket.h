@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Non-blocking TCP socket. Nagle is off: callers batch their writes themselves and send once per tick.
+// Send() gathers several buffers in one call (writev/WSASend), so data shared between connections goes from the
+// caller's memory straight into the socket buffer.
+class Socket {
+public:
+    struct Buffer {
+        const void *data;
+        size_t size;
+    };
+
+    Socket() = default;
+    ~Socket();
+
+    Socket(Socket &&other) noexcept;
+    Socket &operator=(Socket &&other) noexcept;
+    Socket(const Socket &) = delete;
+    Socket &operator=(const Socket &) = delete;
+
+    // Listens on all interfaces; check IsOpen()
+    static Socket Listen(uint16_t port);
+    // Blocks until connected or refused; check IsOpen()
+    static Socket Connect(const std::string &host, uint16_t port);
+
+    // Invalid socket when nobody is waiting
+    Socket Accept();
+
+    // Bytes sent, 0 when the socket buffer is full; -1 once the connection failed
+    int64_t Send(const Buffer *buffers, size_t count);
+    // Bytes received, 0 when nothing arrived; -1 once the connection is closed or failed
+    int64_t Receive(void *data, size_t size);
+
+    void Close();
+    bool IsOpen() const;
+
+    // Address of the peer as text, for logs
+    std::string GetPeerName() const;
+
+private:
+    static constexpr intptr_t INVALID = -1;
+
+    explicit Socket(intptr_t handle);
+    bool Configure();
+
+    intptr_t m_handle = INVALID;
+};
@@ -1,3 +1,17 @@
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <chrono>
+#include <cctype>
+#include <cmath>
+#include <cstdlib>
+#include <filesystem>
+#include <span>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
 #include <spdlog/spdlog.h>
 
 #include <SDL2/SDL.h>
@@ -7,68 +21,36 @@
 #include "EngineFactoryVk.h"
 #include "EngineFactoryD3D11.h"
 #include "EngineFactoryD3D12.h"
+#include "EngineFactoryOpenGL.h"
 
 #include "RefCntAutoPtr.hpp"
 #include "BasicMath.hpp"
-#include "MapHelper.hpp"
-
-
-// TODO: move to files
-static const char *const vertex_shader_code = R"(
-cbuffer Constants
-{
-    float4x4 g_WorldViewProj;
-};
-
-// Vertex shader takes two inputs: vertex position and color.
-// By convention, Diligent Engine expects vertex shader inputs to be
-// labeled 'ATTRIBn', where n is the attribute number.
-struct VSInput
-{
-    float3 Pos   : ATTRIB0;
-    float4 Color : ATTRIB1;
-};
-
-struct PSInput
-{
-    float4 Pos   : SV_POSITION;
-    float4 Color : COLOR0;
-};
+#include "GraphicsAccessories.hpp"
+
+#include "core/Benchmark.h"
+#include "core/JobSystem.h"
+#include "core/LinearArena.h"
+#include "core/Profiler.h"
+#include "render/BlockTextureArray.h"
+#include "render/ChunkRenderer.h"
+#include "render/EntityRenderer.h"
+#include "render/FrameScheduler.h"
+#include "render/GpuProfiler.h"
+#include "render/HiZBuffer.h"
+#include "render/PipelineCache.h"
+#include "render/ProfilerOverlay.h"
+#include "render/ResourceStateTracker.h"
+#include "render/UniformRing.h"
+#include "render/UploadQueue.h"
+#include "world/ChunkStreamer.h"
+#include "world/LightEngine.h"
+#include "world/Raycast.h"
+#include "world/RegionStorage.h"
+#include "world/Simulation.h"
+#include "world/TerrainGenerator.h"
+#include "world/WorldTicker.h"
+#include "world/World.h"
 
-// Note that if separate shader objects are not supported (this is only the case for old GLES3.0 devices), vertex
-// shader output variable name must match exactly the name of the pixel shader input variable.
-// If the variable has structure type (like in this example), the structure declarations must also be identical.
-void main(in  VSInput VSIn,
-          out PSInput PSIn)
-{
-    PSIn.Pos   = mul(float4(VSIn.Pos, 1.0), g_WorldViewProj);
-    PSIn.Color = VSIn.Color;
-}
-)";
-
-static const char *const pixel_shader_code = R"(
-struct PSInput
-{
-    float4 Pos   : SV_POSITION;
-    float4 Color : COLOR0;
-};
-
-struct PSOutput
-{
-    float4 Color : SV_TARGET;
-};
-
-// Note that if separate shader objects are not supported (this is only the case for old GLES3.0 devices), vertex
-// shader output variable name must match exactly the name of the pixel shader input variable.
-// If the variable has structure type (like in this example), the structure declarations must also be identical.
-void main(in  PSInput  PSIn,
-          out PSOutput PSOut)
-{
-    float4 Color = PSIn.Color;
-    PSOut.Color = Color;
-}
-)";
-//
 
 enum WindowMode {
     WINDOWED,
@@ -80,10 +62,14 @@ struct VideoMode {
     int width, height;
     int syncInterval = 0;
     WindowMode windowMode = WINDOWED;
+    FramePacing framePacing = FRAME_PACING_THROUGHPUT;
+    uint32_t framesInFlight = 2;
 };
 
 
 static SDL_Window *m_mainWindow = nullptr;
+// Only made for OpenGL on Linux
+static SDL_GLContext m_glContext = nullptr;
 static bool m_windowShouldClose = false;
 
 namespace dg = Diligent;
@@ -91,15 +77,52 @@ namespace dg = Diligent;
 // Diligent structures
 static dg::RefCntAutoPtr<dg::IRenderDevice> m_pDevice;
 static dg::RefCntAutoPtr<dg::IDeviceContext> m_pImmediateContext;
+// Second immediate context on the copy queue, null when the device has none
+static dg::RefCntAutoPtr<dg::IDeviceContext> m_pTransferContext;
+static std::vector<dg::RefCntAutoPtr<dg::IDeviceContext>> m_pDeferredContexts;
 static dg::RefCntAutoPtr<dg::ISwapChain> m_pSwapChain;
-static dg::RefCntAutoPtr<dg::IPipelineState> m_pPSO;
-static dg::RefCntAutoPtr<dg::IBuffer> m_pVSConstants;
-static dg::RefCntAutoPtr<dg::IShaderResourceBinding> m_pSRB;
 
 static dg::float4x4 m_projMatrix, m_viewMatrix, m_modelMatrix;
 //
 
+static constexpr int32_t WORLD_SEED = 1337;
+static constexpr uint32_t TICK_RATE = 20;
+// In chunks; past LOD_DISTANCE chunks are drawn with lower detail meshes, halving again at every doubling
+static constexpr int VIEW_RADIUS = 32;
+static constexpr float LOD_DISTANCE = 8.f;
+static World m_world;
+static std::unique_ptr<JobSystem> m_jobSystem;
+static std::unique_ptr<RegionStorage> m_regionStorage;
+static std::unique_ptr<LightEngine> m_lightEngine;
+static std::unique_ptr<ChunkStreamer> m_chunkStreamer;
+static std::unique_ptr<Simulation> m_simulation;
+static std::unique_ptr<WorldTicker> m_worldTicker;
+static std::unique_ptr<FrameScheduler> m_frameScheduler;
+static std::unique_ptr<UniformRing> m_uniformRing;
+static std::unique_ptr<UploadQueue> m_uploadQueue;
+static std::unique_ptr<PipelineCache> m_pipelineCache;
+static std::unique_ptr<BlockTextureArray> m_blockTextures;
+static std::unique_ptr<HiZBuffer> m_hiZBuffer;
+static std::unique_ptr<ChunkRenderer> m_chunkRenderer;
+static std::unique_ptr<EntityRenderer> m_entityRenderer;
+static std::unique_ptr<GpuProfiler> m_gpuProfiler;
+static std::unique_ptr<ProfilerOverlay> m_profilerOverlay;
+
+// Drops the device of a failed initialization, so the next backend starts from nothing
+void ReleaseGraphicsEngine() {
+    m_pSwapChain.Release();
+    m_pDeferredContexts.clear();
+    m_pTransferContext.Release();
+    m_pImmediateContext.Release();
+    m_pDevice.Release();
+    if (m_glContext) {
+        SDL_GL_DeleteContext(m_glContext);
+        m_glContext = nullptr;
+    }
+}
+
 void cleanup() {
+    if (m_glContext) SDL_GL_DeleteContext(m_glContext);
     if (m_mainWindow) SDL_DestroyWindow(m_mainWindow);
     SDL_Quit();
 }
@@ -111,32 +134,138 @@ SDL_SysWMinfo GetNativeWindowInfo() {
     return wmInfo;
 }
 
-void InitializeGraphicsEngine(const VideoMode &videoMode,
-                              dg::RENDER_DEVICE_TYPE renderDeviceType = dg::RENDER_DEVICE_TYPE_GL) {
+// The window's native handle for the swap chain; Linux needs X11, Wayland windows are refused
+dg::NativeWindow GetNativeWindow(const SDL_SysWMinfo &wmInfo) {
+#ifdef _WIN32
+    return dg::Win32NativeWindow{wmInfo.info.win.window};
+#elif defined(__MACOSX__)
+    return dg::MacOSNativeWindow{wmInfo.info.cocoa.window};
+#elif defined(__linux__)
+    if (wmInfo.subsystem != SDL_SYSWM_X11)
+        throw std::runtime_error("Only X11 windows are supported");
+    dg::LinuxNativeWindow window;
+    window.WindowId = static_cast<dg::Uint32>(wmInfo.info.x11.window);
+    window.pDisplay = wmInfo.info.x11.display;
+    return window;
+#else
+    throw std::runtime_error("No native window on this platform");
+#endif
+}
+
+// ppContexts holds the immediate contexts followed by the deferred ones; a second immediate context is the
+// transfer context
+void AttachContexts(std::vector<dg::IDeviceContext *> &ppContexts, const dg::Uint32 numImmediateContexts = 1) {
+    m_pImmediateContext.Attach(ppContexts[0]);
+    m_pTransferContext.Release();
+    if (numImmediateContexts > 1)
+        m_pTransferContext.Attach(ppContexts[1]);
+    m_pDeferredContexts.clear();
+    for (size_t i = numImmediateContexts; i < ppContexts.size(); ++i) {
+        if (!ppContexts[i])
+            continue;
+        m_pDeferredContexts.emplace_back();
+        m_pDeferredContexts.back().Attach(ppContexts[i]);
+    }
+}
+
+// Asks for a second immediate context on the adapter's copy queue, for UploadQueue to submit on.
+// Returns the number of immediate contexts requested, 1 when the adapter has no separate copy queue
+template<typename EngineFactory, typename EngineCreateInfo>
+dg::Uint32 RequestTransferContext(EngineFactory *pFactory, EngineCreateInfo &EngineCI,
+                                  std::array<dg::ImmediateContextCreateInfo, 2> &contextInfos) {
+    dg::Uint32 numAdapters = 0;
+    pFactory->EnumerateAdapters(EngineCI.GraphicsAPIVersion, numAdapters, nullptr);
+    if (numAdapters == 0)
+        return 1;
+    std::vector<dg::GraphicsAdapterInfo> adapters(numAdapters);
+    pFactory->EnumerateAdapters(EngineCI.GraphicsAPIVersion, numAdapters, adapters.data());
+
+    // Queues are chosen per adapter, so the adapter has to be picked here too: the first discrete one
+    dg::Uint32 adapterId = 0;
+    for (dg::Uint32 i = 0; i < numAdapters; ++i) {
+        if (adapters[i].Type == dg::ADAPTER_TYPE_DISCRETE) {
+            adapterId = i;
+            break;
+        }
+    }
+
+    const dg::GraphicsAdapterInfo &adapter = adapters[adapterId];
+    constexpr dg::Uint32 NONE = ~0u;
+    dg::Uint32 graphicsQueue = NONE, transferQueue = NONE;
+    for (dg::Uint32 q = 0; q < adapter.NumQueues; ++q) {
+        if (adapter.Queues[q].MaxDeviceContexts == 0)
+            continue;
+        const auto type = adapter.Queues[q].QueueType & dg::COMMAND_QUEUE_TYPE_PRIMARY_MASK;
+        if (type == dg::COMMAND_QUEUE_TYPE_GRAPHICS && graphicsQueue == NONE)
+            graphicsQueue = q;
+        else if (type == dg::COMMAND_QUEUE_TYPE_TRANSFER && transferQueue == NONE)
+            transferQueue = q;
+    }
+    if (graphicsQueue == NONE || transferQueue == NONE)
+        return 1;
+
+    contextInfos[0].Name = "Immediate context";
+    contextInfos[0].QueueId = static_cast<dg::Uint8>(graphicsQueue);
+    contextInfos[1].Name = "Transfer context";
+    contextInfos[1].QueueId = static_cast<dg::Uint8>(transferQueue);
+    EngineCI.AdapterId = adapterId;
+    EngineCI.NumImmediateContexts = static_cast<dg::Uint32>(contextInfos.size());
+    EngineCI.pImmediateContextInfo = contextInfos.data();
+    // Uploads on the copy queue are ordered against the frames with fences shared between queues
+    EngineCI.Features.NativeFence = dg::DEVICE_FEATURE_STATE_OPTIONAL;
+    return EngineCI.NumImmediateContexts;
+}
+
+// The fast paths are taken where the device has them: compute culling and the Hi-Z pyramid, counted multi-draw
+// (see ChunkRenderer), timestamps for the GPU profiler. Asking for them optionally never fails device creation
+template<typename EngineCreateInfo>
+void RequestOptionalFeatures(EngineCreateInfo &EngineCI) {
+    EngineCI.EnableValidation = PLUSCRAFT_VALIDATION != 0;
+    EngineCI.Features.ComputeShaders = dg::DEVICE_FEATURE_STATE_OPTIONAL;
+    EngineCI.Features.NativeMultiDraw = dg::DEVICE_FEATURE_STATE_OPTIONAL;
+    EngineCI.Features.TimestampQueries = dg::DEVICE_FEATURE_STATE_OPTIONAL;
+}
+
+// Throws when the backend is not available: not built for this platform, or no device or swap chain could be made.
+// What was made by then is left for ReleaseGraphicsEngine()
+void InitializeGraphicsEngine(const VideoMode &videoMode, const dg::RENDER_DEVICE_TYPE renderDeviceType,
+                              const dg::Uint32 numDeferredContexts = 4) {
     auto nativeWindowInfo = GetNativeWindowInfo();
+    // Room for a transfer context in front of the deferred ones
+    std::vector<dg::IDeviceContext *> ppContexts(2 + numDeferredContexts, nullptr);
+    std::array<dg::ImmediateContextCreateInfo, 2> contextInfos;
 
     dg::SwapChainDesc SCDesc;
     SCDesc.Width = videoMode.width;
     SCDesc.Height = videoMode.height;
+    // The world's depth buffer is a HiZBuffer, it has to be readable by the pyramid build
+    SCDesc.DepthBufferFormat = dg::TEX_FORMAT_UNKNOWN;
 
+    // One more buffer than frames in flight, so Present never blocks before the frame fence does
+    SCDesc.BufferCount = std::max(2u, videoMode.framesInFlight + 1);
 #ifdef __MACOSX__
-    SCDesc.BufferCount = 3;
+    SCDesc.BufferCount = std::max(3u, SCDesc.BufferCount);
 #endif
 
     switch (renderDeviceType) {
 #ifdef _WIN32
         case dg::RENDER_DEVICE_TYPE_D3D11: {
             dg::EngineD3D11CreateInfo EngineCI;
+            RequestOptionalFeatures(EngineCI);
+            EngineCI.NumDeferredContexts = numDeferredContexts;
 #    if ENGINE_DLL
             // Load the dll and import GetEngineFactoryD3D11() function
             auto *GetEngineFactoryD3D11 = dg::LoadGraphicsEngineD3D11();
 #    endif
 
             auto *pFactoryD3D11 = GetEngineFactoryD3D11();
-            pFactoryD3D11->CreateDeviceAndContextsD3D11(EngineCI, &m_pDevice, &m_pImmediateContext);
-            dg::Win32NativeWindow Window{nativeWindowInfo.info.win.window};
+            pFactoryD3D11->CreateDeviceAndContextsD3D11(EngineCI, &m_pDevice, ppContexts.data());
+            if (!m_pDevice)
+                break;
+            AttachContexts(ppContexts);
             pFactoryD3D11->CreateSwapChainD3D11(m_pDevice, m_pImmediateContext, SCDesc,
-                                                dg::FullScreenModeDesc{}, Window, &m_pSwapChain);
+                                                dg::FullScreenModeDesc{}, GetNativeWindow(nativeWindowInfo),
+                                                &m_pSwapChain);
             break;
         }
 
@@ -146,12 +275,18 @@ void InitializeGraphicsEngine(const VideoMode &videoMode,
             auto GetEngineFactoryD3D12 = dg::LoadGraphicsEngineD3D12();
 #endif
             dg::EngineD3D12CreateInfo EngineCI;
+            RequestOptionalFeatures(EngineCI);
+            EngineCI.NumDeferredContexts = numDeferredContexts;
 
             auto *pFactoryD3D12 = GetEngineFactoryD3D12();
-            pFactoryD3D12->CreateDeviceAndContextsD3D12(EngineCI, &m_pDevice, &m_pImmediateContext);
-            dg::Win32NativeWindow Window{nativeWindowInfo.info.win.window};
+            const dg::Uint32 numImmediateContexts = RequestTransferContext(pFactoryD3D12, EngineCI, contextInfos);
+            pFactoryD3D12->CreateDeviceAndContextsD3D12(EngineCI, &m_pDevice, ppContexts.data());
+            if (!m_pDevice)
+                break;
+            AttachContexts(ppContexts, numImmediateContexts);
             pFactoryD3D12->CreateSwapChainD3D12(m_pDevice, m_pImmediateContext, SCDesc,
-                                                dg::FullScreenModeDesc{}, Window, &m_pSwapChain);
+                                                dg::FullScreenModeDesc{}, GetNativeWindow(nativeWindowInfo),
+                                                &m_pSwapChain);
             break;
         }
 #endif
@@ -163,30 +298,191 @@ void InitializeGraphicsEngine(const VideoMode &videoMode,
             auto GetEngineFactoryVk = dg::GetEngineFactoryVk;
 #endif
             dg::EngineVkCreateInfo EngineCI;
+            RequestOptionalFeatures(EngineCI);
+            EngineCI.NumDeferredContexts = numDeferredContexts;
 
             auto *pFactoryVk = GetEngineFactoryVk();
-            pFactoryVk->CreateDeviceAndContextsVk(EngineCI, &m_pDevice, &m_pImmediateContext);
+            const dg::Uint32 numImmediateContexts = RequestTransferContext(pFactoryVk, EngineCI, contextInfos);
+            pFactoryVk->CreateDeviceAndContextsVk(EngineCI, &m_pDevice, ppContexts.data());
+            if (!m_pDevice)
+                break;
+            AttachContexts(ppContexts, numImmediateContexts);
+            pFactoryVk->CreateSwapChainVk(m_pDevice, m_pImmediateContext, SCDesc, GetNativeWindow(nativeWindowInfo),
+                                          &m_pSwapChain);
+            break;
+        }
+#ifndef __MACOSX__
+        // No deferred contexts and no copy queue: everything is recorded and uploaded on the immediate context
+        case dg::RENDER_DEVICE_TYPE_GL: {
+#    if EXPLICITLY_LOAD_ENGINE_GL_DLL
+            // Load the dll and import GetEngineFactoryOpenGL() function
+            auto GetEngineFactoryOpenGL = dg::LoadGraphicsEngineOpenGL();
+#    else
+            auto GetEngineFactoryOpenGL = dg::GetEngineFactoryOpenGL;
+#    endif
+#    ifdef __linux__
+            // On Linux the engine renders into the context current on this thread, it does not make its own
+            SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, 4);
+            SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, 3);
+            SDL_GL_SetAttribute(SDL_GL_CONTEXT_PROFILE_MASK, SDL_GL_CONTEXT_PROFILE_CORE);
+            m_glContext = SDL_GL_CreateContext(m_mainWindow);
+            if (!m_glContext)
+                throw std::runtime_error(std::string("OpenGL context creation failed: ") + SDL_GetError());
+#    endif
+            dg::EngineGLCreateInfo EngineCI;
+            RequestOptionalFeatures(EngineCI);
+            EngineCI.Window = GetNativeWindow(nativeWindowInfo);
 
-#ifdef __MACOSX__
-            dg::MacOSNativeWindow Window{nativeWindowInfo.info.cocoa.window};
-#elif _WIN32
-            dg::Win32NativeWindow Window{nativeWindowInfo.info.win.window};
-#endif
-            pFactoryVk->CreateSwapChainVk(m_pDevice, m_pImmediateContext, SCDesc, Window, &m_pSwapChain);
+            auto *pFactoryOpenGL = GetEngineFactoryOpenGL();
+            pFactoryOpenGL->CreateDeviceAndSwapChainGL(EngineCI, &m_pDevice, &m_pImmediateContext, SCDesc,
+                                                       &m_pSwapChain);
             break;
         }
+#endif
         default:
-            throw std::runtime_error("Unsupported render device type");
+            throw std::runtime_error("Not supported on this platform");
     }
+    if (!m_pDevice || !m_pSwapChain)
+        throw std::runtime_error("Device or swap chain creation failed");
+}
+
+// Backends to try in order: the one asked for, then the platform's, fastest first
+std::vector<dg::RENDER_DEVICE_TYPE> GetRenderDeviceCandidates(const dg::RENDER_DEVICE_TYPE preferred) {
+    std::vector<dg::RENDER_DEVICE_TYPE> candidates;
+    if (preferred != dg::RENDER_DEVICE_TYPE_UNDEFINED)
+        candidates.push_back(preferred);
+#ifdef _WIN32
+    for (const auto type: {dg::RENDER_DEVICE_TYPE_D3D12, dg::RENDER_DEVICE_TYPE_VULKAN, dg::RENDER_DEVICE_TYPE_D3D11,
+                           dg::RENDER_DEVICE_TYPE_GL}) {
+#elif defined(__MACOSX__)
+    for (const auto type: {dg::RENDER_DEVICE_TYPE_VULKAN}) {
+#else
+    for (const auto type: {dg::RENDER_DEVICE_TYPE_VULKAN, dg::RENDER_DEVICE_TYPE_GL}) {
+#endif
+        if (type != preferred)
+            candidates.push_back(type);
+    }
+    return candidates;
+}
+
+// What the device gave us of the optional features, to log; the renderers check the ones they use themselves
+void LogDeviceCapabilities() {
+    const auto &enabled = m_pDevice->GetDeviceInfo().Features;
+    const auto &adapter = m_pDevice->GetAdapterInfo();
+    const bool multiDraw = (adapter.DrawCommand.CapFlags & dg::DRAW_COMMAND_CAP_FLAG_NATIVE_MULTI_DRAW_INDIRECT) != 0 &&
+                           enabled.NativeMultiDraw == dg::DEVICE_FEATURE_STATE_ENABLED;
+    bool asyncCompute = false;
+    for (dg::Uint32 q = 0; q < adapter.NumQueues; ++q) {
+        if ((adapter.Queues[q].QueueType & dg::COMMAND_QUEUE_TYPE_PRIMARY_MASK) == dg::COMMAND_QUEUE_TYPE_COMPUTE &&
+            adapter.Queues[q].MaxDeviceContexts > 0)
+            asyncCompute = true;
+    }
+    const auto yesNo = [](const bool b) { return b ? "yes" : "no"; };
+    spdlog::info("Render device: {} on {}", dg::GetRenderDeviceTypeString(m_pDevice->GetDeviceInfo().Type),
+                 adapter.Description);
+    spdlog::info("Compute: {}, multi-draw indirect: {}, bindless: {}, async compute queue: {}, copy queue: {}",
+                 yesNo(enabled.ComputeShaders == dg::DEVICE_FEATURE_STATE_ENABLED), yesNo(multiDraw),
+                 yesNo(adapter.Features.BindlessResources != dg::DEVICE_FEATURE_STATE_DISABLED), yesNo(asyncCompute),
+                 yesNo(m_pTransferContext != nullptr));
 }
 
 // Events
+// A block face right in front of the camera covers about a third of the screen height,
+// texture detail beyond that is never visible
+void RequestTextureResolution(const uint32_t screenHeight) {
+    if (m_blockTextures)
+        m_blockTextures->RequestResolution(std::bit_ceil(std::max(1u, screenHeight / 3)));
+}
+
 void OnResize(const int width, const int height) {
-    m_projMatrix = dg::float4x4::Projection(M_PI_2, static_cast<float>(width) / static_cast<float>(height), 0.1f, 1000.f, false);
+    m_projMatrix = dg::float4x4::Projection(M_PI_2, static_cast<float>(width) / static_cast<float>(height), 0.1f, 1000.f,
+                                            m_pDevice->GetDeviceInfo().IsGLDevice());
+    // Back buffers may not be released while frames still reference them
+    if (m_frameScheduler)
+        m_frameScheduler->WaitIdle();
     m_pSwapChain->Resize(width, height);
+    if (m_hiZBuffer)
+        m_hiZBuffer->Resize(m_pSwapChain->GetDesc().Width, m_pSwapChain->GetDesc().Height);
+    RequestTextureResolution(static_cast<uint32_t>(height));
+}
+
+// Breaks the block under the mouse, or places a glowstone against it. The camera orbits high above the ground, hence
+// the long reach
+void PickBlock(const int mouseX, const int mouseY, const bool place) {
+    constexpr float PICK_DISTANCE = 160.f;
+    const dg::SwapChainDesc &desc = m_pSwapChain->GetDesc();
+    const float ndcX = 2.f * (static_cast<float>(mouseX) + 0.5f) / static_cast<float>(desc.Width) - 1.f;
+    const float ndcY = 1.f - 2.f * (static_cast<float>(mouseY) + 0.5f) / static_cast<float>(desc.Height);
+
+    // Unprojects the mouse on the near and far planes
+    const dg::float4x4 invViewProj = (m_modelMatrix * m_viewMatrix * m_projMatrix).Inverse();
+    const dg::float4 nearPoint = dg::float4(ndcX, ndcY, 0.f, 1.f) * invViewProj;
+    const dg::float4 farPoint = dg::float4(ndcX, ndcY, 1.f, 1.f) * invViewProj;
+    const float origin[3] = {nearPoint.x / nearPoint.w, nearPoint.y / nearPoint.w, nearPoint.z / nearPoint.w};
+    const float direction[3] = {farPoint.x / farPoint.w - origin[0], farPoint.y / farPoint.w - origin[1],
+                                farPoint.z / farPoint.w - origin[2]};
+
+    RaycastHit hit;
+    if (!Raycast(m_world, origin, direction, PICK_DISTANCE, hit))
+        return;
+    if (!place) {
+        m_world.SetBlock(hit.x, hit.y, hit.z, BLOCK_AIR);
+        return;
+    }
+    int32_t x, y, z;
+    hit.GetAdjacent(x, y, z);
+    if (y >= 0 && y < Chunk::HEIGHT && !IsSolid(m_world.GetBlock(x, y, z)))
+        m_world.SetBlock(x, y, z, BLOCK_GLOWSTONE);
+}
+
+void PrintUsage() {
+    spdlog::info("Usage: PlusCraft [--device <vulkan|d3d12|d3d11|gl>] [--benchmark] [--benchmark-seconds <n>] "
+                 "[--benchmark-output <file>]");
+    spdlog::info("PLUSCRAFT_DEVICE in the environment picks the device too, --device wins over it");
+}
+
+// Undefined for a name that is none of them
+dg::RENDER_DEVICE_TYPE ParseRenderDeviceType(std::string_view name) {
+    std::string lower(name);
+    std::transform(lower.begin(), lower.end(), lower.begin(), [](const unsigned char c) { return std::tolower(c); });
+    if (lower == "vulkan" || lower == "vk")
+        return dg::RENDER_DEVICE_TYPE_VULKAN;
+    if (lower == "d3d12" || lower == "dx12")
+        return dg::RENDER_DEVICE_TYPE_D3D12;
+    if (lower == "d3d11" || lower == "dx11")
+        return dg::RENDER_DEVICE_TYPE_D3D11;
+    if (lower == "gl" || lower == "opengl")
+        return dg::RENDER_DEVICE_TYPE_GL;
+    return dg::RENDER_DEVICE_TYPE_UNDEFINED;
 }
 
 int main(int argc, char **argv) {
+    dg::RENDER_DEVICE_TYPE preferredDevice = dg::RENDER_DEVICE_TYPE_UNDEFINED;
+    bool benchmarkMode = false;
+    Benchmark::Settings benchmarkSettings;
+    std::string benchmarkOutput = "benchmark.json";
+    if (const char *device = std::getenv("PLUSCRAFT_DEVICE")) {
+        preferredDevice = ParseRenderDeviceType(device);
+        if (preferredDevice == dg::RENDER_DEVICE_TYPE_UNDEFINED)
+            spdlog::warn("Unknown PLUSCRAFT_DEVICE '{}', ignored", device);
+    }
+    for (int i = 1; i < argc; ++i) {
+        const std::string_view arg = argv[i];
+        const bool hasValue = i + 1 < argc;
+        if (arg == "--device" && hasValue && ParseRenderDeviceType(argv[i + 1]) != dg::RENDER_DEVICE_TYPE_UNDEFINED)
+            preferredDevice = ParseRenderDeviceType(argv[++i]);
+        else if (arg == "--benchmark")
+            benchmarkMode = true;
+        else if (arg == "--benchmark-seconds" && hasValue)
+            benchmarkSettings.duration = std::max(1.f, static_cast<float>(std::atof(argv[++i])));
+        else if (arg == "--benchmark-output" && hasValue)
+            benchmarkOutput = argv[++i];
+        else {
+            PrintUsage();
+            return arg == "--help" ? 0 : -1;
+        }
+    }
+
     if (SDL_Init(SDL_INIT_EVENTS | SDL_INIT_VIDEO | SDL_INIT_TIMER) != 0) {
         spdlog::error("SDL2 init failed: {}", SDL_GetError());
         return -1;
@@ -199,6 +495,9 @@ int main(int argc, char **argv) {
         1920, 1080,
         1, WindowMode::WINDOWED
     };
+    // Frames as fast as they go
+    if (benchmarkMode)
+        videoMode.syncInterval = 0;
 
     Uint32 winFlags = SDL_WINDOW_SHOWN;
 
@@ -208,6 +507,10 @@ int main(int argc, char **argv) {
         winFlags |= SDL_WINDOW_FULLSCREEN;
     else if (videoMode.windowMode == WindowMode::BORDERLESS)
         winFlags |= SDL_WINDOW_FULLSCREEN_DESKTOP;
+#ifdef __linux__
+    // Lets OpenGL make its context if it ends up the backend, Vulkan does not mind
+    winFlags |= SDL_WINDOW_OPENGL;
+#endif
 
     m_mainWindow = SDL_CreateWindow("PlusCraft",
                                     SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED,
@@ -219,194 +522,336 @@ int main(int argc, char **argv) {
         return -3;
     }
 
-    //
-    try {
-        InitializeGraphicsEngine(videoMode, dg::RENDER_DEVICE_TYPE_D3D11);
-    } catch (std::exception &e) {
-        spdlog::error("DiligentEngine Init failed: {}", e.what());
-        return -5;
-    }
-
-    // Init PSO
-    dg::GraphicsPipelineStateCreateInfo PSOCreateInfo;
-    PSOCreateInfo.PSODesc.Name = "Triangle PSO";
-    PSOCreateInfo.PSODesc.PipelineType = dg::PIPELINE_TYPE_GRAPHICS;
-
-    PSOCreateInfo.GraphicsPipeline.NumRenderTargets = 1;
-    PSOCreateInfo.GraphicsPipeline.RTVFormats[0] = m_pSwapChain->GetDesc().ColorBufferFormat;
-    PSOCreateInfo.GraphicsPipeline.DSVFormat = m_pSwapChain->GetDesc().DepthBufferFormat;
-    PSOCreateInfo.GraphicsPipeline.PrimitiveTopology = dg::PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
-    PSOCreateInfo.GraphicsPipeline.RasterizerDesc.CullMode = dg::CULL_MODE_BACK;
-    PSOCreateInfo.GraphicsPipeline.DepthStencilDesc.DepthEnable = true;
-
-    // Create shaders
-    dg::ShaderCreateInfo ShaderCI;
-    ShaderCI.SourceLanguage = dg::SHADER_SOURCE_LANGUAGE_HLSL;
-    ShaderCI.Desc.UseCombinedTextureSamplers = true;
-    dg::RefCntAutoPtr<dg::IShader> pVS; {
-        ShaderCI.Desc.ShaderType = dg::SHADER_TYPE_VERTEX;
-        ShaderCI.EntryPoint = "main";
-        ShaderCI.Desc.Name = "Triangle vertex shader";
-        ShaderCI.Source = vertex_shader_code;
-        m_pDevice->CreateShader(ShaderCI, &pVS);
+    // The first backend that comes up wins
+    for (const dg::RENDER_DEVICE_TYPE deviceType: GetRenderDeviceCandidates(preferredDevice)) {
+        try {
+            InitializeGraphicsEngine(videoMode, deviceType,
+                                     std::clamp(std::thread::hardware_concurrency() / 2, 1u, 8u));
+            break;
+        } catch (std::exception &e) {
+            spdlog::warn("{} init failed: {}", dg::GetRenderDeviceTypeString(deviceType), e.what());
+            ReleaseGraphicsEngine();
+        }
     }
-    dg::RefCntAutoPtr<dg::IShader> pPS; {
-        ShaderCI.Desc.ShaderType = dg::SHADER_TYPE_PIXEL;
-        ShaderCI.EntryPoint = "main";
-        ShaderCI.Desc.Name = "Triangle pixel shader";
-        ShaderCI.Source = pixel_shader_code;
-        m_pDevice->CreateShader(ShaderCI, &pPS);
+    if (!m_pDevice) {
+        spdlog::error("DiligentEngine Init failed: no render device available");
+        return -5;
     }
+    LogDeviceCapabilities();
 
-    // Buffers
-    dg::BufferDesc CBDesc;
-    CBDesc.Name = "VS constants CB";
-    CBDesc.Size = sizeof(dg::float4x4);
-    CBDesc.Usage = dg::USAGE_DYNAMIC;
-    CBDesc.BindFlags = dg::BIND_UNIFORM_BUFFER;
-    CBDesc.CPUAccessFlags = dg::CPU_ACCESS_WRITE;
-    m_pDevice->CreateBuffer(CBDesc, nullptr, &m_pVSConstants);
-
-    // Vertex Input Layout
-    dg::LayoutElement LayoutElements[] = {
-        dg::LayoutElement{0, 0, 3, dg::VT_FLOAT32, false},
-        dg::LayoutElement{1, 0, 4, dg::VT_FLOAT32, false}
-    };
-    PSOCreateInfo.GraphicsPipeline.InputLayout.LayoutElements = LayoutElements;
-    PSOCreateInfo.GraphicsPipeline.InputLayout.NumElements = std::size(LayoutElements);
-
-    PSOCreateInfo.PSODesc.ResourceLayout.DefaultVariableType = dg::SHADER_RESOURCE_VARIABLE_TYPE_STATIC;
+    m_jobSystem = std::make_unique<JobSystem>();
+    m_frameScheduler = std::make_unique<FrameScheduler>(m_pDevice, videoMode.framePacing, videoMode.framesInFlight);
+    m_uniformRing = std::make_unique<UniformRing>(m_pDevice, 256 << 10);
 
-    // Link shaders
-    PSOCreateInfo.pVS = pVS;
-    PSOCreateInfo.pPS = pPS;
-    m_pDevice->CreateGraphicsPipelineState(PSOCreateInfo, &m_pPSO);
-
-    // Bind constants
-    m_pPSO->GetStaticVariableByName(dg::SHADER_TYPE_VERTEX, "Constants")->Set(m_pVSConstants);
-
-    // Vertex buffer
-    struct Vertex {
-        dg::float3 pos;
-        dg::float4 color;
-    };
-    Vertex CubeVerts[] =
-    {
-        {dg::float3(-1, -1, -1), dg::float4(1, 0, 0, 1)},
-        {dg::float3(-1, +1, -1), dg::float4(0, 1, 0, 1)},
-        {dg::float3(+1, +1, -1), dg::float4(0, 0, 1, 1)},
-        {dg::float3(+1, -1, -1), dg::float4(1, 1, 1, 1)},
-
-        {dg::float3(-1, -1, +1), dg::float4(1, 1, 0, 1)},
-        {dg::float3(-1, +1, +1), dg::float4(0, 1, 1, 1)},
-        {dg::float3(+1, +1, +1), dg::float4(1, 0, 1, 1)},
-        {dg::float3(+1, -1, +1), dg::float4(0.2f, 0.2f, 0.2f, 1)},
-    };
-
-    uint32_t CubeIndices[] =
+    // Shaders are copied next to the executable at build time, caches and saves live beside them
+    std::string rootPath;
+    if (char *basePath = SDL_GetBasePath()) {
+        rootPath = basePath;
+        SDL_free(basePath);
+    }
+    m_pipelineCache = std::make_unique<PipelineCache>(m_pDevice, rootPath + "shaders", rootPath + "cache");
+    m_blockTextures = std::make_unique<BlockTextureArray>(m_pDevice, *m_jobSystem, rootPath + "textures/blocks",
+                                                          BlockTextureArray::Settings{});
+    RequestTextureResolution(m_pSwapChain->GetDesc().Height);
+    m_hiZBuffer = std::make_unique<HiZBuffer>(m_pDevice, *m_pipelineCache, m_pSwapChain->GetDesc().Width,
+                                              m_pSwapChain->GetDesc().Height);
+    m_uploadQueue = std::make_unique<UploadQueue>(m_pDevice, m_pImmediateContext, m_pTransferContext);
+    m_chunkRenderer = std::make_unique<ChunkRenderer>(m_pDevice, *m_jobSystem, *m_uniformRing, *m_uploadQueue,
+                                                      *m_pipelineCache, *m_blockTextures,
+                                                      m_pSwapChain->GetDesc().ColorBufferFormat,
+                                                      HiZBuffer::DEPTH_FORMAT);
+    m_chunkRenderer->SetLodDistance(LOD_DISTANCE);
+    m_chunkRenderer->SetOcclusionSource(m_hiZBuffer.get());
+    m_entityRenderer = std::make_unique<EntityRenderer>(m_pDevice, *m_uniformRing, *m_pipelineCache, *m_blockTextures,
+                                                        m_pSwapChain->GetDesc().ColorBufferFormat,
+                                                        HiZBuffer::DEPTH_FORMAT);
+    m_gpuProfiler = std::make_unique<GpuProfiler>(m_pDevice);
+    m_profilerOverlay = std::make_unique<ProfilerOverlay>(m_pDevice, m_pSwapChain->GetDesc().ColorBufferFormat,
+                                                          HiZBuffer::DEPTH_FORMAT);
+    spdlog::info("Pipeline cache: {} hits, {} misses", m_pipelineCache->GetHitCount(), m_pipelineCache->GetMissCount());
+    // Everything compiled at startup is archived right away, a crash later must not cost the next launch
+    m_pipelineCache->Save();
+    if (!m_gpuProfiler->IsSupported())
+        spdlog::warn("Timestamp queries are not supported, GPU timings are disabled");
+    if (!m_hiZBuffer->IsSupported())
+        spdlog::warn("Compute shaders are not supported, occlusion culling is disabled");
+    spdlog::info("Job system: {} worker threads, {} deferred contexts", m_jobSystem->GetThreadCount(),
+                 m_pDeferredContexts.size());
     {
-        2, 0, 1, 2, 3, 0,
-        4, 6, 5, 4, 7, 6,
-        0, 7, 4, 0, 3, 7,
-        1, 0, 4, 1, 4, 5,
-        1, 5, 2, 5, 6, 2,
-        3, 6, 7, 3, 2, 6
-    };
+        std::vector<dg::IDeviceContext *> deferredContexts;
+        for (auto &pContext: m_pDeferredContexts)
+            deferredContexts.push_back(pContext);
+        m_chunkRenderer->SetDeferredContexts(deferredContexts);
+    }
 
-    dg::RefCntAutoPtr<dg::IBuffer> cubeVertexBuffer, cubeIndexBuffer;
-
-    dg::BufferDesc VertBuffDesc;
-    VertBuffDesc.Name = "Cube vertex buffer";
-    VertBuffDesc.Usage = dg::USAGE_IMMUTABLE;
-    VertBuffDesc.BindFlags = dg::BIND_VERTEX_BUFFER;
-    VertBuffDesc.Size = sizeof(CubeVerts);
-    dg::BufferData VBData;
-    VBData.pData = CubeVerts;
-    VBData.DataSize = sizeof(CubeVerts);
-    m_pDevice->CreateBuffer(VertBuffDesc, &VBData, &cubeVertexBuffer);
-
-    dg::BufferDesc IndBuffDesc;
-    IndBuffDesc.Name = "Cube index buffer";
-    IndBuffDesc.Usage = dg::USAGE_IMMUTABLE;
-    IndBuffDesc.BindFlags = dg::BIND_INDEX_BUFFER;
-    IndBuffDesc.Size = sizeof(CubeIndices);
-    dg::BufferData IBData;
-    IBData.pData = CubeIndices;
-    IBData.DataSize = sizeof(CubeIndices);
-    m_pDevice->CreateBuffer(IndBuffDesc, &IBData, &cubeIndexBuffer);
-
-    // Init SRB
-    m_pPSO->CreateShaderResourceBinding(&m_pSRB, true);
+    spdlog::info("Terrain noise: {}", GetNoiseSimdLevelName(GetNoiseSimdLevel()));
+    // A benchmark starts from a fresh world every run, chunks saved by the last one would load instead of generating
+    std::string savePath = rootPath + "saves/world";
+    if (benchmarkMode) {
+        savePath = rootPath + "saves/benchmark";
+        std::error_code error;
+        std::filesystem::remove_all(savePath, error);
+    }
+    m_regionStorage = std::make_unique<RegionStorage>(savePath);
+    m_lightEngine = std::make_unique<LightEngine>(m_world, *m_jobSystem);
+    m_chunkStreamer = std::make_unique<ChunkStreamer>(
+        m_world, *m_jobSystem,
+        [terrain = TerrainGenerator(WORLD_SEED)](Chunk &chunk, const std::atomic<bool> &cancelled) {
+            if (!m_regionStorage->LoadChunk(chunk))
+                terrain.Generate(chunk, cancelled);
+            // Light is not saved, loaded chunks are lit again like new ones
+            if (!cancelled)
+                LightEngine::LightChunk(chunk);
+        },
+        ChunkStreamer::Settings{.viewRadius = VIEW_RADIUS});
+    // New chunks take light from their neighbours before any of them is meshed
+    m_chunkStreamer->SetOnChunksLoaded([](const std::span<const ChunkPos> chunks) {
+        for (const ChunkPos pos: chunks)
+            m_lightEngine->QueueChunk(pos);
+        m_lightEngine->Update();
+    });
+    m_chunkStreamer->SetOnChunkReady([](const ChunkPos pos) { m_chunkRenderer->QueueChunk(m_world, pos); });
+    m_chunkStreamer->SetOnChunkHidden([](const ChunkPos pos) { m_chunkRenderer->RemoveChunk(pos); });
+    // Generated chunks are saved too, loading one back is far cheaper than generating it again
+    m_chunkStreamer->SetOnChunkUnloading([](const Chunk &chunk) {
+        if (chunk.IsDirty())
+            m_regionStorage->SaveChunk(chunk);
+    });
 
     dg::float4 ClearColor = {0.350f, 0.350f, 0.350f, 1.0f};
 
-    m_projMatrix = dg::float4x4::Projection(M_PI_2, 16.f / 9.f, 0.1f, 1000.f, false);
+    m_projMatrix = dg::float4x4::Projection(M_PI_2, 16.f / 9.f, 0.1f, 1000.f, m_pDevice->GetDeviceInfo().IsGLDevice());
     m_viewMatrix = dg::float4x4::Identity();
     m_modelMatrix = dg::float4x4::Identity();
 
+    m_simulation = std::make_unique<Simulation>(Simulation::Settings{.tickRate = TICK_RATE, .seed = WORLD_SEED},
+                                                *m_jobSystem, TerrainGenerator(WORLD_SEED));
+    Simulation::Snapshot snapshot;
+    m_worldTicker = std::make_unique<WorldTicker>(m_world, *m_jobSystem,
+                                                  WorldTicker::Settings{.seed = static_cast<uint32_t>(WORLD_SEED)});
+    uint64_t worldTick = 0;
+    std::unique_ptr<Benchmark> benchmark;
+    if (benchmarkMode) {
+        benchmark = std::make_unique<Benchmark>(benchmarkSettings);
+        spdlog::info("Benchmark: {:.0f} s after {:.0f} s of warm-up, results go to {}", benchmarkSettings.duration,
+                     benchmarkSettings.warmup, benchmarkOutput);
+    }
+
+    const uint32_t gpuCullScope = Profiler::Get().RegisterScope("GPU cull", PROFILE_TRACK_GPU);
+    const uint32_t gpuChunksScope = Profiler::Get().RegisterScope("GPU chunks", PROFILE_TRACK_GPU);
+    const uint32_t gpuEntitiesScope = Profiler::Get().RegisterScope("GPU entities", PROFILE_TRACK_GPU);
+    const uint32_t gpuHiZScope = Profiler::Get().RegisterScope("GPU Hi-Z", PROFILE_TRACK_GPU);
+    Profiler::Clock::time_point lastFrameStart = Profiler::Clock::now();
+
     SDL_Event ev;
     do {
+        Profiler::Get().BeginFrame();
+        const float deltaSeconds = std::chrono::duration<float>(Profiler::Get().GetFrameStart() - lastFrameStart).count();
+        lastFrameStart = Profiler::Get().GetFrameStart();
+
+        // Wait for the frame slot first: in low latency mode input is only sampled once the GPU has caught up
+        uint32_t frameSlot;
+        {
+            PROFILE_SCOPE("Frame wait");
+            frameSlot = m_frameScheduler->BeginFrame();
+        }
+        m_gpuProfiler->BeginFrame(frameSlot);
+
         // Poll events
-        while (SDL_PollEvent(&ev)) {
-            switch (ev.type) {
-                case SDL_QUIT: {
-                    m_windowShouldClose = true;
-                    break;
-                }
-                case SDL_WINDOWEVENT: {
-                    switch (ev.window.event) {
-                        case SDL_WINDOWEVENT_RESIZED:
-                        case SDL_WINDOWEVENT_SIZE_CHANGED: {
-                            int newWidth = ev.window.data1, newHeight = ev.window.data2;
-                            OnResize(newWidth, newHeight);
+        {
+            PROFILE_SCOPE("Events");
+            while (SDL_PollEvent(&ev)) {
+                switch (ev.type) {
+                    case SDL_QUIT: {
+                        m_windowShouldClose = true;
+                        break;
+                    }
+                    case SDL_KEYDOWN: {
+                        if (ev.key.keysym.sym == SDLK_F3)
+                            m_profilerOverlay->SetVisible(!m_profilerOverlay->IsVisible());
+                        else if (ev.key.keysym.sym == SDLK_F4)
+                            Profiler::Get().CaptureTrace(120, "pluscraft_trace.json");
+                        break;
+                    }
+                    case SDL_MOUSEBUTTONDOWN: {
+                        // Nothing may change the benchmark's world
+                        if (benchmarkMode)
                             break;
+                        if (ev.button.button == SDL_BUTTON_LEFT || ev.button.button == SDL_BUTTON_RIGHT)
+                            PickBlock(ev.button.x, ev.button.y, ev.button.button == SDL_BUTTON_RIGHT);
+                        break;
+                    }
+                    case SDL_WINDOWEVENT: {
+                        switch (ev.window.event) {
+                            case SDL_WINDOWEVENT_RESIZED:
+                            case SDL_WINDOWEVENT_SIZE_CHANGED: {
+                                int newWidth = ev.window.data1, newHeight = ev.window.data2;
+                                OnResize(newWidth, newHeight);
+                                break;
+                            }
+                            default:
+                                break;
                         }
-                        default:
-                            break;
+                        break;
                     }
-                    break;
+                    default:
+                        break;
                 }
-                default:
-                    break;
             }
         }
 
-        // Render
-        auto *pRTV = m_pSwapChain->GetCurrentBackBufferRTV();
-        auto *pDSV = m_pSwapChain->GetDepthBufferDSV();
+        if (benchmark) {
+            // Resident GPU memory of our own allocations, the device does not tell
+            const uint64_t gpuMemory = m_chunkRenderer->GetPoolStats().bufferBytes +
+                                       m_blockTextures->GetMemoryUsage() + m_uploadQueue->GetCapacity();
+            benchmark->AddFrame(deltaSeconds, {m_chunkStreamer->GetGeneratedCount(),
+                                               m_chunkRenderer->GetMeshedCount(), gpuMemory});
+            if (benchmark->IsFinished())
+                m_windowShouldClose = true;
+        }
 
-        m_pImmediateContext->SetRenderTargets(1, &pRTV, pDSV, dg::RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+        // Slowly orbit the test world, between the last two ticks so the motion stays smooth at any frame rate;
+        // a benchmark flies its own path instead
+        {
+            PROFILE_SCOPE("Camera");
+            m_simulation->GetSnapshot(snapshot);
+            if (benchmark) {
+                const Benchmark::Camera camera = benchmark->GetCamera();
+                m_viewMatrix = dg::float4x4::Translation(-camera.x, -camera.y, -camera.z) *
+                               dg::float4x4::RotationY(camera.yaw) * dg::float4x4::RotationX(0.35f);
+            } else {
+                const float yaw = std::lerp(snapshot.previous.orbitYaw, snapshot.current.orbitYaw, snapshot.alpha);
+                m_viewMatrix = dg::float4x4::Translation(-40.f * std::sin(yaw), -90.f, 40.f * std::cos(yaw)) *
+                               dg::float4x4::RotationY(yaw) * dg::float4x4::RotationX(0.5f);
+            }
+        }
 
-        m_pImmediateContext->ClearRenderTarget(pRTV, ClearColor.Data(), dg::RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
-        m_pImmediateContext->ClearDepthStencil(pDSV, dg::CLEAR_DEPTH_FLAG, 1.f, 0,
-                                               dg::RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+        {
+            PROFILE_SCOPE("Streaming");
+            // The camera's world transform is the inverse view: row 3 is its position, row 2 its forward axis
+            const dg::float4x4 cameraWorld = m_viewMatrix.Inverse();
+            m_chunkStreamer->Update(cameraWorld._41, cameraWorld._43, cameraWorld._31, cameraWorld._33);
+            m_chunkRenderer->UpdateLods(m_world, cameraWorld._41, cameraWorld._43, 2);
+        }
+        // Blocks tick in step with the simulation; after a stall the missed ticks are dropped, not run in a burst
+        {
+            PROFILE_SCOPE("World tick");
+            worldTick = std::max(worldTick, snapshot.current.tick - std::min<uint64_t>(snapshot.current.tick, 2));
+            while (worldTick < snapshot.current.tick)
+                m_worldTicker->Tick(++worldTick);
+            m_lightEngine->Update();
+            m_chunkRenderer->UpdateChangedSections(m_world, 16);
+        }
 
-        uint64_t offset = 0;
-        dg::IBuffer *pBuffs[] = {cubeVertexBuffer};
-        m_pImmediateContext->SetVertexBuffers(0, 1, pBuffs, &offset, dg::RESOURCE_STATE_TRANSITION_MODE_TRANSITION,
-                                              dg::SET_VERTEX_BUFFERS_FLAG_RESET);
-        m_pImmediateContext->SetIndexBuffer(cubeIndexBuffer, 0, dg::RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+        // Finished meshes become visible a few per frame, so a burst of meshing never stalls Present
+        {
+            PROFILE_SCOPE("Mesh upload");
+            m_blockTextures->Update(m_pImmediateContext);
+            m_chunkRenderer->Update(m_pImmediateContext, 32, 2 << 20);
+        }
 
-        m_pImmediateContext->SetPipelineState(m_pPSO);
+        const dg::float4x4 viewProj = m_modelMatrix * m_viewMatrix * m_projMatrix;
+        auto *pRTV = m_pSwapChain->GetCurrentBackBufferRTV();
+        auto *pDSV = m_hiZBuffer->GetDepthDSV();
+        {
+            PROFILE_SCOPE("Recording");
+
+            // All of this frame's constants go through one map of the uniform ring
+            m_uniformRing->BeginFrame(m_pImmediateContext);
+            m_chunkRenderer->PrepareFrame(viewProj, frameSlot);
+            m_entityRenderer->PrepareFrame(viewProj, snapshot.alpha);
+            m_uniformRing->EndFrame(m_pImmediateContext);
+
+            {
+                GpuProfileScope gpuScope(*m_gpuProfiler, m_pImmediateContext, gpuCullScope);
+                m_chunkRenderer->Cull(m_pImmediateContext);
+            }
 
-        m_modelMatrix = dg::float4x4::RotationY(SDL_GetTicks() / 500.f) * dg::float4x4::Translation(0.f, 0.f, 5.f);
+            // Render
+            m_pImmediateContext->SetRenderTargets(1, &pRTV, pDSV, dg::RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
 
+            m_pImmediateContext->ClearRenderTarget(pRTV, ClearColor.Data(),
+                                                   dg::RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+            m_pImmediateContext->ClearDepthStencil(pDSV, dg::CLEAR_DEPTH_FLAG, 1.f, 0,
+                                                   dg::RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+
+            {
+                GpuProfileScope gpuScope(*m_gpuProfiler, m_pImmediateContext, gpuChunksScope);
+                m_chunkRenderer->Render(m_pImmediateContext, pRTV, pDSV);
+            }
+            {
+                GpuProfileScope gpuScope(*m_gpuProfiler, m_pImmediateContext, gpuEntitiesScope);
+                m_entityRenderer->Render(m_pImmediateContext, snapshot.entities);
+            }
+        }
         {
-            dg::MapHelper<dg::float4x4> CBConstants(m_pImmediateContext, m_pVSConstants, dg::MAP_WRITE,
-                                                    dg::MAP_FLAG_DISCARD);
-            *CBConstants = (m_modelMatrix * m_viewMatrix * m_projMatrix).Transpose();
+            PROFILE_SCOPE("Overlay");
+            const auto &SCDesc = m_pSwapChain->GetDesc();
+            m_profilerOverlay->Render(m_pImmediateContext, SCDesc.Width, SCDesc.Height, deltaSeconds);
+        }
+        // Next frame culls against this frame's depth; the depth buffer is read, so it is unbound first
+        {
+            GpuProfileScope gpuScope(*m_gpuProfiler, m_pImmediateContext, gpuHiZScope);
+            m_pImmediateContext->SetRenderTargets(0, nullptr, nullptr, dg::RESOURCE_STATE_TRANSITION_MODE_NONE);
+            m_hiZBuffer->Build(m_pImmediateContext, viewProj);
         }
 
-        m_pImmediateContext->CommitShaderResources(m_pSRB, dg::RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+        m_uploadQueue->EndFrame();
+        m_frameScheduler->EndFrame(m_pImmediateContext);
+        {
+            PROFILE_SCOPE("Present");
+            m_pSwapChain->Present(videoMode.syncInterval);
+        }
 
-        dg::DrawIndexedAttribs drawAttrs;
-        drawAttrs.IndexType = dg::VT_UINT32;
-        drawAttrs.NumIndices = 36;
-        drawAttrs.Flags = dg::DRAW_FLAG_VERIFY_ALL;
-        m_pImmediateContext->DrawIndexed(drawAttrs);
+        // Deferred contexts release their per-frame dynamic memory here
+        for (auto &pContext: m_pDeferredContexts)
+            pContext->FinishFrame();
+        // So does the transfer context, which never presents
+        if (m_pTransferContext)
+            m_pTransferContext->FinishFrame();
+        // Frame scratch of the render thread
+        GetThreadArena().Reset();
 
-        m_pSwapChain->Present(videoMode.syncInterval);
+        Profiler::Get().EndFrame();
     } while (!m_windowShouldClose);
 
-    return 0;
+    int exitCode = 0;
+    if (benchmark) {
+        const Benchmark::RunInfo info{dg::GetRenderDeviceTypeString(m_pDevice->GetDeviceInfo().Type),
+                                      m_pDevice->GetAdapterInfo().Description, m_pSwapChain->GetDesc().Width,
+                                      m_pSwapChain->GetDesc().Height, WORLD_SEED};
+        // A run closed early has nothing to compare
+        if (!benchmark->IsFinished() || !benchmark->WriteResults(benchmarkOutput, info))
+            exitCode = -6;
+    }
+
+    m_frameScheduler->WaitIdle();
+    m_simulation.reset();
+    m_worldTicker.reset();
+    m_chunkStreamer.reset();
+    m_lightEngine.reset();
+    m_jobSystem->WaitIdle();
+    for (const auto &[pos, chunk]: m_world.GetChunks()) {
+        if (chunk->IsDirty())
+            m_regionStorage->SaveChunk(*chunk);
+    }
+    m_regionStorage->Flush();
+    m_regionStorage.reset();
+    m_profilerOverlay.reset();
+    m_gpuProfiler.reset();
+    m_entityRenderer.reset();
+    m_chunkRenderer.reset();
+    m_uploadQueue.reset();
+    m_hiZBuffer.reset();
+    m_blockTextures.reset();
+    m_pipelineCache.reset();
+    m_pDeferredContexts.clear();
+    m_pTransferContext.Release();
+    m_uniformRing.reset();
+    m_frameScheduler.reset();
+    m_jobSystem.reset();
+    // The OpenGL context has to outlive the device
+    ReleaseGraphicsEngine();
+
+    return exitCode;
 }
@@ -0,0 +1,208 @@
+#include "net/Connection.h"
+
+#include <algorithm>
+#include <utility>
+
+namespace {
+    // Frame header with the body size as a three byte varint, the most MAX_PACKET_BODY takes
+    constexpr size_t RESERVED_HEADER = 4;
+    constexpr size_t MAX_GATHER = 64;
+    constexpr size_t RECEIVE_BLOCK = 64 << 10;
+}
+
+Connection::Connection(Socket socket) : m_socket(std::move(socket)), m_peerName(m_socket.GetPeerName()) {}
+
+PacketWriter Connection::BeginPacket(const PacketType type) {
+    m_packetStart = m_buffer.size();
+    m_buffer.resize(m_packetStart + RESERVED_HEADER);
+    m_buffer[m_packetStart] = type;
+    return PacketWriter(m_buffer);
+}
+
+bool Connection::EndPacket() {
+    const size_t bodyStart = m_packetStart + RESERVED_HEADER;
+    const size_t bodySize = m_buffer.size() - bodyStart;
+    if (bodySize > MAX_PACKET_BODY) {
+        m_buffer.resize(m_packetStart);
+        return false;
+    }
+
+    // Shorter varints move the body down over the unused header bytes, small packets are the common case
+    uint8_t size[RESERVED_HEADER];
+    size_t sizeBytes = 0;
+    for (size_t value = bodySize; sizeBytes == 0 || value != 0; value >>= 7)
+        size[sizeBytes++] = static_cast<uint8_t>((value & 0x7f) | (value >= 0x80 ? 0x80 : 0));
+    std::copy_n(size, sizeBytes, m_buffer.begin() + m_packetStart + 1);
+    const size_t headerSize = 1 + sizeBytes;
+    if (headerSize < RESERVED_HEADER) {
+        std::copy(m_buffer.begin() + bodyStart, m_buffer.end(), m_buffer.begin() + m_packetStart + headerSize);
+        m_buffer.resize(m_buffer.size() - (RESERVED_HEADER - headerSize));
+    }
+    QueueWritten();
+    return true;
+}
+
+bool Connection::SendShared(const PacketType type, const uint8_t *header, const size_t headerSize, SharedData data) {
+    if (headerSize + data->size() > MAX_PACKET_BODY)
+        return false;
+    WriteHeader(type, headerSize + data->size());
+    PacketWriter(m_buffer).WriteBytes(header, headerSize);
+    QueueWritten();
+
+    m_queuedBytes += data->size();
+    Segment segment;
+    segment.shared = std::move(data);
+    m_segments.push_back(std::move(segment));
+    return true;
+}
+
+void Connection::WriteHeader(const PacketType type, const size_t bodySize) {
+    PacketWriter writer(m_buffer);
+    writer.WriteU8(type);
+    writer.WriteVarUint(bodySize);
+}
+
+void Connection::QueueWritten() {
+    const size_t end = m_buffer.size();
+    if (end == m_queuedEnd)
+        return;
+    m_queuedBytes += end - m_queuedEnd;
+    if (m_head < m_segments.size() && !m_segments.back().shared) {
+        m_segments.back().end = end;
+    } else {
+        Segment segment;
+        segment.begin = m_queuedEnd;
+        segment.end = end;
+        m_segments.push_back(std::move(segment));
+    }
+    m_queuedEnd = end;
+}
+
+bool Connection::Flush() {
+    if (!IsOpen())
+        return false;
+
+    while (m_head < m_segments.size()) {
+        Socket::Buffer buffers[MAX_GATHER];
+        size_t count = 0, offered = 0;
+        for (size_t i = m_head; i < m_segments.size() && count < MAX_GATHER; ++i) {
+            const Segment &segment = m_segments[i];
+            const uint8_t *data = segment.shared ? segment.shared->data() : m_buffer.data() + segment.begin;
+            const size_t size = segment.shared ? segment.shared->size() : segment.end - segment.begin;
+            buffers[count++] = {data + segment.offset, size - segment.offset};
+            offered += size - segment.offset;
+        }
+
+        const int64_t sent = m_socket.Send(buffers, count);
+        if (sent < 0) {
+            Close();
+            return false;
+        }
+        m_bytesSent += sent;
+        m_queuedBytes -= static_cast<size_t>(sent);
+
+        size_t remaining = static_cast<size_t>(sent);
+        for (size_t i = 0; i < count; ++i) {
+            Segment &segment = m_segments[m_head];
+            if (remaining < buffers[i].size) {
+                segment.offset += remaining;
+                break;
+            }
+            remaining -= buffers[i].size;
+            segment.shared.reset();
+            ++m_head;
+        }
+        // The socket buffer is full
+        if (static_cast<size_t>(sent) < offered)
+            break;
+    }
+
+    Compact();
+    return true;
+}
+
+void Connection::Compact() {
+    if (m_head == m_segments.size()) {
+        m_segments.clear();
+        m_buffer.clear();
+        m_head = 0;
+        m_queuedEnd = 0;
+        return;
+    }
+    if (m_head == 0)
+        return;
+    m_segments.erase(m_segments.begin(), m_segments.begin() + static_cast<ptrdiff_t>(m_head));
+    m_head = 0;
+
+    // Bytes before the first inline segment left are sent; only worth moving once they are most of the buffer
+    size_t sent = m_queuedEnd;
+    for (const Segment &segment: m_segments) {
+        if (!segment.shared) {
+            sent = segment.begin;
+            break;
+        }
+    }
+    if (sent < m_buffer.size() / 2)
+        return;
+    m_buffer.erase(m_buffer.begin(), m_buffer.begin() + static_cast<ptrdiff_t>(sent));
+    for (Segment &segment: m_segments) {
+        if (!segment.shared) {
+            segment.begin -= sent;
+            segment.end -= sent;
+        }
+    }
+    m_queuedEnd -= sent;
+}
+
+bool Connection::Receive() {
+    // Bodies handed out so far are no longer in use
+    m_received.erase(m_received.begin(), m_received.begin() + static_cast<ptrdiff_t>(m_consumed));
+    m_consumed = 0;
+    if (!IsOpen())
+        return false;
+
+    // A peer sending faster than packets are handled is read no further ahead than one maximum packet
+    while (m_received.size() < MAX_PACKET_BODY + RESERVED_HEADER) {
+        const size_t size = m_received.size();
+        m_received.resize(size + RECEIVE_BLOCK);
+        const int64_t received = m_socket.Receive(m_received.data() + size, RECEIVE_BLOCK);
+        m_received.resize(size + static_cast<size_t>(std::max<int64_t>(received, 0)));
+        if (received < 0) {
+            Close();
+            return false;
+        }
+        m_bytesReceived += static_cast<uint64_t>(received);
+        if (static_cast<size_t>(received) < RECEIVE_BLOCK)
+            break;
+    }
+    return true;
+}
+
+bool Connection::NextPacket(PacketType &type, PacketReader &body) {
+    PacketReader frame(m_received.data() + m_consumed, m_received.size() - m_consumed);
+    uint8_t rawType = 0;
+    uint64_t bodySize = 0;
+    if (!frame.ReadU8(rawType))
+        return false;
+    if (!frame.ReadVarUint(bodySize)) {
+        // A size longer than three bytes is broken, a shorter one may just be incomplete
+        if (m_received.size() - m_consumed >= RESERVED_HEADER)
+            Close();
+        return false;
+    }
+    if (rawType >= PACKET_TYPE_COUNT || bodySize > MAX_PACKET_BODY) {
+        Close();
+        return false;
+    }
+    if (frame.GetRemainingSize() < bodySize)
+        return false;
+
+    type = static_cast<PacketType>(rawType);
+    body = PacketReader(frame.GetRemaining(), static_cast<size_t>(bodySize));
+    m_consumed = static_cast<size_t>(frame.GetRemaining() - m_received.data()) + static_cast<size_t>(bodySize);
+    return true;
+}
+
+void Connection::Close() {
+    m_socket.Close();
+}
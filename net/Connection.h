@@ -0,0 +1,82 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "core/Socket.h"
+#include "net/Protocol.h"
+
+// Framed packets over a socket.
+// Packets written between two Flush() calls pile up in one buffer and go out together in a single gathered send,
+// so a tick's worth of small packets costs one system call and as few TCP segments as they fit in.
+// Shared data (chunk payloads sent to many players) is referenced by the queue and never copied; the socket
+// takes it straight from the shared buffer.
+// Whatever the socket does not take stays queued for the next Flush(). GetQueuedBytes() is how callers notice
+// a slow peer and hold back bulk data instead of queueing without bound.
+class Connection {
+public:
+    using SharedData = std::shared_ptr<const std::vector<uint8_t>>;
+
+    explicit Connection(Socket socket);
+
+    // The body goes into the returned writer until EndPacket(); no other packet may be started meanwhile.
+    // Bodies over MAX_PACKET_BODY would break the framing, such a packet is dropped and EndPacket() returns false
+    PacketWriter BeginPacket(PacketType type);
+    bool EndPacket();
+    // Packet whose body is header followed by data; only the header is copied. False, sending nothing, when the
+    // body is over MAX_PACKET_BODY
+    bool SendShared(PacketType type, const uint8_t *header, size_t headerSize, SharedData data);
+
+    // Sends what the socket takes; false once the connection failed
+    bool Flush();
+
+    // Reads whatever arrived; false once the connection is closed
+    bool Receive();
+    // Next complete packet received, its body is valid until the next Receive(); false when there is none.
+    // A peer that broke the framing is disconnected.
+    bool NextPacket(PacketType &type, PacketReader &body);
+
+    void Close();
+    bool IsOpen() const { return m_socket.IsOpen(); }
+    const std::string &GetPeerName() const { return m_peerName; }
+
+    size_t GetQueuedBytes() const { return m_queuedBytes; }
+    uint64_t GetBytesSent() const { return m_bytesSent; }
+    uint64_t GetBytesReceived() const { return m_bytesReceived; }
+
+private:
+    // Either bytes of m_buffer or shared data, of which offset bytes were already sent
+    struct Segment {
+        size_t begin = 0, end = 0;
+        SharedData shared;
+        size_t offset = 0;
+    };
+
+    void WriteHeader(PacketType type, size_t bodySize);
+    // Queues the bytes written to m_buffer since the last call
+    void QueueWritten();
+    // Drops what was sent
+    void Compact();
+
+    Socket m_socket;
+    std::string m_peerName;
+
+    std::vector<uint8_t> m_buffer;
+    std::vector<Segment> m_segments;
+    // First segment not sent completely
+    size_t m_head = 0;
+    // Bytes of m_buffer in segments
+    size_t m_queuedEnd = 0;
+    size_t m_queuedBytes = 0;
+    // Start of the packet being written
+    size_t m_packetStart = 0;
+
+    std::vector<uint8_t> m_received;
+    // Bytes of m_received handed out by NextPacket()
+    size_t m_consumed = 0;
+
+    uint64_t m_bytesSent = 0;
+    uint64_t m_bytesReceived = 0;
+};
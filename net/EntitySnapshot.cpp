@@ -0,0 +1,201 @@
+#include "net/EntitySnapshot.h"
+
+#include <cmath>
+#include <numbers>
+#include <type_traits>
+
+namespace {
+    enum DeltaFlags : uint8_t {
+        DELTA_NEW = 1 << 0,
+        DELTA_X = 1 << 1,
+        DELTA_Y = 1 << 2,
+        DELTA_Z = 1 << 3,
+        DELTA_YAW = 1 << 4
+    };
+
+    constexpr float YAW_SCALE = 65536.f / (2.f * std::numbers::pi_v<float>);
+
+    int32_t QuantizePosition(const float value) {
+        return static_cast<int32_t>(std::lround(value * POSITION_SCALE));
+    }
+
+    bool IsSameEntity(const NetEntity &a, const NetEntity &b) {
+        return a.index == b.index && a.generation == b.generation;
+    }
+
+    // Entries of baseline that are also in current, in lockstep with it; nullptr for the others
+    template<typename Fn>
+    void Match(const EntitySnapshot &baseline, const EntitySnapshot &current, Fn &&fn) {
+        size_t b = 0;
+        for (const NetEntity &entity: current) {
+            while (b < baseline.size() && baseline[b].index < entity.index)
+                ++b;
+            const bool found = b < baseline.size() && IsSameEntity(baseline[b], entity);
+            fn(entity, found ? &baseline[b] : nullptr);
+        }
+    }
+}
+
+NetEntity QuantizeEntity(const EntityInstance &instance) {
+    NetEntity entity;
+    entity.index = instance.entity.index;
+    entity.generation = instance.entity.generation;
+    entity.x = QuantizePosition(instance.to.x);
+    entity.y = QuantizePosition(instance.to.y);
+    entity.z = QuantizePosition(instance.to.z);
+    // Wrapping is what the 16 bits are for, unwrapped yaw keeps growing
+    entity.yaw = static_cast<uint16_t>(static_cast<int64_t>(std::lround(instance.to.yaw * YAW_SCALE)));
+    entity.mesh = instance.mesh;
+    entity.block = instance.block;
+    return entity;
+}
+
+Transform DequantizeTransform(const NetEntity &entity) {
+    Transform transform;
+    transform.x = static_cast<float>(entity.x) / POSITION_SCALE;
+    transform.y = static_cast<float>(entity.y) / POSITION_SCALE;
+    transform.z = static_cast<float>(entity.z) / POSITION_SCALE;
+    transform.yaw = static_cast<float>(entity.yaw) / YAW_SCALE;
+    return transform;
+}
+
+void WriteEntityDelta(PacketWriter &writer, const EntitySnapshot &baseline, const EntitySnapshot &current) {
+    // Baseline entities current lacks, or has under a newer generation
+    std::vector<uint32_t> removed;
+    size_t c = 0;
+    for (const NetEntity &entity: baseline) {
+        while (c < current.size() && current[c].index < entity.index)
+            ++c;
+        if (c == current.size() || !IsSameEntity(current[c], entity))
+            removed.push_back(entity.index);
+    }
+    writer.WriteVarUint(removed.size());
+    uint32_t previous = 0;
+    for (const uint32_t index: removed) {
+        writer.WriteVarUint(index - previous);
+        previous = index;
+    }
+
+    size_t changed = 0;
+    Match(baseline, current, [&](const NetEntity &entity, const NetEntity *pBase) {
+        if (!pBase || pBase->x != entity.x || pBase->y != entity.y || pBase->z != entity.z || pBase->yaw != entity.yaw)
+            ++changed;
+    });
+    writer.WriteVarUint(changed);
+
+    previous = 0;
+    Match(baseline, current, [&](const NetEntity &entity, const NetEntity *pBase) {
+        uint8_t flags = 0;
+        if (!pBase) {
+            flags = DELTA_NEW;
+        } else {
+            flags |= pBase->x != entity.x ? DELTA_X : 0;
+            flags |= pBase->y != entity.y ? DELTA_Y : 0;
+            flags |= pBase->z != entity.z ? DELTA_Z : 0;
+            flags |= pBase->yaw != entity.yaw ? DELTA_YAW : 0;
+            if (flags == 0)
+                return;
+        }
+        writer.WriteVarUint(entity.index - previous);
+        previous = entity.index;
+        writer.WriteU8(flags);
+
+        if (flags & DELTA_NEW) {
+            writer.WriteVarUint(entity.generation);
+            writer.WriteU8(entity.mesh);
+            writer.WriteVarUint(entity.block);
+            writer.WriteVarInt(entity.x);
+            writer.WriteVarInt(entity.y);
+            writer.WriteVarInt(entity.z);
+            writer.WriteU16(entity.yaw);
+            return;
+        }
+        if (flags & DELTA_X)
+            writer.WriteVarInt(static_cast<int64_t>(entity.x) - pBase->x);
+        if (flags & DELTA_Y)
+            writer.WriteVarInt(static_cast<int64_t>(entity.y) - pBase->y);
+        if (flags & DELTA_Z)
+            writer.WriteVarInt(static_cast<int64_t>(entity.z) - pBase->z);
+        if (flags & DELTA_YAW)
+            writer.WriteVarInt(static_cast<int16_t>(static_cast<uint16_t>(entity.yaw - pBase->yaw)));
+    });
+}
+
+bool ReadEntityDelta(PacketReader &reader, const EntitySnapshot &baseline, EntitySnapshot &current) {
+    current.clear();
+
+    uint32_t removedCount = 0;
+    if (!reader.ReadVar(removedCount) || removedCount > baseline.size())
+        return false;
+    std::vector<uint32_t> removed(removedCount);
+    uint32_t previous = 0;
+    for (uint32_t &index: removed) {
+        uint32_t step = 0;
+        if (!reader.ReadVar(step))
+            return false;
+        index = previous + step;
+        previous = index;
+    }
+
+    uint32_t changedCount = 0;
+    if (!reader.ReadVar(changedCount) || changedCount > MAX_PACKET_BODY)
+        return false;
+    current.reserve(baseline.size() - removedCount + changedCount);
+
+    // Merge: baseline entities that were neither removed nor changed carry over as they are
+    size_t b = 0, r = 0;
+    const auto carryOverUntil = [&](const uint64_t index) {
+        for (; b < baseline.size() && baseline[b].index < index; ++b) {
+            while (r < removed.size() && removed[r] < baseline[b].index)
+                ++r;
+            if (r == removed.size() || removed[r] != baseline[b].index)
+                current.push_back(baseline[b]);
+        }
+    };
+
+    previous = 0;
+    for (uint32_t i = 0; i < changedCount; ++i) {
+        uint32_t step = 0;
+        uint8_t flags = 0;
+        if (!reader.ReadVar(step) || !reader.ReadU8(flags))
+            return false;
+        NetEntity entity;
+        entity.index = previous + step;
+        if ((i > 0 && step == 0) || entity.index < previous)
+            return false;
+        previous = entity.index;
+        carryOverUntil(entity.index);
+
+        if (flags & DELTA_NEW) {
+            uint8_t mesh = 0;
+            if (!reader.ReadVar(entity.generation) || !reader.ReadU8(mesh) || mesh >= ENTITY_MESH_COUNT ||
+                !reader.ReadVar(entity.block) || !reader.ReadVar(entity.x) || !reader.ReadVar(entity.y) ||
+                !reader.ReadVar(entity.z) || !reader.ReadU16(entity.yaw) || !IsValidBlock(entity.block))
+                return false;
+            entity.mesh = static_cast<EntityMesh>(mesh);
+            // A new generation replaces the baseline entry, which the server listed as removed
+            if (b < baseline.size() && baseline[b].index == entity.index)
+                ++b;
+        } else {
+            if (b == baseline.size() || baseline[b].index != entity.index)
+                return false;
+            entity = baseline[b++];
+            const auto readDelta = [&](const uint8_t flag, auto &value) {
+                int64_t delta = 0;
+                if (!(flags & flag))
+                    return true;
+                if (!reader.ReadVarInt(delta))
+                    return false;
+                // Yaw wraps around like it did when the server took the difference
+                value = static_cast<std::remove_reference_t<decltype(value)>>(value + delta);
+                return true;
+            };
+            if (!readDelta(DELTA_X, entity.x) || !readDelta(DELTA_Y, entity.y) || !readDelta(DELTA_Z, entity.z) ||
+                !readDelta(DELTA_YAW, entity.yaw))
+                return false;
+        }
+        current.push_back(entity);
+    }
+    carryOverUntil(UINT64_MAX);
+    return reader.IsAtEnd();
+}
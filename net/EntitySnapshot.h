@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "net/Protocol.h"
+#include "world/Entities.h"
+
+// Entity as sent: its handle, a quantized transform and its looks.
+// Positions are in 1/POSITION_SCALE blocks, yaw in 1/65536 turns.
+struct NetEntity {
+    uint32_t index = 0, generation = 0;
+    int32_t x = 0, y = 0, z = 0;
+    uint16_t yaw = 0;
+    EntityMesh mesh = ENTITY_MESH_MOB;
+    BlockId block = BLOCK_AIR;
+};
+
+// Entities sorted by index
+using EntitySnapshot = std::vector<NetEntity>;
+
+// Most entities a snapshot may hold, so that a delta against a baseline of the same limit always fits a packet:
+// per entity at most one removal (5 bytes) and one new entry (32 bytes), plus the packet's ticks and counts
+constexpr uint32_t MAX_SNAPSHOT_ENTITIES = 32768;
+static_assert(4 * 10 + MAX_SNAPSHOT_ENTITIES * (5 + 32) <= MAX_PACKET_BODY);
+
+// Of the transform the instance ends up at
+NetEntity QuantizeEntity(const EntityInstance &instance);
+// Yaw in [0, 2 pi)
+Transform DequantizeTransform(const NetEntity &entity);
+
+// Writes current as the changes from baseline. Entities that did not change cost nothing; moved ones cost their
+// index step, a flag byte and a small varint per changed coordinate; new ones are written in full.
+//   varint removed count, per removed entity: varint index step
+//   varint changed count, per changed entity: varint index step, u8 flags, then
+//     new: varint generation, u8 mesh, varint block, zigzag x, y, z, u16 yaw
+//     otherwise, for each flagged field: zigzag difference (yaw: of the 16 bit values, wrapped)
+// Index steps are from the previous index in the same list, or from 0.
+void WriteEntityDelta(PacketWriter &writer, const EntitySnapshot &baseline, const EntitySnapshot &current);
+// Rebuilds current from the baseline the server used; false on malformed input
+bool ReadEntityDelta(PacketReader &reader, const EntitySnapshot &baseline, EntitySnapshot &current);
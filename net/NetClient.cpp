@@ -0,0 +1,201 @@
+#include "net/NetClient.h"
+
+#include <cmath>
+#include <numbers>
+
+#include <spdlog/spdlog.h>
+
+#include "world/ChunkSerializer.h"
+
+namespace {
+    // The server keeps as many, older ones cannot be baselines anyway
+    constexpr size_t MAX_SNAPSHOT_HISTORY = 64;
+
+    bool ReadChunkPos(PacketReader &body, ChunkPos &pos) {
+        return body.ReadVar(pos.x) && body.ReadVar(pos.z);
+    }
+}
+
+NetClient::NetClient(World &world) : m_world(world) {}
+
+bool NetClient::Connect(const std::string &host, const uint16_t port, const int viewRadius) {
+    Socket socket = Socket::Connect(host, port);
+    if (!socket.IsOpen()) {
+        spdlog::error("Failed to connect to {}:{}", host, port);
+        return false;
+    }
+    m_connection = std::make_unique<Connection>(std::move(socket));
+    m_joined = false;
+
+    PacketWriter writer = m_connection->BeginPacket(PACKET_HELLO);
+    writer.WriteVarUint(PROTOCOL_VERSION);
+    writer.WriteVarUint(static_cast<uint32_t>(std::max(1, viewRadius)));
+    m_connection->EndPacket();
+    m_connection->Flush();
+    spdlog::info("Connected to {}", m_connection->GetPeerName());
+    return true;
+}
+
+void NetClient::Update(const float x, const float y, const float z) {
+    if (!IsConnected())
+        return;
+
+    m_connection->Receive();
+    PacketType type;
+    PacketReader body;
+    while (m_connection->NextPacket(type, body))
+        HandlePacket(type, body);
+
+    if (m_joined) {
+        PacketWriter writer = m_connection->BeginPacket(PACKET_PLAYER_STATE);
+        writer.WriteVarUint(m_entityTick);
+        writer.WriteVarInt(std::lround(x * POSITION_SCALE));
+        writer.WriteVarInt(std::lround(y * POSITION_SCALE));
+        writer.WriteVarInt(std::lround(z * POSITION_SCALE));
+        m_connection->EndPacket();
+    }
+    if (!m_connection->Flush())
+        spdlog::warn("Lost the connection to the server");
+}
+
+void NetClient::TakeLoadedChunks(std::vector<ChunkPos> &out) {
+    out.insert(out.end(), m_loaded.begin(), m_loaded.end());
+    m_loaded.clear();
+}
+
+void NetClient::TakeUnloadedChunks(std::vector<ChunkPos> &out) {
+    out.insert(out.end(), m_unloaded.begin(), m_unloaded.end());
+    m_unloaded.clear();
+}
+
+void NetClient::HandlePacket(const PacketType type, PacketReader &body) {
+    bool valid = false;
+    if (type == PACKET_WELCOME && !m_joined) {
+        uint32_t version = 0, viewRadius = 0;
+        valid = body.ReadVar(version) && body.ReadVar(m_tickRate) && body.ReadVar(viewRadius) &&
+                version == PROTOCOL_VERSION;
+        m_joined = valid;
+        if (valid)
+            spdlog::info("Joined the server, {} ticks per second, view radius {}", m_tickRate, viewRadius);
+    } else if (m_joined) {
+        switch (type) {
+            case PACKET_CHUNK:
+                valid = ReadChunk(body, false);
+                break;
+            case PACKET_CHUNK_SECTIONS:
+                valid = ReadChunk(body, true);
+                break;
+            case PACKET_BLOCK_CHANGES:
+                valid = ReadBlockChanges(body);
+                break;
+            case PACKET_UNLOAD_CHUNK: {
+                ChunkPos pos;
+                valid = ReadChunkPos(body, pos) && body.IsAtEnd();
+                if (valid && m_world.RemoveChunk(pos))
+                    m_unloaded.push_back(pos);
+                break;
+            }
+            case PACKET_ENTITIES:
+                valid = ReadEntities(body);
+                break;
+            default:
+                break;
+        }
+    }
+    if (!valid) {
+        spdlog::error("Malformed or unexpected packet {} from the server, disconnecting", static_cast<int>(type));
+        m_connection->Close();
+    }
+}
+
+bool NetClient::ReadChunk(PacketReader &body, const bool sections) {
+    ChunkPos pos;
+    uint16_t mask = (1u << Chunk::SECTION_COUNT) - 1;
+    if (!ReadChunkPos(body, pos) || (sections && !body.ReadU16(mask)))
+        return false;
+    if (!DecompressChunkPayload(body.GetRemaining(), body.GetRemainingSize(), m_payload))
+        return false;
+
+    if (!sections) {
+        auto chunk = std::make_unique<Chunk>(pos);
+        if (!DeserializeChunk(m_payload.data(), m_payload.size(), *chunk))
+            return false;
+        m_world.InsertChunk(std::move(chunk));
+    } else {
+        // Sections of a chunk dropped meanwhile are of no use
+        Chunk *chunk = m_world.GetChunk(pos);
+        if (!chunk)
+            return true;
+        if (!DeserializeSections(m_payload.data(), m_payload.size(), mask, *chunk))
+            return false;
+    }
+    m_loaded.push_back(pos);
+    return true;
+}
+
+bool NetClient::ReadBlockChanges(PacketReader &body) {
+    ChunkPos pos;
+    uint32_t count = 0;
+    if (!ReadChunkPos(body, pos) || !body.ReadVar(count) || body.GetRemainingSize() != count * size_t{4})
+        return false;
+    for (uint32_t i = 0; i < count; ++i) {
+        uint16_t local = 0, id = 0;
+        body.ReadU16(local);
+        body.ReadU16(id);
+        if (!IsValidBlock(id))
+            return false;
+        m_world.SetBlock(pos.x * Chunk::SIZE + (local & 15), local >> 8, pos.z * Chunk::SIZE + (local >> 4 & 15),
+                         static_cast<BlockId>(id));
+    }
+    return true;
+}
+
+bool NetClient::ReadEntities(PacketReader &body) {
+    uint64_t tick = 0, baselineTick = 0;
+    if (!body.ReadVarUint(tick) || !body.ReadVarUint(baselineTick) || tick <= m_entityTick)
+        return false;
+
+    static const EntitySnapshot EMPTY;
+    const EntitySnapshot *pBaseline = baselineTick == 0 ? &EMPTY : nullptr;
+    for (const auto &[snapshotTick, snapshot]: m_snapshots) {
+        if (snapshotTick == baselineTick)
+            pBaseline = &snapshot;
+    }
+    if (!pBaseline)
+        return false;
+    EntitySnapshot current;
+    if (!ReadEntityDelta(body, *pBaseline, current))
+        return false;
+
+    // Blend from the previous snapshot; entities new to it start where they are
+    const EntitySnapshot *pPrevious = m_snapshots.empty() ? &EMPTY : &m_snapshots.back().second;
+    m_instances.clear();
+    size_t p = 0;
+    for (const NetEntity &entity: current) {
+        while (p < pPrevious->size() && (*pPrevious)[p].index < entity.index)
+            ++p;
+        EntityInstance instance;
+        instance.entity = {entity.index, entity.generation};
+        instance.to = DequantizeTransform(entity);
+        instance.from = instance.to;
+        if (p < pPrevious->size() && (*pPrevious)[p].index == entity.index &&
+            (*pPrevious)[p].generation == entity.generation) {
+            instance.from = DequantizeTransform((*pPrevious)[p]);
+            // The shorter way round, yaw is only unwrapped within the pair
+            instance.to.yaw = instance.from.yaw +
+                              std::remainder(instance.to.yaw - instance.from.yaw, 2.f * std::numbers::pi_v<float>);
+        }
+        instance.mesh = entity.mesh;
+        instance.block = entity.block;
+        m_instances.push_back(instance);
+    }
+
+    // Baselines only move forward, anything older than this one is done with
+    while (!m_snapshots.empty() && m_snapshots.front().first < baselineTick)
+        m_snapshots.pop_front();
+    m_snapshots.emplace_back(tick, std::move(current));
+    while (m_snapshots.size() > MAX_SNAPSHOT_HISTORY)
+        m_snapshots.pop_front();
+    m_entityTick = tick;
+    return true;
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "net/Connection.h"
+#include "net/EntitySnapshot.h"
+#include "world/World.h"
+
+// Client end of the protocol, run by the thread that owns the world.
+// Chunks and block changes the server sends are applied to the world; entity snapshots are decoded against the
+// baseline the server picked and every one received is acknowledged, so the next can be a delta against it.
+class NetClient {
+public:
+    explicit NetClient(World &world);
+
+    NetClient(const NetClient &) = delete;
+    NetClient &operator=(const NetClient &) = delete;
+
+    // Blocks until connected; false when the server cannot be reached
+    bool Connect(const std::string &host, uint16_t port, int viewRadius);
+    bool IsConnected() const { return m_connection && m_connection->IsOpen(); }
+    bool HasJoined() const { return m_joined; }
+
+    // Applies everything that arrived, then sends the player position in blocks and the acknowledgement
+    void Update(float x, float y, float z);
+
+    // Chunks received whole or in sections since the last call, they need meshing
+    void TakeLoadedChunks(std::vector<ChunkPos> &out);
+    // Chunks the server dropped since the last call, they are gone from the world
+    void TakeUnloadedChunks(std::vector<ChunkPos> &out);
+
+    // Entities of the newest snapshot, blended from where they were in the one before
+    const std::vector<EntityInstance> &GetEntities() const { return m_instances; }
+    uint64_t GetEntityTick() const { return m_entityTick; }
+    uint32_t GetTickRate() const { return m_tickRate; }
+
+private:
+    void HandlePacket(PacketType type, PacketReader &body);
+    bool ReadChunk(PacketReader &body, bool sections);
+    bool ReadBlockChanges(PacketReader &body);
+    bool ReadEntities(PacketReader &body);
+
+    World &m_world;
+    std::unique_ptr<Connection> m_connection;
+    bool m_joined = false;
+    uint32_t m_tickRate = 0;
+
+    std::vector<ChunkPos> m_loaded;
+    std::vector<ChunkPos> m_unloaded;
+    std::vector<uint8_t> m_payload;
+
+    // Snapshots the server may still use as baselines, oldest first
+    std::deque<std::pair<uint64_t, EntitySnapshot>> m_snapshots;
+    uint64_t m_entityTick = 0;
+    std::vector<EntityInstance> m_instances;
+};
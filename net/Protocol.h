@@ -0,0 +1,148 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <type_traits>
+#include <vector>
+
+// Client/server protocol over TCP. Every packet is framed as
+//   u8 type, varint body size, body
+// Integers in bodies are LEB128 varints, signed ones zigzag encoded first, fixed-size ones little-endian.
+// Positions in blocks are sent as integers of 1/POSITION_SCALE blocks.
+constexpr uint32_t PROTOCOL_VERSION = 1;
+constexpr uint16_t DEFAULT_PORT = 25570;
+// Bodies must fit a three byte varint; larger ones are a protocol error
+constexpr uint32_t MAX_PACKET_BODY = (1u << 21) - 1;
+constexpr float POSITION_SCALE = 32.f;
+
+enum PacketType : uint8_t {
+    // Client to server
+    // varint version, varint view radius in chunks
+    PACKET_HELLO,
+    // varint tick of the newest entity snapshot received, zigzag x, y, z of the player
+    PACKET_PLAYER_STATE,
+
+    // Server to client
+    // varint version, varint tick rate, varint view radius in chunks
+    PACKET_WELCOME,
+    // zigzag x, z, chunk payload (see CompressChunkPayload)
+    PACKET_CHUNK,
+    // zigzag x, z, u16 section mask, payload of those sections; sections of the mask it lacks are air
+    PACKET_CHUNK_SECTIONS,
+    // zigzag x, z, varint count, per change: u16 position (x | z << 4 | y << 8 within the chunk), u16 block
+    PACKET_BLOCK_CHANGES,
+    // zigzag x, z
+    PACKET_UNLOAD_CHUNK,
+    // varint tick, varint baseline tick (0: none), entity delta (see EntitySnapshot.h)
+    PACKET_ENTITIES,
+
+    PACKET_TYPE_COUNT
+};
+
+// Appends to a byte vector
+class PacketWriter {
+public:
+    explicit PacketWriter(std::vector<uint8_t> &out) : m_out(out) {}
+
+    void WriteU8(const uint8_t value) { m_out.push_back(value); }
+
+    void WriteU16(const uint16_t value) {
+        m_out.push_back(static_cast<uint8_t>(value));
+        m_out.push_back(static_cast<uint8_t>(value >> 8));
+    }
+
+    void WriteVarUint(uint64_t value) {
+        while (value >= 0x80) {
+            m_out.push_back(static_cast<uint8_t>(value | 0x80));
+            value >>= 7;
+        }
+        m_out.push_back(static_cast<uint8_t>(value));
+    }
+
+    void WriteVarInt(const int64_t value) {
+        WriteVarUint((static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63));
+    }
+
+    void WriteBytes(const void *data, const size_t size) {
+        if (size == 0)
+            return;
+        const size_t offset = m_out.size();
+        m_out.resize(offset + size);
+        std::memcpy(m_out.data() + offset, data, size);
+    }
+
+private:
+    std::vector<uint8_t> &m_out;
+};
+
+// Reads a packet body; every method returns false instead of reading past the end
+class PacketReader {
+public:
+    PacketReader() = default;
+    PacketReader(const uint8_t *data, const size_t size) : m_data(data), m_size(size) {}
+
+    bool ReadU8(uint8_t &value) {
+        if (m_offset == m_size)
+            return false;
+        value = m_data[m_offset++];
+        return true;
+    }
+
+    bool ReadU16(uint16_t &value) {
+        if (m_size - m_offset < 2)
+            return false;
+        value = static_cast<uint16_t>(m_data[m_offset] | m_data[m_offset + 1] << 8);
+        m_offset += 2;
+        return true;
+    }
+
+    bool ReadVarUint(uint64_t &value) {
+        value = 0;
+        for (uint32_t shift = 0; shift < 64; shift += 7) {
+            uint8_t byte = 0;
+            if (!ReadU8(byte))
+                return false;
+            value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+            if (!(byte & 0x80))
+                return true;
+        }
+        return false;
+    }
+
+    bool ReadVarInt(int64_t &value) {
+        uint64_t encoded = 0;
+        if (!ReadVarUint(encoded))
+            return false;
+        value = static_cast<int64_t>(encoded >> 1) ^ -static_cast<int64_t>(encoded & 1);
+        return true;
+    }
+
+    // Varint that must fit T
+    template<typename T>
+    bool ReadVar(T &value) {
+        if constexpr (std::is_signed_v<T>) {
+            int64_t wide = 0;
+            if (!ReadVarInt(wide) || wide < std::numeric_limits<T>::min() ||
+                wide > std::numeric_limits<T>::max())
+                return false;
+            value = static_cast<T>(wide);
+        } else {
+            uint64_t wide = 0;
+            if (!ReadVarUint(wide) || wide > std::numeric_limits<T>::max())
+                return false;
+            value = static_cast<T>(wide);
+        }
+        return true;
+    }
+
+    const uint8_t *GetRemaining() const { return m_data + m_offset; }
+    size_t GetRemainingSize() const { return m_size - m_offset; }
+    bool IsAtEnd() const { return m_offset == m_size; }
+
+private:
+    const uint8_t *m_data = nullptr;
+    size_t m_size = 0;
+    size_t m_offset = 0;
+};
@@ -0,0 +1,305 @@
+#include "render/BlockTextureArray.h"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+#include <spdlog/spdlog.h>
+
+#include "Image.h"
+
+#include "world/Block.h"
+
+namespace {
+    struct LayerInfo {
+        const char *name;
+        // Generated texture when the pack has none, sRGB
+        uint8_t color[3];
+    };
+
+    constexpr LayerInfo LAYERS[] = {
+        {"stone", {128, 128, 128}},
+        {"dirt", {115, 77, 46}},
+        {"grass_top", {77, 153, 51}},
+        {"grass_side", {97, 107, 51}},
+        {"sand", {219, 204, 140}},
+        {"gravel", {140, 133, 128}},
+        {"water", {38, 77, 204}},
+        {"log_side", {102, 71, 38}},
+        {"log_top", {140, 107, 64}},
+        {"leaves", {46, 115, 31}},
+        {"bedrock", {38, 38, 38}},
+        {"glowstone", {230, 190, 110}}
+    };
+    static_assert(std::size(LAYERS) == TEXTURE_COUNT);
+
+    constexpr uint32_t GENERATED_SIZE = 16;
+
+    // Width and height from the IHDR chunk, which PNG requires to come first
+    bool ReadPngSize(const std::string &path, uint32_t &width, uint32_t &height) {
+        std::ifstream file(path, std::ios::binary);
+        uint8_t header[24];
+        if (!file.read(reinterpret_cast<char *>(header), sizeof(header)))
+            return false;
+        if (header[1] != 'P' || header[2] != 'N' || header[3] != 'G' || std::memcmp(header + 12, "IHDR", 4) != 0)
+            return false;
+        const auto readBigEndian = [](const uint8_t *p) {
+            return (uint32_t{p[0]} << 24) | (uint32_t{p[1]} << 16) | (uint32_t{p[2]} << 8) | p[3];
+        };
+        width = readBigEndian(header + 16);
+        height = readBigEndian(header + 20);
+        return width > 0 && height > 0;
+    }
+
+    // Mips are averaged in linear space, averaging sRGB values darkens them
+    struct SrgbTables {
+        float toLinear[256];
+
+        SrgbTables() {
+            for (int i = 0; i < 256; ++i) {
+                const float c = static_cast<float>(i) / 255.f;
+                toLinear[i] = c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+            }
+        }
+
+        static uint8_t ToSrgb(const float linear) {
+            const float c = linear <= 0.0031308f ? linear * 12.92f : 1.055f * std::pow(linear, 1.f / 2.4f) - 0.055f;
+            return static_cast<uint8_t>(std::clamp(c, 0.f, 1.f) * 255.f + 0.5f);
+        }
+    };
+
+    const SrgbTables &GetSrgbTables() {
+        static const SrgbTables tables;
+        return tables;
+    }
+
+    void Downsample(const uint8_t *src, const uint32_t srcSize, uint8_t *dst) {
+        const SrgbTables &tables = GetSrgbTables();
+        const uint32_t dstSize = std::max(1u, srcSize / 2);
+        const uint32_t step = srcSize > 1 ? 2 : 1;
+        for (uint32_t y = 0; y < dstSize; ++y) {
+            for (uint32_t x = 0; x < dstSize; ++x) {
+                const uint8_t *p00 = src + ((y * step) * srcSize + x * step) * 4;
+                const uint8_t *p10 = p00 + (step - 1) * 4;
+                const uint8_t *p01 = p00 + (step - 1) * srcSize * 4;
+                const uint8_t *p11 = p01 + (step - 1) * 4;
+                uint8_t *out = dst + (y * dstSize + x) * 4;
+                for (int c = 0; c < 3; ++c) {
+                    const float sum = tables.toLinear[p00[c]] + tables.toLinear[p10[c]] +
+                                      tables.toLinear[p01[c]] + tables.toLinear[p11[c]];
+                    out[c] = SrgbTables::ToSrgb(sum * 0.25f);
+                }
+                out[3] = static_cast<uint8_t>((p00[3] + p10[3] + p01[3] + p11[3] + 2) / 4);
+            }
+        }
+    }
+
+    // Noisy variation of the layer color, stable across runs
+    void GenerateTexture(const uint32_t layer, std::vector<uint8_t> &texels) {
+        texels.resize(GENERATED_SIZE * GENERATED_SIZE * 4);
+        for (uint32_t i = 0; i < GENERATED_SIZE * GENERATED_SIZE; ++i) {
+            uint32_t hash = (i + 1) * 0x9e3779b9u ^ layer * 0x85ebca6bu;
+            hash ^= hash >> 15;
+            hash *= 0x2c1b3c6du;
+            hash ^= hash >> 12;
+            const float shade = 0.85f + 0.3f * static_cast<float>(hash & 0xff) / 255.f;
+            for (int c = 0; c < 3; ++c)
+                texels[i * 4 + c] = static_cast<uint8_t>(std::min(255.f, LAYERS[layer].color[c] * shade));
+            texels[i * 4 + 3] = 255;
+        }
+    }
+}
+
+BlockTextureArray::BlockTextureArray(dg::IRenderDevice *pDevice, JobSystem &jobSystem, const std::string &directory,
+                                     const Settings &settings)
+    : m_jobSystem(jobSystem), m_settings(settings) {
+    // The array size has to be known up front, it is the largest pack texture rounded up to a power of two
+    std::vector<std::string> paths(TEXTURE_COUNT);
+    uint32_t packTextures = 0;
+    m_size = GENERATED_SIZE;
+    for (uint32_t layer = 0; layer < TEXTURE_COUNT; ++layer) {
+        const std::string path = (std::filesystem::path(directory) / (std::string(LAYERS[layer].name) + ".png")).string();
+        uint32_t width = 0, height = 0;
+        if (!ReadPngSize(path, width, height))
+            continue;
+        paths[layer] = path;
+        m_size = std::max(m_size, std::bit_ceil(std::max(width, height)));
+        ++packTextures;
+    }
+    m_size = std::min(m_size, std::bit_floor(std::max(1u, m_settings.maxResolution)));
+    m_mipCount = static_cast<uint32_t>(std::bit_width(m_size));
+    m_residentMip = m_mipCount;
+    m_requestedMip = 0;
+    spdlog::info("Block textures: {} of {} from {}, {}x{} with {} mips", packTextures, TEXTURE_COUNT, directory,
+                 m_size, m_size, m_mipCount);
+
+    m_levels.resize(m_mipCount);
+    for (uint32_t mip = 0; mip < m_mipCount; ++mip) {
+        m_levels[mip].size = std::max(1u, m_size >> mip);
+        m_levels[mip].texels.resize(size_t{m_levels[mip].size} * m_levels[mip].size * 4 * TEXTURE_COUNT);
+    }
+
+    dg::TextureDesc TexDesc;
+    TexDesc.Name = "Block texture array";
+    TexDesc.Type = dg::RESOURCE_DIM_TEX_2D_ARRAY;
+    TexDesc.Width = m_size;
+    TexDesc.Height = m_size;
+    TexDesc.ArraySize = TEXTURE_COUNT;
+    TexDesc.MipLevels = m_mipCount;
+    TexDesc.Format = dg::TEX_FORMAT_RGBA8_UNORM_SRGB;
+    TexDesc.Usage = dg::USAGE_DEFAULT;
+    TexDesc.BindFlags = dg::BIND_SHADER_RESOURCE;
+    pDevice->CreateTexture(TexDesc, nullptr, &m_pTexture);
+
+    for (uint32_t layer = 0; layer < TEXTURE_COUNT; ++layer)
+        m_jobSystem.Submit([this, layer, path = paths[layer]] { DecodeLayer(layer, path); }, m_decodeJobs);
+}
+
+BlockTextureArray::~BlockTextureArray() {
+    m_jobSystem.Wait(m_decodeJobs);
+}
+
+void BlockTextureArray::DecodeLayer(const uint32_t layer, const std::string &path) {
+    std::vector<uint8_t> source;
+    uint32_t sourceSize = 0;
+
+    if (!path.empty()) {
+        dg::RefCntAutoPtr<dg::Image> pImage;
+        dg::CreateImageFromFile(path.c_str(), &pImage, nullptr);
+        const dg::ImageDesc *pDesc = pImage ? &pImage->GetDesc() : nullptr;
+        if (pDesc && pDesc->ComponentType == dg::VT_UINT8 && pDesc->NumComponents >= 3) {
+            // Resampled square to the next power of two, the loop below halves it down to the array size
+            sourceSize = std::bit_ceil(std::max(pDesc->Width, pDesc->Height));
+            source.resize(size_t{sourceSize} * sourceSize * 4);
+            const auto *pixels = static_cast<const uint8_t *>(pImage->GetData()->GetConstDataPtr());
+            for (uint32_t y = 0; y < sourceSize; ++y) {
+                const uint8_t *row = pixels + size_t{y * pDesc->Height / sourceSize} * pDesc->RowStride;
+                for (uint32_t x = 0; x < sourceSize; ++x) {
+                    const uint8_t *pixel = row + size_t{x * pDesc->Width / sourceSize} * pDesc->NumComponents;
+                    uint8_t *out = source.data() + (size_t{y} * sourceSize + x) * 4;
+                    out[0] = pixel[0];
+                    out[1] = pixel[1];
+                    out[2] = pixel[2];
+                    out[3] = pDesc->NumComponents == 4 ? pixel[3] : 255;
+                }
+            }
+        } else {
+            spdlog::warn("Unsupported block texture {}, using a generated one", path);
+        }
+    }
+    if (source.empty()) {
+        GenerateTexture(layer, source);
+        sourceSize = GENERATED_SIZE;
+    }
+
+    // Halve down to the array size, small textures are scaled up with nearest sampling to stay crisp
+    std::vector<uint8_t> scratch;
+    while (sourceSize > m_size) {
+        scratch.resize(size_t{sourceSize / 2} * (sourceSize / 2) * 4);
+        Downsample(source.data(), sourceSize, scratch.data());
+        source.swap(scratch);
+        sourceSize /= 2;
+    }
+    const size_t baseBytes = size_t{m_size} * m_size * 4;
+    uint8_t *base = m_levels[0].texels.data() + baseBytes * layer;
+    const uint32_t scale = m_size / sourceSize;
+    for (uint32_t y = 0; y < m_size; ++y) {
+        for (uint32_t x = 0; x < m_size; ++x)
+            std::memcpy(base + (size_t{y} * m_size + x) * 4, source.data() + (size_t{y / scale} * sourceSize + x / scale) * 4, 4);
+    }
+
+    for (uint32_t mip = 1; mip < m_mipCount; ++mip) {
+        const Level &parent = m_levels[mip - 1];
+        Level &level = m_levels[mip];
+        Downsample(parent.texels.data() + size_t{parent.size} * parent.size * 4 * layer, parent.size,
+                   level.texels.data() + size_t{level.size} * level.size * 4 * layer);
+    }
+}
+
+void BlockTextureArray::RequestResolution(const uint32_t texels) {
+    uint32_t mip = 0;
+    while (mip + 1 < m_mipCount && (m_size >> (mip + 1)) >= texels)
+        ++mip;
+    m_requestedMip = mip;
+}
+
+void BlockTextureArray::Update(dg::IDeviceContext *pContext) {
+    bool uploaded = false;
+
+    // Until the jobs are done, every layer shows its generated color
+    if (!m_placeholderUploaded) {
+        for (uint32_t layer = 0; layer < TEXTURE_COUNT; ++layer) {
+            const uint8_t texel[4] = {LAYERS[layer].color[0], LAYERS[layer].color[1], LAYERS[layer].color[2], 255};
+            UploadLevel(pContext, m_mipCount - 1, texel, layer);
+        }
+        m_placeholderUploaded = true;
+        m_residentMip = m_mipCount - 1;
+        uploaded = true;
+    }
+
+    if (!m_decodedUploading && m_decodeJobs.IsDone()) {
+        m_decodedUploading = true;
+        m_residentMip = m_mipCount;
+        m_uploadLayer = 0;
+    }
+
+    if (m_decodedUploading) {
+        size_t budget = m_settings.maxUploadBytes;
+        while (m_residentMip > m_requestedMip) {
+            const uint32_t mip = m_residentMip - 1;
+            Level &level = m_levels[mip];
+            const size_t layerBytes = size_t{level.size} * level.size * 4;
+            // The coarsest missing layer always goes, so a budget below one layer still makes progress
+            if (uploaded && layerBytes > budget)
+                break;
+            UploadLevel(pContext, mip, level.texels.data() + layerBytes * m_uploadLayer, m_uploadLayer);
+            budget -= std::min(budget, layerBytes);
+            uploaded = true;
+
+            if (++m_uploadLayer == TEXTURE_COUNT) {
+                m_residentMip = mip;
+                m_uploadLayer = 0;
+                std::vector<uint8_t>().swap(level.texels);
+            }
+        }
+    }
+
+    if (uploaded) {
+        const dg::StateTransitionDesc Barrier{m_pTexture, dg::RESOURCE_STATE_UNKNOWN, dg::RESOURCE_STATE_SHADER_RESOURCE,
+                                              dg::STATE_TRANSITION_FLAG_UPDATE_STATE};
+        pContext->TransitionResourceStates(1, &Barrier);
+    }
+}
+
+void BlockTextureArray::UploadLevel(dg::IDeviceContext *pContext, const uint32_t mip, const uint8_t *texels,
+                                    const uint32_t layer) {
+    const uint32_t size = std::max(1u, m_size >> mip);
+    dg::TextureSubResData SubResData;
+    SubResData.pData = texels;
+    SubResData.Stride = size * 4;
+    const dg::Box Region{0, size, 0, size};
+    pContext->UpdateTexture(m_pTexture, mip, layer, Region, SubResData, dg::RESOURCE_STATE_TRANSITION_MODE_TRANSITION,
+                            dg::RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+}
+
+dg::ITextureView *BlockTextureArray::GetShaderResourceView() const {
+    return m_pTexture->GetDefaultView(dg::TEXTURE_VIEW_SHADER_RESOURCE);
+}
+
+float BlockTextureArray::GetMinLod() const {
+    return static_cast<float>(std::min(m_residentMip, m_mipCount - 1));
+}
+
+uint32_t BlockTextureArray::GetResidentResolution() const {
+    return std::max(1u, m_size >> std::min(m_residentMip, m_mipCount - 1));
+}
+
+uint64_t BlockTextureArray::GetMemoryUsage() const {
+    uint64_t bytes = 0;
+    for (const Level &level: m_levels)
+        bytes += uint64_t{level.size} * level.size * 4 * TEXTURE_COUNT;
+    return bytes;
+}
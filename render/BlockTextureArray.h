@@ -0,0 +1,80 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "RefCntAutoPtr.hpp"
+#include "RenderDevice.h"
+#include "DeviceContext.h"
+#include "Texture.h"
+
+#include "core/JobSystem.h"
+
+namespace dg = Diligent;
+
+// All block textures as the layers of one Texture2DArray with a full mip chain, indexed by BlockTexture.
+// Layers are read from "<name>.png" in the resource pack directory; missing files get a generated texture.
+//
+// Decoding and mip generation run on the job system. Levels are then uploaded coarsest first, a few per frame,
+// and only down to the resolution the view asked for, so a high resolution pack neither stalls startup nor
+// uploads detail nobody can see. The shader clamps its LOD to GetMinLod(), the finest level already uploaded.
+class BlockTextureArray {
+public:
+    struct Settings {
+        // Larger pack textures are downscaled to this, in texels
+        uint32_t maxResolution = 512;
+        // Texel data uploaded per Update()
+        size_t maxUploadBytes = 2 << 20;
+    };
+
+    BlockTextureArray(dg::IRenderDevice *pDevice, JobSystem &jobSystem, const std::string &directory,
+                      const Settings &settings);
+    // Waits for the decode jobs
+    ~BlockTextureArray();
+
+    BlockTextureArray(const BlockTextureArray &) = delete;
+    BlockTextureArray &operator=(const BlockTextureArray &) = delete;
+
+    // Finest texture size the view can resolve, levels above it are kept on the CPU until requested
+    void RequestResolution(uint32_t texels);
+    // Uploads decoded levels within the budget, call on the immediate context before drawing
+    void Update(dg::IDeviceContext *pContext);
+
+    dg::ITextureView *GetShaderResourceView() const;
+    float GetMinLod() const;
+
+    uint32_t GetResolution() const { return m_size; }
+    uint32_t GetResidentResolution() const;
+    // Bytes of the whole texture, every level is allocated up front whether uploaded or not
+    uint64_t GetMemoryUsage() const;
+
+private:
+    // RGBA8 texels of every layer of one mip level, layer after layer
+    struct Level {
+        uint32_t size = 0;
+        std::vector<uint8_t> texels;
+    };
+
+    void DecodeLayer(uint32_t layer, const std::string &path);
+    void UploadLevel(dg::IDeviceContext *pContext, uint32_t mip, const uint8_t *texels, uint32_t layer);
+
+    JobSystem &m_jobSystem;
+    Settings m_settings;
+    dg::RefCntAutoPtr<dg::ITexture> m_pTexture;
+    uint32_t m_size = 0;
+    uint32_t m_mipCount = 0;
+
+    // Written by the decode jobs until m_decodeJobs is done
+    std::vector<Level> m_levels;
+    JobCounter m_decodeJobs;
+
+    // Finest level with every layer uploaded, m_mipCount while nothing is
+    uint32_t m_residentMip = 0;
+    uint32_t m_requestedMip = 0;
+    // Layers of level m_residentMip - 1 uploaded so far
+    uint32_t m_uploadLayer = 0;
+    bool m_placeholderUploaded = false;
+    bool m_decodedUploading = false;
+};
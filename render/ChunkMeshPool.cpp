@@ -0,0 +1,165 @@
+#include "render/ChunkMeshPool.h"
+
+#include <algorithm>
+
+ChunkMeshPool::ChunkMeshPool(dg::IRenderDevice *pDevice, const uint32_t vertexCapacity, const uint32_t indexCapacity,
+                             const uint64_t immediateContextMask)
+    : m_pDevice(pDevice), m_contextMask(immediateContextMask),
+      m_vertices{"Chunk vertex pool", dg::BIND_VERTEX_BUFFER, sizeof(ChunkVertex), {}, RangeAllocator(vertexCapacity),
+                 std::pmr::map<uint32_t, Handle>(&m_ownerNodes)},
+      m_indices{"Chunk index pool", dg::BIND_INDEX_BUFFER, sizeof(uint16_t), {}, RangeAllocator(indexCapacity),
+                std::pmr::map<uint32_t, Handle>(&m_ownerNodes)} {
+    m_vertices.buffer = CreateBuffer(m_vertices, vertexCapacity);
+    m_indices.buffer = CreateBuffer(m_indices, indexCapacity);
+}
+
+dg::RefCntAutoPtr<dg::IBuffer> ChunkMeshPool::CreateBuffer(const Arena &arena, const uint32_t capacity) const {
+    dg::BufferDesc BuffDesc;
+    BuffDesc.Name = arena.name;
+    BuffDesc.Usage = dg::USAGE_DEFAULT;
+    BuffDesc.BindFlags = arena.bindFlags;
+    BuffDesc.Size = static_cast<uint64_t>(capacity) * arena.elementSize;
+    BuffDesc.ImmediateContextMask = m_contextMask;
+    dg::RefCntAutoPtr<dg::IBuffer> pBuffer;
+    m_pDevice->CreateBuffer(BuffDesc, nullptr, &pBuffer);
+    return pBuffer;
+}
+
+void ChunkMeshPool::Grow(Arena &arena, dg::IDeviceContext *pContext, const uint32_t minCapacity) {
+    const uint32_t oldCapacity = arena.allocator.GetCapacity();
+    const uint32_t newCapacity = std::max(minCapacity, oldCapacity * 2);
+    auto pNewBuffer = CreateBuffer(arena, newCapacity);
+    if (oldCapacity > 0) {
+        pContext->CopyBuffer(arena.buffer, 0, dg::RESOURCE_STATE_TRANSITION_MODE_TRANSITION,
+                             pNewBuffer, 0, static_cast<uint64_t>(oldCapacity) * arena.elementSize,
+                             dg::RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+    }
+    arena.buffer = pNewBuffer;
+    arena.allocator.Grow(newCapacity);
+}
+
+uint32_t ChunkMeshPool::Reserve(Arena &arena, dg::IDeviceContext *pContext, const uint32_t count, const Handle owner) {
+    uint32_t offset = arena.allocator.Allocate(count);
+    if (offset == RangeAllocator::INVALID_OFFSET) {
+        Grow(arena, pContext, arena.allocator.GetCapacity() + count);
+        offset = arena.allocator.Allocate(count);
+    }
+    arena.owners[offset] = owner;
+    return offset;
+}
+
+void ChunkMeshPool::Release(Arena &arena, const uint32_t offset, const uint32_t count) {
+    arena.owners.erase(offset);
+    arena.allocator.Free(offset, count);
+}
+
+ChunkMeshPool::Handle ChunkMeshPool::Allocate(dg::IDeviceContext *pContext, const uint32_t vertexCount,
+                                              const uint32_t indexCount) {
+    if (indexCount == 0)
+        return INVALID_HANDLE;
+
+    Handle handle;
+    if (!m_freeHandles.empty()) {
+        handle = m_freeHandles.back();
+        m_freeHandles.pop_back();
+    } else {
+        handle = static_cast<Handle>(m_slices.size());
+        m_slices.emplace_back();
+    }
+
+    MeshSlice slice;
+    slice.vertexCount = vertexCount;
+    slice.indexCount = indexCount;
+    slice.vertexOffset = Reserve(m_vertices, pContext, slice.vertexCount, handle);
+    slice.indexOffset = Reserve(m_indices, pContext, slice.indexCount, handle);
+    m_slices[handle] = slice;
+    ++m_meshCount;
+    return handle;
+}
+
+bool ChunkMeshPool::Fits(const uint32_t vertexCount, const uint32_t indexCount) const {
+    return m_vertices.allocator.GetLargestFreeBlock() >= vertexCount &&
+           m_indices.allocator.GetLargestFreeBlock() >= indexCount;
+}
+
+void ChunkMeshPool::Free(const Handle handle) {
+    if (handle == INVALID_HANDLE)
+        return;
+    const MeshSlice &slice = m_slices[handle];
+    Release(m_vertices, slice.vertexOffset, slice.vertexCount);
+    Release(m_indices, slice.indexOffset, slice.indexCount);
+    m_slices[handle] = {};
+    m_freeHandles.push_back(handle);
+    --m_meshCount;
+}
+
+dg::IBuffer *ChunkMeshPool::GetScratch(const uint64_t size) {
+    if (!m_pScratch || m_pScratch->GetDesc().Size < size) {
+        dg::BufferDesc BuffDesc;
+        BuffDesc.Name = "Chunk pool defrag scratch";
+        BuffDesc.Usage = dg::USAGE_DEFAULT;
+        BuffDesc.BindFlags = dg::BIND_VERTEX_BUFFER;
+        BuffDesc.Size = std::max<uint64_t>(size, 512 << 10);
+        m_pScratch.Release();
+        m_pDevice->CreateBuffer(BuffDesc, nullptr, &m_pScratch);
+    }
+    return m_pScratch;
+}
+
+ChunkMeshPool::Handle ChunkMeshPool::MoveLast(Arena &arena, dg::IDeviceContext *pContext, const bool vertices) {
+    if (arena.owners.empty())
+        return INVALID_HANDLE;
+
+    const auto [offset, handle] = *arena.owners.rbegin();
+    MeshSlice &slice = m_slices[handle];
+    const uint32_t count = vertices ? slice.vertexCount : slice.indexCount;
+
+    const uint32_t newOffset = arena.allocator.AllocateBelow(count, offset);
+    if (newOffset == RangeAllocator::INVALID_OFFSET)
+        return INVALID_HANDLE;
+
+    // Go through a scratch buffer, copies within one buffer are not allowed on every backend
+    const uint64_t size = static_cast<uint64_t>(count) * arena.elementSize;
+    dg::IBuffer *pScratch = GetScratch(size);
+    pContext->CopyBuffer(arena.buffer, static_cast<uint64_t>(offset) * arena.elementSize,
+                         dg::RESOURCE_STATE_TRANSITION_MODE_TRANSITION,
+                         pScratch, 0, size, dg::RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+    pContext->CopyBuffer(pScratch, 0, dg::RESOURCE_STATE_TRANSITION_MODE_TRANSITION,
+                         arena.buffer, static_cast<uint64_t>(newOffset) * arena.elementSize, size,
+                         dg::RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+
+    Release(arena, offset, count);
+    arena.owners[newOffset] = handle;
+    (vertices ? slice.vertexOffset : slice.indexOffset) = newOffset;
+    return handle;
+}
+
+uint32_t ChunkMeshPool::Defragment(dg::IDeviceContext *pContext, const uint32_t maxMoves,
+                                   std::vector<Handle> &moved) {
+    uint32_t moves = 0;
+    bool progress = true;
+    while (moves < maxMoves && progress) {
+        progress = false;
+        for (const bool vertices: {true, false}) {
+            const Handle handle = MoveLast(vertices ? m_vertices : m_indices, pContext, vertices);
+            if (handle == INVALID_HANDLE)
+                continue;
+            moved.push_back(handle);
+            progress = true;
+            ++moves;
+        }
+    }
+    return moves;
+}
+
+ChunkMeshPool::Stats ChunkMeshPool::GetStats() const {
+    return {
+        m_meshCount,
+        m_vertices.allocator.GetUsed(), m_vertices.allocator.GetCapacity(),
+        m_indices.allocator.GetUsed(), m_indices.allocator.GetCapacity(),
+        static_cast<uint32_t>(m_vertices.allocator.GetFreeBlockCount() + m_indices.allocator.GetFreeBlockCount()),
+        uint64_t{m_vertices.allocator.GetCapacity()} * m_vertices.elementSize +
+            uint64_t{m_indices.allocator.GetCapacity()} * m_indices.elementSize +
+            (m_pScratch ? m_pScratch->GetDesc().Size : 0)
+    };
+}
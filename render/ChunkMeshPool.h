@@ -0,0 +1,96 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <memory_resource>
+#include <vector>
+
+#include "RefCntAutoPtr.hpp"
+#include "RenderDevice.h"
+#include "DeviceContext.h"
+#include "Buffer.h"
+
+#include "core/ObjectPool.h"
+#include "core/RangeAllocator.h"
+#include "render/ChunkMesher.h"
+
+namespace dg = Diligent;
+
+// Where a mesh lives inside the pool buffers, in elements
+struct MeshSlice {
+    uint32_t vertexOffset = 0, vertexCount = 0;
+    uint32_t indexOffset = 0, indexCount = 0;
+};
+
+// One vertex and one index buffer shared by every chunk mesh.
+// Meshes are written into sub-allocated slices and drawn with BaseVertex/FirstIndexLocation,
+// so the buffers are bound once per frame instead of once per draw.
+// Slices are referred to by handle, which lets Defragment() move them around behind the owner's back.
+// The pool only reserves slices, their data is copied in by the owner, possibly from another context in
+// immediateContextMask.
+class ChunkMeshPool {
+public:
+    using Handle = uint32_t;
+    static constexpr Handle INVALID_HANDLE = ~0u;
+
+    struct Stats {
+        uint32_t meshCount;
+        uint32_t vertexUsed, vertexCapacity;
+        uint32_t indexUsed, indexCapacity;
+        uint32_t freeBlocks;
+        // Of the vertex, index and scratch buffers
+        uint64_t bufferBytes;
+    };
+
+    ChunkMeshPool(dg::IRenderDevice *pDevice, uint32_t vertexCapacity, uint32_t indexCapacity,
+                  uint64_t immediateContextMask = 1);
+
+    // Grows the buffers on pContext when the slices do not fit, copying the old contents over
+    Handle Allocate(dg::IDeviceContext *pContext, uint32_t vertexCount, uint32_t indexCount);
+    void Free(Handle handle);
+    // False when Allocate() would have to grow the buffers
+    bool Fits(uint32_t vertexCount, uint32_t indexCount) const;
+
+    const MeshSlice &Get(const Handle handle) const { return m_slices[handle]; }
+
+    // Moves up to maxMoves slices from the end of the buffers into free space further down.
+    // Meant for frames with nothing else to upload; handles of the moved slices are appended to moved.
+    uint32_t Defragment(dg::IDeviceContext *pContext, uint32_t maxMoves, std::vector<Handle> &moved);
+
+    // Upper bound of handle values, for per-handle side tables
+    uint32_t GetHandleCount() const { return static_cast<uint32_t>(m_slices.size()); }
+
+    dg::IBuffer *GetVertexBuffer() const { return m_vertices.buffer; }
+    dg::IBuffer *GetIndexBuffer() const { return m_indices.buffer; }
+
+    Stats GetStats() const;
+
+private:
+    struct Arena {
+        const char *name;
+        dg::BIND_FLAGS bindFlags;
+        uint32_t elementSize;
+        dg::RefCntAutoPtr<dg::IBuffer> buffer;
+        RangeAllocator allocator;
+        std::pmr::map<uint32_t, Handle> owners; // slice offset -> handle, nodes from m_ownerNodes
+    };
+
+    dg::RefCntAutoPtr<dg::IBuffer> CreateBuffer(const Arena &arena, uint32_t capacity) const;
+    uint32_t Reserve(Arena &arena, dg::IDeviceContext *pContext, uint32_t count, Handle owner);
+    void Release(Arena &arena, uint32_t offset, uint32_t count);
+    void Grow(Arena &arena, dg::IDeviceContext *pContext, uint32_t minCapacity);
+    Handle MoveLast(Arena &arena, dg::IDeviceContext *pContext, bool vertices);
+    dg::IBuffer *GetScratch(uint64_t size);
+
+    dg::RefCntAutoPtr<dg::IRenderDevice> m_pDevice;
+    uint64_t m_contextMask = 1;
+    // Every mesh upload and free adds and drops owner entries, their nodes stay in a pool
+    SizeClassPool m_ownerNodes{"Mesh slice owners", 64, 16 << 10};
+    Arena m_vertices;
+    Arena m_indices;
+    dg::RefCntAutoPtr<dg::IBuffer> m_pScratch;
+
+    std::vector<MeshSlice> m_slices;
+    std::vector<Handle> m_freeHandles;
+    uint32_t m_meshCount = 0;
+};
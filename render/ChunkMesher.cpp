@@ -0,0 +1,322 @@
+#include "render/ChunkMesher.h"
+
+#include <algorithm>
+
+namespace {
+    constexpr int S = ChunkSection::SIZE;
+
+    // Mask entries: bits 32-39 the light in front of the face, bit 24 set when there is a face, bits 16-23 the four
+    // corner AO values, bits 0-15 the texture layer.
+    // Faces only merge when the whole key matches, so merged quads never smear occlusion or light.
+    constexpr uint64_t FACE_PRESENT = 1u << 24;
+
+    // Opacity of every block of a grid, looked up 16 blocks at a time before meshing it
+    using OpacityGrid = std::array<uint8_t, SectionNeighborhood::VOLUME>;
+
+    bool IsFaceVisible(const BlockId block, const BlockId neighbor, const bool neighborOpaque) {
+        if (IsAir(block))
+            return false;
+        // Transparent blocks of the same kind (water next to water) don't need a face between them
+        return !neighborOpaque && neighbor != block;
+    }
+
+    uint32_t VertexAO(const bool side1, const bool side2, const bool corner) {
+        if (side1 && side2)
+            return 0;
+        return 3 - (side1 + side2 + corner);
+    }
+
+    // AO of the four face corners in quad order (u0 v0), (u1 v0), (u1 v1), (u0 v1), 2 bits each.
+    // p is the air cell in front of the face.
+    uint32_t FaceAO(const OpacityGrid &opacity, const int(&p)[3], const int u, const int v) {
+        auto opaque = [&](const int du, const int dv) {
+            int q[3] = {p[0], p[1], p[2]};
+            q[u] += du;
+            q[v] += dv;
+            return opacity[SectionNeighborhood::Index(q[0], q[1], q[2])] != 0;
+        };
+
+        const bool um = opaque(-1, 0), up = opaque(1, 0), vm = opaque(0, -1), vp = opaque(0, 1);
+        const uint32_t ao0 = VertexAO(um, vm, opaque(-1, -1));
+        const uint32_t ao1 = VertexAO(up, vm, opaque(1, -1));
+        const uint32_t ao2 = VertexAO(up, vp, opaque(1, 1));
+        const uint32_t ao3 = VertexAO(um, vp, opaque(-1, 1));
+        return ao0 | (ao1 << 2) | (ao2 << 4) | (ao3 << 6);
+    }
+
+    // base, w and h are in cells of scale blocks
+    void EmitQuad(ChunkMesh &mesh, const int face, const int d, const int(&base)[3],
+                  const int w, const int h, const int scale, const uint64_t key) {
+        const int u = (d + 1) % 3, v = (d + 2) % 3;
+        int du[3] = {0, 0, 0}, dv[3] = {0, 0, 0};
+        du[u] = w;
+        dv[v] = h;
+
+        const int corners[4][3] = {
+            {base[0], base[1], base[2]},
+            {base[0] + du[0], base[1] + du[1], base[2] + du[2]},
+            {base[0] + du[0] + dv[0], base[1] + du[1] + dv[1], base[2] + du[2] + dv[2]},
+            {base[0] + dv[0], base[1] + dv[1], base[2] + dv[2]},
+        };
+
+        const auto layer = static_cast<uint32_t>(key & 0xFFFF);
+        const auto light = static_cast<uint32_t>((key >> 32) & 0xFF);
+        uint32_t ao[4];
+        for (int i = 0; i < 4; ++i)
+            ao[i] = (key >> (16 + i * 2)) & 3;
+
+        const auto first = static_cast<uint32_t>(mesh.vertices.size());
+        for (int i = 0; i < 4; ++i) {
+            mesh.vertices.push_back(ChunkVertex::Pack(corners[i][0] * scale, corners[i][1] * scale,
+                                                      corners[i][2] * scale, face, ao[i], layer, light));
+        }
+
+        // cross(u, v) points along +d, so positive faces keep the corner order and negative ones flip it.
+        // The quad is split along the brighter diagonal, otherwise AO interpolates anisotropically.
+        const bool positive = (face & 1) == 0;
+        const bool flipDiagonal = ao[0] + ao[2] < ao[1] + ao[3];
+        const uint32_t order[4][6] = {
+            {0, 1, 2, 0, 2, 3},
+            {0, 2, 1, 0, 3, 2},
+            {1, 2, 3, 1, 3, 0},
+            {1, 3, 2, 1, 0, 3},
+        };
+        for (const uint32_t i: order[(flipDiagonal ? 2 : 0) + (positive ? 0 : 1)])
+            mesh.indices.push_back(static_cast<uint16_t>(first + i));
+    }
+
+    // Fine coordinates covered by coarse coordinate c along one axis: a cell of size blocks, or the border layer
+    void CellRange(const int c, const int n, const int size, int &begin, int &end) {
+        if (c < 0) {
+            begin = -1, end = 0;
+        } else if (c >= n) {
+            begin = S, end = S + 1;
+        } else {
+            begin = c * size, end = begin + size;
+        }
+    }
+
+    // Builds the (S >> lod)^3 cell grid for a lower detail mesh, in the same layout as the neighborhood.
+    // A cell is opaque as soon as any block in it is, taking the topmost opaque block so surfaces keep their top
+    // textures; cells without opaque blocks take their topmost other block. Coarse solids therefore always
+    // contain the finer ones, and a neighbour drawn at a finer level can only be hidden inside a coarse cell,
+    // never leave a gap next to it.
+    // Border cells only see the one block border, they count as a block when the whole border patch agrees on
+    // it and as air otherwise. Faces towards a border cell are then only dropped when the neighbour is surely
+    // solid at every level of detail.
+    void Downsample(const SectionNeighborhood &section, const int lod, SectionNeighborhood &cells) {
+        const int n = S >> lod, size = 1 << lod;
+        cells.sx = section.sx, cells.sy = section.sy, cells.sz = section.sz;
+        cells.blocks.fill(BLOCK_AIR);
+        cells.light.fill(0);
+
+        for (int cy = -1; cy <= n; ++cy) {
+            for (int cz = -1; cz <= n; ++cz) {
+                for (int cx = -1; cx <= n; ++cx) {
+                    int x0, x1, y0, y1, z0, z1;
+                    CellRange(cx, n, size, x0, x1);
+                    CellRange(cy, n, size, y0, y1);
+                    CellRange(cz, n, size, z0, z1);
+                    const bool interior = cx >= 0 && cx < n && cy >= 0 && cy < n && cz >= 0 && cz < n;
+
+                    BlockId cell = BLOCK_AIR;
+                    if (interior) {
+                        BlockId topmost = BLOCK_AIR;
+                        for (int y = y1 - 1; y >= y0 && !IsOpaque(cell); --y) {
+                            for (int z = z0; z < z1 && !IsOpaque(cell); ++z) {
+                                for (int x = x0; x < x1; ++x) {
+                                    const BlockId block = section.Get(x, y, z);
+                                    if (IsOpaque(block)) {
+                                        cell = block;
+                                        break;
+                                    }
+                                    if (IsAir(topmost))
+                                        topmost = block;
+                                }
+                            }
+                        }
+                        if (IsAir(cell))
+                            cell = topmost;
+                    } else {
+                        cell = section.Get(x0, y0, z0);
+                        for (int y = y0; y < y1 && !IsAir(cell); ++y)
+                            for (int z = z0; z < z1 && !IsAir(cell); ++z)
+                                for (int x = x0; x < x1; ++x) {
+                                    const BlockId block = section.Get(x, y, z);
+                                    if (block != cell && !(IsOpaque(block) && IsOpaque(cell))) {
+                                        cell = BLOCK_AIR;
+                                        break;
+                                    }
+                                }
+                    }
+                    cells.blocks[SectionNeighborhood::Index(cx, cy, cz)] = cell;
+
+                    // Faces of a cell are lit by the brightest block of the cell in front
+                    uint8_t sky = 0, block = 0;
+                    for (int y = y0; y < y1; ++y)
+                        for (int z = z0; z < z1; ++z)
+                            for (int x = x0; x < x1; ++x) {
+                                const uint8_t light = section.GetLight(x, y, z);
+                                sky = std::max<uint8_t>(sky, light & 15);
+                                block = std::max<uint8_t>(block, light >> 4);
+                            }
+                    cells.light[SectionNeighborhood::Index(cx, cy, cz)] = static_cast<uint8_t>(sky | (block << 4));
+                }
+            }
+        }
+    }
+
+    // Meshes the n^3 cells of grid, each scale blocks wide, using its one cell border for culling and AO
+    void MeshGrid(const SectionNeighborhood &grid, const int n, const int scale, ChunkMesh &mesh) {
+        mesh.vertices.clear();
+        mesh.indices.clear();
+
+        std::array<uint64_t, S * S> mask;
+        OpacityGrid opacity;
+        GetBlockOpacity(grid.blocks.data(), SectionNeighborhood::VOLUME, opacity.data());
+
+        // Faces: +X, -X, +Y, -Y, +Z, -Z
+        for (int face = 0; face < 6; ++face) {
+            const int d = face / 2;
+            const int u = (d + 1) % 3, v = (d + 2) % 3;
+            const int step = (face & 1) == 0 ? 1 : -1;
+
+            for (int slice = 0; slice < n; ++slice) {
+                // Mask of visible faces in this slice
+                for (int j = 0; j < n; ++j) {
+                    for (int i = 0; i < n; ++i) {
+                        int p[3];
+                        p[d] = slice, p[u] = i, p[v] = j;
+                        const BlockId block = grid.Get(p[0], p[1], p[2]);
+                        p[d] += step;
+                        const int neighborIndex = SectionNeighborhood::Index(p[0], p[1], p[2]);
+
+                        uint64_t key = 0;
+                        if (IsFaceVisible(block, grid.blocks[neighborIndex], opacity[neighborIndex] != 0)) {
+                            key = FACE_PRESENT | (FaceAO(opacity, p, u, v) << 16) | GetBlockTexture(block, face) |
+                                  (static_cast<uint64_t>(grid.GetLight(p[0], p[1], p[2])) << 32);
+                        }
+                        mask[j * n + i] = key;
+                    }
+                }
+
+                // Greedy merge: grow each quad along u, then along v while the whole row matches
+                for (int j = 0; j < n; ++j) {
+                    for (int i = 0; i < n;) {
+                        const uint64_t key = mask[j * n + i];
+                        if (key == 0) {
+                            ++i;
+                            continue;
+                        }
+
+                        int w = 1;
+                        while (i + w < n && mask[j * n + i + w] == key)
+                            ++w;
+
+                        int h = 1;
+                        for (; j + h < n; ++h) {
+                            bool rowMatches = true;
+                            for (int k = 0; k < w && rowMatches; ++k)
+                                rowMatches = mask[(j + h) * n + i + k] == key;
+                            if (!rowMatches)
+                                break;
+                        }
+
+                        int base[3];
+                        base[d] = slice + (step > 0 ? 1 : 0);
+                        base[u] = i;
+                        base[v] = j;
+                        EmitQuad(mesh, face, d, base, w, h, scale, key);
+
+                        for (int y = 0; y < h; ++y)
+                            std::fill_n(mask.begin() + (j + y) * n + i, w, 0ull);
+                        i += w;
+                    }
+                }
+            }
+        }
+
+        uint32_t boundsMin[3] = {S, S, S}, boundsMax[3] = {0, 0, 0};
+        for (const ChunkVertex &vertex: mesh.vertices) {
+            for (int axis = 0; axis < 3; ++axis) {
+                const uint32_t value = (vertex.geometry >> (axis * 5)) & 31;
+                boundsMin[axis] = std::min(boundsMin[axis], value);
+                boundsMax[axis] = std::max(boundsMax[axis], value);
+            }
+        }
+        for (int axis = 0; axis < 3; ++axis) {
+            mesh.boundsMin[axis] = static_cast<uint8_t>(mesh.vertices.empty() ? 0 : boundsMin[axis]);
+            mesh.boundsMax[axis] = static_cast<uint8_t>(boundsMax[axis]);
+        }
+    }
+}
+
+void SectionNeighborhood::Gather(const World &world, const int sectionX, const int sectionY, const int sectionZ) {
+    sx = sectionX, sy = sectionY, sz = sectionZ;
+
+    std::array<BlockId, ChunkSection::VOLUME> decoded;
+    for (int ny = -1; ny <= 1; ++ny) {
+        for (int nz = -1; nz <= 1; ++nz) {
+            for (int nx = -1; nx <= 1; ++nx) {
+                // Range of local coordinates this neighbour contributes, [-1] or [0, S) or [S]
+                const int x0 = nx < 0 ? -1 : (nx > 0 ? S : 0), x1 = nx < 0 ? 0 : (nx > 0 ? S + 1 : S);
+                const int y0 = ny < 0 ? -1 : (ny > 0 ? S : 0), y1 = ny < 0 ? 0 : (ny > 0 ? S + 1 : S);
+                const int z0 = nz < 0 ? -1 : (nz > 0 ? S : 0), z1 = nz < 0 ? 0 : (nz > 0 ? S + 1 : S);
+
+                const int ly = sy + ny;
+                const bool inside = ly >= 0 && ly < Chunk::SECTION_COUNT;
+                const Chunk *chunk = world.GetChunk({sx + nx, sz + nz});
+                const ChunkSection *section = chunk && inside ? chunk->GetSection(ly) : nullptr;
+                if (!section) {
+                    for (int y = y0; y < y1; ++y)
+                        for (int z = z0; z < z1; ++z)
+                            for (int x = x0; x < x1; ++x)
+                                blocks[Index(x, y, z)] = BLOCK_AIR;
+                } else if (nx == 0 && ny == 0 && nz == 0) {
+                    section->Decode(decoded.data());
+                    for (int y = 0; y < S; ++y)
+                        for (int z = 0; z < S; ++z)
+                            std::copy_n(decoded.data() + ChunkSection::Index(0, y, z), S, blocks.data() + Index(0, y, z));
+                } else {
+                    // Neighbours only give a face, edge or corner of the border, decoding them whole is wasted work
+                    for (int y = y0; y < y1; ++y)
+                        for (int z = z0; z < z1; ++z)
+                            for (int x = x0; x < x1; ++x)
+                                blocks[Index(x, y, z)] = section->GetBlock(x - nx * S, y - ny * S, z - nz * S);
+                }
+
+                // Missing chunks and the space above the world count as open sky
+                if (!chunk || !inside) {
+                    const uint8_t open = !chunk || ly >= Chunk::SECTION_COUNT ? MAX_LIGHT : 0;
+                    for (int y = y0; y < y1; ++y)
+                        for (int z = z0; z < z1; ++z)
+                            for (int x = x0; x < x1; ++x)
+                                light[Index(x, y, z)] = open;
+                    continue;
+                }
+                const LightArray &skyLight = chunk->GetLight(LIGHT_SKY, ly);
+                const LightArray &blockLight = chunk->GetLight(LIGHT_BLOCK, ly);
+                for (int y = y0; y < y1; ++y)
+                    for (int z = z0; z < z1; ++z)
+                        for (int x = x0; x < x1; ++x) {
+                            const int index = ChunkSection::Index(x - nx * S, y - ny * S, z - nz * S);
+                            light[Index(x, y, z)] = static_cast<uint8_t>(skyLight.Get(index) | (blockLight.Get(index) << 4));
+                        }
+            }
+        }
+    }
+}
+
+void MeshSection(const SectionNeighborhood &section, ChunkMesh &mesh) {
+    MeshGrid(section, S, 1, mesh);
+}
+
+void MeshSectionLod(const SectionNeighborhood &section, const int lod, ChunkMesh &mesh) {
+    if (lod <= 0) {
+        MeshSection(section, mesh);
+        return;
+    }
+    SectionNeighborhood cells;
+    Downsample(section, lod, cells);
+    MeshGrid(cells, S >> lod, 1 << lod, mesh);
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <memory_resource>
+#include <vector>
+
+#include "world/World.h"
+
+// 8 byte chunk vertex, decoded by the chunk vertex shader.
+// geometry: bits 0-4 x, 5-9 y, 10-14 z (section-local, 0..16), 15-17 face, 18-19 ambient occlusion (3 = unoccluded)
+// material: bits 0-15 texture layer, 16-19 sky light, 20-23 block light (of the block in front of the face)
+struct ChunkVertex {
+    uint32_t geometry;
+    uint32_t material;
+
+    static constexpr ChunkVertex Pack(const uint32_t x, const uint32_t y, const uint32_t z,
+                                      const uint32_t face, const uint32_t ao, const uint32_t layer,
+                                      const uint32_t light) {
+        return {
+            x | (y << 5) | (z << 10) | (face << 15) | (ao << 18),
+            layer | (light << 16)
+        };
+    }
+};
+static_assert(sizeof(ChunkVertex) == 8);
+
+// Indices are relative to the mesh's first vertex and drawn with BaseVertex,
+// a section never exceeds 65536 vertices (worst case is a 3D checkerboard at 49152).
+// Meshing jobs build into a mesh on their thread's arena and copy it out, see LinearArena
+struct ChunkMesh {
+    ChunkMesh() = default;
+    explicit ChunkMesh(std::pmr::memory_resource *pResource) : vertices(pResource), indices(pResource) {}
+
+    std::pmr::vector<ChunkVertex> vertices;
+    std::pmr::vector<uint16_t> indices;
+    // Section-local bounding box of the vertices, used for culling
+    uint8_t boundsMin[3] = {0, 0, 0};
+    uint8_t boundsMax[3] = {0, 0, 0};
+
+    bool IsEmpty() const { return indices.empty(); }
+};
+
+// Copy of a section's blocks and light plus a one block border from the 26 neighbouring sections.
+// Gathered on the thread that owns the world, so meshing can run on any worker without touching it.
+struct SectionNeighborhood {
+    static constexpr int SIZE = ChunkSection::SIZE + 2;
+    static constexpr int VOLUME = SIZE * SIZE * SIZE;
+
+    // x, y, z in [-1, ChunkSection::SIZE]
+    static constexpr int Index(const int x, const int y, const int z) {
+        return ((y + 1) * SIZE + (z + 1)) * SIZE + (x + 1);
+    }
+
+    BlockId Get(const int x, const int y, const int z) const { return blocks[Index(x, y, z)]; }
+    // Sky light in the low nibble, block light in the high one
+    uint8_t GetLight(const int x, const int y, const int z) const { return light[Index(x, y, z)]; }
+
+    void Gather(const World &world, int sx, int sy, int sz);
+
+    int sx = 0, sy = 0, sz = 0;
+    std::array<BlockId, VOLUME> blocks;
+    std::array<uint8_t, VOLUME> light;
+};
+
+// Face-culled greedy mesher: faces between two opaque blocks are dropped and coplanar faces
+// with the same texture, ambient occlusion and light are merged into as few quads as possible.
+// Vertex positions are relative to the section origin.
+void MeshSection(const SectionNeighborhood &section, ChunkMesh &mesh);
+
+constexpr int MAX_MESH_LOD = 3;
+
+// Lower detail mesh over cells of 2^lod blocks, lod in [0, MAX_MESH_LOD]. Vertices stay in block units, so these
+// meshes draw exactly like full detail ones. Neighbouring sections may use any other level without cracks.
+void MeshSectionLod(const SectionNeighborhood &section, int lod, ChunkMesh &mesh);
@@ -0,0 +1,787 @@
+#include "render/ChunkRenderer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <thread>
+
+#include <spdlog/spdlog.h>
+
+#include "core/LinearArena.h"
+#include "core/Profiler.h"
+#include "render/Frustum.h"
+
+namespace {
+    constexpr uint32_t DRAW_ARGS_STRIDE = 5 * sizeof(uint32_t);
+    constexpr uint32_t CULL_GROUP_SIZE = 64;
+    // Below this many draws per batch, recording in parallel costs more than it saves
+    constexpr size_t MIN_DRAWS_PER_BATCH = 256;
+
+    dg::RefCntAutoPtr<dg::IShader> CreateShader(PipelineCache &pipelineCache, const dg::SHADER_TYPE type,
+                                                const char *name, const char *filePath,
+                                                const dg::ShaderMacroArray &macros = {}) {
+        dg::ShaderCreateInfo ShaderCI;
+        ShaderCI.SourceLanguage = dg::SHADER_SOURCE_LANGUAGE_HLSL;
+        ShaderCI.Desc.UseCombinedTextureSamplers = true;
+        ShaderCI.Desc.ShaderType = type;
+        ShaderCI.EntryPoint = "main";
+        ShaderCI.Desc.Name = name;
+        ShaderCI.FilePath = filePath;
+        ShaderCI.Macros = macros;
+        return pipelineCache.CreateShader(ShaderCI);
+    }
+
+    const char *GetDrawPathName(const ChunkRenderer::DrawPath path) {
+        switch (path) {
+            case ChunkRenderer::DRAW_PATH_MULTI_INDIRECT: return "multi-draw indirect";
+            case ChunkRenderer::DRAW_PATH_INDIRECT_LOOP: return "indirect loop";
+            default: return "direct";
+        }
+    }
+}
+
+ChunkRenderer::ChunkRenderer(dg::IRenderDevice *pDevice, JobSystem &jobSystem, UniformRing &uniformRing,
+                             UploadQueue &uploadQueue, PipelineCache &pipelineCache,
+                             const BlockTextureArray &blockTextures, const dg::TEXTURE_FORMAT colorFormat,
+                             const dg::TEXTURE_FORMAT depthFormat, const uint32_t vertexCapacity,
+                             const uint32_t indexCapacity)
+    : m_pDevice(pDevice), m_jobSystem(jobSystem), m_uniformRing(uniformRing), m_uploadQueue(uploadQueue),
+      m_blockTextures(blockTextures),
+      m_meshPool(pDevice, vertexCapacity, indexCapacity, uploadQueue.GetContextMask()) {
+    const auto &features = pDevice->GetDeviceInfo().Features;
+    const auto capFlags = pDevice->GetAdapterInfo().DrawCommand.CapFlags;
+
+    const bool hasCompute = features.ComputeShaders != dg::DEVICE_FEATURE_STATE_DISABLED;
+    const bool hasIndirect = (capFlags & dg::DRAW_COMMAND_CAP_FLAG_DRAW_INDIRECT) != 0 &&
+                             (capFlags & dg::DRAW_COMMAND_CAP_FLAG_DRAW_INDIRECT_FIRST_INSTANCE) != 0;
+    // The adapter having it is not enough, the device must have been created with it
+    const bool hasMultiDraw = (capFlags & dg::DRAW_COMMAND_CAP_FLAG_NATIVE_MULTI_DRAW_INDIRECT) != 0 &&
+                              (capFlags & dg::DRAW_COMMAND_CAP_FLAG_DRAW_INDIRECT_COUNTER_BUFFER) != 0 &&
+                              features.NativeMultiDraw == dg::DEVICE_FEATURE_STATE_ENABLED;
+
+    if (hasCompute && hasIndirect)
+        m_drawPath = hasMultiDraw ? DRAW_PATH_MULTI_INDIRECT : DRAW_PATH_INDIRECT_LOOP;
+    spdlog::info("Chunk renderer draw path: {}", GetDrawPathName(m_drawPath));
+
+    CreatePipelines(pipelineCache, colorFormat, depthFormat);
+}
+
+ChunkRenderer::~ChunkRenderer() {
+    // Jobs write into m_results, they must be done before it goes away
+    while (m_inFlight.load(std::memory_order_acquire) > 0)
+        std::this_thread::yield();
+    for (const auto &result: m_results)
+        m_uploadQueue.Discard(result.staging);
+}
+
+void ChunkRenderer::CreatePipelines(PipelineCache &pipelineCache, const dg::TEXTURE_FORMAT colorFormat,
+                                    const dg::TEXTURE_FORMAT depthFormat) {
+    dg::GraphicsPipelineStateCreateInfo PSOCreateInfo;
+    PSOCreateInfo.PSODesc.Name = "Chunk PSO";
+    PSOCreateInfo.PSODesc.PipelineType = dg::PIPELINE_TYPE_GRAPHICS;
+
+    PSOCreateInfo.GraphicsPipeline.NumRenderTargets = 1;
+    PSOCreateInfo.GraphicsPipeline.RTVFormats[0] = colorFormat;
+    PSOCreateInfo.GraphicsPipeline.DSVFormat = depthFormat;
+    PSOCreateInfo.GraphicsPipeline.PrimitiveTopology = dg::PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+    PSOCreateInfo.GraphicsPipeline.RasterizerDesc.CullMode = dg::CULL_MODE_BACK;
+    PSOCreateInfo.GraphicsPipeline.DepthStencilDesc.DepthEnable = true;
+
+    auto pVS = CreateShader(pipelineCache, dg::SHADER_TYPE_VERTEX, "Chunk vertex shader", "chunk.vsh");
+    auto pPS = CreateShader(pipelineCache, dg::SHADER_TYPE_PIXEL, "Chunk pixel shader", "chunk.psh");
+
+    // Slot 0: packed vertices (see ChunkVertex), slot 1: per-draw section origin
+    dg::LayoutElement LayoutElements[] = {
+        dg::LayoutElement{0, 0, 2, dg::VT_UINT32, false},
+        dg::LayoutElement{1, 1, 4, dg::VT_FLOAT32, false, dg::INPUT_ELEMENT_FREQUENCY_PER_INSTANCE}
+    };
+    PSOCreateInfo.GraphicsPipeline.InputLayout.LayoutElements = LayoutElements;
+    PSOCreateInfo.GraphicsPipeline.InputLayout.NumElements = std::size(LayoutElements);
+
+    // Constants are slices of the uniform ring, selected per frame with a dynamic offset
+    dg::ShaderResourceVariableDesc Vars[] = {
+        {dg::SHADER_TYPE_VERTEX, "Constants", dg::SHADER_RESOURCE_VARIABLE_TYPE_DYNAMIC}
+    };
+    PSOCreateInfo.PSODesc.ResourceLayout.DefaultVariableType = dg::SHADER_RESOURCE_VARIABLE_TYPE_STATIC;
+    PSOCreateInfo.PSODesc.ResourceLayout.Variables = Vars;
+    PSOCreateInfo.PSODesc.ResourceLayout.NumVariables = std::size(Vars);
+
+    // Pixelated up close, trilinear in the distance; texture coordinates repeat once per block
+    const dg::SamplerDesc BlockSampler{dg::FILTER_TYPE_LINEAR, dg::FILTER_TYPE_POINT, dg::FILTER_TYPE_LINEAR,
+                                       dg::TEXTURE_ADDRESS_WRAP, dg::TEXTURE_ADDRESS_WRAP, dg::TEXTURE_ADDRESS_WRAP};
+    dg::ImmutableSamplerDesc ImmutableSamplers[] = {
+        {dg::SHADER_TYPE_PIXEL, "g_BlockTextures", BlockSampler}
+    };
+    PSOCreateInfo.PSODesc.ResourceLayout.ImmutableSamplers = ImmutableSamplers;
+    PSOCreateInfo.PSODesc.ResourceLayout.NumImmutableSamplers = std::size(ImmutableSamplers);
+
+    PSOCreateInfo.pVS = pVS;
+    PSOCreateInfo.pPS = pPS;
+    m_pPSO = pipelineCache.CreateGraphicsPipelineState(PSOCreateInfo);
+    // Static, so every SRB made from the PSO, including the deferred contexts' ones, shares the binding
+    m_pPSO->GetStaticVariableByName(dg::SHADER_TYPE_PIXEL, "g_BlockTextures")
+        ->Set(m_blockTextures.GetShaderResourceView());
+    m_pPSO->CreateShaderResourceBinding(&m_pSRB, true);
+    m_pConstantsVar = m_pSRB->GetVariableByName(dg::SHADER_TYPE_VERTEX, "Constants");
+    m_uniformRing.Bind(m_pConstantsVar, sizeof(ChunkConstants));
+
+    if (m_drawPath == DRAW_PATH_DIRECT)
+        return;
+
+    const dg::ShaderMacro CullMacros[] = {
+        {"COMPACT_DRAWS", m_drawPath == DRAW_PATH_MULTI_INDIRECT ? "1" : "0"}
+    };
+    auto pCS = CreateShader(pipelineCache, dg::SHADER_TYPE_COMPUTE, "Chunk cull shader", "chunk_cull.csh",
+                            {CullMacros, static_cast<dg::Uint32>(std::size(CullMacros))});
+
+    dg::ComputePipelineStateCreateInfo CullPSOCreateInfo;
+    CullPSOCreateInfo.PSODesc.Name = "Chunk cull PSO";
+    CullPSOCreateInfo.PSODesc.PipelineType = dg::PIPELINE_TYPE_COMPUTE;
+    // Slot buffers are recreated when they grow, together with the SRB; the Hi-Z pyramid on resize without them
+    dg::ShaderResourceVariableDesc CullVars[] = {
+        {dg::SHADER_TYPE_COMPUTE, "CullConstants", dg::SHADER_RESOURCE_VARIABLE_TYPE_DYNAMIC},
+        {dg::SHADER_TYPE_COMPUTE, "g_HiZ", dg::SHADER_RESOURCE_VARIABLE_TYPE_DYNAMIC}
+    };
+    CullPSOCreateInfo.PSODesc.ResourceLayout.DefaultVariableType = dg::SHADER_RESOURCE_VARIABLE_TYPE_MUTABLE;
+    CullPSOCreateInfo.PSODesc.ResourceLayout.Variables = CullVars;
+    CullPSOCreateInfo.PSODesc.ResourceLayout.NumVariables = std::size(CullVars);
+    CullPSOCreateInfo.pCS = pCS;
+    m_pCullPSO = pipelineCache.CreateComputePipelineState(CullPSOCreateInfo);
+
+    dg::BufferDesc CountDesc;
+    CountDesc.Name = "Chunk draw count";
+    CountDesc.Usage = dg::USAGE_DEFAULT;
+    CountDesc.BindFlags = dg::BIND_UNORDERED_ACCESS | dg::BIND_INDIRECT_DRAW_ARGS;
+    CountDesc.Mode = dg::BUFFER_MODE_RAW;
+    CountDesc.ElementByteStride = sizeof(uint32_t);
+    CountDesc.Size = 4 * sizeof(uint32_t);
+    m_pDevice->CreateBuffer(CountDesc, nullptr, &m_pDrawCount);
+
+    // Bound while there is no pyramid, the shader skips the test then
+    const float farDepth = 1.f;
+    dg::TextureDesc NoHiZDesc;
+    NoHiZDesc.Name = "Empty Hi-Z";
+    NoHiZDesc.Type = dg::RESOURCE_DIM_TEX_2D;
+    NoHiZDesc.Width = NoHiZDesc.Height = 1;
+    NoHiZDesc.Format = dg::TEX_FORMAT_R32_FLOAT;
+    NoHiZDesc.Usage = dg::USAGE_IMMUTABLE;
+    NoHiZDesc.BindFlags = dg::BIND_SHADER_RESOURCE;
+    dg::TextureSubResData NoHiZLevel{&farDepth, sizeof(farDepth)};
+    dg::TextureData NoHiZData{&NoHiZLevel, 1};
+    m_pDevice->CreateTexture(NoHiZDesc, &NoHiZData, &m_pNoHiZ);
+}
+
+void ChunkRenderer::ReserveSlots(const uint32_t slotCount) {
+    if (slotCount <= m_slotCapacity)
+        return;
+
+    uint32_t capacity = std::max(m_slotCapacity, 1024u);
+    while (capacity < slotCount)
+        capacity *= 2;
+    m_slotCapacity = capacity;
+    m_drawInfo.resize(capacity, DrawInfo{});
+    m_instanceData.resize(capacity, dg::float4(0, 0, 0, 0));
+
+    // The CPU copies are complete, so the new buffers are simply initialized from them
+    dg::BufferDesc InstDesc;
+    InstDesc.Name = "Chunk instance data";
+    InstDesc.Usage = dg::USAGE_DEFAULT;
+    InstDesc.BindFlags = dg::BIND_VERTEX_BUFFER;
+    InstDesc.Size = static_cast<uint64_t>(capacity) * sizeof(dg::float4);
+    dg::BufferData InstData{m_instanceData.data(), InstDesc.Size};
+    m_pInstanceData.Release();
+    m_pDevice->CreateBuffer(InstDesc, &InstData, &m_pInstanceData);
+
+    if (m_drawPath == DRAW_PATH_DIRECT)
+        return;
+
+    dg::BufferDesc InfoDesc;
+    InfoDesc.Name = "Chunk draw info";
+    InfoDesc.Usage = dg::USAGE_DEFAULT;
+    InfoDesc.BindFlags = dg::BIND_SHADER_RESOURCE;
+    InfoDesc.Mode = dg::BUFFER_MODE_STRUCTURED;
+    InfoDesc.ElementByteStride = sizeof(DrawInfo);
+    InfoDesc.Size = static_cast<uint64_t>(capacity) * sizeof(DrawInfo);
+    dg::BufferData InfoData{m_drawInfo.data(), InfoDesc.Size};
+    m_pDrawInfo.Release();
+    m_pDevice->CreateBuffer(InfoDesc, &InfoData, &m_pDrawInfo);
+
+    dg::BufferDesc ArgsDesc;
+    ArgsDesc.Name = "Chunk draw args";
+    ArgsDesc.Usage = dg::USAGE_DEFAULT;
+    ArgsDesc.BindFlags = dg::BIND_UNORDERED_ACCESS | dg::BIND_INDIRECT_DRAW_ARGS;
+    ArgsDesc.Mode = dg::BUFFER_MODE_RAW;
+    ArgsDesc.ElementByteStride = sizeof(uint32_t);
+    ArgsDesc.Size = static_cast<uint64_t>(capacity) * DRAW_ARGS_STRIDE;
+    m_pDrawArgs.Release();
+    m_pDevice->CreateBuffer(ArgsDesc, nullptr, &m_pDrawArgs);
+
+    m_pCullSRB.Release();
+    m_pCullPSO->CreateShaderResourceBinding(&m_pCullSRB, true);
+    m_pCullConstantsVar = m_pCullSRB->GetVariableByName(dg::SHADER_TYPE_COMPUTE, "CullConstants");
+    m_uniformRing.Bind(m_pCullConstantsVar, sizeof(CullConstants));
+    m_pCullHiZVar = m_pCullSRB->GetVariableByName(dg::SHADER_TYPE_COMPUTE, "g_HiZ");
+    m_pCullSRB->GetVariableByName(dg::SHADER_TYPE_COMPUTE, "g_DrawInfo")
+              ->Set(m_pDrawInfo->GetDefaultView(dg::BUFFER_VIEW_SHADER_RESOURCE));
+    m_pCullSRB->GetVariableByName(dg::SHADER_TYPE_COMPUTE, "g_DrawArgs")
+              ->Set(m_pDrawArgs->GetDefaultView(dg::BUFFER_VIEW_UNORDERED_ACCESS));
+    if (m_drawPath == DRAW_PATH_MULTI_INDIRECT) {
+        m_pCullSRB->GetVariableByName(dg::SHADER_TYPE_COMPUTE, "g_DrawCount")
+                  ->Set(m_pDrawCount->GetDefaultView(dg::BUFFER_VIEW_UNORDERED_ACCESS));
+    }
+}
+
+void ChunkRenderer::WriteSlot(dg::IDeviceContext *pContext, const ChunkMeshPool::Handle handle) {
+    const MeshSlice &slice = m_meshPool.Get(handle);
+    DrawInfo &info = m_drawInfo[handle];
+    info.numIndices = slice.indexCount;
+    info.firstIndex = slice.indexOffset;
+    info.baseVertex = slice.vertexOffset;
+
+    pContext->UpdateBuffer(m_pInstanceData, static_cast<uint64_t>(handle) * sizeof(dg::float4), sizeof(dg::float4),
+                           &m_instanceData[handle], dg::RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+    if (m_pDrawInfo) {
+        pContext->UpdateBuffer(m_pDrawInfo, static_cast<uint64_t>(handle) * sizeof(DrawInfo), sizeof(DrawInfo),
+                               &info, dg::RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+    }
+}
+
+void ChunkRenderer::ClearSlot(dg::IDeviceContext *pContext, const ChunkMeshPool::Handle handle) {
+    // The handle may have been reused by an upload since it was freed
+    if (handle >= m_slotCapacity || m_drawInfo[handle].numIndices != 0)
+        return;
+    if (m_pDrawInfo) {
+        pContext->UpdateBuffer(m_pDrawInfo, static_cast<uint64_t>(handle) * sizeof(DrawInfo), sizeof(DrawInfo),
+                               &m_drawInfo[handle], dg::RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+    }
+}
+
+void ChunkRenderer::QueueChunk(const World &world, const ChunkPos pos) {
+    const Chunk *chunk = world.GetChunk(pos);
+    if (!chunk)
+        return;
+
+    PROFILE_SCOPE("Mesh gather");
+    const int lod = GetLod(GetChunkDistance(pos));
+    m_chunkLods[pos] = lod;
+    for (int sy = 0; sy < Chunk::SECTION_COUNT; ++sy)
+        QueueSection(world, *chunk, {pos.x, sy, pos.z}, lod, false);
+}
+
+bool ChunkRenderer::QueueSection(const World &world, const Chunk &chunk, const SectionPos pos, const int lod,
+                                 const bool urgent) {
+    const ChunkSection *section = chunk.GetSection(pos.y);
+    const uint32_t version = ++m_nextVersion;
+    m_versions[pos] = version;
+
+    if (!section || section->IsEmpty()) {
+        FreeMesh(pos);
+        return false;
+    }
+
+    // Returned to the pool by the job
+    SectionNeighborhood *pBlocks = m_neighborhoods.Create();
+    pBlocks->Gather(world, pos.x, pos.y, pos.z);
+
+    m_inFlight.fetch_add(1, std::memory_order_relaxed);
+    m_jobSystem.Submit([this, pos, version, lod, urgent, pBlocks] {
+        PROFILE_SCOPE("Meshing");
+        LinearArena &arena = GetThreadArena();
+        const LinearArena::Scope scratch(arena);
+        ChunkMesh mesh(&arena);
+        MeshSectionLod(*pBlocks, lod, mesh);
+        m_neighborhoods.Destroy(pBlocks);
+
+        MeshResult result{pos, version, urgent};
+        result.vertexCount = static_cast<uint32_t>(mesh.vertices.size());
+        result.indexCount = static_cast<uint32_t>(mesh.indices.size());
+        std::copy_n(mesh.boundsMin, 3, result.mesh.boundsMin);
+        std::copy_n(mesh.boundsMax, 3, result.mesh.boundsMax);
+        // The render thread retries when the ring is full, the mesh has to outlive the arena until then
+        if (!StageMesh(result, mesh)) {
+            result.mesh.vertices.assign(mesh.vertices.begin(), mesh.vertices.end());
+            result.mesh.indices.assign(mesh.indices.begin(), mesh.indices.end());
+        }
+        {
+            std::lock_guard lock(m_resultMutex);
+            m_results.push_back(std::move(result));
+        }
+        m_meshedCount.fetch_add(1, std::memory_order_relaxed);
+        m_inFlight.fetch_sub(1, std::memory_order_release);
+    });
+    return true;
+}
+
+void ChunkRenderer::UpdateChangedSections(World &world, const uint32_t maxSections) {
+    std::vector<SectionPos> changed;
+    world.TakeChangedSections(changed);
+    for (const SectionPos &pos: changed) {
+        // Sections of chunks that are not drawn get meshed with their chunk once it becomes ready
+        if (m_chunkLods.contains({pos.x, pos.z}) && m_changedSet.insert(pos).second)
+            m_changedSections.push_back(pos);
+    }
+    if (m_changedSections.empty())
+        return;
+
+    PROFILE_SCOPE("Mesh gather");
+    uint32_t queued = 0;
+    for (size_t i = 0; i < m_changedSections.size() && queued < maxSections;) {
+        const SectionPos pos = m_changedSections[i];
+        const auto lod = m_chunkLods.find({pos.x, pos.z});
+        const Chunk *chunk = world.GetChunk({pos.x, pos.z});
+        if (lod == m_chunkLods.end() || !chunk) {
+            m_changedSet.erase(pos);
+            m_changedSections.erase(m_changedSections.begin() + static_cast<ptrdiff_t>(i));
+            continue;
+        }
+        // One edit mesh per section at a time: remeshing on every edit would make each in-flight mesh stale
+        // before it lands, and a section edited every frame would never update
+        if (m_urgentInFlight.contains(pos)) {
+            ++i;
+            continue;
+        }
+        if (QueueSection(world, *chunk, pos, lod->second, true))
+            m_urgentInFlight.insert(pos);
+        m_changedSet.erase(pos);
+        m_changedSections.erase(m_changedSections.begin() + static_cast<ptrdiff_t>(i));
+        ++queued;
+    }
+}
+
+void ChunkRenderer::RemoveChunk(const ChunkPos pos) {
+    m_chunkLods.erase(pos);
+    for (int sy = 0; sy < Chunk::SECTION_COUNT; ++sy) {
+        const SectionPos sectionPos{pos.x, sy, pos.z};
+        FreeMesh(sectionPos);
+        m_urgentInFlight.erase(sectionPos);
+        // Without a version entry any mesh still in flight is stale
+        m_versions.erase(sectionPos);
+    }
+}
+
+float ChunkRenderer::GetChunkDistance(const ChunkPos pos) const {
+    const float dx = static_cast<float>(pos.x) + 0.5f - m_cameraX;
+    const float dz = static_cast<float>(pos.z) + 0.5f - m_cameraZ;
+    return std::sqrt(dx * dx + dz * dz);
+}
+
+int ChunkRenderer::GetLod(const float distance) const {
+    int lod = 0;
+    for (float limit = m_lodDistance; lod < MAX_MESH_LOD && distance >= limit; limit *= 2.f)
+        ++lod;
+    return lod;
+}
+
+void ChunkRenderer::UpdateLods(const World &world, const float cameraX, const float cameraZ,
+                               const uint32_t maxRemeshes) {
+    // Levels only change a chunk past their border, so moving along it does not remesh back and forth
+    constexpr float HYSTERESIS = 1.f;
+
+    m_cameraX = cameraX / static_cast<float>(Chunk::SIZE);
+    m_cameraZ = cameraZ / static_cast<float>(Chunk::SIZE);
+
+    struct Change {
+        ChunkPos pos;
+        int error;
+    };
+    std::vector<Change> changes;
+    for (const auto &[pos, lod]: m_chunkLods) {
+        const float distance = GetChunkDistance(pos);
+        if (lod >= GetLod(distance - HYSTERESIS) && lod <= GetLod(distance + HYSTERESIS))
+            continue;
+        changes.push_back({pos, std::abs(GetLod(distance) - lod)});
+    }
+    if (changes.empty())
+        return;
+
+    const size_t count = std::min<size_t>(changes.size(), maxRemeshes);
+    std::partial_sort(changes.begin(), changes.begin() + count, changes.end(),
+                      [](const Change &a, const Change &b) { return a.error > b.error; });
+    for (size_t i = 0; i < count; ++i)
+        QueueChunk(world, changes[i].pos);
+}
+
+std::array<uint32_t, MAX_MESH_LOD + 1> ChunkRenderer::GetLodCounts() const {
+    std::array<uint32_t, MAX_MESH_LOD + 1> counts{};
+    for (const auto &[pos, lod]: m_chunkLods)
+        ++counts[lod];
+    return counts;
+}
+
+void ChunkRenderer::FreeMesh(const SectionPos pos) {
+    const auto it = m_meshes.find(pos);
+    if (it == m_meshes.end())
+        return;
+    m_meshPool.Free(it->second);
+    if (it->second < m_slotCapacity)
+        m_drawInfo[it->second] = DrawInfo{};
+    m_freedSlots.push_back(it->second);
+    m_meshes.erase(it);
+}
+
+void ChunkRenderer::Update(dg::IDeviceContext *pContext, const uint32_t maxUploads, const size_t maxUploadBytes) {
+    // Scratch for the frame, the render thread's arena is reset after Present
+    std::pmr::vector<MeshResult> results(&GetThreadArena());
+    {
+        std::lock_guard lock(m_resultMutex);
+        // Edited sections go first, streaming and LOD changes can wait a frame
+        std::stable_partition(m_results.begin(), m_results.end(), [](const MeshResult &result) { return result.urgent; });
+        // Always take at least one mesh, a single large one must not stall the queue
+        size_t count = 0, bytes = 0;
+        while (count < m_results.size() && count < maxUploads) {
+            const MeshResult &result = m_results[count];
+            bytes += result.vertexCount * sizeof(ChunkVertex) + result.indexCount * sizeof(uint16_t);
+            if (count > 0 && bytes > maxUploadBytes)
+                break;
+            ++count;
+        }
+        results.assign(std::make_move_iterator(m_results.begin()),
+                       std::make_move_iterator(m_results.begin() + static_cast<ptrdiff_t>(count)));
+        m_results.erase(m_results.begin(), m_results.begin() + static_cast<ptrdiff_t>(count));
+    }
+
+    m_uploadQueue.Update();
+    std::pmr::vector<MeshResult> unstaged(&GetThreadArena());
+    for (auto &result: results) {
+        const auto it = m_versions.find(result.pos);
+        const bool stale = it == m_versions.end() || it->second != result.version;
+        if (!stale && result.indexCount > 0 && !result.staging.IsValid() && !StageMesh(result, result.mesh)) {
+            // The ring is full until copies in flight complete. The results after this one may already be staged,
+            // going on with them is what frees the ring up
+            unstaged.push_back(std::move(result));
+            continue;
+        }
+        if (result.urgent)
+            m_urgentInFlight.erase(result.pos);
+        if (stale)
+            m_uploadQueue.Discard(result.staging);
+        else if (result.indexCount == 0)
+            FreeMesh(result.pos);
+        else
+            Upload(pContext, result);
+    }
+    if (!unstaged.empty()) {
+        std::lock_guard lock(m_resultMutex);
+        m_results.insert(m_results.begin(), std::make_move_iterator(unstaged.begin()),
+                         std::make_move_iterator(unstaged.end()));
+    }
+    SubmitUploads();
+    InstallUploads(pContext);
+
+    for (const auto handle: m_freedSlots)
+        ClearSlot(pContext, handle);
+    m_freedSlots.clear();
+
+    // Moving slices while the transfer queue writes into the pool would race with it
+    if (results.empty() && m_pendingUploads.empty()) {
+        m_movedSlots.clear();
+        m_meshPool.Defragment(pContext, 4, m_movedSlots);
+        for (const auto handle: m_movedSlots)
+            WriteSlot(pContext, handle);
+    }
+}
+
+bool ChunkRenderer::StageMesh(MeshResult &result, const ChunkMesh &mesh) {
+    if (result.indexCount == 0)
+        return true;
+    const size_t vertexBytes = result.vertexCount * sizeof(ChunkVertex);
+    const size_t indexBytes = result.indexCount * sizeof(uint16_t);
+    result.staging = m_uploadQueue.Allocate(static_cast<uint32_t>(vertexBytes + indexBytes));
+    if (!result.staging.IsValid())
+        return false;
+
+    auto *pData = static_cast<uint8_t *>(result.staging.pData);
+    std::memcpy(pData, mesh.vertices.data(), vertexBytes);
+    std::memcpy(pData + vertexBytes, mesh.indices.data(), indexBytes);
+    // Staged by the render thread after all, the copy kept for it can go
+    if (&mesh == &result.mesh) {
+        result.mesh.vertices.clear();
+        result.mesh.vertices.shrink_to_fit();
+        result.mesh.indices.clear();
+        result.mesh.indices.shrink_to_fit();
+    }
+    return true;
+}
+
+void ChunkRenderer::Upload(dg::IDeviceContext *pContext, const MeshResult &result) {
+    // Growing copies the pool on the immediate context, which must come after every copy into the old buffers
+    if (!m_meshPool.Fits(result.vertexCount, result.indexCount)) {
+        SubmitUploads();
+        m_uploadQueue.WaitIdle();
+    }
+
+    // The section keeps drawing its old mesh until the copy is done
+    const ChunkMeshPool::Handle handle = m_meshPool.Allocate(pContext, result.vertexCount, result.indexCount);
+    const MeshSlice &slice = m_meshPool.Get(handle);
+    const auto vertexBytes = static_cast<uint32_t>(result.vertexCount * sizeof(ChunkVertex));
+    const auto indexBytes = static_cast<uint32_t>(result.indexCount * sizeof(uint16_t));
+    m_uploadQueue.Copy(result.staging, 0, vertexBytes, m_meshPool.GetVertexBuffer(),
+                       static_cast<uint64_t>(slice.vertexOffset) * sizeof(ChunkVertex));
+    m_uploadQueue.Copy(result.staging, vertexBytes, indexBytes, m_meshPool.GetIndexBuffer(),
+                       static_cast<uint64_t>(slice.indexOffset) * sizeof(uint16_t));
+
+    const auto &mesh = result.mesh;
+    m_pendingUploads.push_back({result.pos, result.version, handle,
+                                dg::float3(mesh.boundsMin[0], mesh.boundsMin[1], mesh.boundsMin[2]),
+                                dg::float3(mesh.boundsMax[0], mesh.boundsMax[1], mesh.boundsMax[2])});
+}
+
+void ChunkRenderer::SubmitUploads() {
+    const UploadQueue::Ticket ticket = m_uploadQueue.Submit();
+    for (auto it = m_pendingUploads.rbegin(); it != m_pendingUploads.rend() && it->ticket == 0; ++it)
+        it->ticket = ticket;
+}
+
+void ChunkRenderer::InstallUploads(dg::IDeviceContext *pContext) {
+    size_t count = 0;
+    while (count < m_pendingUploads.size() && m_pendingUploads[count].ticket != 0 &&
+           m_uploadQueue.IsReady(m_pendingUploads[count].ticket))
+        ++count;
+    if (count == 0)
+        return;
+    // This frame's draws read what the transfer queue wrote
+    m_uploadQueue.WaitOnGpu(m_pendingUploads[count - 1].ticket);
+
+    for (size_t i = 0; i < count; ++i) {
+        const PendingUpload &upload = m_pendingUploads[i];
+        const auto it = m_versions.find(upload.pos);
+        if (it == m_versions.end() || it->second != upload.version) {
+            m_meshPool.Free(upload.handle);
+            continue;
+        }
+
+        FreeMesh(upload.pos);
+        m_meshes[upload.pos] = upload.handle;
+        ReserveSlots(m_meshPool.GetHandleCount());
+
+        const dg::float3 origin(static_cast<float>(upload.pos.x * ChunkSection::SIZE),
+                                static_cast<float>(upload.pos.y * ChunkSection::SIZE),
+                                static_cast<float>(upload.pos.z * ChunkSection::SIZE));
+        m_instanceData[upload.handle] = dg::float4(origin, 0.f);
+        m_drawInfo[upload.handle].boundsMin = dg::float4(origin + upload.boundsMin, 0.f);
+        m_drawInfo[upload.handle].boundsMax = dg::float4(origin + upload.boundsMax, 0.f);
+        WriteSlot(pContext, upload.handle);
+    }
+    m_pendingUploads.erase(m_pendingUploads.begin(), m_pendingUploads.begin() + static_cast<ptrdiff_t>(count));
+}
+
+void ChunkRenderer::PrepareFrame(const dg::float4x4 &viewProj, const uint32_t frameSlot) {
+    m_frameSlot = frameSlot;
+    m_frameConstants.viewProj = viewProj.Transpose();
+    m_frameConstants.textureMinLod = m_blockTextures.GetMinLod();
+    if (auto *pConstants = m_uniformRing.Allocate<ChunkConstants>(m_constantsOffset))
+        *pConstants = m_frameConstants;
+    else
+        m_constantsOffset = ~0u;
+
+    const Frustum frustum = Frustum::FromViewProj(viewProj);
+
+    m_drawList.clear();
+    if (m_drawPath == DRAW_PATH_DIRECT) {
+        for (const auto &[pos, handle]: m_meshes) {
+            const DrawInfo &info = m_drawInfo[handle];
+            const dg::float3 boxMin(info.boundsMin.x, info.boundsMin.y, info.boundsMin.z);
+            const dg::float3 boxMax(info.boundsMax.x, info.boundsMax.y, info.boundsMax.z);
+            if (frustum.IntersectsBox(boxMin, boxMax))
+                m_drawList.push_back(handle);
+        }
+        return;
+    }
+    if (m_drawPath == DRAW_PATH_INDIRECT_LOOP) {
+        for (const auto &[pos, handle]: m_meshes)
+            m_drawList.push_back(handle);
+    }
+
+    if (auto *pCullConstants = m_uniformRing.Allocate<CullConstants>(m_cullConstantsOffset)) {
+        std::copy(std::begin(frustum.planes), std::end(frustum.planes), pCullConstants->frustumPlanes);
+        pCullConstants->slotCount = m_meshPool.GetHandleCount();
+        const bool occlusion = m_pHiZ && m_pHiZ->IsValid();
+        pCullConstants->hiZViewProj = occlusion ? m_pHiZ->GetViewProj().Transpose() : dg::float4x4::Identity();
+        pCullConstants->hiZMipCount = occlusion ? m_pHiZ->GetMipCount() : 0;
+        pCullConstants->hiZWidth = occlusion ? m_pHiZ->GetWidth() : 0;
+        pCullConstants->hiZHeight = occlusion ? m_pHiZ->GetHeight() : 0;
+        const dg::NDCAttribs ndc = m_pDevice->GetDeviceInfo().GetNDCAttribs();
+        pCullConstants->ndcMinZ = ndc.MinZ;
+        pCullConstants->ndcZtoDepthScale = ndc.ZtoDepthScale;
+        pCullConstants->ndcYtoVScale = ndc.YtoVScale;
+        pCullConstants->padding = 0.f;
+    } else {
+        m_cullConstantsOffset = ~0u;
+    }
+}
+
+void ChunkRenderer::Cull(dg::IDeviceContext *pContext) {
+    const uint32_t slotCount = m_meshPool.GetHandleCount();
+    if (m_drawPath == DRAW_PATH_DIRECT || slotCount == 0 || !m_pCullSRB || m_cullConstantsOffset == ~0u)
+        return;
+
+    if (m_drawPath == DRAW_PATH_MULTI_INDIRECT) {
+        const uint32_t zero = 0;
+        pContext->UpdateBuffer(m_pDrawCount, 0, sizeof(zero), &zero, dg::RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+    }
+
+    // Uploads leave the slot buffers in COPY_DEST, move everything into place with one barrier batch
+    m_stateTracker.Require(m_pDrawInfo, dg::RESOURCE_STATE_SHADER_RESOURCE);
+    m_stateTracker.Require(m_pDrawArgs, dg::RESOURCE_STATE_UNORDERED_ACCESS);
+    if (m_drawPath == DRAW_PATH_MULTI_INDIRECT)
+        m_stateTracker.Require(m_pDrawCount, dg::RESOURCE_STATE_UNORDERED_ACCESS);
+    dg::ITexture *pHiZ = m_pHiZ && m_pHiZ->GetPyramid() ? m_pHiZ->GetPyramid() : m_pNoHiZ.RawPtr();
+    m_stateTracker.Require(pHiZ, dg::RESOURCE_STATE_SHADER_RESOURCE);
+    m_stateTracker.Flush(pContext);
+    m_pCullHiZVar->Set(pHiZ->GetDefaultView(dg::TEXTURE_VIEW_SHADER_RESOURCE));
+
+    m_pCullConstantsVar->SetBufferOffset(m_cullConstantsOffset);
+    pContext->SetPipelineState(m_pCullPSO);
+    pContext->CommitShaderResources(m_pCullSRB, DRAW_TRANSITION_MODE);
+    dg::DispatchComputeAttribs dispatchAttrs{(slotCount + CULL_GROUP_SIZE - 1) / CULL_GROUP_SIZE, 1, 1};
+    pContext->DispatchCompute(dispatchAttrs);
+}
+
+void ChunkRenderer::SetDeferredContexts(const std::vector<dg::IDeviceContext *> &contexts) {
+    m_deferredContexts.assign(contexts.begin(), contexts.end());
+    m_deferredSRBs.clear();
+    m_deferredConstantsVars.clear();
+    if (contexts.empty())
+        return;
+
+    for (auto &pConstants: m_sharedConstants) {
+        if (pConstants)
+            continue;
+        dg::BufferDesc CBDesc;
+        CBDesc.Name = "Chunk shared constants CB";
+        CBDesc.Size = sizeof(ChunkConstants);
+        CBDesc.Usage = dg::USAGE_DEFAULT;
+        CBDesc.BindFlags = dg::BIND_UNIFORM_BUFFER;
+        m_pDevice->CreateBuffer(CBDesc, nullptr, &pConstants);
+    }
+
+    // One SRB per context, so batches never commit the same binding concurrently
+    for (size_t i = 0; i < contexts.size(); ++i) {
+        dg::RefCntAutoPtr<dg::IShaderResourceBinding> pSRB;
+        m_pPSO->CreateShaderResourceBinding(&pSRB, true);
+        m_deferredConstantsVars.push_back(pSRB->GetVariableByName(dg::SHADER_TYPE_VERTEX, "Constants"));
+        m_deferredSRBs.push_back(pSRB);
+    }
+}
+
+void ChunkRenderer::BindDrawState(dg::IDeviceContext *pContext, dg::IShaderResourceBinding *pSRB) {
+    pContext->SetPipelineState(m_pPSO);
+    pContext->CommitShaderResources(pSRB, DRAW_TRANSITION_MODE);
+
+    // Every mesh lives in the pool buffers, bind them once
+    const uint64_t offsets[] = {0, 0};
+    dg::IBuffer *pBuffs[] = {m_meshPool.GetVertexBuffer(), m_pInstanceData};
+    pContext->SetVertexBuffers(0, 2, pBuffs, offsets, DRAW_TRANSITION_MODE, dg::SET_VERTEX_BUFFERS_FLAG_RESET);
+    pContext->SetIndexBuffer(m_meshPool.GetIndexBuffer(), 0, DRAW_TRANSITION_MODE);
+}
+
+void ChunkRenderer::RecordDraws(dg::IDeviceContext *pContext, const size_t begin, const size_t end) {
+    if (m_drawPath == DRAW_PATH_INDIRECT_LOOP) {
+        // Culled slots carry zero instances, the GPU skips them
+        dg::DrawIndexedIndirectAttribs drawAttrs;
+        drawAttrs.pAttribsBuffer = m_pDrawArgs;
+        drawAttrs.IndexType = dg::VT_UINT16;
+        drawAttrs.Flags = DRAW_FLAGS;
+        drawAttrs.AttribsBufferStateTransitionMode = DRAW_TRANSITION_MODE;
+        for (size_t i = begin; i < end; ++i) {
+            drawAttrs.DrawArgsOffset = static_cast<uint64_t>(m_drawList[i]) * DRAW_ARGS_STRIDE;
+            pContext->DrawIndexedIndirect(drawAttrs);
+        }
+        return;
+    }
+
+    for (size_t i = begin; i < end; ++i) {
+        const ChunkMeshPool::Handle handle = m_drawList[i];
+        const MeshSlice &slice = m_meshPool.Get(handle);
+        dg::DrawIndexedAttribs drawAttrs;
+        drawAttrs.IndexType = dg::VT_UINT16;
+        drawAttrs.NumIndices = slice.indexCount;
+        drawAttrs.BaseVertex = slice.vertexOffset;
+        drawAttrs.FirstIndexLocation = slice.indexOffset;
+        drawAttrs.FirstInstanceLocation = handle;
+        drawAttrs.Flags = DRAW_FLAGS;
+        pContext->DrawIndexed(drawAttrs);
+    }
+}
+
+void ChunkRenderer::RecordBatch(const uint32_t batch, const size_t begin, const size_t end,
+                                dg::ITextureView *pRTV, dg::ITextureView *pDSV) {
+    PROFILE_SCOPE("Record batch");
+    dg::IDeviceContext *pContext = m_deferredContexts[batch];
+    pContext->Begin(0);
+    // States were set up on the immediate context, deferred contexts only verify them
+    pContext->SetRenderTargets(1, &pRTV, pDSV, DRAW_TRANSITION_MODE);
+    m_deferredConstantsVars[batch]->Set(m_sharedConstants[m_frameSlot]);
+    BindDrawState(pContext, m_deferredSRBs[batch]);
+    RecordDraws(pContext, begin, end);
+    pContext->FinishCommandList(&m_commandLists[batch]);
+}
+
+void ChunkRenderer::Render(dg::IDeviceContext *pContext, dg::ITextureView *pRTV, dg::ITextureView *pDSV) {
+    const uint32_t slotCount = m_meshPool.GetHandleCount();
+    if (slotCount == 0 || !m_pInstanceData || m_constantsOffset == ~0u)
+        return;
+
+    m_stateTracker.Require(m_meshPool.GetVertexBuffer(), dg::RESOURCE_STATE_VERTEX_BUFFER);
+    m_stateTracker.Require(m_meshPool.GetIndexBuffer(), dg::RESOURCE_STATE_INDEX_BUFFER);
+    m_stateTracker.Require(m_pInstanceData, dg::RESOURCE_STATE_VERTEX_BUFFER);
+    if (m_drawPath != DRAW_PATH_DIRECT)
+        m_stateTracker.Require(m_pDrawArgs, dg::RESOURCE_STATE_INDIRECT_ARGUMENT);
+    if (m_drawPath == DRAW_PATH_MULTI_INDIRECT)
+        m_stateTracker.Require(m_pDrawCount, dg::RESOURCE_STATE_INDIRECT_ARGUMENT);
+
+    const size_t drawCount = m_drawList.size();
+    const auto batchCount = static_cast<uint32_t>(
+        std::min(m_deferredContexts.size(), (drawCount + MIN_DRAWS_PER_BATCH - 1) / MIN_DRAWS_PER_BATCH));
+
+    if (m_drawPath == DRAW_PATH_MULTI_INDIRECT || batchCount <= 1) {
+        m_stateTracker.Flush(pContext);
+        m_pConstantsVar->SetBufferOffset(m_constantsOffset);
+        BindDrawState(pContext, m_pSRB);
+
+        if (m_drawPath == DRAW_PATH_MULTI_INDIRECT) {
+            dg::DrawIndexedIndirectAttribs drawAttrs;
+            drawAttrs.pAttribsBuffer = m_pDrawArgs;
+            drawAttrs.IndexType = dg::VT_UINT16;
+            drawAttrs.DrawCount = slotCount;
+            drawAttrs.DrawArgsStride = DRAW_ARGS_STRIDE;
+            drawAttrs.pCounterBuffer = m_pDrawCount;
+            drawAttrs.Flags = DRAW_FLAGS;
+            drawAttrs.AttribsBufferStateTransitionMode = DRAW_TRANSITION_MODE;
+            drawAttrs.CounterBufferStateTransitionMode = DRAW_TRANSITION_MODE;
+            pContext->DrawIndexedIndirect(drawAttrs);
+        } else {
+            RecordDraws(pContext, 0, drawCount);
+        }
+        return;
+    }
+
+    dg::IBuffer *pSharedConstants = m_sharedConstants[m_frameSlot];
+    pContext->UpdateBuffer(pSharedConstants, 0, sizeof(ChunkConstants), &m_frameConstants,
+                           dg::RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+    m_stateTracker.Require(pSharedConstants, dg::RESOURCE_STATE_CONSTANT_BUFFER);
+    m_stateTracker.Flush(pContext);
+
+    // Batch 0 is recorded by this thread while the workers take the rest
+    m_commandLists.resize(batchCount);
+    const size_t perBatch = (drawCount + batchCount - 1) / batchCount;
+    JobCounter counter;
+    for (uint32_t batch = 1; batch < batchCount; ++batch) {
+        const size_t begin = batch * perBatch, end = std::min(drawCount, begin + perBatch);
+        m_jobSystem.Submit([this, batch, begin, end, pRTV, pDSV] {
+            RecordBatch(batch, begin, end, pRTV, pDSV);
+        }, counter);
+    }
+    RecordBatch(0, 0, std::min(drawCount, perBatch), pRTV, pDSV);
+    m_jobSystem.Wait(counter);
+
+    std::pmr::vector<dg::ICommandList *> commandLists(&GetThreadArena());
+    for (auto &pCommandList: m_commandLists)
+        commandLists.push_back(pCommandList);
+    pContext->ExecuteCommandLists(batchCount, commandLists.data());
+    for (auto &pCommandList: m_commandLists)
+        pCommandList.Release();
+
+    // Executing command lists resets the immediate context's state
+    pContext->SetRenderTargets(1, &pRTV, pDSV, DRAW_TRANSITION_MODE);
+}
@@ -0,0 +1,257 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "RefCntAutoPtr.hpp"
+#include "RenderDevice.h"
+#include "DeviceContext.h"
+#include "Buffer.h"
+#include "PipelineState.h"
+#include "ShaderResourceBinding.h"
+#include "CommandList.h"
+#include "BasicMath.hpp"
+
+#include "core/JobSystem.h"
+#include "core/ObjectPool.h"
+#include "render/BlockTextureArray.h"
+#include "render/ChunkMesher.h"
+#include "render/ChunkMeshPool.h"
+#include "render/FrameScheduler.h"
+#include "render/HiZBuffer.h"
+#include "render/PipelineCache.h"
+#include "render/ResourceStateTracker.h"
+#include "render/UniformRing.h"
+#include "render/UploadQueue.h"
+
+namespace dg = Diligent;
+
+// Layout of the chunk vertex shader's Constants buffer
+struct ChunkConstants {
+    dg::float4x4 viewProj;
+    float textureMinLod;
+    float padding[3];
+};
+
+// Owns the GPU meshes of all loaded sections and draws them.
+// Meshing is done on the job system, which writes finished meshes straight into the upload queue's staging ring.
+// Update() copies them into the mesh pool on the transfer queue; a mesh is drawn once its copy has completed.
+//
+// Every mesh pool handle doubles as a draw slot: slot N has its bounds, pool slice and section origin stored
+// in per-slot buffers. A compute pass culls the slots against the frustum and writes indirect draw
+// arguments, which are drawn with a single multi-draw where the device supports it.
+class ChunkRenderer {
+public:
+    enum DrawPath {
+        // Compute culling + one counted multi-draw-indirect
+        DRAW_PATH_MULTI_INDIRECT,
+        // Compute culling + one DrawIndexedIndirect per slot
+        DRAW_PATH_INDIRECT_LOOP,
+        // CPU culling + DrawIndexed, for devices without compute or indirect first instance
+        DRAW_PATH_DIRECT
+    };
+
+    // The upload queue and the block textures must outlive the renderer
+    ChunkRenderer(dg::IRenderDevice *pDevice, JobSystem &jobSystem, UniformRing &uniformRing,
+                  UploadQueue &uploadQueue, PipelineCache &pipelineCache, const BlockTextureArray &blockTextures,
+                  dg::TEXTURE_FORMAT colorFormat, dg::TEXTURE_FORMAT depthFormat,
+                  uint32_t vertexCapacity = 4 << 20, uint32_t indexCapacity = 6 << 20);
+    ~ChunkRenderer();
+
+    // Snapshots the chunk's sections and queues them for meshing, must be called from the thread owning the world.
+    // The level of detail follows the chunk's distance to the camera given to UpdateLods()
+    void QueueChunk(const World &world, ChunkPos pos);
+    void RemoveChunk(ChunkPos pos);
+
+    // Remeshes sections changed through World::SetBlock, at most maxSections per call. Their meshes are uploaded
+    // ahead of streaming ones; a section keeps drawing its old mesh until the new one is uploaded
+    void UpdateChangedSections(World &world, uint32_t maxSections);
+
+    // Full detail up to lodDistance chunks from the camera, each level beyond covers twice the distance
+    void SetLodDistance(float lodDistance) { m_lodDistance = lodDistance; }
+    // Remeshes up to maxRemeshes chunks whose level of detail changed, farthest from the right level first.
+    // Camera in blocks; the old mesh is drawn until the new one is uploaded, so switching never leaves holes
+    void UpdateLods(const World &world, float cameraX, float cameraZ, uint32_t maxRemeshes);
+
+    // Submits copies of up to maxUploads finished meshes within maxUploadBytes of vertex and index data and
+    // starts drawing the ones whose copies are done. Frames with nothing in flight defragment the mesh pool instead
+    void Update(dg::IDeviceContext *pContext, uint32_t maxUploads, size_t maxUploadBytes);
+
+    // Writes this frame's constants into the uniform ring, call between its BeginFrame() and EndFrame().
+    // frameSlot comes from FrameScheduler and selects the per-frame resources
+    void PrepareFrame(const dg::float4x4 &viewProj, uint32_t frameSlot);
+
+    // Sections hidden behind the pyramid's depth are culled too; nullptr disables occlusion culling.
+    // Only the compute culling paths use it
+    void SetOcclusionSource(const HiZBuffer *pHiZ) { m_pHiZ = pHiZ; }
+
+    // Culls the sections, call before the render targets are bound
+    void Cull(dg::IDeviceContext *pContext);
+
+    // Contexts to record draw batches on in parallel, when there are enough draws to be worth splitting
+    void SetDeferredContexts(const std::vector<dg::IDeviceContext *> &contexts);
+
+    // Draws the sections that passed Cull() into the given targets, which must already be bound on pContext
+    // and in render target / depth write state
+    void Render(dg::IDeviceContext *pContext, dg::ITextureView *pRTV, dg::ITextureView *pDSV);
+
+    DrawPath GetDrawPath() const { return m_drawPath; }
+    size_t GetMeshCount() const { return m_meshes.size(); }
+    ChunkMeshPool::Stats GetPoolStats() const { return m_meshPool.GetStats(); }
+    uint32_t GetPendingCount() const { return m_inFlight.load(std::memory_order_relaxed); }
+    // Sections meshed since construction, at any level of detail
+    uint64_t GetMeshedCount() const { return m_meshedCount.load(std::memory_order_relaxed); }
+    // Chunks meshed at each level of detail
+    std::array<uint32_t, MAX_MESH_LOD + 1> GetLodCounts() const;
+
+private:
+    struct MeshResult {
+        SectionPos pos;
+        uint32_t version = 0;
+        // Remeshed after an edit
+        bool urgent = false;
+        // Only the bounds while the mesh is staged, the whole mesh when the ring was full
+        ChunkMesh mesh;
+        uint32_t vertexCount = 0, indexCount = 0;
+        // Vertices followed by indices, invalid while the ring was full
+        UploadQueue::Allocation staging;
+    };
+
+    // Mesh whose copy into the pool was submitted, drawn from the next Update() after its ticket is ready
+    struct PendingUpload {
+        SectionPos pos;
+        uint32_t version = 0;
+        ChunkMeshPool::Handle handle = ChunkMeshPool::INVALID_HANDLE;
+        dg::float3 boundsMin, boundsMax;
+        // 0 until submitted
+        UploadQueue::Ticket ticket = 0;
+    };
+
+    // Matches DrawInfo in the cull shader
+    struct DrawInfo {
+        dg::float4 boundsMin;
+        dg::float4 boundsMax;
+        uint32_t numIndices;
+        uint32_t firstIndex;
+        uint32_t baseVertex;
+        uint32_t padding;
+    };
+
+    struct CullConstants {
+        dg::float4 frustumPlanes[6];
+        dg::float4x4 hiZViewProj;
+        uint32_t slotCount;
+        // 0 disables the occlusion test
+        uint32_t hiZMipCount;
+        // Depth buffer size the pyramid was built from
+        uint32_t hiZWidth, hiZHeight;
+        // The device's NDC depth range and texture row order, see chunk_cull.csh
+        float ndcMinZ, ndcZtoDepthScale, ndcYtoVScale;
+        float padding;
+    };
+
+    void CreatePipelines(PipelineCache &pipelineCache, dg::TEXTURE_FORMAT colorFormat, dg::TEXTURE_FORMAT depthFormat);
+    void ReserveSlots(uint32_t slotCount);
+    void WriteSlot(dg::IDeviceContext *pContext, ChunkMeshPool::Handle handle);
+    void ClearSlot(dg::IDeviceContext *pContext, ChunkMeshPool::Handle handle);
+
+    void BindDrawState(dg::IDeviceContext *pContext, dg::IShaderResourceBinding *pSRB);
+    void RecordDraws(dg::IDeviceContext *pContext, size_t begin, size_t end);
+    void RecordBatch(uint32_t batch, size_t begin, size_t end, dg::ITextureView *pRTV, dg::ITextureView *pDSV);
+
+    // False when the section is empty, its mesh is then freed right away
+    bool QueueSection(const World &world, const Chunk &chunk, SectionPos pos, int lod, bool urgent);
+
+    float GetChunkDistance(ChunkPos pos) const;
+    int GetLod(float distance) const;
+
+    // Copies the mesh into the staging ring, false while the ring is full; thread-safe
+    bool StageMesh(MeshResult &result, const ChunkMesh &mesh);
+    void Upload(dg::IDeviceContext *pContext, const MeshResult &result);
+    void SubmitUploads();
+    void InstallUploads(dg::IDeviceContext *pContext);
+    void FreeMesh(SectionPos pos);
+
+    dg::RefCntAutoPtr<dg::IRenderDevice> m_pDevice;
+    JobSystem &m_jobSystem;
+    UniformRing &m_uniformRing;
+    UploadQueue &m_uploadQueue;
+    const BlockTextureArray &m_blockTextures;
+    ChunkMeshPool m_meshPool;
+    ResourceStateTracker m_stateTracker;
+    DrawPath m_drawPath = DRAW_PATH_DIRECT;
+
+    dg::RefCntAutoPtr<dg::IPipelineState> m_pPSO;
+    dg::RefCntAutoPtr<dg::IShaderResourceBinding> m_pSRB;
+    dg::IShaderResourceVariable *m_pConstantsVar = nullptr;
+
+    dg::RefCntAutoPtr<dg::IPipelineState> m_pCullPSO;
+    dg::RefCntAutoPtr<dg::IShaderResourceBinding> m_pCullSRB;
+    dg::IShaderResourceVariable *m_pCullConstantsVar = nullptr;
+    dg::IShaderResourceVariable *m_pCullHiZVar = nullptr;
+    const HiZBuffer *m_pHiZ = nullptr;
+
+    // Uniform ring offsets of this frame's constants, ~0u when the ring was full
+    uint32_t m_constantsOffset = ~0u;
+    uint32_t m_cullConstantsOffset = ~0u;
+
+    // Per-slot data, m_slotCapacity entries each
+    uint32_t m_slotCapacity = 0;
+    std::vector<DrawInfo> m_drawInfo;            // CPU copies, used for CPU culling and buffer growth
+    std::vector<dg::float4> m_instanceData;
+    dg::RefCntAutoPtr<dg::IBuffer> m_pDrawInfo;  // structured, read by the cull shader
+    dg::RefCntAutoPtr<dg::IBuffer> m_pInstanceData; // float4 section origin, per-instance vertex stream
+    dg::RefCntAutoPtr<dg::IBuffer> m_pDrawArgs;  // indirect draw arguments written by the cull shader
+    dg::RefCntAutoPtr<dg::IBuffer> m_pDrawCount; // visible draw count for the multi-draw path
+    dg::RefCntAutoPtr<dg::ITexture> m_pNoHiZ;    // bound to the cull shader without an occlusion source
+
+    std::vector<ChunkMeshPool::Handle> m_freedSlots; // cleared on the GPU in the next Update()
+    std::vector<ChunkMeshPool::Handle> m_movedSlots;
+
+    // Slots drawn one by one this frame: visible ones for DRAW_PATH_DIRECT, all live ones for DRAW_PATH_INDIRECT_LOOP
+    std::vector<ChunkMeshPool::Handle> m_drawList;
+
+    // Parallel recording. Dynamic buffers can only be used by the context that mapped them,
+    // so the deferred contexts read this frame's constants from a default-usage copy instead of the ring.
+    // There is one copy per frame slot, so updating it never waits on a frame the GPU is still drawing.
+    ChunkConstants m_frameConstants{};
+    uint32_t m_frameSlot = 0;
+    std::array<dg::RefCntAutoPtr<dg::IBuffer>, FrameScheduler::MAX_FRAMES_IN_FLIGHT> m_sharedConstants;
+    std::vector<dg::RefCntAutoPtr<dg::IDeviceContext>> m_deferredContexts;
+    std::vector<dg::RefCntAutoPtr<dg::IShaderResourceBinding>> m_deferredSRBs;
+    std::vector<dg::IShaderResourceVariable *> m_deferredConstantsVars;
+    std::vector<dg::RefCntAutoPtr<dg::ICommandList>> m_commandLists;
+
+    std::unordered_map<SectionPos, ChunkMeshPool::Handle, SectionPosHash> m_meshes;
+    // Latest requested mesh version per section, stale results are dropped.
+    // Versions are unique across sections, so an entry can be erased and later recreated safely.
+    std::unordered_map<SectionPos, uint32_t, SectionPosHash> m_versions;
+    uint32_t m_nextVersion = 0;
+
+    // Level of detail each queued chunk was meshed at
+    std::unordered_map<ChunkPos, int, ChunkPosHash> m_chunkLods;
+
+    // Edited sections waiting to be remeshed, oldest first, and the ones with an edit mesh in flight
+    std::vector<SectionPos> m_changedSections;
+    std::unordered_set<SectionPos, SectionPosHash> m_changedSet;
+    std::unordered_set<SectionPos, SectionPosHash> m_urgentInFlight;
+    float m_lodDistance = 8.f;
+    // Camera in chunk units
+    float m_cameraX = 0.f, m_cameraZ = 0.f;
+
+    // Block snapshots of the sections being meshed
+    ObjectPool<SectionNeighborhood> m_neighborhoods{"Section neighborhoods", 64};
+
+    std::mutex m_resultMutex;
+    std::vector<MeshResult> m_results;
+    // Oldest first, tickets are in submission order
+    std::vector<PendingUpload> m_pendingUploads;
+    std::atomic<uint32_t> m_inFlight{0};
+    std::atomic<uint64_t> m_meshedCount{0};
+};
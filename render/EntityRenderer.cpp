@@ -0,0 +1,223 @@
+#include "render/EntityRenderer.h"
+
+#include <algorithm>
+
+#include "MapHelper.hpp"
+
+#include "render/ResourceStateTracker.h"
+
+namespace {
+    constexpr uint32_t BOX_INDEX_COUNT = 36;
+
+    struct BoxSize {
+        // Half extents; minY is where the box starts below the entity's origin
+        float halfWidth, height, minY;
+    };
+
+    constexpr BoxSize MESH_BOXES[ENTITY_MESH_COUNT] = {
+        {0.3f, 1.8f, 0.f},
+        {0.125f, 0.25f, -0.125f},
+    };
+}
+
+EntityRenderer::EntityRenderer(dg::IRenderDevice *pDevice, UniformRing &uniformRing, PipelineCache &pipelineCache,
+                               const BlockTextureArray &blockTextures, const dg::TEXTURE_FORMAT colorFormat,
+                               const dg::TEXTURE_FORMAT depthFormat)
+    : m_pDevice(pDevice), m_uniformRing(uniformRing), m_blockTextures(blockTextures) {
+    dg::GraphicsPipelineStateCreateInfo PSOCreateInfo;
+    PSOCreateInfo.PSODesc.Name = "Entity PSO";
+    PSOCreateInfo.PSODesc.PipelineType = dg::PIPELINE_TYPE_GRAPHICS;
+
+    PSOCreateInfo.GraphicsPipeline.NumRenderTargets = 1;
+    PSOCreateInfo.GraphicsPipeline.RTVFormats[0] = colorFormat;
+    PSOCreateInfo.GraphicsPipeline.DSVFormat = depthFormat;
+    PSOCreateInfo.GraphicsPipeline.PrimitiveTopology = dg::PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+    PSOCreateInfo.GraphicsPipeline.RasterizerDesc.CullMode = dg::CULL_MODE_BACK;
+    PSOCreateInfo.GraphicsPipeline.DepthStencilDesc.DepthEnable = true;
+
+    dg::ShaderCreateInfo ShaderCI;
+    ShaderCI.SourceLanguage = dg::SHADER_SOURCE_LANGUAGE_HLSL;
+    ShaderCI.Desc.UseCombinedTextureSamplers = true;
+    ShaderCI.EntryPoint = "main";
+
+    ShaderCI.Desc.ShaderType = dg::SHADER_TYPE_VERTEX;
+    ShaderCI.Desc.Name = "Entity vertex shader";
+    ShaderCI.FilePath = "entity.vsh";
+    auto pVS = pipelineCache.CreateShader(ShaderCI);
+
+    // Entities are textured and lit like blocks, the vertex shader outputs what the chunk pixel shader expects
+    ShaderCI.Desc.ShaderType = dg::SHADER_TYPE_PIXEL;
+    ShaderCI.Desc.Name = "Entity pixel shader";
+    ShaderCI.FilePath = "chunk.psh";
+    auto pPS = pipelineCache.CreateShader(ShaderCI);
+
+    // Slot 0: box vertices, slot 1: per-instance transforms and texture layers (see Instance)
+    dg::LayoutElement LayoutElements[] = {
+        dg::LayoutElement{0, 0, 3, dg::VT_FLOAT32, false},
+        dg::LayoutElement{1, 0, 2, dg::VT_FLOAT32, false},
+        dg::LayoutElement{2, 0, 1, dg::VT_UINT32, false},
+        dg::LayoutElement{3, 1, 4, dg::VT_FLOAT32, false, dg::INPUT_ELEMENT_FREQUENCY_PER_INSTANCE},
+        dg::LayoutElement{4, 1, 4, dg::VT_FLOAT32, false, dg::INPUT_ELEMENT_FREQUENCY_PER_INSTANCE},
+        dg::LayoutElement{5, 1, 3, dg::VT_UINT32, false, dg::INPUT_ELEMENT_FREQUENCY_PER_INSTANCE}
+    };
+    PSOCreateInfo.GraphicsPipeline.InputLayout.LayoutElements = LayoutElements;
+    PSOCreateInfo.GraphicsPipeline.InputLayout.NumElements = std::size(LayoutElements);
+
+    dg::ShaderResourceVariableDesc Vars[] = {
+        {dg::SHADER_TYPE_VERTEX, "Constants", dg::SHADER_RESOURCE_VARIABLE_TYPE_DYNAMIC}
+    };
+    PSOCreateInfo.PSODesc.ResourceLayout.DefaultVariableType = dg::SHADER_RESOURCE_VARIABLE_TYPE_STATIC;
+    PSOCreateInfo.PSODesc.ResourceLayout.Variables = Vars;
+    PSOCreateInfo.PSODesc.ResourceLayout.NumVariables = std::size(Vars);
+
+    const dg::SamplerDesc BlockSampler{dg::FILTER_TYPE_LINEAR, dg::FILTER_TYPE_POINT, dg::FILTER_TYPE_LINEAR,
+                                       dg::TEXTURE_ADDRESS_WRAP, dg::TEXTURE_ADDRESS_WRAP, dg::TEXTURE_ADDRESS_WRAP};
+    dg::ImmutableSamplerDesc ImmutableSamplers[] = {
+        {dg::SHADER_TYPE_PIXEL, "g_BlockTextures", BlockSampler}
+    };
+    PSOCreateInfo.PSODesc.ResourceLayout.ImmutableSamplers = ImmutableSamplers;
+    PSOCreateInfo.PSODesc.ResourceLayout.NumImmutableSamplers = std::size(ImmutableSamplers);
+
+    PSOCreateInfo.pVS = pVS;
+    PSOCreateInfo.pPS = pPS;
+    m_pPSO = pipelineCache.CreateGraphicsPipelineState(PSOCreateInfo);
+    m_pPSO->GetStaticVariableByName(dg::SHADER_TYPE_PIXEL, "g_BlockTextures")
+        ->Set(m_blockTextures.GetShaderResourceView());
+    m_pPSO->CreateShaderResourceBinding(&m_pSRB, true);
+    m_pConstantsVar = m_pSRB->GetVariableByName(dg::SHADER_TYPE_VERTEX, "Constants");
+    m_uniformRing.Bind(m_pConstantsVar, sizeof(EntityConstants));
+
+    CreateMeshes();
+}
+
+void EntityRenderer::CreateMeshes() {
+    // Faces: 0 +X, 1 -X, 2 +Y, 3 -Y, 4 +Z, 5 -Z; corners counter-clockwise seen from outside
+    static constexpr float FACE_CORNERS[6][4][3] = {
+        {{1, 0, 0}, {1, 1, 0}, {1, 1, 1}, {1, 0, 1}},
+        {{0, 0, 1}, {0, 1, 1}, {0, 1, 0}, {0, 0, 0}},
+        {{0, 1, 0}, {0, 1, 1}, {1, 1, 1}, {1, 1, 0}},
+        {{0, 0, 1}, {0, 0, 0}, {1, 0, 0}, {1, 0, 1}},
+        {{1, 0, 1}, {1, 1, 1}, {0, 1, 1}, {0, 0, 1}},
+        {{0, 0, 0}, {0, 1, 0}, {1, 1, 0}, {1, 0, 0}},
+    };
+    static constexpr float CORNER_UVS[4][2] = {{0, 1}, {0, 0}, {1, 0}, {1, 1}};
+
+    std::vector<Vertex> vertices;
+    std::vector<uint16_t> indices;
+    for (int mesh = 0; mesh < ENTITY_MESH_COUNT; ++mesh) {
+        const BoxSize &box = MESH_BOXES[mesh];
+        m_meshes[mesh] = {static_cast<uint32_t>(indices.size()), static_cast<uint32_t>(vertices.size())};
+        for (uint32_t face = 0; face < 6; ++face) {
+            const auto base = static_cast<uint16_t>(vertices.size() - m_meshes[mesh].baseVertex);
+            for (int corner = 0; corner < 4; ++corner) {
+                const float *c = FACE_CORNERS[face][corner];
+                const dg::float3 position((c[0] * 2.f - 1.f) * box.halfWidth, box.minY + c[1] * box.height,
+                                          (c[2] * 2.f - 1.f) * box.halfWidth);
+                vertices.push_back({position, dg::float2(CORNER_UVS[corner][0], CORNER_UVS[corner][1]), face});
+            }
+            for (const uint16_t i: {0, 1, 2, 0, 2, 3})
+                indices.push_back(static_cast<uint16_t>(base + i));
+        }
+    }
+
+    dg::BufferDesc VBDesc;
+    VBDesc.Name = "Entity vertices";
+    VBDesc.Usage = dg::USAGE_IMMUTABLE;
+    VBDesc.BindFlags = dg::BIND_VERTEX_BUFFER;
+    VBDesc.Size = vertices.size() * sizeof(Vertex);
+    dg::BufferData VBData{vertices.data(), VBDesc.Size};
+    m_pDevice->CreateBuffer(VBDesc, &VBData, &m_pVertexBuffer);
+
+    dg::BufferDesc IBDesc;
+    IBDesc.Name = "Entity indices";
+    IBDesc.Usage = dg::USAGE_IMMUTABLE;
+    IBDesc.BindFlags = dg::BIND_INDEX_BUFFER;
+    IBDesc.Size = indices.size() * sizeof(uint16_t);
+    dg::BufferData IBData{indices.data(), IBDesc.Size};
+    m_pDevice->CreateBuffer(IBDesc, &IBData, &m_pIndexBuffer);
+}
+
+void EntityRenderer::ReserveInstances(const uint32_t count) {
+    if (count <= m_instanceCapacity)
+        return;
+
+    m_instanceCapacity = std::max(m_instanceCapacity, 1024u);
+    while (m_instanceCapacity < count)
+        m_instanceCapacity *= 2;
+
+    dg::BufferDesc Desc;
+    Desc.Name = "Entity instances";
+    Desc.Usage = dg::USAGE_DYNAMIC;
+    Desc.BindFlags = dg::BIND_VERTEX_BUFFER;
+    Desc.CPUAccessFlags = dg::CPU_ACCESS_WRITE;
+    Desc.Size = static_cast<uint64_t>(m_instanceCapacity) * sizeof(Instance);
+    m_pInstanceBuffer.Release();
+    m_pDevice->CreateBuffer(Desc, nullptr, &m_pInstanceBuffer);
+}
+
+void EntityRenderer::PrepareFrame(const dg::float4x4 &viewProj, const float alpha) {
+    if (auto *pConstants = m_uniformRing.Allocate<EntityConstants>(m_constantsOffset)) {
+        pConstants->viewProj = viewProj.Transpose();
+        pConstants->alpha = alpha;
+        pConstants->textureMinLod = m_blockTextures.GetMinLod();
+    } else {
+        m_constantsOffset = ~0u;
+    }
+}
+
+void EntityRenderer::Render(dg::IDeviceContext *pContext, const std::vector<EntityInstance> &instances) {
+    m_instanceCount = static_cast<uint32_t>(instances.size());
+    if (instances.empty() || m_constantsOffset == ~0u)
+        return;
+    ReserveInstances(m_instanceCount);
+
+    // Counting sort by mesh straight into the mapped buffer, every mesh's instances end up contiguous
+    std::array<uint32_t, ENTITY_MESH_COUNT + 1> firstInstance{};
+    for (const EntityInstance &instance: instances)
+        ++firstInstance[instance.mesh + 1];
+    for (int mesh = 0; mesh < ENTITY_MESH_COUNT; ++mesh)
+        firstInstance[mesh + 1] += firstInstance[mesh];
+
+    {
+        dg::MapHelper<Instance> mapped(pContext, m_pInstanceBuffer, dg::MAP_WRITE, dg::MAP_FLAG_DISCARD);
+        std::array<uint32_t, ENTITY_MESH_COUNT> next{};
+        std::copy_n(firstInstance.begin(), ENTITY_MESH_COUNT, next.begin());
+        for (const EntityInstance &instance: instances) {
+            Instance &out = mapped[next[instance.mesh]++];
+            out.from = dg::float4(instance.from.x, instance.from.y, instance.from.z, instance.from.yaw);
+            out.to = dg::float4(instance.to.x, instance.to.y, instance.to.z, instance.to.yaw);
+            out.layers[0] = GetBlockTexture(instance.block, 2);
+            out.layers[1] = GetBlockTexture(instance.block, 3);
+            out.layers[2] = GetBlockTexture(instance.block, 0);
+        }
+    }
+
+    m_stateTracker.Require(m_pVertexBuffer, dg::RESOURCE_STATE_VERTEX_BUFFER);
+    m_stateTracker.Require(m_pInstanceBuffer, dg::RESOURCE_STATE_VERTEX_BUFFER);
+    m_stateTracker.Require(m_pIndexBuffer, dg::RESOURCE_STATE_INDEX_BUFFER);
+    m_stateTracker.Flush(pContext);
+
+    pContext->SetPipelineState(m_pPSO);
+    m_pConstantsVar->SetBufferOffset(m_constantsOffset);
+    pContext->CommitShaderResources(m_pSRB, DRAW_TRANSITION_MODE);
+
+    const uint64_t offsets[] = {0, 0};
+    dg::IBuffer *pBuffs[] = {m_pVertexBuffer, m_pInstanceBuffer};
+    pContext->SetVertexBuffers(0, 2, pBuffs, offsets, DRAW_TRANSITION_MODE, dg::SET_VERTEX_BUFFERS_FLAG_RESET);
+    pContext->SetIndexBuffer(m_pIndexBuffer, 0, DRAW_TRANSITION_MODE);
+
+    for (int mesh = 0; mesh < ENTITY_MESH_COUNT; ++mesh) {
+        const uint32_t count = firstInstance[mesh + 1] - firstInstance[mesh];
+        if (count == 0)
+            continue;
+        dg::DrawIndexedAttribs drawAttrs;
+        drawAttrs.IndexType = dg::VT_UINT16;
+        drawAttrs.NumIndices = BOX_INDEX_COUNT;
+        drawAttrs.FirstIndexLocation = m_meshes[mesh].firstIndex;
+        drawAttrs.BaseVertex = m_meshes[mesh].baseVertex;
+        drawAttrs.NumInstances = count;
+        drawAttrs.FirstInstanceLocation = firstInstance[mesh];
+        drawAttrs.Flags = DRAW_FLAGS;
+        pContext->DrawIndexed(drawAttrs);
+    }
+}
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+#include "RefCntAutoPtr.hpp"
+#include "RenderDevice.h"
+#include "DeviceContext.h"
+#include "Buffer.h"
+#include "PipelineState.h"
+#include "ShaderResourceBinding.h"
+#include "BasicMath.hpp"
+
+#include "render/BlockTextureArray.h"
+#include "render/PipelineCache.h"
+#include "render/ResourceStateTracker.h"
+#include "render/UniformRing.h"
+#include "world/Entities.h"
+
+namespace dg = Diligent;
+
+// Layout of the entity vertex shader's Constants buffer
+struct EntityConstants {
+    dg::float4x4 viewProj;
+    // Blend between the instances' from and to transforms
+    float alpha;
+    float textureMinLod;
+    float padding[2];
+};
+
+// Draws the simulation's entities instanced: one draw per EntityMesh, whatever the number of entities.
+// Every frame the snapshot's instances are grouped by mesh into one dynamic instance buffer; the vertex shader
+// blends each instance between its two tick transforms, so the CPU does no per-entity math.
+class EntityRenderer {
+public:
+    // The block textures are bound once for all draws and must outlive the renderer
+    EntityRenderer(dg::IRenderDevice *pDevice, UniformRing &uniformRing, PipelineCache &pipelineCache,
+                   const BlockTextureArray &blockTextures, dg::TEXTURE_FORMAT colorFormat,
+                   dg::TEXTURE_FORMAT depthFormat);
+
+    // Writes this frame's constants into the uniform ring, call between its BeginFrame() and EndFrame()
+    void PrepareFrame(const dg::float4x4 &viewProj, float alpha);
+
+    // Uploads the instances and draws them into the bound render targets
+    void Render(dg::IDeviceContext *pContext, const std::vector<EntityInstance> &instances);
+
+    uint32_t GetInstanceCount() const { return m_instanceCount; }
+
+private:
+    // Matches VSInput in entity.vsh, slot 0
+    struct Vertex {
+        dg::float3 position;
+        dg::float2 texCoord;
+        uint32_t face;
+    };
+
+    // Slot 1, per instance
+    struct Instance {
+        dg::float4 from;
+        dg::float4 to;
+        // Texture layer of the top, bottom and sides
+        uint32_t layers[3];
+    };
+
+    struct MeshRange {
+        uint32_t firstIndex = 0;
+        uint32_t baseVertex = 0;
+    };
+
+    void CreateMeshes();
+    void ReserveInstances(uint32_t count);
+
+    dg::RefCntAutoPtr<dg::IRenderDevice> m_pDevice;
+    UniformRing &m_uniformRing;
+    const BlockTextureArray &m_blockTextures;
+
+    dg::RefCntAutoPtr<dg::IPipelineState> m_pPSO;
+    dg::RefCntAutoPtr<dg::IShaderResourceBinding> m_pSRB;
+    dg::IShaderResourceVariable *m_pConstantsVar = nullptr;
+    uint32_t m_constantsOffset = ~0u;
+
+    // All meshes in one vertex and one index buffer; every mesh is a box of 36 indices
+    dg::RefCntAutoPtr<dg::IBuffer> m_pVertexBuffer;
+    dg::RefCntAutoPtr<dg::IBuffer> m_pIndexBuffer;
+    std::array<MeshRange, ENTITY_MESH_COUNT> m_meshes{};
+
+    dg::RefCntAutoPtr<dg::IBuffer> m_pInstanceBuffer;
+    uint32_t m_instanceCapacity = 0;
+    uint32_t m_instanceCount = 0;
+
+    ResourceStateTracker m_stateTracker;
+};
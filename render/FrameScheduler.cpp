@@ -0,0 +1,48 @@
+#include "render/FrameScheduler.h"
+
+#include <algorithm>
+#include <chrono>
+
+FrameScheduler::FrameScheduler(dg::IRenderDevice *pDevice, const FramePacing pacing, const uint32_t queueDepth)
+    : m_queueDepth(std::clamp(queueDepth, 1u, MAX_FRAMES_IN_FLIGHT)), m_pacing(pacing) {
+    dg::FenceDesc FenceDesc;
+    FenceDesc.Name = "Frame fence";
+    FenceDesc.Type = dg::FENCE_TYPE_CPU_WAIT_ONLY;
+    pDevice->CreateFence(FenceDesc, &m_pFence);
+}
+
+uint32_t FrameScheduler::GetQueueDepth() const {
+    return m_pacing == FRAME_PACING_LOW_LATENCY ? 1 : m_queueDepth;
+}
+
+uint32_t FrameScheduler::BeginFrame() {
+    ++m_frameNumber;
+    m_frameSlot = static_cast<uint32_t>(m_frameNumber % m_queueDepth);
+
+    // Low latency waits for the previous frame regardless of the slot; slots still rotate over the full depth
+    // so switching pacing at runtime never reuses a slot that is in flight
+    uint64_t waitValue = m_slotFenceValues[m_frameSlot];
+    if (m_pacing == FRAME_PACING_LOW_LATENCY)
+        waitValue = m_fenceValue;
+
+    m_lastWaitMs = 0.0;
+    if (m_pFence->GetCompletedValue() < waitValue) {
+        const auto start = std::chrono::steady_clock::now();
+        m_pFence->Wait(waitValue);
+        m_lastWaitMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+    return m_frameSlot;
+}
+
+void FrameScheduler::EndFrame(dg::IDeviceContext *pContext) {
+    pContext->EnqueueSignal(m_pFence, ++m_fenceValue);
+    m_slotFenceValues[m_frameSlot] = m_fenceValue;
+}
+
+void FrameScheduler::WaitIdle() {
+    m_pFence->Wait(m_fenceValue);
+}
+
+void FrameScheduler::SetPacing(const FramePacing pacing) {
+    m_pacing = pacing;
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+#include "RefCntAutoPtr.hpp"
+#include "RenderDevice.h"
+#include "DeviceContext.h"
+#include "Fence.h"
+
+namespace dg = Diligent;
+
+enum FramePacing {
+    // The CPU waits for the previous frame's GPU work before sampling input, one frame in flight
+    FRAME_PACING_LOW_LATENCY,
+    // The CPU runs up to the queue depth ahead of the GPU
+    FRAME_PACING_THROUGHPUT
+};
+
+// Bounds how far the CPU may run ahead of the GPU.
+// Every frame signals one fence value right before Present; BeginFrame() of frame N blocks until the GPU has
+// finished frame N - depth, whose frame slot (and every per-frame resource indexed by it) is then reused.
+// With a depth of 2 or more the CPU prepares frame N + 1 while the GPU still renders frame N.
+class FrameScheduler {
+public:
+    static constexpr uint32_t MAX_FRAMES_IN_FLIGHT = 4;
+
+    FrameScheduler(dg::IRenderDevice *pDevice, FramePacing pacing, uint32_t queueDepth = 2);
+
+    // Blocks until the next frame slot is free, returns it
+    uint32_t BeginFrame();
+    // Enqueues the frame's fence signal, call right before Present which submits it
+    void EndFrame(dg::IDeviceContext *pContext);
+    // Waits for all frames in flight, e.g. before resizing or shutting down
+    void WaitIdle();
+
+    // Takes effect from the next BeginFrame()
+    void SetPacing(FramePacing pacing);
+    FramePacing GetPacing() const { return m_pacing; }
+    // Frames that may be in flight under the current pacing
+    uint32_t GetQueueDepth() const;
+    // Swap chain buffers needed so Present never blocks before the fence does
+    uint32_t GetSwapChainBufferCount() const { return m_queueDepth + 1; }
+
+    uint32_t GetFrameSlot() const { return m_frameSlot; }
+    uint64_t GetFrameNumber() const { return m_frameNumber; }
+    // Time BeginFrame() spent blocked on the GPU
+    double GetLastWaitMs() const { return m_lastWaitMs; }
+
+private:
+    dg::RefCntAutoPtr<dg::IFence> m_pFence;
+    std::array<uint64_t, MAX_FRAMES_IN_FLIGHT> m_slotFenceValues{};
+    uint64_t m_fenceValue = 0;
+    uint64_t m_frameNumber = 0;
+    uint32_t m_frameSlot = 0;
+    uint32_t m_queueDepth = 2;
+    FramePacing m_pacing = FRAME_PACING_THROUGHPUT;
+    double m_lastWaitMs = 0.0;
+};
@@ -0,0 +1,39 @@
+#pragma once
+
+#include "BasicMath.hpp"
+
+namespace dg = Diligent;
+
+// View frustum planes extracted from a row-vector view-projection matrix (clip = v * M, D3D depth range).
+// Plane normals point inwards, a point p is inside when dot(plane.xyz, p) + plane.w >= 0 for all planes.
+struct Frustum {
+    dg::float4 planes[6];
+
+    static Frustum FromViewProj(const dg::float4x4 &m) {
+        auto column = [&m](const int c) { return dg::float4(m[0][c], m[1][c], m[2][c], m[3][c]); };
+        const dg::float4 c0 = column(0), c1 = column(1), c2 = column(2), c3 = column(3);
+
+        Frustum frustum;
+        frustum.planes[0] = c3 + c0; // left
+        frustum.planes[1] = c3 - c0; // right
+        frustum.planes[2] = c3 + c1; // bottom
+        frustum.planes[3] = c3 - c1; // top
+        frustum.planes[4] = c2;      // near
+        frustum.planes[5] = c3 - c2; // far
+        for (auto &plane: frustum.planes)
+            plane = plane / dg::length(dg::float3(plane.x, plane.y, plane.z));
+        return frustum;
+    }
+
+    // Tests the box corner furthest along each plane normal
+    bool IntersectsBox(const dg::float3 &boxMin, const dg::float3 &boxMax) const {
+        for (const auto &plane: planes) {
+            const dg::float3 corner(plane.x >= 0 ? boxMax.x : boxMin.x,
+                                    plane.y >= 0 ? boxMax.y : boxMin.y,
+                                    plane.z >= 0 ? boxMax.z : boxMin.z);
+            if (plane.x * corner.x + plane.y * corner.y + plane.z * corner.z + plane.w < 0)
+                return false;
+        }
+        return true;
+    }
+};
@@ -0,0 +1,93 @@
+#include "render/GpuProfiler.h"
+
+#include <algorithm>
+#include <chrono>
+
+namespace {
+    constexpr uint32_t INVALID_PASS = ~0u;
+}
+
+GpuProfiler::GpuProfiler(dg::IRenderDevice *pDevice)
+    : m_pDevice(pDevice) {
+    m_supported = pDevice->GetDeviceInfo().Features.TimestampQueries == dg::DEVICE_FEATURE_STATE_ENABLED;
+    if (m_supported)
+        m_frameScope = Profiler::Get().RegisterScope("GPU frame", PROFILE_TRACK_GPU);
+}
+
+void GpuProfiler::BeginFrame(const uint32_t frameSlot) {
+    if (!m_supported)
+        return;
+    m_pCurrent = &m_frames[frameSlot];
+    ReadBack(*m_pCurrent);
+    m_pCurrent->passCount = 0;
+    m_pCurrent->cpuStart = Profiler::Get().GetFrameStart();
+}
+
+uint32_t GpuProfiler::BeginPass(dg::IDeviceContext *pContext, const uint32_t scope) {
+    if (!m_pCurrent || m_pCurrent->passCount == MAX_PASSES)
+        return INVALID_PASS;
+
+    Frame &frame = *m_pCurrent;
+    if (frame.passCount == frame.passes.size()) {
+        Pass pass;
+        dg::QueryDesc QueryDesc;
+        QueryDesc.Name = "Pass timestamp";
+        QueryDesc.Type = dg::QUERY_TYPE_TIMESTAMP;
+        m_pDevice->CreateQuery(QueryDesc, &pass.pBegin);
+        m_pDevice->CreateQuery(QueryDesc, &pass.pEnd);
+        frame.passes.push_back(std::move(pass));
+    }
+
+    const uint32_t index = frame.passCount++;
+    Pass &pass = frame.passes[index];
+    pass.scope = scope;
+    // Timestamp queries are written with EndQuery only
+    pContext->EndQuery(pass.pBegin);
+    return index;
+}
+
+void GpuProfiler::EndPass(dg::IDeviceContext *pContext, const uint32_t pass) {
+    if (!m_pCurrent || pass == INVALID_PASS)
+        return;
+    pContext->EndQuery(m_pCurrent->passes[pass].pEnd);
+}
+
+void GpuProfiler::ReadBack(Frame &frame) {
+    struct Timing {
+        uint32_t scope;
+        uint64_t begin, end;
+    };
+    std::array<Timing, MAX_PASSES> timings{};
+    uint32_t timingCount = 0;
+    uint64_t frameBegin = ~0ull, frameEnd = 0, frequency = 0;
+
+    for (uint32_t i = 0; i < frame.passCount; ++i) {
+        Pass &pass = frame.passes[i];
+        dg::QueryDataTimestamp begin, end;
+        // Passes whose results are not available are dropped rather than waited for
+        if (!pass.pBegin->GetData(&begin, sizeof(begin)) || !pass.pEnd->GetData(&end, sizeof(end)))
+            continue;
+        if (begin.Frequency == 0 || end.Counter < begin.Counter)
+            continue;
+        frequency = begin.Frequency;
+        frameBegin = std::min(frameBegin, begin.Counter);
+        frameEnd = std::max(frameEnd, end.Counter);
+        timings[timingCount++] = {pass.scope, begin.Counter, end.Counter};
+    }
+    if (timingCount == 0)
+        return;
+
+    const auto toDuration = [frequency](const uint64_t ticks) {
+        return std::chrono::duration_cast<Profiler::Clock::duration>(
+            std::chrono::duration<double>(static_cast<double>(ticks) / static_cast<double>(frequency)));
+    };
+
+    // Place the passes relative to the first timestamp of the frame
+    Profiler &profiler = Profiler::Get();
+    for (uint32_t i = 0; i < timingCount; ++i) {
+        const Timing &timing = timings[i];
+        const auto start = frame.cpuStart + toDuration(timing.begin - frameBegin);
+        profiler.Record(timing.scope, start, start + toDuration(timing.end - timing.begin));
+    }
+    profiler.Record(m_frameScope, frame.cpuStart, frame.cpuStart + toDuration(frameEnd - frameBegin));
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+#include "RefCntAutoPtr.hpp"
+#include "RenderDevice.h"
+#include "DeviceContext.h"
+#include "Query.h"
+
+#include "core/Profiler.h"
+#include "render/FrameScheduler.h"
+
+namespace dg = Diligent;
+
+// GPU pass timings through timestamp queries.
+// Queries are kept per frame slot and read back when the slot comes around again, by which point
+// FrameScheduler has waited for that frame, so reading never stalls. Results land in the Profiler's GPU scopes
+// one queue depth late; the trace places them at the CPU start of the frame they were issued in.
+class GpuProfiler {
+public:
+    static constexpr uint32_t MAX_PASSES = 16;
+
+    explicit GpuProfiler(dg::IRenderDevice *pDevice);
+
+    bool IsSupported() const { return m_supported; }
+
+    // Reads back the slot's previous timings, call after FrameScheduler::BeginFrame()
+    void BeginFrame(uint32_t frameSlot);
+
+    // Returns the pass index for EndPass()
+    uint32_t BeginPass(dg::IDeviceContext *pContext, uint32_t scope);
+    void EndPass(dg::IDeviceContext *pContext, uint32_t pass);
+
+private:
+    struct Pass {
+        uint32_t scope = Profiler::INVALID_SCOPE;
+        dg::RefCntAutoPtr<dg::IQuery> pBegin;
+        dg::RefCntAutoPtr<dg::IQuery> pEnd;
+    };
+
+    struct Frame {
+        std::vector<Pass> passes;
+        uint32_t passCount = 0;
+        Profiler::Clock::time_point cpuStart;
+    };
+
+    void ReadBack(Frame &frame);
+
+    dg::IRenderDevice *m_pDevice = nullptr;
+    bool m_supported = false;
+    uint32_t m_frameScope = Profiler::INVALID_SCOPE;
+    std::array<Frame, FrameScheduler::MAX_FRAMES_IN_FLIGHT> m_frames;
+    Frame *m_pCurrent = nullptr;
+};
+
+// Times a GPU pass for the rest of the enclosing block
+class GpuProfileScope {
+public:
+    GpuProfileScope(GpuProfiler &profiler, dg::IDeviceContext *pContext, const uint32_t scope)
+        : m_profiler(profiler), m_pContext(pContext), m_pass(profiler.BeginPass(pContext, scope)) {}
+    ~GpuProfileScope() { m_profiler.EndPass(m_pContext, m_pass); }
+
+    GpuProfileScope(const GpuProfileScope &) = delete;
+    GpuProfileScope &operator=(const GpuProfileScope &) = delete;
+
+private:
+    GpuProfiler &m_profiler;
+    dg::IDeviceContext *m_pContext;
+    uint32_t m_pass;
+};
@@ -0,0 +1,135 @@
+#include "render/HiZBuffer.h"
+
+#include <algorithm>
+#include <bit>
+
+namespace {
+    constexpr uint32_t BUILD_GROUP_SIZE = 8;
+}
+
+HiZBuffer::HiZBuffer(dg::IRenderDevice *pDevice, PipelineCache &pipelineCache, const uint32_t width,
+                     const uint32_t height)
+    : m_pDevice(pDevice) {
+    if (pDevice->GetDeviceInfo().Features.ComputeShaders != dg::DEVICE_FEATURE_STATE_DISABLED) {
+        dg::ShaderCreateInfo ShaderCI;
+        ShaderCI.SourceLanguage = dg::SHADER_SOURCE_LANGUAGE_HLSL;
+        ShaderCI.Desc.UseCombinedTextureSamplers = true;
+        ShaderCI.Desc.ShaderType = dg::SHADER_TYPE_COMPUTE;
+        ShaderCI.EntryPoint = "main";
+        ShaderCI.Desc.Name = "Hi-Z build shader";
+        ShaderCI.FilePath = "hiz_build.csh";
+        auto pCS = pipelineCache.CreateShader(ShaderCI);
+
+        dg::ComputePipelineStateCreateInfo PSOCreateInfo;
+        PSOCreateInfo.PSODesc.Name = "Hi-Z build PSO";
+        PSOCreateInfo.PSODesc.PipelineType = dg::PIPELINE_TYPE_COMPUTE;
+        // Every level has its own SRB, bound once when the textures are created
+        PSOCreateInfo.PSODesc.ResourceLayout.DefaultVariableType = dg::SHADER_RESOURCE_VARIABLE_TYPE_MUTABLE;
+        PSOCreateInfo.pCS = pCS;
+        m_pBuildPSO = pipelineCache.CreateComputePipelineState(PSOCreateInfo);
+    }
+
+    Resize(width, height);
+}
+
+void HiZBuffer::Resize(const uint32_t width, const uint32_t height) {
+    m_width = std::max(1u, width);
+    m_height = std::max(1u, height);
+    m_valid = false;
+    m_buildSRBs.clear();
+    m_levelViews.clear();
+    m_pPyramid.Release();
+    m_pDepth.Release();
+
+    dg::TextureDesc DepthDesc;
+    DepthDesc.Name = "World depth";
+    DepthDesc.Type = dg::RESOURCE_DIM_TEX_2D;
+    DepthDesc.Width = m_width;
+    DepthDesc.Height = m_height;
+    DepthDesc.Format = DEPTH_FORMAT;
+    DepthDesc.BindFlags = dg::BIND_DEPTH_STENCIL | (IsSupported() ? dg::BIND_SHADER_RESOURCE : dg::BIND_NONE);
+    DepthDesc.ClearValue.Format = DEPTH_FORMAT;
+    DepthDesc.ClearValue.DepthStencil.Depth = 1.f;
+    m_pDevice->CreateTexture(DepthDesc, nullptr, &m_pDepth);
+
+    if (!IsSupported())
+        return;
+
+    const uint32_t pyramidWidth = std::max(1u, m_width / 2), pyramidHeight = std::max(1u, m_height / 2);
+    m_mipCount = static_cast<uint32_t>(std::bit_width(std::max(pyramidWidth, pyramidHeight)));
+
+    dg::TextureDesc PyramidDesc;
+    PyramidDesc.Name = "Hi-Z pyramid";
+    PyramidDesc.Type = dg::RESOURCE_DIM_TEX_2D;
+    PyramidDesc.Width = pyramidWidth;
+    PyramidDesc.Height = pyramidHeight;
+    PyramidDesc.MipLevels = m_mipCount;
+    PyramidDesc.Format = dg::TEX_FORMAT_R32_FLOAT;
+    PyramidDesc.BindFlags = dg::BIND_SHADER_RESOURCE | dg::BIND_UNORDERED_ACCESS;
+    m_pDevice->CreateTexture(PyramidDesc, nullptr, &m_pPyramid);
+
+    for (uint32_t level = 0; level < m_mipCount; ++level) {
+        dg::TextureViewDesc ViewDesc;
+        ViewDesc.TextureDim = dg::RESOURCE_DIM_TEX_2D;
+        ViewDesc.MostDetailedMip = level;
+        ViewDesc.NumMipLevels = 1;
+
+        dg::RefCntAutoPtr<dg::ITextureView> pUAV;
+        ViewDesc.ViewType = dg::TEXTURE_VIEW_UNORDERED_ACCESS;
+        m_pPyramid->CreateView(ViewDesc, &pUAV);
+
+        dg::RefCntAutoPtr<dg::ITextureView> pSRV;
+        ViewDesc.ViewType = dg::TEXTURE_VIEW_SHADER_RESOURCE;
+        m_pPyramid->CreateView(ViewDesc, &pSRV);
+
+        dg::RefCntAutoPtr<dg::IShaderResourceBinding> pSRB;
+        m_pBuildPSO->CreateShaderResourceBinding(&pSRB, true);
+        pSRB->GetVariableByName(dg::SHADER_TYPE_COMPUTE, "g_Source")
+            ->Set(level == 0 ? m_pDepth->GetDefaultView(dg::TEXTURE_VIEW_SHADER_RESOURCE) : m_levelViews.back().RawPtr());
+        pSRB->GetVariableByName(dg::SHADER_TYPE_COMPUTE, "g_Destination")->Set(pUAV);
+
+        m_buildSRBs.push_back(pSRB);
+        m_levelViews.push_back(pSRV);
+    }
+}
+
+dg::ITextureView *HiZBuffer::GetDepthDSV() const {
+    return m_pDepth->GetDefaultView(dg::TEXTURE_VIEW_DEPTH_STENCIL);
+}
+
+dg::ITextureView *HiZBuffer::GetPyramidSRV() const {
+    return m_pPyramid ? m_pPyramid->GetDefaultView(dg::TEXTURE_VIEW_SHADER_RESOURCE) : nullptr;
+}
+
+void HiZBuffer::Build(dg::IDeviceContext *pContext, const dg::float4x4 &viewProj) {
+    if (!IsSupported())
+        return;
+
+    // Levels are read and written in turn, so they are transitioned one by one. The texture-wide state is
+    // meaningless meanwhile; it is set to unknown so nothing verifies or transitions the whole texture.
+    const dg::StateTransitionDesc Barriers[] = {
+        {m_pDepth, dg::RESOURCE_STATE_UNKNOWN, dg::RESOURCE_STATE_SHADER_RESOURCE, dg::STATE_TRANSITION_FLAG_UPDATE_STATE},
+        {m_pPyramid, dg::RESOURCE_STATE_UNKNOWN, dg::RESOURCE_STATE_UNORDERED_ACCESS, dg::STATE_TRANSITION_FLAG_UPDATE_STATE}
+    };
+    pContext->TransitionResourceStates(static_cast<dg::Uint32>(std::size(Barriers)), Barriers);
+    m_pPyramid->SetState(dg::RESOURCE_STATE_UNKNOWN);
+
+    pContext->SetPipelineState(m_pBuildPSO);
+    for (uint32_t level = 0; level < m_mipCount; ++level) {
+        const uint32_t levelWidth = std::max(1u, m_pPyramid->GetDesc().Width >> level);
+        const uint32_t levelHeight = std::max(1u, m_pPyramid->GetDesc().Height >> level);
+
+        pContext->CommitShaderResources(m_buildSRBs[level], dg::RESOURCE_STATE_TRANSITION_MODE_NONE);
+        dg::DispatchComputeAttribs DispatchAttrs{(levelWidth + BUILD_GROUP_SIZE - 1) / BUILD_GROUP_SIZE,
+                                                 (levelHeight + BUILD_GROUP_SIZE - 1) / BUILD_GROUP_SIZE, 1};
+        pContext->DispatchCompute(DispatchAttrs);
+
+        const dg::StateTransitionDesc LevelBarrier{m_pPyramid, dg::RESOURCE_STATE_UNORDERED_ACCESS,
+                                                   dg::RESOURCE_STATE_SHADER_RESOURCE, level, 1};
+        pContext->TransitionResourceStates(1, &LevelBarrier);
+    }
+    m_pPyramid->SetState(dg::RESOURCE_STATE_SHADER_RESOURCE);
+
+    m_viewProj = viewProj;
+    m_valid = true;
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "RefCntAutoPtr.hpp"
+#include "RenderDevice.h"
+#include "DeviceContext.h"
+#include "Texture.h"
+#include "PipelineState.h"
+#include "ShaderResourceBinding.h"
+#include "BasicMath.hpp"
+
+#include "render/PipelineCache.h"
+
+namespace dg = Diligent;
+
+// The world's depth buffer and a hierarchical-Z pyramid built from it, for occlusion culling.
+// The depth buffer lives here rather than in the swap chain because swap chain depth cannot be sampled on
+// every backend. Level 0 of the pyramid is half the depth buffer's resolution and every level keeps the
+// farthest depth underneath it, so a box whose nearest point lies behind the pyramid texel covering it is
+// hidden. The pyramid describes the frame it was built from; culling tests against it with that frame's
+// view-projection, so a section that comes out from behind an occluder appears one frame late.
+class HiZBuffer {
+public:
+    static constexpr dg::TEXTURE_FORMAT DEPTH_FORMAT = dg::TEX_FORMAT_D32_FLOAT;
+
+    HiZBuffer(dg::IRenderDevice *pDevice, PipelineCache &pipelineCache, uint32_t width, uint32_t height);
+
+    // Building needs compute shaders, the depth buffer is usable either way
+    bool IsSupported() const { return m_pBuildPSO != nullptr; }
+
+    // Recreates everything, the pyramid is invalid until the next Build()
+    void Resize(uint32_t width, uint32_t height);
+
+    dg::ITextureView *GetDepthDSV() const;
+
+    // Builds the pyramid from this frame's depth, call once the world has been drawn into it
+    void Build(dg::IDeviceContext *pContext, const dg::float4x4 &viewProj);
+
+    // Whether the pyramid holds a built frame
+    bool IsValid() const { return m_valid; }
+    dg::ITexture *GetPyramid() const { return m_pPyramid; }
+    dg::ITextureView *GetPyramidSRV() const;
+    // Of the frame the pyramid was built from
+    const dg::float4x4 &GetViewProj() const { return m_viewProj; }
+    uint32_t GetWidth() const { return m_width; }
+    uint32_t GetHeight() const { return m_height; }
+    uint32_t GetMipCount() const { return m_mipCount; }
+
+private:
+    dg::RefCntAutoPtr<dg::IRenderDevice> m_pDevice;
+    dg::RefCntAutoPtr<dg::IPipelineState> m_pBuildPSO;
+
+    dg::RefCntAutoPtr<dg::ITexture> m_pDepth;
+    dg::RefCntAutoPtr<dg::ITexture> m_pPyramid;
+    // One per pyramid level, reading the level before it (or the depth buffer) and writing the level
+    std::vector<dg::RefCntAutoPtr<dg::IShaderResourceBinding>> m_buildSRBs;
+    std::vector<dg::RefCntAutoPtr<dg::ITextureView>> m_levelViews;
+
+    // Depth buffer size
+    uint32_t m_width = 0, m_height = 0;
+    uint32_t m_mipCount = 0;
+    dg::float4x4 m_viewProj;
+    bool m_valid = false;
+};
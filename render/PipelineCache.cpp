@@ -0,0 +1,122 @@
+#include "render/PipelineCache.h"
+
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <vector>
+
+#include <spdlog/spdlog.h>
+
+#include "ArchiverFactoryLoader.h"
+#include "DataBlobImpl.hpp"
+#include "GraphicsAccessories.hpp"
+
+PipelineCache::PipelineCache(dg::IRenderDevice *pDevice, const std::string &shaderDirectory,
+                             const std::string &cacheDirectory)
+    : m_pDevice(pDevice) {
+    pDevice->GetEngineFactory()->CreateDefaultShaderSourceStreamFactory(shaderDirectory.c_str(),
+                                                                        &m_pShaderSourceFactory);
+
+#if ENGINE_DLL
+    dg::IArchiverFactory *pArchiverFactory = dg::LoadAndGetArchiverFactory();
+#else
+    dg::IArchiverFactory *pArchiverFactory = dg::GetArchiverFactory();
+#endif
+    if (!pArchiverFactory) {
+        spdlog::warn("Archiver is not available, shaders are compiled on every launch");
+        return;
+    }
+
+    dg::RenderStateCacheCreateInfo CacheCI;
+    CacheCI.pDevice = pDevice;
+    CacheCI.pArchiverFactory = pArchiverFactory;
+    CacheCI.LogLevel = dg::RENDER_STATE_CACHE_LOG_LEVEL_NORMAL;
+    CacheCI.FileHashMode = dg::RENDER_STATE_CACHE_FILE_HASH_MODE_BY_CONTENT;
+    dg::CreateRenderStateCache(CacheCI, &m_pCache);
+    if (!m_pCache) {
+        spdlog::warn("Failed to create the render state cache");
+        return;
+    }
+
+    // Archives only hold the bytecode of the backend that wrote them
+    const std::string deviceName = dg::GetRenderDeviceTypeShortString(pDevice->GetDeviceInfo().Type);
+    m_cachePath = (std::filesystem::path(cacheDirectory) / ("pipelines_" + deviceName + ".bin")).string();
+
+    std::ifstream file(m_cachePath, std::ios::binary);
+    if (!file)
+        return;
+    const std::vector<char> bytes((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    auto pArchive = dg::DataBlobImpl::Create(bytes.size(), bytes.data());
+    if (m_pCache->Load(pArchive, CONTENT_VERSION))
+        spdlog::info("Loaded pipeline cache {} ({} KiB)", m_cachePath, bytes.size() >> 10);
+    else
+        spdlog::warn("Pipeline cache {} is stale or corrupt, rebuilding it", m_cachePath);
+}
+
+PipelineCache::~PipelineCache() {
+    Save();
+}
+
+dg::RefCntAutoPtr<dg::IShader> PipelineCache::CreateShader(dg::ShaderCreateInfo ShaderCI) {
+    ShaderCI.pShaderSourceStreamFactory = m_pShaderSourceFactory;
+
+    dg::RefCntAutoPtr<dg::IShader> pShader;
+    if (!m_pCache) {
+        m_pDevice->CreateShader(ShaderCI, &pShader);
+        return pShader;
+    }
+    if (m_pCache->CreateShader(ShaderCI, &pShader))
+        ++m_hits;
+    else
+        ++m_misses;
+    return pShader;
+}
+
+dg::RefCntAutoPtr<dg::IPipelineState> PipelineCache::CreateGraphicsPipelineState(
+    const dg::GraphicsPipelineStateCreateInfo &PSOCreateInfo) {
+    dg::RefCntAutoPtr<dg::IPipelineState> pPSO;
+    if (!m_pCache) {
+        m_pDevice->CreateGraphicsPipelineState(PSOCreateInfo, &pPSO);
+        return pPSO;
+    }
+    if (m_pCache->CreateGraphicsPipelineState(PSOCreateInfo, &pPSO))
+        ++m_hits;
+    else
+        ++m_misses;
+    return pPSO;
+}
+
+dg::RefCntAutoPtr<dg::IPipelineState> PipelineCache::CreateComputePipelineState(
+    const dg::ComputePipelineStateCreateInfo &PSOCreateInfo) {
+    dg::RefCntAutoPtr<dg::IPipelineState> pPSO;
+    if (!m_pCache) {
+        m_pDevice->CreateComputePipelineState(PSOCreateInfo, &pPSO);
+        return pPSO;
+    }
+    if (m_pCache->CreateComputePipelineState(PSOCreateInfo, &pPSO))
+        ++m_hits;
+    else
+        ++m_misses;
+    return pPSO;
+}
+
+void PipelineCache::Save() {
+    if (!m_pCache || m_misses == 0)
+        return;
+
+    dg::RefCntAutoPtr<dg::IDataBlob> pArchive;
+    m_pCache->WriteToBlob(CONTENT_VERSION, &pArchive);
+    if (!pArchive)
+        return;
+
+    std::error_code error;
+    std::filesystem::create_directories(std::filesystem::path(m_cachePath).parent_path(), error);
+    std::ofstream file(m_cachePath, std::ios::binary | std::ios::trunc);
+    if (!file) {
+        spdlog::warn("Failed to write pipeline cache {}", m_cachePath);
+        return;
+    }
+    file.write(static_cast<const char *>(pArchive->GetConstDataPtr()), static_cast<std::streamsize>(pArchive->GetSize()));
+    spdlog::info("Saved pipeline cache {} ({} KiB)", m_cachePath, pArchive->GetSize() >> 10);
+    m_misses = 0;
+}
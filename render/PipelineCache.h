@@ -0,0 +1,48 @@
+#pragma once
+
+#include <string>
+
+#include "RefCntAutoPtr.hpp"
+#include "RenderDevice.h"
+#include "Shader.h"
+#include "PipelineState.h"
+#include "RenderStateCache.h"
+
+namespace dg = Diligent;
+
+// Shader and pipeline creation through a persistent render state cache.
+// Shaders are loaded by file name from the shader directory. Compiled bytecode and pipelines are archived
+// per backend and written to disk, so later launches skip HLSL compilation; on Vulkan/D3D12 the archived
+// pipelines also skip driver compilation. Shader files are hashed by content, so edits invalidate their entries.
+// Falls back to plain device creation when the cache cannot be created.
+class PipelineCache {
+public:
+    // Bumping this discards every archive written by older builds
+    static constexpr dg::Uint32 CONTENT_VERSION = 1;
+
+    PipelineCache(dg::IRenderDevice *pDevice, const std::string &shaderDirectory, const std::string &cacheDirectory);
+    // Saves the archive
+    ~PipelineCache();
+
+    PipelineCache(const PipelineCache &) = delete;
+    PipelineCache &operator=(const PipelineCache &) = delete;
+
+    // ShaderCI.FilePath names a file in the shader directory
+    dg::RefCntAutoPtr<dg::IShader> CreateShader(dg::ShaderCreateInfo ShaderCI);
+    dg::RefCntAutoPtr<dg::IPipelineState> CreateGraphicsPipelineState(const dg::GraphicsPipelineStateCreateInfo &PSOCreateInfo);
+    dg::RefCntAutoPtr<dg::IPipelineState> CreateComputePipelineState(const dg::ComputePipelineStateCreateInfo &PSOCreateInfo);
+
+    // Writes the archive if anything new was created since it was loaded
+    void Save();
+
+    uint32_t GetHitCount() const { return m_hits; }
+    uint32_t GetMissCount() const { return m_misses; }
+
+private:
+    dg::RefCntAutoPtr<dg::IRenderDevice> m_pDevice;
+    dg::RefCntAutoPtr<dg::IShaderSourceInputStreamFactory> m_pShaderSourceFactory;
+    dg::RefCntAutoPtr<dg::IRenderStateCache> m_pCache;
+    std::string m_cachePath;
+    uint32_t m_hits = 0;
+    uint32_t m_misses = 0;
+};
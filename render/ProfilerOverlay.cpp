@@ -0,0 +1,77 @@
+#include "render/ProfilerOverlay.h"
+
+#include "ImGuiImplDiligent.hpp"
+#include "imgui.h"
+
+#include "core/LinearArena.h"
+#include "core/ObjectPool.h"
+#include "core/Profiler.h"
+
+namespace {
+    void StatsRow(const char *name, const Profiler::Stats &stats) {
+        ImGui::TableNextRow();
+        ImGui::TableNextColumn();
+        ImGui::TextUnformatted(name);
+        for (const double value: {stats.last, stats.p50, stats.p99, stats.max}) {
+            ImGui::TableNextColumn();
+            ImGui::Text("%6.2f", value);
+        }
+    }
+}
+
+ProfilerOverlay::ProfilerOverlay(dg::IRenderDevice *pDevice, const dg::TEXTURE_FORMAT colorFormat,
+                                 const dg::TEXTURE_FORMAT depthFormat) {
+    dg::ImGuiDiligentCreateInfo ImGuiCI{pDevice, colorFormat, depthFormat};
+    m_pImGui = std::make_unique<dg::ImGuiImplDiligent>(ImGuiCI);
+}
+
+ProfilerOverlay::~ProfilerOverlay() = default;
+
+void ProfilerOverlay::Render(dg::IDeviceContext *pContext, const uint32_t width, const uint32_t height,
+                             const float deltaSeconds) {
+    if (!m_visible)
+        return;
+
+    ImGui::GetIO().DeltaTime = deltaSeconds > 0.f ? deltaSeconds : 1.f / 60.f;
+    m_pImGui->NewFrame(width, height, dg::SURFACE_TRANSFORM_IDENTITY);
+
+    const Profiler &profiler = Profiler::Get();
+    ImGui::SetNextWindowPos(ImVec2(10, 10), ImGuiCond_FirstUseEver);
+    ImGui::SetNextWindowBgAlpha(0.8f);
+    if (ImGui::Begin("Profiler", nullptr, ImGuiWindowFlags_AlwaysAutoResize | ImGuiWindowFlags_NoFocusOnAppearing)) {
+        const Profiler::Stats frame = profiler.GetFrameStats();
+        ImGui::Text("Frame %llu  %.2f ms (%.0f fps)", static_cast<unsigned long long>(profiler.GetFrameNumber()),
+                    frame.last, frame.p50 > 0.0 ? 1000.0 / frame.p50 : 0.0);
+        if (profiler.IsCapturing())
+            ImGui::TextUnformatted("Capturing trace...");
+
+        if (ImGui::BeginTable("scopes", 5, ImGuiTableFlags_RowBg | ImGuiTableFlags_SizingFixedFit)) {
+            ImGui::TableSetupColumn("Scope (ms)");
+            ImGui::TableSetupColumn("last");
+            ImGui::TableSetupColumn("p50");
+            ImGui::TableSetupColumn("p99");
+            ImGui::TableSetupColumn("max");
+            ImGui::TableHeadersRow();
+
+            StatsRow("Frame", frame);
+            for (const ProfileTrack track: {PROFILE_TRACK_CPU, PROFILE_TRACK_GPU}) {
+                for (uint32_t scope = 0; scope < profiler.GetScopeCount(); ++scope) {
+                    if (profiler.GetScopeTrack(scope) == track)
+                        StatsRow(profiler.GetScopeName(scope), profiler.GetStats(scope));
+                }
+            }
+            ImGui::EndTable();
+        }
+        const ThreadArenaStats arenas = GetThreadArenaStats();
+        ImGui::Text("Scratch arenas: %u threads, %zu KiB peak, %zu KiB reserved", arenas.threads, arenas.peak >> 10,
+                    arenas.capacity >> 10);
+        for (const FixedPool::Stats &pool: GetFixedPoolStats()) {
+            ImGui::Text("%s: %zu live, %zu peak, %zu KiB reserved", pool.name, pool.live, pool.peak,
+                        pool.capacity * pool.slotSize >> 10);
+        }
+        ImGui::TextUnformatted("F3 toggle, F4 capture trace");
+    }
+    ImGui::End();
+
+    m_pImGui->Render(pContext);
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+
+#include "RenderDevice.h"
+#include "DeviceContext.h"
+
+namespace Diligent {
+    class ImGuiImplDiligent;
+}
+
+namespace dg = Diligent;
+
+// ImGui window listing every profiler scope with its last/p50/p99/max time
+class ProfilerOverlay {
+public:
+    ProfilerOverlay(dg::IRenderDevice *pDevice, dg::TEXTURE_FORMAT colorFormat, dg::TEXTURE_FORMAT depthFormat);
+    ~ProfilerOverlay();
+
+    void SetVisible(bool visible) { m_visible = visible; }
+    bool IsVisible() const { return m_visible; }
+
+    // Draws into the bound render targets
+    void Render(dg::IDeviceContext *pContext, uint32_t width, uint32_t height, float deltaSeconds);
+
+private:
+    std::unique_ptr<dg::ImGuiImplDiligent> m_pImGui;
+    bool m_visible = false;
+};
@@ -0,0 +1,20 @@
+#include "render/ResourceStateTracker.h"
+
+void ResourceStateTracker::Require(dg::IBuffer *pBuffer, const dg::RESOURCE_STATE state) {
+    if (!pBuffer || pBuffer->GetState() == state)
+        return;
+    m_barriers.emplace_back(pBuffer, dg::RESOURCE_STATE_UNKNOWN, state, dg::STATE_TRANSITION_FLAG_UPDATE_STATE);
+}
+
+void ResourceStateTracker::Require(dg::ITexture *pTexture, const dg::RESOURCE_STATE state) {
+    if (!pTexture || pTexture->GetState() == state)
+        return;
+    m_barriers.emplace_back(pTexture, dg::RESOURCE_STATE_UNKNOWN, state, dg::STATE_TRANSITION_FLAG_UPDATE_STATE);
+}
+
+void ResourceStateTracker::Flush(dg::IDeviceContext *pContext) {
+    if (m_barriers.empty())
+        return;
+    pContext->TransitionResourceStates(static_cast<dg::Uint32>(m_barriers.size()), m_barriers.data());
+    m_barriers.clear();
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <vector>
+
+#include "DeviceContext.h"
+#include "Buffer.h"
+#include "Texture.h"
+
+namespace dg = Diligent;
+
+// Debug builds (PLUSCRAFT_VALIDATION) verify resource states and draw arguments on every call,
+// release builds trust the explicit transitions below and skip the per-draw checks entirely.
+#ifndef PLUSCRAFT_VALIDATION
+#    define PLUSCRAFT_VALIDATION 0
+#endif
+
+#if PLUSCRAFT_VALIDATION
+constexpr dg::RESOURCE_STATE_TRANSITION_MODE DRAW_TRANSITION_MODE = dg::RESOURCE_STATE_TRANSITION_MODE_VERIFY;
+constexpr dg::DRAW_FLAGS DRAW_FLAGS = dg::DRAW_FLAG_VERIFY_ALL;
+#else
+constexpr dg::RESOURCE_STATE_TRANSITION_MODE DRAW_TRANSITION_MODE = dg::RESOURCE_STATE_TRANSITION_MODE_NONE;
+constexpr dg::DRAW_FLAGS DRAW_FLAGS = dg::DRAW_FLAG_NONE;
+#endif
+
+// Batches the state transitions a pass needs into a single TransitionResourceStates() call.
+// Resources already in the requested state (as tracked by the engine) are skipped,
+// so passes can declare their requirements every frame at no cost.
+class ResourceStateTracker {
+public:
+    void Require(dg::IBuffer *pBuffer, dg::RESOURCE_STATE state);
+    void Require(dg::ITexture *pTexture, dg::RESOURCE_STATE state);
+
+    void Flush(dg::IDeviceContext *pContext);
+
+private:
+    std::vector<dg::StateTransitionDesc> m_barriers;
+};
@@ -0,0 +1,51 @@
+#include "render/UniformRing.h"
+
+#include <algorithm>
+
+#include <spdlog/spdlog.h>
+
+UniformRing::UniformRing(dg::IRenderDevice *pDevice, const uint32_t sizePerFrame)
+    : m_capacity(sizePerFrame) {
+    const uint32_t alignment = static_cast<uint32_t>(pDevice->GetAdapterInfo().Buffer.ConstantBufferOffsetAlignment);
+    m_alignment = std::max(alignment, 16u);
+
+    dg::BufferDesc CBDesc;
+    CBDesc.Name = "Uniform ring";
+    CBDesc.Size = m_capacity;
+    CBDesc.Usage = dg::USAGE_DYNAMIC;
+    CBDesc.BindFlags = dg::BIND_UNIFORM_BUFFER;
+    CBDesc.CPUAccessFlags = dg::CPU_ACCESS_WRITE;
+    pDevice->CreateBuffer(CBDesc, nullptr, &m_pBuffer);
+}
+
+void UniformRing::BeginFrame(dg::IDeviceContext *pContext) {
+    void *pData = nullptr;
+    pContext->MapBuffer(m_pBuffer, dg::MAP_WRITE, dg::MAP_FLAG_DISCARD, pData);
+    m_pMapped = static_cast<uint8_t *>(pData);
+    m_used = 0;
+}
+
+void UniformRing::EndFrame(dg::IDeviceContext *pContext) {
+    if (!m_pMapped)
+        return;
+    pContext->UnmapBuffer(m_pBuffer, dg::MAP_WRITE);
+    m_pMapped = nullptr;
+    m_peakUsed = std::max(m_peakUsed, m_used);
+}
+
+UniformRing::Allocation UniformRing::Allocate(const uint32_t size) {
+    const uint32_t offset = (m_used + m_alignment - 1) / m_alignment * m_alignment;
+    if (!m_pMapped || offset + size > m_capacity) {
+        if (m_pMapped && !m_overflowReported) {
+            spdlog::error("Uniform ring overflow: {} bytes per frame are not enough", m_capacity);
+            m_overflowReported = true;
+        }
+        return {};
+    }
+    m_used = offset + size;
+    return {m_pMapped + offset, offset};
+}
+
+void UniformRing::Bind(dg::IShaderResourceVariable *pVariable, const uint32_t sliceSize) const {
+    pVariable->SetBufferRange(m_pBuffer, 0, sliceSize);
+}
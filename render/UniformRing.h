@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstdint>
+
+#include "RefCntAutoPtr.hpp"
+#include "RenderDevice.h"
+#include "DeviceContext.h"
+#include "Buffer.h"
+#include "ShaderResourceVariable.h"
+
+namespace dg = Diligent;
+
+// Per-frame constant buffer ring.
+// A single dynamic buffer is mapped once at BeginFrame() and unmapped at EndFrame(); in between, every pass
+// bump-allocates aligned slices from it and binds them through dynamic offsets (SetBufferOffset) instead of
+// mapping a buffer of its own per draw.
+// Mapping with DISCARD hands out fresh memory every frame: D3D11 renames the buffer, D3D12/Vulkan take it from
+// the context's dynamic heap which is released per frame once the GPU fence for that frame has passed,
+// so slices written for frame N are never overwritten while the GPU may still read them.
+class UniformRing {
+public:
+    struct Allocation {
+        void *pData = nullptr;
+        uint32_t offset = 0;
+    };
+
+    UniformRing(dg::IRenderDevice *pDevice, uint32_t sizePerFrame);
+
+    void BeginFrame(dg::IDeviceContext *pContext);
+    // Slices must not be written after this
+    void EndFrame(dg::IDeviceContext *pContext);
+
+    // Returns a null allocation when the frame's budget is exhausted
+    Allocation Allocate(uint32_t size);
+
+    template<typename T>
+    T *Allocate(uint32_t &offset) {
+        const Allocation allocation = Allocate(sizeof(T));
+        offset = allocation.offset;
+        return static_cast<T *>(allocation.pData);
+    }
+
+    // Binds the ring to a DYNAMIC shader variable once, slices are then selected with SetBufferOffset()
+    void Bind(dg::IShaderResourceVariable *pVariable, uint32_t sliceSize) const;
+
+    dg::IBuffer *GetBuffer() const { return m_pBuffer; }
+    uint32_t GetUsed() const { return m_used; }
+    uint32_t GetPeakUsed() const { return m_peakUsed; }
+    uint32_t GetCapacity() const { return m_capacity; }
+
+private:
+    dg::RefCntAutoPtr<dg::IBuffer> m_pBuffer;
+    uint8_t *m_pMapped = nullptr;
+    uint32_t m_capacity = 0;
+    uint32_t m_alignment = 256;
+    uint32_t m_used = 0;
+    uint32_t m_peakUsed = 0;
+    bool m_overflowReported = false;
+};
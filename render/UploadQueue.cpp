@@ -0,0 +1,192 @@
+#include "render/UploadQueue.h"
+
+#include <algorithm>
+
+#include <spdlog/spdlog.h>
+
+namespace {
+    // Keeps every copy source aligned for both vertex and index data
+    constexpr uint32_t ALIGNMENT = 16;
+}
+
+UploadQueue::UploadQueue(dg::IRenderDevice *pDevice, dg::IDeviceContext *pImmediateContext,
+                         dg::IDeviceContext *pTransferContext, const uint32_t capacity)
+    : m_pImmediateContext(pImmediateContext), m_capacity(capacity) {
+    const auto deviceType = pDevice->GetDeviceInfo().Type;
+    const bool persistentMapping = deviceType == dg::RENDER_DEVICE_TYPE_D3D12 ||
+                                   deviceType == dg::RENDER_DEVICE_TYPE_VULKAN;
+    // The transfer queue waits for the frames before on the GPU, which takes fences shared between queues
+    const bool nativeFence = pDevice->GetDeviceInfo().Features.NativeFence != dg::DEVICE_FEATURE_STATE_DISABLED;
+    if (pTransferContext && persistentMapping && nativeFence)
+        m_pTransferContext = pTransferContext;
+    m_pCopyContext = m_pTransferContext ? m_pTransferContext.RawPtr() : m_pImmediateContext.RawPtr();
+
+    m_contextMask = uint64_t{1} << pImmediateContext->GetDesc().ContextId;
+    if (m_pTransferContext)
+        m_contextMask |= uint64_t{1} << m_pTransferContext->GetDesc().ContextId;
+
+    if (!persistentMapping) {
+        m_pSystemStaging = std::make_unique<uint8_t[]>(m_capacity);
+        m_pMapped = m_pSystemStaging.get();
+        spdlog::info("Uploads: staged in system memory on the immediate context");
+        return;
+    }
+
+    dg::BufferDesc BuffDesc;
+    BuffDesc.Name = "Upload staging ring";
+    BuffDesc.Usage = dg::USAGE_STAGING;
+    BuffDesc.CPUAccessFlags = dg::CPU_ACCESS_WRITE;
+    BuffDesc.Size = m_capacity;
+    BuffDesc.ImmediateContextMask = uint64_t{1} << m_pCopyContext->GetDesc().ContextId;
+    pDevice->CreateBuffer(BuffDesc, nullptr, &m_pStaging);
+    void *pData = nullptr;
+    m_pCopyContext->MapBuffer(m_pStaging, dg::MAP_WRITE, dg::MAP_FLAG_NONE, pData);
+    m_pMapped = static_cast<uint8_t *>(pData);
+
+    dg::FenceDesc FenceDesc;
+    FenceDesc.Name = "Upload fence";
+    FenceDesc.Type = m_pTransferContext ? dg::FENCE_TYPE_GENERAL : dg::FENCE_TYPE_CPU_WAIT_ONLY;
+    pDevice->CreateFence(FenceDesc, &m_pFence);
+    if (m_pTransferContext) {
+        FenceDesc.Name = "Upload frame fence";
+        pDevice->CreateFence(FenceDesc, &m_pFrameFence);
+    }
+    spdlog::info("Uploads: {} MB staging ring on the {} queue", m_capacity >> 20,
+                 m_pTransferContext ? "transfer" : "graphics");
+}
+
+UploadQueue::~UploadQueue() {
+    WaitIdle();
+    if (m_pStaging && m_pMapped)
+        m_pCopyContext->UnmapBuffer(m_pStaging, dg::MAP_WRITE);
+}
+
+UploadQueue::Allocation UploadQueue::Allocate(const uint32_t size) {
+    const uint64_t alignedSize = (static_cast<uint64_t>(size) + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+    if (size == 0 || alignedSize > m_capacity)
+        return {};
+
+    std::lock_guard lock(m_mutex);
+    // Nothing to wait for, restart at the beginning so the allocation needs no padding
+    if (m_live.empty())
+        m_head = (m_head + m_capacity - 1) / m_capacity * m_capacity;
+
+    // An allocation never wraps, the end of the ring is skipped instead
+    uint64_t begin = m_head;
+    const uint64_t offset = begin % m_capacity;
+    if (offset + alignedSize > m_capacity)
+        begin += m_capacity - offset;
+
+    const uint64_t tail = m_live.empty() ? m_head : m_live.begin()->first;
+    if (begin + alignedSize - tail > m_capacity)
+        return {};
+
+    const uint64_t position = m_head;
+    m_live[position] = begin + alignedSize;
+    m_head = begin + alignedSize;
+    const auto bufferOffset = static_cast<uint32_t>(begin % m_capacity);
+    return {m_pMapped + bufferOffset, bufferOffset, size, position};
+}
+
+void UploadQueue::Discard(const Allocation &allocation) {
+    if (allocation.IsValid())
+        Release(allocation.position);
+}
+
+void UploadQueue::Release(const uint64_t position) {
+    std::lock_guard lock(m_mutex);
+    m_live.erase(position);
+}
+
+void UploadQueue::Copy(const Allocation &allocation, const uint32_t srcOffset, const uint32_t size,
+                       dg::IBuffer *pDst, const uint64_t dstOffset) {
+    const uint32_t offset = allocation.offset + srcOffset;
+    if (!m_pStaging) {
+        m_pImmediateContext->UpdateBuffer(pDst, dstOffset, size, m_pMapped + offset,
+                                          dg::RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+    } else {
+        // The workers' writes are made visible to the GPU here, on memory that is not host coherent
+        m_pStaging->FlushMappedRange(offset, size);
+        // Resource states are tracked per resource, not per queue: only the immediate context transitions them,
+        // the transfer queue relies on buffers being accessible from the copy queue in their common state
+        const auto mode = m_pTransferContext ? dg::RESOURCE_STATE_TRANSITION_MODE_NONE
+                                             : dg::RESOURCE_STATE_TRANSITION_MODE_TRANSITION;
+        m_pCopyContext->CopyBuffer(m_pStaging, offset, mode, pDst, dstOffset, size, mode);
+    }
+    if (m_recorded.empty() || m_recorded.back() != allocation.position)
+        m_recorded.push_back(allocation.position);
+}
+
+UploadQueue::Ticket UploadQueue::Submit() {
+    if (m_recorded.empty())
+        return m_nextTicket - 1;
+
+    const Ticket ticket = m_nextTicket++;
+    if (!m_pStaging) {
+        // UpdateBuffer took its own copy of the data
+        for (const uint64_t position: m_recorded)
+            Release(position);
+        m_recorded.clear();
+        return ticket;
+    }
+
+    if (m_pTransferContext) {
+        // Freed ranges of the destinations may be overwritten only once the frames drawing them are done
+        if (m_frameFenceValue > 0)
+            m_pTransferContext->DeviceWaitForFence(m_pFrameFence, m_frameFenceValue);
+        m_pTransferContext->EnqueueSignal(m_pFence, ticket);
+        m_pTransferContext->Flush();
+    } else {
+        // Submitted with the frame
+        m_pImmediateContext->EnqueueSignal(m_pFence, ticket);
+    }
+    for (const uint64_t position: m_recorded)
+        m_pendingReleases.push_back({ticket, position});
+    m_recorded.clear();
+    return ticket;
+}
+
+UploadQueue::Ticket UploadQueue::GetCompletedTicket() const {
+    return m_pFence ? m_pFence->GetCompletedValue() : m_nextTicket - 1;
+}
+
+bool UploadQueue::IsReady(const Ticket ticket) const {
+    // On the immediate context the copies come before anything recorded after them
+    return !m_pTransferContext || ticket <= GetCompletedTicket();
+}
+
+void UploadQueue::WaitOnGpu(const Ticket ticket) {
+    if (m_pTransferContext && ticket > 0)
+        m_pImmediateContext->DeviceWaitForFence(m_pFence, ticket);
+}
+
+void UploadQueue::WaitIdle() {
+    const Ticket ticket = Submit();
+    if (m_pFence && !m_pendingReleases.empty()) {
+        // The signal may still be waiting for the frame to be submitted
+        m_pCopyContext->Flush();
+        m_pFence->Wait(ticket);
+    }
+    WaitOnGpu(ticket);
+    Update();
+}
+
+void UploadQueue::Update() {
+    const Ticket completed = GetCompletedTicket();
+    // Tickets are submitted in order
+    const auto done = std::find_if(m_pendingReleases.begin(), m_pendingReleases.end(),
+                                   [completed](const PendingRelease &release) { return release.ticket > completed; });
+    for (auto it = m_pendingReleases.begin(); it != done; ++it)
+        Release(it->position);
+    m_pendingReleases.erase(m_pendingReleases.begin(), done);
+}
+
+void UploadQueue::EndFrame() {
+    if (m_pTransferContext)
+        m_pImmediateContext->EnqueueSignal(m_pFrameFence, ++m_frameFenceValue);
+}
+
+uint32_t UploadQueue::GetUsed() const {
+    std::lock_guard lock(m_mutex);
+    return m_live.empty() ? 0 : static_cast<uint32_t>(m_head - m_live.begin()->first);
+}
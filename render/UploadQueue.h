@@ -0,0 +1,122 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "RefCntAutoPtr.hpp"
+#include "RenderDevice.h"
+#include "DeviceContext.h"
+#include "Buffer.h"
+#include "Fence.h"
+
+namespace dg = Diligent;
+
+// Staging ring for buffer uploads, filled from any thread and copied to the GPU on a transfer queue.
+//
+// Allocate() is thread-safe, so worker threads write their data straight into upload memory. The render thread
+// records the copies with Copy() and hands them to the transfer context with Submit(), which returns a ticket:
+// the fence value signalled once those copies are done. Destinations may only be used once IsReady() says so.
+// Ring space is reclaimed in Update() as tickets complete.
+//
+// Without a transfer context the copies run on the immediate context, ordered before everything recorded after
+// them, so tickets are ready right away. Backends that cannot keep a staging buffer mapped while the GPU reads it
+// (D3D11, OpenGL) stage in system memory and copy with UpdateBuffer instead.
+//
+// The transfer queue does not see the immediate context's barriers. A range freed by the owner of a destination
+// buffer may still be read by frames in flight, so every Submit() waits on the GPU for the graphics work of the
+// frames before, signalled by EndFrame().
+class UploadQueue {
+public:
+    using Ticket = uint64_t;
+
+    struct Allocation {
+        void *pData = nullptr;
+        uint32_t offset = 0;
+        uint32_t size = 0;
+        // Ring position the allocation was made at, including any padding before it
+        uint64_t position = 0;
+
+        bool IsValid() const { return pData != nullptr; }
+    };
+
+    // pTransferContext may be null. Destination buffers must include GetContextMask() in their
+    // ImmediateContextMask; the ring must be larger than any single upload
+    UploadQueue(dg::IRenderDevice *pDevice, dg::IDeviceContext *pImmediateContext,
+                dg::IDeviceContext *pTransferContext, uint32_t capacity = 32 << 20);
+    // Waits for the copies in flight
+    ~UploadQueue();
+
+    UploadQueue(const UploadQueue &) = delete;
+    UploadQueue &operator=(const UploadQueue &) = delete;
+
+    // Thread-safe; returns an invalid allocation while the ring is full
+    Allocation Allocate(uint32_t size);
+    // Returns an allocation that will not be copied, thread-safe
+    void Discard(const Allocation &allocation);
+
+    // Records a copy of size bytes at srcOffset within the allocation into pDst. The allocation is released once
+    // the ticket of the next Submit() completes
+    void Copy(const Allocation &allocation, uint32_t srcOffset, uint32_t size, dg::IBuffer *pDst, uint64_t dstOffset);
+    // Submits the copies recorded since the last call, returns their ticket
+    Ticket Submit();
+    // The ticket's copies are visible to commands recorded on the immediate context from now on
+    bool IsReady(Ticket ticket) const;
+    // Makes the immediate context wait on the GPU for the ticket's copies. Tickets found ready by IsReady()
+    // have already completed, so the wait only orders their memory accesses
+    void WaitOnGpu(Ticket ticket);
+    // Submits what is recorded and blocks the CPU until every copy is done, the immediate context's next
+    // commands are ordered after them
+    void WaitIdle();
+    bool IsIdle() const { return m_pendingReleases.empty(); }
+
+    // Reclaims the ring space of completed tickets, call once per frame on the render thread
+    void Update();
+    // Signals the end of the frame's graphics work, call right before Present
+    void EndFrame();
+
+    bool HasTransferQueue() const { return m_pTransferContext != nullptr; }
+    uint64_t GetContextMask() const { return m_contextMask; }
+    uint32_t GetCapacity() const { return m_capacity; }
+    // Bytes allocated and not yet released
+    uint32_t GetUsed() const;
+
+private:
+    struct PendingRelease {
+        Ticket ticket;
+        uint64_t position;
+    };
+
+    void Release(uint64_t position);
+    Ticket GetCompletedTicket() const;
+
+    dg::RefCntAutoPtr<dg::IDeviceContext> m_pImmediateContext;
+    dg::RefCntAutoPtr<dg::IDeviceContext> m_pTransferContext;
+    // Context the copies are recorded on, one of the two above
+    dg::IDeviceContext *m_pCopyContext = nullptr;
+    uint64_t m_contextMask = 0;
+
+    // Staging buffer, persistently mapped; null when staging in system memory
+    dg::RefCntAutoPtr<dg::IBuffer> m_pStaging;
+    std::unique_ptr<uint8_t[]> m_pSystemStaging;
+    uint8_t *m_pMapped = nullptr;
+    uint32_t m_capacity = 0;
+
+    // Signalled by the copy context per ticket, and by the immediate context per frame when there is a transfer queue
+    dg::RefCntAutoPtr<dg::IFence> m_pFence;
+    dg::RefCntAutoPtr<dg::IFence> m_pFrameFence;
+    Ticket m_nextTicket = 1;
+    uint64_t m_frameFenceValue = 0;
+
+    mutable std::mutex m_mutex;
+    // Monotonic ring positions, position % capacity is the buffer offset
+    uint64_t m_head = 0;
+    // Live allocations, position -> end
+    std::map<uint64_t, uint64_t> m_live;
+
+    // Render thread only
+    std::vector<uint64_t> m_recorded;
+    std::vector<PendingRelease> m_pendingReleases;
+};
@@ -0,0 +1,26 @@
+#include "server/ChunkPayloadCache.h"
+
+#include "world/ChunkSerializer.h"
+
+ChunkPayloadCache::ChunkPayloadCache(RegionStorage &storage) : m_storage(storage) {}
+
+ChunkPayloadCache::Payload ChunkPayloadCache::Get(const Chunk &chunk) {
+    Payload &payload = m_payloads[chunk.GetPos()];
+    if (payload)
+        return payload;
+
+    auto data = std::make_shared<std::vector<uint8_t>>();
+    if (!chunk.IsDirty() && m_storage.ReadStoredPayload(chunk.GetPos(), *data)) {
+        ++m_stats.stored;
+    } else {
+        SerializeChunk(chunk, m_serialized);
+        CompressChunkPayload(m_serialized.data(), m_serialized.size(), *data);
+        ++m_stats.built;
+    }
+    payload = std::move(data);
+    return payload;
+}
+
+void ChunkPayloadCache::Invalidate(const ChunkPos pos) {
+    m_payloads.erase(pos);
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include "world/Chunk.h"
+#include "world/RegionStorage.h"
+
+// Chunk payloads ready to send, one shared buffer per chunk however many players get it.
+// A chunk that matches its region file is sent exactly as stored there, so the server neither serializes nor
+// compresses it; changed and never saved chunks are serialized and compressed once per change.
+// Only used by the tick thread.
+class ChunkPayloadCache {
+public:
+    using Payload = std::shared_ptr<const std::vector<uint8_t>>;
+
+    struct Stats {
+        // Payloads taken from region files, and built from chunks
+        uint64_t stored = 0;
+        uint64_t built = 0;
+    };
+
+    explicit ChunkPayloadCache(RegionStorage &storage);
+
+    ChunkPayloadCache(const ChunkPayloadCache &) = delete;
+    ChunkPayloadCache &operator=(const ChunkPayloadCache &) = delete;
+
+    Payload Get(const Chunk &chunk);
+    // Call when the chunk changed or is unloaded
+    void Invalidate(ChunkPos pos);
+
+    const Stats &GetStats() const { return m_stats; }
+
+private:
+    RegionStorage &m_storage;
+    std::unordered_map<ChunkPos, Payload, ChunkPosHash> m_payloads;
+    std::vector<uint8_t> m_serialized;
+    Stats m_stats;
+};
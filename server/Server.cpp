@@ -0,0 +1,410 @@
+#include "server/Server.h"
+
+#include <algorithm>
+#include <cmath>
+#include <thread>
+
+#include <spdlog/spdlog.h>
+
+#include "core/LinearArena.h"
+#include "world/ChunkSerializer.h"
+#include "world/TerrainGenerator.h"
+
+namespace {
+    // Chunks sent to a player are unloaded this many chunks past its view radius, so walking along a chunk
+    // border does not resend them
+    constexpr int CHUNK_HYSTERESIS = 2;
+    // Snapshots of a player that stops acknowledging are dropped past this, it then gets a full one
+    constexpr size_t MAX_SNAPSHOT_HISTORY = 64;
+
+    void WriteChunkPos(PacketWriter &writer, const ChunkPos pos) {
+        writer.WriteVarInt(pos.x);
+        writer.WriteVarInt(pos.z);
+    }
+
+    int GetDistanceSquared(const ChunkPos a, const ChunkPos b) {
+        return (a.x - b.x) * (a.x - b.x) + (a.z - b.z) * (a.z - b.z);
+    }
+}
+
+Server::Server(const Settings &settings)
+    : m_settings(settings),
+      m_tickInterval(std::chrono::duration_cast<Clock::duration>(
+          std::chrono::duration<double>(1.0 / std::max(1u, settings.tickRate)))) {
+    m_jobSystem = std::make_unique<JobSystem>(settings.threadCount);
+    m_regionStorage = std::make_unique<RegionStorage>(settings.worldDirectory);
+
+    // Nothing is meshed here, chunks become ready as fast as they are generated
+    ChunkStreamer::Settings streamerSettings;
+    streamerSettings.viewRadius = settings.loadRadius;
+    streamerSettings.maxReadyPerFrame = 256;
+    m_chunkStreamer = std::make_unique<ChunkStreamer>(
+        m_world, *m_jobSystem,
+        [this, terrain = TerrainGenerator(settings.seed)](Chunk &chunk, const std::atomic<bool> &cancelled) {
+            if (!m_regionStorage->LoadChunk(chunk))
+                terrain.Generate(chunk, cancelled);
+        },
+        streamerSettings);
+    m_chunkStreamer->SetOnChunkReady([this](ChunkPos) {
+        for (const auto &pPlayer: m_players)
+            pPlayer->chunksComplete = false;
+    });
+    m_chunkStreamer->SetOnChunkUnloading([this](const Chunk &chunk) {
+        if (chunk.IsDirty())
+            m_regionStorage->SaveChunk(chunk);
+        m_payloadCache->Invalidate(chunk.GetPos());
+        for (const auto &pPlayer: m_players) {
+            if (!pPlayer->chunks.erase(chunk.GetPos()))
+                continue;
+            PacketWriter writer = pPlayer->connection.BeginPacket(PACKET_UNLOAD_CHUNK);
+            WriteChunkPos(writer, chunk.GetPos());
+            pPlayer->connection.EndPacket();
+        }
+    });
+    m_payloadCache = std::make_unique<ChunkPayloadCache>(*m_regionStorage);
+
+    m_worldTicker = std::make_unique<WorldTicker>(m_world, *m_jobSystem,
+                                                  WorldTicker::Settings{.seed = static_cast<uint32_t>(settings.seed)});
+    m_simulation = std::make_unique<Simulation>(
+        Simulation::Settings{.tickRate = settings.tickRate, .seed = static_cast<uint32_t>(settings.seed)},
+        *m_jobSystem, TerrainGenerator(settings.seed));
+
+    for (int z = -settings.loadRadius; z <= settings.loadRadius; ++z) {
+        for (int x = -settings.loadRadius; x <= settings.loadRadius; ++x) {
+            if (x * x + z * z <= settings.loadRadius * settings.loadRadius)
+                m_chunkOrder.push_back({x, z});
+        }
+    }
+    std::ranges::sort(m_chunkOrder, {}, [](const ChunkPos offset) { return GetDistanceSquared(offset, {}); });
+
+    spdlog::info("Server: {} ticks per second, {} worker threads, load radius {} chunks", settings.tickRate,
+                 m_jobSystem->GetThreadCount(), settings.loadRadius);
+
+    if (settings.port != 0) {
+        m_listener = Socket::Listen(settings.port);
+        if (m_listener.IsOpen())
+            spdlog::info("Server: listening on port {}", settings.port);
+        else
+            spdlog::error("Server: failed to listen on port {}, players cannot join", settings.port);
+    }
+    m_world.SetRecordBlockChanges(m_listener.IsOpen());
+}
+
+Server::~Server() {
+    m_simulation.reset();
+    m_chunkStreamer.reset();
+    m_jobSystem->WaitIdle();
+    for (const auto &[pos, chunk]: m_world.GetChunks()) {
+        if (chunk->IsDirty())
+            m_regionStorage->SaveChunk(*chunk);
+    }
+    m_regionStorage->Flush();
+    spdlog::info("Server: world saved");
+}
+
+void Server::Run(const std::atomic<bool> &stop) {
+    Clock::time_point nextTick = Clock::now();
+    m_statsStart = nextTick;
+    while (!stop.load(std::memory_order_relaxed)) {
+        const Clock::time_point start = Clock::now();
+        Tick();
+        const Clock::time_point end = Clock::now();
+
+        ++m_statsTicks;
+        m_statsTotal += end - start;
+        m_statsMax = std::max(m_statsMax, end - start);
+        if (m_settings.statsInterval.count() > 0 && end - m_statsStart >= m_settings.statsInterval)
+            LogStats();
+
+        // Ticks that overran are not made up for: the world slows down instead of ticking in bursts
+        nextTick += m_tickInterval;
+        if (nextTick < end)
+            nextTick = end;
+        std::this_thread::sleep_until(nextTick);
+    }
+}
+
+void Server::Tick() {
+    ++m_tick;
+    m_chunkStreamer->Update(0.f, 0.f, 0.f, 1.f);
+    m_worldTicker->Tick(m_tick);
+    m_statsChanges += m_worldTicker->GetStats().changes;
+
+    m_changedSections.clear();
+    m_world.TakeChangedSections(m_changedSections);
+
+    if (!m_listener.IsOpen())
+        return;
+    const Clock::time_point start = Clock::now();
+    AcceptPlayers();
+    ReceiveFromPlayers();
+    SendBlockChanges();
+    for (const auto &pPlayer: m_players) {
+        if (pPlayer->joined)
+            SendChunks(*pPlayer);
+    }
+    SendEntities();
+    FlushPlayers();
+    m_statsNetwork += Clock::now() - start;
+}
+
+void Server::LogStats() {
+    const double average = std::chrono::duration<double, std::milli>(m_statsTotal).count() / std::max(1u, m_statsTicks);
+    const double slowest = std::chrono::duration<double, std::milli>(m_statsMax).count();
+    const WorldTicker::Stats &stats = m_worldTicker->GetStats();
+    spdlog::info("Tick {}: {:.2f} ms average, {:.2f} ms max over {} ticks; {} chunks in {} regions, {} block changes",
+                 m_tick, average, slowest, m_statsTicks, stats.chunks, stats.regions, m_statsChanges);
+    const FixedPool::Stats sections = Chunk::GetSectionPoolStats();
+    const ThreadArenaStats arenas = GetThreadArenaStats();
+    spdlog::info("Memory: {} sections live, {} peak; scratch arenas {} KiB peak, {} KiB reserved over {} threads",
+                 sections.live, sections.peak, arenas.peak >> 10, arenas.capacity >> 10, arenas.threads);
+    if (!m_players.empty()) {
+        const double seconds = std::chrono::duration<double>(Clock::now() - m_statsStart).count();
+        const double network = std::chrono::duration<double, std::milli>(m_statsNetwork).count() /
+                               std::max(1u, m_statsTicks);
+        const ChunkPayloadCache::Stats &payloads = m_payloadCache->GetStats();
+        spdlog::info("Network: {} players, {:.1f} KiB/s each, {:.2f} ms per tick; {} chunks sent as stored, {} built",
+                     m_players.size(), static_cast<double>(m_statsBytesSent) / 1024. / seconds / m_players.size(),
+                     network, payloads.stored, payloads.built);
+    }
+
+    m_statsStart = Clock::now();
+    m_statsTicks = 0;
+    m_statsChanges = 0;
+    m_statsTotal = {};
+    m_statsMax = {};
+    m_statsNetwork = {};
+    m_statsBytesSent = 0;
+}
+
+void Server::AcceptPlayers() {
+    for (Socket socket = m_listener.Accept(); socket.IsOpen(); socket = m_listener.Accept()) {
+        auto pPlayer = std::make_unique<Player>(std::move(socket));
+        spdlog::info("Player {} connected", pPlayer->connection.GetPeerName());
+        m_players.push_back(std::move(pPlayer));
+    }
+}
+
+void Server::ReceiveFromPlayers() {
+    for (const auto &pPlayer: m_players) {
+        pPlayer->connection.Receive();
+        PacketType type;
+        PacketReader body;
+        while (pPlayer->connection.NextPacket(type, body))
+            HandlePacket(*pPlayer, type, body);
+    }
+}
+
+void Server::HandlePacket(Player &player, const PacketType type, PacketReader &body) {
+    if (type == PACKET_HELLO && !player.joined) {
+        uint32_t version = 0, viewRadius = 0;
+        if (body.ReadVar(version) && body.ReadVar(viewRadius) && version == PROTOCOL_VERSION) {
+            player.joined = true;
+            player.viewRadius = std::clamp(static_cast<int>(std::min<uint32_t>(viewRadius, 1024)), 1,
+                                           m_settings.loadRadius);
+            PacketWriter writer = player.connection.BeginPacket(PACKET_WELCOME);
+            writer.WriteVarUint(PROTOCOL_VERSION);
+            writer.WriteVarUint(m_settings.tickRate);
+            writer.WriteVarUint(player.viewRadius);
+            player.connection.EndPacket();
+            spdlog::info("Player {} joined, view radius {}", player.connection.GetPeerName(), player.viewRadius);
+            return;
+        }
+        spdlog::warn("Player {} speaks protocol {}, this server {}", player.connection.GetPeerName(), version,
+                     PROTOCOL_VERSION);
+    } else if (type == PACKET_PLAYER_STATE && player.joined) {
+        uint64_t ackedTick = 0;
+        int32_t x = 0, y = 0, z = 0;
+        if (body.ReadVarUint(ackedTick) && body.ReadVar(x) && body.ReadVar(y) && body.ReadVar(z) && body.IsAtEnd() &&
+            ackedTick <= m_entityTick) {
+            player.x = static_cast<float>(x) / POSITION_SCALE;
+            player.y = static_cast<float>(y) / POSITION_SCALE;
+            player.z = static_cast<float>(z) / POSITION_SCALE;
+            player.ackedTick = std::max(player.ackedTick, ackedTick);
+            // Older snapshots can never be a baseline again
+            while (!player.snapshots.empty() && player.snapshots.front().first < player.ackedTick)
+                player.snapshots.pop_front();
+
+            const ChunkPos center = World::ToChunkPos(static_cast<int>(std::floor(player.x)),
+                                                      static_cast<int>(std::floor(player.z)));
+            if (center != player.center) {
+                player.center = center;
+                player.chunksComplete = false;
+                UnloadFarChunks(player);
+            }
+            return;
+        }
+    }
+    spdlog::warn("Player {} sent a malformed or unexpected packet {}, disconnecting", player.connection.GetPeerName(),
+                 static_cast<int>(type));
+    player.connection.Close();
+}
+
+void Server::SendBlockChanges() {
+    m_blockChanges.clear();
+    m_world.TakeBlockChanges(m_blockChanges);
+    // Changes to one chunk end up next to each other, each chunk's in the order they were made
+    std::ranges::stable_sort(m_blockChanges, {}, [](const BlockChange &change) {
+        const ChunkPos pos = World::ToChunkPos(change.x, change.z);
+        return std::pair(pos.x, pos.z);
+    });
+
+    for (size_t begin = 0, end = 0; begin < m_blockChanges.size(); begin = end) {
+        const ChunkPos pos = World::ToChunkPos(m_blockChanges[begin].x, m_blockChanges[begin].z);
+        uint16_t mask = 0;
+        for (end = begin; end < m_blockChanges.size() &&
+                          World::ToChunkPos(m_blockChanges[end].x, m_blockChanges[end].z) == pos; ++end)
+            mask |= static_cast<uint16_t>(1u << (m_blockChanges[end].y >> 4));
+        m_payloadCache->Invalidate(pos);
+
+        // Encoded once for everybody who has the chunk, and only if somebody does
+        PacketType type = PACKET_BLOCK_CHANGES;
+        Connection::SharedData data;
+        std::vector<uint8_t> header;
+        for (const auto &pPlayer: m_players) {
+            if (!pPlayer->chunks.contains(pos))
+                continue;
+            if (!data && end - begin <= m_settings.maxBlockChanges) {
+                auto changes = std::make_shared<std::vector<uint8_t>>();
+                PacketWriter writer(*changes);
+                WriteChunkPos(writer, pos);
+                writer.WriteVarUint(end - begin);
+                for (size_t i = begin; i < end; ++i) {
+                    const BlockChange &change = m_blockChanges[i];
+                    writer.WriteU16(static_cast<uint16_t>(World::ToLocal(change.x) | World::ToLocal(change.z) << 4 |
+                                                          change.y << 8));
+                    writer.WriteU16(change.id);
+                }
+                data = std::move(changes);
+            } else if (!data) {
+                const Chunk *chunk = m_world.GetChunk(pos);
+                if (!chunk)
+                    break;
+                type = PACKET_CHUNK_SECTIONS;
+                PacketWriter writer(header);
+                WriteChunkPos(writer, pos);
+                writer.WriteU16(mask);
+                SerializeSections(*chunk, mask, m_scratch);
+                auto sections = std::make_shared<std::vector<uint8_t>>();
+                CompressChunkPayload(m_scratch.data(), m_scratch.size(), *sections);
+                data = std::move(sections);
+            }
+            pPlayer->connection.SendShared(type, header.data(), header.size(), data);
+        }
+    }
+}
+
+void Server::SendChunks(Player &player) {
+    if (player.chunksComplete)
+        return;
+
+    // Missing chunks do not count: once they load, the ready callback asks for another pass
+    bool complete = true;
+    std::vector<uint8_t> header;
+    for (const ChunkPos offset: m_chunkOrder) {
+        if (GetDistanceSquared(offset, {}) > player.viewRadius * player.viewRadius)
+            break;
+        const ChunkPos pos{player.center.x + offset.x, player.center.z + offset.z};
+        if (player.chunks.contains(pos))
+            continue;
+        const Chunk *chunk = m_world.GetChunk(pos);
+        if (!chunk)
+            continue;
+        if (player.connection.GetQueuedBytes() >= m_settings.maxQueuedBytes) {
+            complete = false;
+            break;
+        }
+        header.clear();
+        PacketWriter writer(header);
+        WriteChunkPos(writer, pos);
+        player.connection.SendShared(PACKET_CHUNK, header.data(), header.size(), m_payloadCache->Get(*chunk));
+        player.chunks.insert(pos);
+    }
+    player.chunksComplete = complete;
+}
+
+void Server::UnloadFarChunks(Player &player) {
+    const int radius = player.viewRadius + CHUNK_HYSTERESIS;
+    for (auto it = player.chunks.begin(); it != player.chunks.end();) {
+        if (GetDistanceSquared(*it, player.center) <= radius * radius) {
+            ++it;
+            continue;
+        }
+        PacketWriter writer = player.connection.BeginPacket(PACKET_UNLOAD_CHUNK);
+        WriteChunkPos(writer, *it);
+        player.connection.EndPacket();
+        it = player.chunks.erase(it);
+    }
+}
+
+void Server::SendEntities() {
+    m_simulation->GetSnapshot(m_snapshot);
+    const uint64_t tick = m_snapshot.current.tick;
+    if (tick == m_entityTick)
+        return;
+    m_entityTick = tick;
+
+    // Quantized once, every player's snapshot is a subset
+    m_entities.clear();
+    for (const EntityInstance &instance: m_snapshot.entities)
+        m_entities.push_back(QuantizeEntity(instance));
+    std::ranges::sort(m_entities, {}, &NetEntity::index);
+
+    const double radius = m_settings.entityRadius * POSITION_SCALE;
+    for (const auto &pPlayer: m_players) {
+        if (!pPlayer->joined)
+            continue;
+        Player &player = *pPlayer;
+        const double x = player.x * POSITION_SCALE, z = player.z * POSITION_SCALE;
+        EntitySnapshot current;
+        for (const NetEntity &entity: m_entities) {
+            const double dx = entity.x - x, dz = entity.z - z;
+            if (dx * dx + dz * dz <= radius * radius)
+                current.push_back(entity);
+        }
+        // More than a packet holds: the nearest ones
+        if (current.size() > MAX_SNAPSHOT_ENTITIES) {
+            const auto distance = [&](const NetEntity &entity) {
+                const double dx = entity.x - x, dz = entity.z - z;
+                return dx * dx + dz * dz;
+            };
+            std::ranges::nth_element(current, current.begin() + MAX_SNAPSHOT_ENTITIES, {}, distance);
+            current.resize(MAX_SNAPSHOT_ENTITIES);
+            std::ranges::sort(current, {}, &NetEntity::index);
+        }
+
+        static const EntitySnapshot EMPTY;
+        const EntitySnapshot *pBaseline = &EMPTY;
+        uint64_t baselineTick = 0;
+        for (const auto &[snapshotTick, snapshot]: player.snapshots) {
+            if (snapshotTick == player.ackedTick) {
+                pBaseline = &snapshot;
+                baselineTick = snapshotTick;
+            }
+        }
+
+        PacketWriter writer = player.connection.BeginPacket(PACKET_ENTITIES);
+        writer.WriteVarUint(tick);
+        writer.WriteVarUint(baselineTick);
+        WriteEntityDelta(writer, *pBaseline, current);
+        player.connection.EndPacket();
+
+        player.snapshots.emplace_back(tick, std::move(current));
+        while (player.snapshots.size() > MAX_SNAPSHOT_HISTORY)
+            player.snapshots.pop_front();
+    }
+}
+
+void Server::FlushPlayers() {
+    for (const auto &pPlayer: m_players) {
+        const uint64_t sent = pPlayer->connection.GetBytesSent();
+        pPlayer->connection.Flush();
+        m_statsBytesSent += pPlayer->connection.GetBytesSent() - sent;
+    }
+    std::erase_if(m_players, [](const std::unique_ptr<Player> &pPlayer) {
+        if (pPlayer->connection.IsOpen())
+            return false;
+        spdlog::info("Player {} left", pPlayer->connection.GetPeerName());
+        return true;
+    });
+}
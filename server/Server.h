@@ -0,0 +1,132 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <string>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include "core/JobSystem.h"
+#include "core/Socket.h"
+#include "net/Connection.h"
+#include "net/EntitySnapshot.h"
+#include "server/ChunkPayloadCache.h"
+#include "world/ChunkStreamer.h"
+#include "world/RegionStorage.h"
+#include "world/Simulation.h"
+#include "world/World.h"
+#include "world/WorldTicker.h"
+
+// Headless game server: keeps the area around spawn loaded and ticks it at a fixed rate.
+// The world is owned by the thread calling Run(); chunk ticks are spread over the job system by WorldTicker,
+// entities are stepped by the Simulation on its own thread.
+//
+// Players connect over TCP (see net/Protocol.h). Every tick each one gets, in one batch: the block changes of
+// chunks it has, loaded chunks around it nearest first while its connection keeps up, and the entities near it
+// as a delta against the last snapshot it acknowledged. Per tick, entities are quantized once and chunk changes
+// encoded once for all players; chunk payloads are shared and, for unchanged chunks, read as stored.
+class Server {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    struct Settings {
+        std::string worldDirectory = "saves/world";
+        int32_t seed = 1337;
+        // In chunks around spawn
+        int loadRadius = 16;
+        uint32_t tickRate = 20;
+        // 0 means one per hardware thread, minus the tick thread
+        unsigned threadCount = 0;
+        // Tick statistics are logged this often, 0 disables them
+        std::chrono::seconds statsInterval{10};
+
+        // 0 disables networking
+        uint16_t port = DEFAULT_PORT;
+        // Entities farther from a player are not sent to it, in blocks
+        float entityRadius = 96.f;
+        // Chunks are held back while this much is queued for a player, in bytes
+        size_t maxQueuedBytes = 1 << 20;
+        // Chunks changed by more block changes are resent section by section
+        uint32_t maxBlockChanges = 256;
+    };
+
+    explicit Server(const Settings &settings);
+    // Saves every changed chunk
+    ~Server();
+
+    Server(const Server &) = delete;
+    Server &operator=(const Server &) = delete;
+
+    // Ticks until stop is set
+    void Run(const std::atomic<bool> &stop);
+
+private:
+    struct Player {
+        explicit Player(Socket socket) : connection(std::move(socket)) {}
+
+        Connection connection;
+        bool joined = false;
+        int viewRadius = 0;
+        float x = 0.f, y = 0.f, z = 0.f;
+        // Chunks it was sent and not told to unload
+        std::unordered_set<ChunkPos, ChunkPosHash> chunks;
+        // Nothing within its view radius is left to send, until it moves to another chunk or chunks load
+        bool chunksComplete = false;
+        ChunkPos center;
+        // Entity snapshots sent since the one acknowledged, oldest first; any of them may become the baseline
+        std::deque<std::pair<uint64_t, EntitySnapshot>> snapshots;
+        uint64_t ackedTick = 0;
+    };
+
+    void Tick();
+    void LogStats();
+
+    void AcceptPlayers();
+    void ReceiveFromPlayers();
+    void HandlePacket(Player &player, PacketType type, PacketReader &body);
+    void SendBlockChanges();
+    void SendChunks(Player &player);
+    void UnloadFarChunks(Player &player);
+    void SendEntities();
+    void FlushPlayers();
+
+    Settings m_settings;
+    Clock::duration m_tickInterval;
+    uint64_t m_tick = 0;
+
+    World m_world;
+    std::unique_ptr<JobSystem> m_jobSystem;
+    std::unique_ptr<RegionStorage> m_regionStorage;
+    std::unique_ptr<ChunkStreamer> m_chunkStreamer;
+    std::unique_ptr<WorldTicker> m_worldTicker;
+    std::unique_ptr<Simulation> m_simulation;
+
+    // Players learn about changes block by block, the section set is only drained
+    std::vector<SectionPos> m_changedSections;
+    std::vector<BlockChange> m_blockChanges;
+
+    Socket m_listener;
+    std::vector<std::unique_ptr<Player>> m_players;
+    std::unique_ptr<ChunkPayloadCache> m_payloadCache;
+    // Chunk offsets within the load radius, nearest first
+    std::vector<ChunkPos> m_chunkOrder;
+    Simulation::Snapshot m_snapshot;
+    // Every entity of the newest snapshot, quantized
+    EntitySnapshot m_entities;
+    uint64_t m_entityTick = 0;
+    std::vector<uint8_t> m_scratch;
+
+    // Since the last LogStats()
+    Clock::time_point m_statsStart;
+    uint32_t m_statsTicks = 0;
+    uint32_t m_statsChanges = 0;
+    Clock::duration m_statsTotal{};
+    Clock::duration m_statsMax{};
+    // Spent encoding and sending to players
+    Clock::duration m_statsNetwork{};
+    uint64_t m_statsBytesSent = 0;
+};
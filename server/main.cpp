@@ -0,0 +1,52 @@
+#include <algorithm>
+#include <atomic>
+#include <csignal>
+#include <cstdlib>
+#include <string>
+#include <string_view>
+
+#include <spdlog/spdlog.h>
+
+#include "server/Server.h"
+
+namespace {
+    std::atomic<bool> g_stop{false};
+
+    void OnSignal(int) {
+        g_stop.store(true, std::memory_order_relaxed);
+    }
+
+    void PrintUsage() {
+        spdlog::info("Usage: PlusCraftServer [--world <directory>] [--seed <n>] [--radius <chunks>] [--threads <n>] "
+                     "[--port <n>, 0 for none]");
+    }
+}
+
+int main(int argc, char **argv) {
+    Server::Settings settings;
+    for (int i = 1; i < argc; ++i) {
+        const std::string_view arg = argv[i];
+        const bool hasValue = i + 1 < argc;
+        if (arg == "--world" && hasValue)
+            settings.worldDirectory = argv[++i];
+        else if (arg == "--seed" && hasValue)
+            settings.seed = static_cast<int32_t>(std::strtol(argv[++i], nullptr, 10));
+        else if (arg == "--radius" && hasValue)
+            settings.loadRadius = std::max(1, std::atoi(argv[++i]));
+        else if (arg == "--threads" && hasValue)
+            settings.threadCount = static_cast<unsigned>(std::max(0, std::atoi(argv[++i])));
+        else if (arg == "--port" && hasValue)
+            settings.port = static_cast<uint16_t>(std::clamp(std::atoi(argv[++i]), 0, 65535));
+        else {
+            PrintUsage();
+            return arg == "--help" ? 0 : -1;
+        }
+    }
+
+    std::signal(SIGINT, OnSignal);
+    std::signal(SIGTERM, OnSignal);
+
+    Server server(settings);
+    server.Run(g_stop);
+    return 0;
+}
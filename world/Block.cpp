@@ -0,0 +1,57 @@
+#include "world/Block.h"
+
+#if defined(__aarch64__) || defined(_M_ARM64)
+#include <arm_neon.h>
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#endif
+
+// Whole steps of 16 only, returns how many blocks it did
+using BlockOpacityKernel = int (*)(const BlockId *blocks, int count, uint8_t *out);
+
+// Defined in BlockSSSE3.cpp, null when compiled out
+BlockOpacityKernel GetBlockOpacityKernelSSSE3();
+
+namespace {
+#if defined(__aarch64__) || defined(_M_ARM64)
+    // NEON is mandatory on AArch64, and its table lookup gives 0 for indices past the table by itself
+    int GetBlockOpacityNEON(const BlockId *blocks, const int count, uint8_t *out) {
+        int i = 0;
+        for (; i + 16 <= count; i += 16) {
+            uint8x16_t ids = vcombine_u8(vqmovn_u16(vld1q_u16(blocks + i)), vqmovn_u16(vld1q_u16(blocks + i + 8)));
+            uint8x16_t result = vdupq_n_u8(0);
+            for (int page = 0; page < BlockTables::SIZE; page += 16) {
+                result = vorrq_u8(result, vqtbl1q_u8(vld1q_u8(BLOCK_TABLES.opaque + page), ids));
+                ids = vsubq_u8(ids, vdupq_n_u8(16));
+            }
+            vst1q_u8(out + i, result);
+        }
+        return i;
+    }
+#endif
+
+    BlockOpacityKernel DetectKernel() {
+#if defined(__aarch64__) || defined(_M_ARM64)
+        return &GetBlockOpacityNEON;
+#elif defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#    if defined(_MSC_VER)
+        int info[4];
+        __cpuid(info, 1);
+        const bool ssse3 = (info[2] & (1 << 9)) != 0;
+#    else
+        __builtin_cpu_init();
+        const bool ssse3 = __builtin_cpu_supports("ssse3");
+#    endif
+        return ssse3 ? GetBlockOpacityKernelSSSE3() : nullptr;
+#else
+        return nullptr;
+#endif
+    }
+}
+
+void GetBlockOpacity(const BlockId *blocks, const int count, uint8_t *out) {
+    static const BlockOpacityKernel kernel = DetectKernel();
+    int i = kernel ? kernel(blocks, count, out) : 0;
+    for (; i < count; ++i)
+        out[i] = BLOCK_TABLES.opaque[blocks[i]];
+}
@@ -0,0 +1,156 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+using BlockId = uint16_t;
+
+enum BlockType : BlockId {
+    BLOCK_AIR = 0,
+    BLOCK_STONE,
+    BLOCK_DIRT,
+    BLOCK_GRASS,
+    BLOCK_SAND,
+    BLOCK_GRAVEL,
+    BLOCK_WATER,
+    BLOCK_LOG,
+    BLOCK_LEAVES,
+    BLOCK_BEDROCK,
+    BLOCK_GLOWSTONE,
+    BLOCK_COUNT
+};
+
+inline bool IsAir(const BlockId id) {
+    return id == BLOCK_AIR;
+}
+
+// Ids from region files and the network are checked with this before they reach the world,
+// every property lookup below assumes a valid id
+inline bool IsValidBlock(const BlockId id) {
+    return id < BLOCK_COUNT;
+}
+
+// Texture array layers
+enum BlockTexture : uint16_t {
+    TEXTURE_STONE = 0,
+    TEXTURE_DIRT,
+    TEXTURE_GRASS_TOP,
+    TEXTURE_GRASS_SIDE,
+    TEXTURE_SAND,
+    TEXTURE_GRAVEL,
+    TEXTURE_WATER,
+    TEXTURE_LOG_SIDE,
+    TEXTURE_LOG_TOP,
+    TEXTURE_LEAVES,
+    TEXTURE_BEDROCK,
+    TEXTURE_GLOWSTONE,
+    TEXTURE_COUNT
+};
+
+struct BlockDefinition {
+    BlockId id;
+    // Opaque blocks hide the faces of their neighbours
+    bool opaque;
+    // Solid blocks stop entities and picking rays
+    bool solid;
+    // Light levels lost passing through the block, on top of the one lost per block travelled; opaque blocks stop light
+    uint8_t lightOpacity;
+    // Block light level the block gives off
+    uint8_t lightEmission;
+    // Faces: 0 +X, 1 -X, 2 +Y, 3 -Y, 4 +Z, 5 -Z
+    std::array<uint16_t, 6> textures;
+
+    static constexpr std::array<uint16_t, 6> AllFaces(const uint16_t layer) {
+        return {layer, layer, layer, layer, layer, layer};
+    }
+
+    static constexpr std::array<uint16_t, 6> Column(const uint16_t side, const uint16_t top, const uint16_t bottom) {
+        return {side, side, top, bottom, side, side};
+    }
+};
+
+// One entry per block, in id order
+constexpr BlockDefinition BLOCK_DEFINITIONS[] = {
+    {BLOCK_AIR, false, false, 0, 0, BlockDefinition::AllFaces(TEXTURE_STONE)},
+    {BLOCK_STONE, true, true, 15, 0, BlockDefinition::AllFaces(TEXTURE_STONE)},
+    {BLOCK_DIRT, true, true, 15, 0, BlockDefinition::AllFaces(TEXTURE_DIRT)},
+    {BLOCK_GRASS, true, true, 15, 0, BlockDefinition::Column(TEXTURE_GRASS_SIDE, TEXTURE_GRASS_TOP, TEXTURE_DIRT)},
+    {BLOCK_SAND, true, true, 15, 0, BlockDefinition::AllFaces(TEXTURE_SAND)},
+    {BLOCK_GRAVEL, true, true, 15, 0, BlockDefinition::AllFaces(TEXTURE_GRAVEL)},
+    {BLOCK_WATER, false, false, 2, 0, BlockDefinition::AllFaces(TEXTURE_WATER)},
+    {BLOCK_LOG, true, true, 15, 0, BlockDefinition::Column(TEXTURE_LOG_SIDE, TEXTURE_LOG_TOP, TEXTURE_LOG_TOP)},
+    {BLOCK_LEAVES, false, true, 1, 0, BlockDefinition::AllFaces(TEXTURE_LEAVES)},
+    {BLOCK_BEDROCK, true, true, 15, 0, BlockDefinition::AllFaces(TEXTURE_BEDROCK)},
+    {BLOCK_GLOWSTONE, true, true, 15, 15, BlockDefinition::AllFaces(TEXTURE_GLOWSTONE)},
+};
+
+// Properties as flat arrays indexed by block id, built from BLOCK_DEFINITIONS at compile time so hot loops do
+// plain loads. Padded to a multiple of 16 with air-like entries: opacity is stored as 0xFF/0 bytes in pages of
+// 16, one byte shuffle looks up 16 blocks at once (see GetBlockOpacity).
+struct BlockTables {
+    static constexpr int SIZE = (BLOCK_COUNT + 15) / 16 * 16;
+
+    alignas(16) uint8_t opaque[SIZE];
+    bool solid[SIZE];
+    uint8_t lightOpacity[SIZE];
+    uint8_t lightEmission[SIZE];
+    uint16_t textures[SIZE][6];
+};
+
+constexpr BlockTables MakeBlockTables() {
+    BlockTables tables{};
+    for (const BlockDefinition &definition: BLOCK_DEFINITIONS) {
+        tables.opaque[definition.id] = definition.opaque ? 0xFF : 0;
+        tables.solid[definition.id] = definition.solid;
+        tables.lightOpacity[definition.id] = definition.lightOpacity;
+        tables.lightEmission[definition.id] = definition.lightEmission;
+        for (int face = 0; face < 6; ++face)
+            tables.textures[definition.id][face] = definition.textures[face];
+    }
+    return tables;
+}
+
+constexpr bool AreBlockDefinitionsValid() {
+    if (std::size(BLOCK_DEFINITIONS) != BLOCK_COUNT)
+        return false;
+    for (int id = 0; id < BLOCK_COUNT; ++id) {
+        const BlockDefinition &definition = BLOCK_DEFINITIONS[id];
+        if (definition.id != id || definition.lightOpacity > 15 || definition.lightEmission > 15)
+            return false;
+        // Opaque blocks must stop light, or light would leak through faces the mesher culled
+        if (definition.opaque && definition.lightOpacity != 15)
+            return false;
+        for (const uint16_t layer: definition.textures)
+            if (layer >= TEXTURE_COUNT)
+                return false;
+    }
+    return true;
+}
+static_assert(AreBlockDefinitionsValid(), "BLOCK_DEFINITIONS must list every block once, in id order");
+// The byte shuffle lookup packs ids into bytes
+static_assert(BlockTables::SIZE < 256);
+
+inline constexpr BlockTables BLOCK_TABLES = MakeBlockTables();
+
+inline uint16_t GetBlockTexture(const BlockId id, const int face) {
+    return BLOCK_TABLES.textures[id][face];
+}
+
+inline bool IsOpaque(const BlockId id) {
+    return BLOCK_TABLES.opaque[id] != 0;
+}
+
+inline bool IsSolid(const BlockId id) {
+    return BLOCK_TABLES.solid[id];
+}
+
+inline uint8_t GetLightOpacity(const BlockId id) {
+    return BLOCK_TABLES.lightOpacity[id];
+}
+
+inline uint8_t GetLightEmission(const BlockId id) {
+    return BLOCK_TABLES.lightEmission[id];
+}
+
+// out[i] = 0xFF when blocks[i] is opaque, 0 otherwise. 16 blocks per step with SSSE3 (when the CPU has it) or NEON
+void GetBlockOpacity(const BlockId *blocks, int count, uint8_t *out);
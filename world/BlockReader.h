@@ -0,0 +1,39 @@
+#pragma once
+
+#include "world/World.h"
+
+// Reads blocks one at a time while walking a small neighbourhood, e.g. for raycasts and collision.
+// The chunk of the last read is kept: moving within it costs a palette read, only stepping into another chunk
+// looks the map up again. The world must not add or remove chunks meanwhile.
+class BlockReader {
+public:
+    explicit BlockReader(const World &world) : m_world(world) {}
+
+    // Air outside the world and in chunks that are not loaded
+    BlockId Get(const int x, const int y, const int z) {
+        if (y < 0 || y >= Chunk::HEIGHT)
+            return BLOCK_AIR;
+        const Chunk *chunk = Find(World::ToChunkPos(x, z));
+        if (!chunk)
+            return BLOCK_AIR;
+        const ChunkSection *section = chunk->GetSection(y / ChunkSection::SIZE);
+        if (!section)
+            return BLOCK_AIR;
+        return section->GetBlock(World::ToLocal(x), y % ChunkSection::SIZE, World::ToLocal(z));
+    }
+
+private:
+    const Chunk *Find(const ChunkPos pos) {
+        if (!m_cached || pos != m_cachedPos) {
+            m_pCached = m_world.GetChunk(pos);
+            m_cachedPos = pos;
+            m_cached = true;
+        }
+        return m_pCached;
+    }
+
+    const World &m_world;
+    bool m_cached = false;
+    ChunkPos m_cachedPos;
+    const Chunk *m_pCached = nullptr;
+};
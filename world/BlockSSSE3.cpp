@@ -0,0 +1,46 @@
+#include "world/Block.h"
+
+using BlockOpacityKernel = int (*)(const BlockId *blocks, int count, uint8_t *out);
+
+// Compiled with SSSE3 enabled, only called after the CPU check in Block.cpp
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+
+#include <tmmintrin.h>
+
+namespace {
+    int GetBlockOpacitySSSE3(const BlockId *blocks, const int count, uint8_t *out) {
+        const __m128i pageSize = _mm_set1_epi8(16);
+        const __m128i maxIndex = _mm_set1_epi8(15);
+        const __m128i highBit = _mm_set1_epi8(static_cast<char>(0x80));
+        int i = 0;
+        for (; i + 16 <= count; i += 16) {
+            const __m128i lo = _mm_loadu_si128(reinterpret_cast<const __m128i *>(blocks + i));
+            const __m128i hi = _mm_loadu_si128(reinterpret_cast<const __m128i *>(blocks + i + 8));
+            __m128i ids = _mm_packus_epi16(lo, hi);
+
+            __m128i result = _mm_setzero_si128();
+            for (int page = 0; page < BlockTables::SIZE; page += 16) {
+                const __m128i table = _mm_load_si128(reinterpret_cast<const __m128i *>(BLOCK_TABLES.opaque + page));
+                // The shuffle gives 0 where the index has its high bit set, which is how ids outside the page drop out
+                const __m128i inside = _mm_cmpeq_epi8(_mm_min_epu8(ids, maxIndex), ids);
+                const __m128i index = _mm_or_si128(ids, _mm_andnot_si128(inside, highBit));
+                result = _mm_or_si128(result, _mm_shuffle_epi8(table, index));
+                ids = _mm_sub_epi8(ids, pageSize);
+            }
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(out + i), result);
+        }
+        return i;
+    }
+}
+
+BlockOpacityKernel GetBlockOpacityKernelSSSE3() {
+    return &GetBlockOpacitySSSE3;
+}
+
+#else
+
+BlockOpacityKernel GetBlockOpacityKernelSSSE3() {
+    return nullptr;
+}
+
+#endif
@@ -0,0 +1,88 @@
+#include "world/Chunk.h"
+
+namespace {
+    // Never destroyed, chunks of static worlds are freed after function-local statics
+    ObjectPool<ChunkSection> &GetSectionPool() {
+        static auto *pPool = new ObjectPool<ChunkSection>("Chunk sections", 1024);
+        return *pPool;
+    }
+}
+
+void Chunk::SectionDeleter::operator()(ChunkSection *pSection) const {
+    GetSectionPool().Destroy(pSection);
+}
+
+Chunk::Chunk(const ChunkPos pos) : m_pos(pos) {
+    for (auto &light: m_light)
+        light[LIGHT_SKY].Fill(MAX_LIGHT);
+}
+
+BlockId Chunk::GetBlock(const int x, const int y, const int z) const {
+    if (y < 0 || y >= HEIGHT)
+        return BLOCK_AIR;
+    const auto &section = m_sections[y / ChunkSection::SIZE];
+    if (!section)
+        return BLOCK_AIR;
+    return section->GetBlock(x, y % ChunkSection::SIZE, z);
+}
+
+void Chunk::SetBlock(const int x, const int y, const int z, const BlockId id) {
+    if (y < 0 || y >= HEIGHT)
+        return;
+    const int sy = y / ChunkSection::SIZE;
+    if (!m_sections[sy] && IsAir(id))
+        return;
+    GetOrCreateSection(sy).SetBlock(x, y % ChunkSection::SIZE, z, id);
+    m_dirty = true;
+}
+
+uint8_t Chunk::GetLight(const LightChannel channel, const int x, const int y, const int z) const {
+    if (y < 0)
+        return 0;
+    if (y >= HEIGHT)
+        return channel == LIGHT_SKY ? MAX_LIGHT : 0;
+    return m_light[y / ChunkSection::SIZE][channel].Get(x, y % ChunkSection::SIZE, z);
+}
+
+bool Chunk::SetLight(const LightChannel channel, const int x, const int y, const int z, const uint8_t level) {
+    if (y < 0 || y >= HEIGHT)
+        return false;
+    return m_light[y / ChunkSection::SIZE][channel].Set(x, y % ChunkSection::SIZE, z, level);
+}
+
+ChunkSection &Chunk::GetOrCreateSection(const int sy) {
+    auto &section = m_sections[sy];
+    if (!section)
+        section.reset(GetSectionPool().Create());
+    return *section;
+}
+
+void Chunk::FreeEmptySections() {
+    for (auto &section: m_sections)
+        if (section && section->IsEmpty())
+            section.reset();
+}
+
+void Chunk::Compact() {
+    for (auto &section: m_sections) {
+        if (!section)
+            continue;
+        if (section->IsEmpty())
+            section.reset();
+        else
+            section->Compact();
+    }
+}
+
+FixedPool::Stats Chunk::GetSectionPoolStats() {
+    return GetSectionPool().GetStats();
+}
+
+size_t Chunk::GetMemoryUsage() const {
+    size_t usage = sizeof(*this);
+    for (const auto &section: m_sections)
+        usage += section ? section->GetMemoryUsage() : 0;
+    for (const auto &light: m_light)
+        usage += light[LIGHT_SKY].GetMemoryUsage() + light[LIGHT_BLOCK].GetMemoryUsage();
+    return usage;
+}
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+#include "core/ObjectPool.h"
+#include "world/ChunkSection.h"
+#include "world/LightArray.h"
+
+struct ChunkPos {
+    int32_t x = 0, z = 0;
+
+    bool operator==(const ChunkPos &) const = default;
+};
+
+struct ChunkPosHash {
+    size_t operator()(const ChunkPos &pos) const noexcept {
+        // Pack both coordinates and scramble, neighbouring chunks must not collide into the same buckets
+        uint64_t key = (static_cast<uint64_t>(static_cast<uint32_t>(pos.x)) << 32) | static_cast<uint32_t>(pos.z);
+        key ^= key >> 33;
+        key *= 0xff51afd7ed558ccdull;
+        key ^= key >> 33;
+        return static_cast<size_t>(key);
+    }
+};
+
+// Section coordinates: chunk x and z plus the section index y
+struct SectionPos {
+    int32_t x = 0, y = 0, z = 0;
+
+    bool operator==(const SectionPos &) const = default;
+};
+
+struct SectionPosHash {
+    size_t operator()(const SectionPos &pos) const noexcept {
+        return ChunkPosHash{}({pos.x, pos.z}) ^ (static_cast<size_t>(pos.y) * 0x9e3779b97f4a7c15ull);
+    }
+};
+
+// Column of SECTION_COUNT sections. Fully empty sections are not allocated,
+// the others come from a pool shared by every chunk, as sections are created and freed all session long.
+// Every section also has its sky and block light, kept up to date by LightEngine; a new chunk is fully sky lit.
+class Chunk {
+public:
+    static constexpr int SIZE = ChunkSection::SIZE;
+    static constexpr int SECTION_COUNT = 16;
+    static constexpr int HEIGHT = SECTION_COUNT * ChunkSection::SIZE;
+
+    explicit Chunk(ChunkPos pos);
+
+    ChunkPos GetPos() const { return m_pos; }
+
+    // Local coordinates, x/z in [0, SIZE), y in [0, HEIGHT)
+    BlockId GetBlock(int x, int y, int z) const;
+    void SetBlock(int x, int y, int z, BlockId id);
+
+    ChunkSection *GetSection(const int sy) { return m_sections[sy].get(); }
+    const ChunkSection *GetSection(const int sy) const { return m_sections[sy].get(); }
+    ChunkSection &GetOrCreateSection(int sy);
+
+    // Local coordinates like GetBlock. Above the chunk the sky is fully lit, below it everything is dark
+    uint8_t GetLight(LightChannel channel, int x, int y, int z) const;
+    // Returns whether the level changed, never does outside the chunk
+    bool SetLight(LightChannel channel, int x, int y, int z, uint8_t level);
+    LightArray &GetLight(const LightChannel channel, const int sy) { return m_light[sy][channel]; }
+    const LightArray &GetLight(const LightChannel channel, const int sy) const { return m_light[sy][channel]; }
+
+    // Whether the blocks differ from what was last saved or loaded; new chunks start dirty.
+    // SetBlock marks the chunk, edits made through its sections must do so themselves
+    bool IsDirty() const { return m_dirty; }
+    void SetDirty(const bool dirty) { m_dirty = dirty; }
+
+    // Frees empty sections and compacts palettes, call after bulk edits
+    void Compact();
+    // Frees empty sections only, for sections that are already packed (loaded ones)
+    void FreeEmptySections();
+
+    size_t GetMemoryUsage() const;
+
+    static FixedPool::Stats GetSectionPoolStats();
+
+private:
+    struct SectionDeleter {
+        void operator()(ChunkSection *pSection) const;
+    };
+
+    ChunkPos m_pos;
+    std::array<std::unique_ptr<ChunkSection, SectionDeleter>, SECTION_COUNT> m_sections;
+    std::array<std::array<LightArray, LIGHT_CHANNEL_COUNT>, SECTION_COUNT> m_light;
+    bool m_dirty = true;
+};
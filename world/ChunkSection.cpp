@@ -0,0 +1,244 @@
+#include "world/ChunkSection.h"
+
+#include <algorithm>
+#include <array>
+
+#include "core/ObjectPool.h"
+
+namespace {
+    // Never destroyed, sections of static worlds are freed after function-local statics.
+    // Classes up to the direct mode words, 8 KiB
+    std::pmr::memory_resource *GetSectionStorage() {
+        static auto *pPool = new SizeClassPool("Section storage", ChunkSection::VOLUME * sizeof(BlockId), 64 << 10);
+        return pPool;
+    }
+
+    uint8_t BitsForPaletteSize(const size_t size) {
+        if (size <= 1) return 0;
+        if (size <= 2) return 1;
+        if (size <= 4) return 2;
+        if (size <= 16) return 4;
+        if (size <= 256) return 8;
+        return ChunkSection::DIRECT_BITS;
+    }
+
+    constexpr bool IsValidBits(const uint8_t bits) {
+        return bits == 0 || bits == 1 || bits == 2 || bits == 4 || bits == 8 || bits == ChunkSection::DIRECT_BITS;
+    }
+}
+
+ChunkSection::ChunkSection(const BlockId fill) : m_palette(GetSectionStorage()), m_data(GetSectionStorage()) {
+    Fill(fill);
+}
+
+ChunkSection::ChunkSection(const ChunkSection &other)
+    : m_palette(other.m_palette, GetSectionStorage()), m_data(other.m_data, GetSectionStorage()),
+      m_bits(other.m_bits), m_nonAirCount(other.m_nonAirCount) {}
+
+size_t ChunkSection::WordCount(const uint8_t bits) {
+    // Widths over 64 come from corrupt data only, Load() rejects them
+    return bits == 0 || bits > 64 ? 0 : VOLUME / (64 / bits);
+}
+
+uint32_t ChunkSection::GetEntry(const int index) const {
+    // bits is a power of two, so the divisions below compile to shifts
+    const uint32_t perWord = 64 / m_bits;
+    const uint64_t word = m_data[index / perWord];
+    const uint32_t shift = (index % perWord) * m_bits;
+    return static_cast<uint32_t>((word >> shift) & ((1ull << m_bits) - 1));
+}
+
+void ChunkSection::SetEntry(const int index, const uint32_t value) {
+    const uint32_t perWord = 64 / m_bits;
+    uint64_t &word = m_data[index / perWord];
+    const uint32_t shift = (index % perWord) * m_bits;
+    const uint64_t mask = ((1ull << m_bits) - 1) << shift;
+    word = (word & ~mask) | ((static_cast<uint64_t>(value) << shift) & mask);
+}
+
+BlockId ChunkSection::GetBlock(const int index) const {
+    if (m_bits == 0)
+        return m_palette[0];
+    const uint32_t entry = GetEntry(index);
+    return m_bits == DIRECT_BITS ? static_cast<BlockId>(entry) : m_palette[entry];
+}
+
+void ChunkSection::SetBlock(const int index, const BlockId id) {
+    const BlockId old = GetBlock(index);
+    if (old == id)
+        return;
+
+    if (IsAir(old)) ++m_nonAirCount;
+    else if (IsAir(id)) --m_nonAirCount;
+
+    const uint32_t entry = FindOrAddPalette(id);
+    SetEntry(index, entry);
+}
+
+uint32_t ChunkSection::FindOrAddPalette(const BlockId id) {
+    if (m_bits == DIRECT_BITS)
+        return id;
+
+    const auto it = std::find(m_palette.begin(), m_palette.end(), id);
+    if (it != m_palette.end())
+        return static_cast<uint32_t>(it - m_palette.begin());
+
+    m_palette.push_back(id);
+    if (m_palette.size() > (1u << m_bits)) {
+        Repack(BitsForPaletteSize(m_palette.size()));
+        if (m_bits == DIRECT_BITS)
+            return id;
+    }
+    return static_cast<uint32_t>(m_palette.size() - 1);
+}
+
+void ChunkSection::Repack(const uint8_t bits) {
+    // Palette indices stay valid when only the width grows, so entries are copied without a palette lookup
+    std::array<uint32_t, VOLUME> entries;
+    if (m_bits == 0) {
+        entries.fill(0);
+    } else {
+        for (int i = 0; i < VOLUME; ++i)
+            entries[i] = GetEntry(i);
+    }
+
+    const bool toDirect = bits == DIRECT_BITS && m_bits != DIRECT_BITS;
+    if (toDirect) {
+        for (auto &entry: entries)
+            entry = m_palette[entry];
+        m_palette.clear();
+        m_palette.shrink_to_fit();
+    }
+
+    m_bits = bits;
+    m_data.assign(WordCount(bits), 0);
+    m_data.shrink_to_fit();
+    if (bits == 0)
+        return;
+    for (int i = 0; i < VOLUME; ++i)
+        SetEntry(i, entries[i]);
+}
+
+void ChunkSection::Fill(const BlockId id) {
+    m_bits = 0;
+    m_palette.assign(1, id);
+    m_data.clear();
+    m_data.shrink_to_fit();
+    m_nonAirCount = IsAir(id) ? 0 : VOLUME;
+}
+
+void ChunkSection::Assign(const BlockId *blocks) {
+    std::array<BlockId, VOLUME> sorted;
+    std::copy_n(blocks, VOLUME, sorted.begin());
+    std::sort(sorted.begin(), sorted.end());
+    const auto last = std::unique(sorted.begin(), sorted.end());
+    const size_t uniqueCount = last - sorted.begin();
+
+    if (uniqueCount == 1) {
+        Fill(sorted[0]);
+        return;
+    }
+
+    m_bits = BitsForPaletteSize(uniqueCount);
+    m_data.assign(WordCount(m_bits), 0);
+    m_data.shrink_to_fit();
+    if (m_bits == DIRECT_BITS) {
+        m_palette.clear();
+        for (int i = 0; i < VOLUME; ++i)
+            SetEntry(i, blocks[i]);
+    } else {
+        m_palette.assign(sorted.begin(), last);
+        // Generated terrain is mostly long runs of one block, so remember the last lookup
+        BlockId lastId = m_palette[0];
+        uint32_t lastEntry = 0;
+        for (int i = 0; i < VOLUME; ++i) {
+            if (blocks[i] != lastId) {
+                lastId = blocks[i];
+                lastEntry = static_cast<uint32_t>(
+                    std::lower_bound(m_palette.begin(), m_palette.end(), lastId) - m_palette.begin());
+            }
+            SetEntry(i, lastEntry);
+        }
+    }
+    CountNonAir();
+}
+
+void ChunkSection::Decode(BlockId *out) const {
+    if (m_bits == 0) {
+        std::fill_n(out, VOLUME, m_palette[0]);
+        return;
+    }
+
+    const uint32_t perWord = 64 / m_bits;
+    const uint64_t mask = (1ull << m_bits) - 1;
+    int index = 0;
+    for (const uint64_t word: m_data) {
+        for (uint32_t i = 0; i < perWord; ++i, ++index) {
+            const auto entry = static_cast<uint32_t>((word >> (i * m_bits)) & mask);
+            out[index] = m_bits == DIRECT_BITS ? static_cast<BlockId>(entry) : m_palette[entry];
+        }
+    }
+}
+
+void ChunkSection::Compact() {
+    if (m_bits == 0)
+        return;
+    std::array<BlockId, VOLUME> blocks;
+    Decode(blocks.data());
+    Assign(blocks.data());
+}
+
+void ChunkSection::CountNonAir() {
+    if (m_bits == 0) {
+        m_nonAirCount = IsAir(m_palette[0]) ? 0 : VOLUME;
+        return;
+    }
+    uint32_t count = 0;
+    for (int i = 0; i < VOLUME; ++i)
+        count += IsAir(GetBlock(i)) ? 0 : 1;
+    m_nonAirCount = static_cast<uint16_t>(count);
+}
+
+bool ChunkSection::Load(const uint8_t bits, const std::vector<BlockId> &palette, const std::vector<uint64_t> &data) {
+    if (!IsValidBits(bits) || data.size() != WordCount(bits))
+        return false;
+    if (bits != DIRECT_BITS && (palette.empty() || palette.size() > (1u << bits)))
+        return false;
+    if (bits == DIRECT_BITS && !palette.empty())
+        return false;
+
+    // Block properties are looked up by id without bounds checks, unknown ids must not get into the world
+    for (const BlockId id: palette)
+        if (!IsValidBlock(id))
+            return false;
+
+    // One pass over the packed words checks every entry and counts the blocks, nothing is unpacked or re-encoded
+    uint32_t nonAirCount = 0;
+    if (bits == 0) {
+        nonAirCount = IsAir(palette[0]) ? 0 : VOLUME;
+    } else {
+        const uint32_t perWord = 64 / bits;
+        const uint64_t mask = (1ull << bits) - 1;
+        for (const uint64_t word: data) {
+            for (uint32_t i = 0; i < perWord; ++i) {
+                const auto entry = static_cast<uint32_t>((word >> (i * bits)) & mask);
+                BlockId id = static_cast<BlockId>(entry);
+                if (bits != DIRECT_BITS)
+                    id = entry < palette.size() ? palette[entry] : static_cast<BlockId>(BLOCK_COUNT);
+                if (!IsValidBlock(id))
+                    return false;
+                nonAirCount += IsAir(id) ? 0 : 1;
+            }
+        }
+    }
+
+    m_bits = bits;
+    m_palette.assign(palette.begin(), palette.end());
+    m_data.assign(data.begin(), data.end());
+    m_nonAirCount = static_cast<uint16_t>(nonAirCount);
+    return true;
+}
+
+size_t ChunkSection::GetMemoryUsage() const {
+    return sizeof(*this) + m_palette.capacity() * sizeof(BlockId) + m_data.capacity() * sizeof(uint64_t);
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+#include <vector>
+
+#include "world/Block.h"
+
+// 16x16x16 cube of blocks.
+// Blocks are stored as palette indices bit-packed into 64-bit words (entries never straddle a word),
+// so a section made of a handful of block types takes a few hundred bytes instead of 8 KiB.
+// Once the palette outgrows 8 bits the section switches to direct mode and stores block IDs as is.
+// Flat index layout is y-major: index = (y * 16 + z) * 16 + x, so one row along X is contiguous.
+// The palette and words come from a shared pool of size classes instead of the general heap, sections are
+// created, repacked and freed all the time while chunks stream.
+class ChunkSection {
+public:
+    static constexpr int SIZE = 16;
+    static constexpr int AREA = SIZE * SIZE;
+    static constexpr int VOLUME = SIZE * SIZE * SIZE;
+    static constexpr uint8_t DIRECT_BITS = 16;
+
+    static constexpr int Index(const int x, const int y, const int z) {
+        return (y * SIZE + z) * SIZE + x;
+    }
+
+    explicit ChunkSection(BlockId fill = BLOCK_AIR);
+    // Copies keep their storage in the pool too
+    ChunkSection(const ChunkSection &other);
+    ChunkSection &operator=(const ChunkSection &other) = default;
+
+    BlockId GetBlock(int x, int y, int z) const { return GetBlock(Index(x, y, z)); }
+    BlockId GetBlock(int index) const;
+
+    void SetBlock(int x, int y, int z, BlockId id) { SetBlock(Index(x, y, z), id); }
+    void SetBlock(int index, BlockId id);
+
+    // Replaces the whole section
+    void Fill(BlockId id);
+    void Assign(const BlockId *blocks);
+
+    // Unpacks the section into a flat array of VOLUME block IDs
+    void Decode(BlockId *out) const;
+
+    // Drops unused palette entries and shrinks the index width
+    void Compact();
+
+    bool IsEmpty() const { return m_nonAirCount == 0; }
+    uint32_t GetNonAirCount() const { return m_nonAirCount; }
+    size_t GetMemoryUsage() const;
+
+    // Raw storage, used by serialization
+    uint8_t GetBitsPerEntry() const { return m_bits; }
+    const std::pmr::vector<BlockId> &GetPalette() const { return m_palette; }
+    const std::pmr::vector<uint64_t> &GetData() const { return m_data; }
+    // Takes the storage as saved, false (leaving the section as it was) when it is malformed or has unknown blocks
+    bool Load(uint8_t bits, const std::vector<BlockId> &palette, const std::vector<uint64_t> &data);
+
+    static size_t WordCount(uint8_t bits);
+
+private:
+    uint32_t GetEntry(int index) const;
+    void SetEntry(int index, uint32_t value);
+    uint32_t FindOrAddPalette(BlockId id);
+    void Repack(uint8_t bits);
+    void CountNonAir();
+
+    // Palette mode: m_bits in {0, 1, 2, 4, 8}, 0 means the whole section is m_palette[0].
+    // Direct mode: m_bits == DIRECT_BITS, m_palette is empty.
+    std::pmr::vector<BlockId> m_palette;
+    std::pmr::vector<uint64_t> m_data;
+    uint8_t m_bits = 0;
+    uint16_t m_nonAirCount = 0;
+};
@@ -0,0 +1,187 @@
+#include "world/ChunkSerializer.h"
+
+#include <cstring>
+
+#include <lz4.h>
+
+namespace {
+    constexpr uint16_t ALL_SECTIONS = (1u << Chunk::SECTION_COUNT) - 1;
+    // Every section in direct mode, the largest form SerializeSections writes. Payloads claiming more are
+    // corrupt, and are rejected before anything is allocated for them
+    constexpr size_t MAX_SERIALIZED_SIZE = sizeof(uint16_t) + Chunk::SECTION_COUNT *
+        (sizeof(uint8_t) + sizeof(uint16_t) + ChunkSection::VOLUME * sizeof(BlockId));
+
+    enum PayloadCodec : uint8_t {
+        CODEC_NONE,
+        CODEC_LZ4
+    };
+
+    struct PayloadHeader {
+        uint32_t uncompressedSize;
+        uint32_t storedSize;
+        uint8_t codec;
+        uint8_t reserved[3];
+    };
+
+    void ClearSections(Chunk &chunk, const uint16_t mask) {
+        for (int sy = 0; sy < Chunk::SECTION_COUNT; ++sy) {
+            ChunkSection *section = chunk.GetSection(sy);
+            if (section && (mask & (1u << sy)))
+                section->Fill(BLOCK_AIR);
+        }
+    }
+
+    template<typename T>
+    void Append(std::vector<uint8_t> &out, const T *values, const size_t count) {
+        const size_t offset = out.size();
+        out.resize(offset + count * sizeof(T));
+        std::memcpy(out.data() + offset, values, count * sizeof(T));
+    }
+
+    class Reader {
+    public:
+        Reader(const uint8_t *data, const size_t size) : m_data(data), m_size(size) {}
+
+        template<typename T>
+        bool Read(T *values, const size_t count) {
+            const size_t bytes = count * sizeof(T);
+            if (m_size - m_offset < bytes)
+                return false;
+            std::memcpy(values, m_data + m_offset, bytes);
+            m_offset += bytes;
+            return true;
+        }
+
+        bool IsAtEnd() const { return m_offset == m_size; }
+
+    private:
+        const uint8_t *m_data;
+        size_t m_size;
+        size_t m_offset = 0;
+    };
+}
+
+void SerializeChunk(const Chunk &chunk, std::vector<uint8_t> &out) {
+    SerializeSections(chunk, ALL_SECTIONS, out);
+}
+
+bool DeserializeChunk(const uint8_t *data, const size_t size, Chunk &chunk) {
+    return DeserializeSections(data, size, ALL_SECTIONS, chunk);
+}
+
+void SerializeSections(const Chunk &chunk, const uint16_t sections, std::vector<uint8_t> &out) {
+    out.clear();
+    uint16_t mask = 0;
+    for (int sy = 0; sy < Chunk::SECTION_COUNT; ++sy) {
+        const ChunkSection *section = chunk.GetSection(sy);
+        if ((sections & (1u << sy)) && section && !section->IsEmpty())
+            mask |= static_cast<uint16_t>(1u << sy);
+    }
+    Append(out, &mask, 1);
+
+    for (int sy = 0; sy < Chunk::SECTION_COUNT; ++sy) {
+        if (!(mask & (1u << sy)))
+            continue;
+        const ChunkSection &section = *chunk.GetSection(sy);
+        const uint8_t bits = section.GetBitsPerEntry();
+        const auto paletteSize = static_cast<uint16_t>(section.GetPalette().size());
+        Append(out, &bits, 1);
+        Append(out, &paletteSize, 1);
+        Append(out, section.GetPalette().data(), paletteSize);
+        Append(out, section.GetData().data(), section.GetData().size());
+    }
+}
+
+bool DeserializeSections(const uint8_t *data, const size_t size, const uint16_t sections, Chunk &chunk) {
+    ClearSections(chunk, sections);
+
+    Reader reader(data, size);
+    uint16_t mask = 0;
+    if (!reader.Read(&mask, 1))
+        return false;
+    const bool inside = (mask & ~sections) == 0;
+
+    // Reused by every section, Load() copies them into the section's own storage
+    std::vector<BlockId> palette;
+    std::vector<uint64_t> words;
+    for (int sy = 0; inside && sy < Chunk::SECTION_COUNT; ++sy) {
+        if (!(mask & (1u << sy)))
+            continue;
+        uint8_t bits = 0;
+        uint16_t paletteSize = 0;
+        if (!reader.Read(&bits, 1) || !reader.Read(&paletteSize, 1))
+            break;
+        palette.resize(paletteSize);
+        words.resize(ChunkSection::WordCount(bits));
+        if (!reader.Read(palette.data(), palette.size()) || !reader.Read(words.data(), words.size()))
+            break;
+        if (!chunk.GetOrCreateSection(sy).Load(bits, palette, words))
+            break;
+        mask &= static_cast<uint16_t>(~(1u << sy));
+    }
+
+    // Loaded sections are stored as they were saved, packed already; they are not re-encoded here
+    if (mask != 0 || !reader.IsAtEnd()) {
+        ClearSections(chunk, sections);
+        chunk.FreeEmptySections();
+        return false;
+    }
+    chunk.FreeEmptySections();
+    return true;
+}
+
+void CompressChunkPayload(const uint8_t *data, const size_t size, std::vector<uint8_t> &out) {
+    const int bound = LZ4_compressBound(static_cast<int>(size));
+    out.resize(sizeof(PayloadHeader) + bound);
+    char *stored = reinterpret_cast<char *>(out.data() + sizeof(PayloadHeader));
+
+    PayloadHeader header{};
+    header.uncompressedSize = static_cast<uint32_t>(size);
+    const int compressed = LZ4_compress_default(reinterpret_cast<const char *>(data), stored,
+                                                static_cast<int>(size), bound);
+    if (compressed > 0 && static_cast<size_t>(compressed) < size) {
+        header.codec = CODEC_LZ4;
+        header.storedSize = static_cast<uint32_t>(compressed);
+    } else {
+        header.codec = CODEC_NONE;
+        header.storedSize = header.uncompressedSize;
+        std::memcpy(stored, data, size);
+    }
+    std::memcpy(out.data(), &header, sizeof(header));
+    out.resize(sizeof(PayloadHeader) + header.storedSize);
+}
+
+size_t GetChunkPayloadSize(const uint8_t *data, const size_t size) {
+    PayloadHeader header;
+    if (size < sizeof(header))
+        return 0;
+    std::memcpy(&header, data, sizeof(header));
+    if (header.storedSize > size - sizeof(header))
+        return 0;
+    return sizeof(header) + header.storedSize;
+}
+
+bool DecompressChunkPayload(const uint8_t *data, const size_t size, std::vector<uint8_t> &out) {
+    if (GetChunkPayloadSize(data, size) == 0)
+        return false;
+    PayloadHeader header;
+    std::memcpy(&header, data, sizeof(header));
+    const auto *stored = reinterpret_cast<const char *>(data + sizeof(header));
+    if (header.uncompressedSize > MAX_SERIALIZED_SIZE)
+        return false;
+
+    out.resize(header.uncompressedSize);
+    if (header.codec == CODEC_NONE) {
+        if (header.storedSize != header.uncompressedSize)
+            return false;
+        std::memcpy(out.data(), stored, header.storedSize);
+        return true;
+    }
+    if (header.codec == CODEC_LZ4) {
+        const int decompressed = LZ4_decompress_safe(stored, reinterpret_cast<char *>(out.data()),
+                                                     static_cast<int>(header.storedSize),
+                                                     static_cast<int>(header.uncompressedSize));
+        return decompressed == static_cast<int>(header.uncompressedSize);
+    }
+    return false;
+}
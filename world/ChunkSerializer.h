@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "world/Chunk.h"
+
+// Compact binary form of a chunk's blocks, shared by region files and the network.
+// Sections are written in their packed storage form (palette + words), so saving and loading never
+// expand them to one ID per block. Little-endian.
+//   u16 section mask, then per present section: u8 bits, u16 palette size, u16 palette[], u64 words[]
+void SerializeChunk(const Chunk &chunk, std::vector<uint8_t> &out);
+// Replaces the chunk's sections; false on malformed input, the chunk is then left empty
+bool DeserializeChunk(const uint8_t *data, size_t size, Chunk &chunk);
+
+// Same form limited to the sections in mask, empty ones are left out as usual
+void SerializeSections(const Chunk &chunk, uint16_t mask, std::vector<uint8_t> &out);
+// Replaces only the sections in mask, sections of the mask missing from the data become air.
+// False on malformed input or data outside the mask, the sections of the mask are then left empty
+bool DeserializeSections(const uint8_t *data, size_t size, uint16_t mask, Chunk &chunk);
+
+// Serialized chunk data as stored and sent: a small header, then the data LZ4 compressed, or as is when that
+// does not make it smaller
+//   u32 uncompressed size, u32 stored size, u8 codec, u8 reserved[3], stored bytes
+void CompressChunkPayload(const uint8_t *data, size_t size, std::vector<uint8_t> &out);
+// Size of the payload at data including its header, 0 when the header is malformed or size is too small for it
+size_t GetChunkPayloadSize(const uint8_t *data, size_t size);
+// false on malformed or truncated payloads
+bool DecompressChunkPayload(const uint8_t *data, size_t size, std::vector<uint8_t> &out);
@@ -0,0 +1,186 @@
+#include "world/ChunkStreamer.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+    // Diagonal neighbours of a chunk at some distance are up to sqrt(2) chunks further away
+    constexpr float NEIGHBOR_MARGIN = 1.5f;
+}
+
+ChunkStreamer::ChunkStreamer(World &world, JobSystem &jobSystem, Generator generator, const Settings &settings)
+    : m_world(world), m_jobSystem(jobSystem), m_generator(std::move(generator)), m_settings(settings) {
+    if (m_settings.maxGenerationsInFlight == 0)
+        m_settings.maxGenerationsInFlight = 2 * std::max(1u, jobSystem.GetThreadCount());
+}
+
+ChunkStreamer::~ChunkStreamer() {
+    for (auto &[pos, entry]: m_entries) {
+        if (entry.state == CHUNK_GENERATING)
+            entry.cancelled->store(true, std::memory_order_relaxed);
+    }
+    m_jobSystem.Wait(m_jobs);
+}
+
+float ChunkStreamer::GetDistance(const ChunkPos pos) const {
+    const float dx = static_cast<float>(pos.x) + 0.5f - m_cameraX;
+    const float dz = static_cast<float>(pos.z) + 0.5f - m_cameraZ;
+    return std::sqrt(dx * dx + dz * dz);
+}
+
+float ChunkStreamer::GetPriority(const ChunkPos pos) const {
+    const float distance = GetDistance(pos);
+    // The chunks around the camera come first whatever the direction
+    if (distance < 1.5f)
+        return distance;
+    const float dx = static_cast<float>(pos.x) + 0.5f - m_cameraX;
+    const float dz = static_cast<float>(pos.z) + 0.5f - m_cameraZ;
+    const float facing = (dx * m_forwardX + dz * m_forwardZ) / distance;
+    // Straight ahead counts at its distance, straight behind at twice that
+    return distance * (1.5f - 0.5f * facing);
+}
+
+bool ChunkStreamer::HasAllNeighbors(const ChunkPos pos) const {
+    for (int dz = -1; dz <= 1; ++dz) {
+        for (int dx = -1; dx <= 1; ++dx) {
+            if (dx == 0 && dz == 0)
+                continue;
+            const auto it = m_entries.find({pos.x + dx, pos.z + dz});
+            if (it == m_entries.end() || it->second.state == CHUNK_GENERATING)
+                return false;
+        }
+    }
+    return true;
+}
+
+void ChunkStreamer::Update(const float cameraX, const float cameraZ, const float forwardX, const float forwardZ) {
+    m_cameraX = cameraX / static_cast<float>(Chunk::SIZE);
+    m_cameraZ = cameraZ / static_cast<float>(Chunk::SIZE);
+    const float length = std::sqrt(forwardX * forwardX + forwardZ * forwardZ);
+    if (length > 1e-4f) {
+        m_forwardX = forwardX / length;
+        m_forwardZ = forwardZ / length;
+    }
+
+    CollectGenerated();
+    if (m_onChunksLoaded && !m_loaded.empty())
+        m_onChunksLoaded(m_loaded);
+    Evict();
+    SubmitGeneration();
+    ReleaseReady();
+}
+
+void ChunkStreamer::CollectGenerated() {
+    std::vector<Generated> generated;
+    {
+        std::lock_guard lock(m_generatedMutex);
+        generated.swap(m_generated);
+    }
+
+    m_loaded.clear();
+    for (auto &result: generated) {
+        --m_inFlight;
+        const ChunkPos pos = result.chunk->GetPos();
+        const auto it = m_entries.find(pos);
+        // Evicted while generating, possibly requested again since: only the latest request counts
+        if (it == m_entries.end() || it->second.cancelled != result.cancelled)
+            continue;
+        m_world.InsertChunk(std::move(result.chunk));
+        m_loaded.push_back(pos);
+        ++m_generatedCount;
+        it->second.state = CHUNK_LOADED;
+        it->second.cancelled.reset();
+    }
+}
+
+void ChunkStreamer::Evict() {
+    const float hiddenDistance = static_cast<float>(m_settings.viewRadius + m_settings.hysteresis);
+    const float unloadDistance = hiddenDistance + NEIGHBOR_MARGIN;
+
+    for (auto it = m_entries.begin(); it != m_entries.end();) {
+        const ChunkPos pos = it->first;
+        Entry &entry = it->second;
+        const float distance = GetDistance(pos);
+
+        if (entry.state == CHUNK_READY && distance > hiddenDistance) {
+            if (m_onChunkHidden)
+                m_onChunkHidden(pos);
+            entry.state = CHUNK_LOADED;
+        }
+
+        if (distance <= unloadDistance) {
+            ++it;
+            continue;
+        }
+        if (entry.state == CHUNK_GENERATING) {
+            entry.cancelled->store(true, std::memory_order_relaxed);
+        } else {
+            if (const Chunk *chunk = m_world.GetChunk(pos); chunk && m_onChunkUnloading)
+                m_onChunkUnloading(*chunk);
+            m_world.RemoveChunk(pos);
+        }
+        it = m_entries.erase(it);
+    }
+}
+
+void ChunkStreamer::SubmitGeneration() {
+    if (m_inFlight >= m_settings.maxGenerationsInFlight)
+        return;
+
+    // One extra ring is generated so that the chunks at the view radius have all of their neighbours
+    const float distance = static_cast<float>(m_settings.viewRadius) + NEIGHBOR_MARGIN;
+    const int radius = static_cast<int>(std::ceil(distance));
+    const auto centerX = static_cast<int>(std::floor(m_cameraX));
+    const auto centerZ = static_cast<int>(std::floor(m_cameraZ));
+
+    m_candidates.clear();
+    for (int z = centerZ - radius; z <= centerZ + radius; ++z) {
+        for (int x = centerX - radius; x <= centerX + radius; ++x) {
+            const ChunkPos pos{x, z};
+            if (GetDistance(pos) > distance || m_entries.contains(pos))
+                continue;
+            m_candidates.push_back({pos, GetPriority(pos)});
+        }
+    }
+
+    const size_t count = std::min<size_t>(m_candidates.size(), m_settings.maxGenerationsInFlight - m_inFlight);
+    std::partial_sort(m_candidates.begin(), m_candidates.begin() + static_cast<ptrdiff_t>(count), m_candidates.end(),
+                      [](const Candidate &a, const Candidate &b) { return a.priority < b.priority; });
+
+    for (size_t i = 0; i < count; ++i) {
+        const ChunkPos pos = m_candidates[i].pos;
+        auto cancelled = std::make_shared<std::atomic<bool>>(false);
+        m_entries[pos] = Entry{CHUNK_GENERATING, cancelled};
+        ++m_inFlight;
+
+        m_jobSystem.Submit([this, pos, cancelled] {
+            auto chunk = std::make_unique<Chunk>(pos);
+            if (!cancelled->load(std::memory_order_relaxed)) {
+                m_generator(*chunk, *cancelled);
+                chunk->Compact();
+            }
+            std::lock_guard lock(m_generatedMutex);
+            m_generated.push_back({std::move(chunk), cancelled});
+        }, m_jobs);
+    }
+}
+
+void ChunkStreamer::ReleaseReady() {
+    const auto viewRadius = static_cast<float>(m_settings.viewRadius);
+
+    m_candidates.clear();
+    for (const auto &[pos, entry]: m_entries) {
+        if (entry.state == CHUNK_LOADED && GetDistance(pos) <= viewRadius && HasAllNeighbors(pos))
+            m_candidates.push_back({pos, GetPriority(pos)});
+    }
+
+    const size_t count = std::min<size_t>(m_candidates.size(), m_settings.maxReadyPerFrame);
+    std::partial_sort(m_candidates.begin(), m_candidates.begin() + static_cast<ptrdiff_t>(count), m_candidates.end(),
+                      [](const Candidate &a, const Candidate &b) { return a.priority < b.priority; });
+
+    for (size_t i = 0; i < count; ++i) {
+        m_entries[m_candidates[i].pos].state = CHUNK_READY;
+        if (m_onChunkReady)
+            m_onChunkReady(m_candidates[i].pos);
+    }
+}
@@ -0,0 +1,121 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <unordered_map>
+#include <vector>
+
+#include "core/JobSystem.h"
+#include "world/World.h"
+
+// Keeps the chunks around the camera loaded.
+// Chunks within about viewRadius + 1 are generated on the job system, nearest and most in front of the camera first;
+// a chunk becomes ready for meshing once its 8 neighbours are loaded and it lies within viewRadius.
+// Work for chunks the camera moved away from is cancelled, and chunks are only dropped hysteresis chunks past
+// the radius they were loaded for, so moving back and forth across a border never reloads them.
+// Everything except the generator runs on the thread that owns the world.
+class ChunkStreamer {
+public:
+    // Fills a standalone chunk, runs on a worker. Should return early once cancelled is set.
+    using Generator = std::function<void(Chunk &chunk, const std::atomic<bool> &cancelled)>;
+    using ChunkCallback = std::function<void(ChunkPos pos)>;
+    using UnloadCallback = std::function<void(const Chunk &chunk)>;
+    using LoadedCallback = std::function<void(std::span<const ChunkPos> chunks)>;
+
+    struct Settings {
+        // In chunks
+        int viewRadius = 8;
+        int hysteresis = 2;
+        // 0 means two per worker thread; pending chunks are only handed out this many at a time,
+        // so priorities are re-evaluated every frame
+        uint32_t maxGenerationsInFlight = 0;
+        // Calls to onChunkReady per frame, each one gathers the chunk's sections on the calling thread
+        uint32_t maxReadyPerFrame = 4;
+    };
+
+    ChunkStreamer(World &world, JobSystem &jobSystem, Generator generator, const Settings &settings);
+    // Cancels and waits for all generation jobs
+    ~ChunkStreamer();
+
+    ChunkStreamer(const ChunkStreamer &) = delete;
+    ChunkStreamer &operator=(const ChunkStreamer &) = delete;
+
+    // A chunk can be meshed now
+    void SetOnChunkReady(ChunkCallback callback) { m_onChunkReady = std::move(callback); }
+    // Chunks were just added to the world; called before any of them or their neighbours is released as ready,
+    // e.g. to exchange light with the chunks around
+    void SetOnChunksLoaded(LoadedCallback callback) { m_onChunksLoaded = std::move(callback); }
+    // A ready chunk left the view radius, its mesh should go; also called right before a ready chunk is unloaded
+    void SetOnChunkHidden(ChunkCallback callback) { m_onChunkHidden = std::move(callback); }
+    // A loaded chunk is about to be removed from the world, e.g. to save it
+    void SetOnChunkUnloading(UnloadCallback callback) { m_onChunkUnloading = std::move(callback); }
+
+    // Camera position in blocks and horizontal view direction, need not be normalized
+    void Update(float cameraX, float cameraZ, float forwardX, float forwardZ);
+
+    const Settings &GetSettings() const { return m_settings; }
+    uint32_t GetInFlightCount() const { return m_inFlight; }
+    size_t GetLoadedCount() const { return m_world.GetChunkCount(); }
+    // Chunks generated or loaded from disk since construction
+    uint64_t GetGeneratedCount() const { return m_generatedCount; }
+
+private:
+    enum ChunkState {
+        CHUNK_GENERATING,
+        CHUNK_LOADED,
+        CHUNK_READY
+    };
+
+    struct Entry {
+        ChunkState state = CHUNK_GENERATING;
+        std::shared_ptr<std::atomic<bool>> cancelled;
+    };
+
+    struct Candidate {
+        ChunkPos pos;
+        float priority;
+    };
+
+    struct Generated {
+        std::unique_ptr<Chunk> chunk;
+        std::shared_ptr<std::atomic<bool>> cancelled;
+    };
+
+    float GetDistance(ChunkPos pos) const;
+    // Lower is sooner
+    float GetPriority(ChunkPos pos) const;
+    bool HasAllNeighbors(ChunkPos pos) const;
+
+    void CollectGenerated();
+    void Evict();
+    void SubmitGeneration();
+    void ReleaseReady();
+
+    World &m_world;
+    JobSystem &m_jobSystem;
+    Generator m_generator;
+    Settings m_settings;
+    ChunkCallback m_onChunkReady;
+    ChunkCallback m_onChunkHidden;
+    UnloadCallback m_onChunkUnloading;
+    LoadedCallback m_onChunksLoaded;
+
+    // Camera in chunk units
+    float m_cameraX = 0.f, m_cameraZ = 0.f;
+    float m_forwardX = 0.f, m_forwardZ = 1.f;
+
+    std::unordered_map<ChunkPos, Entry, ChunkPosHash> m_entries;
+    std::vector<Candidate> m_candidates;
+    // Inserted by the last CollectGenerated
+    std::vector<ChunkPos> m_loaded;
+    uint32_t m_inFlight = 0;
+    uint64_t m_generatedCount = 0;
+
+    JobCounter m_jobs;
+    std::mutex m_generatedMutex;
+    std::vector<Generated> m_generated;
+};
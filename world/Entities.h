@@ -0,0 +1,68 @@
+#pragma once
+
+#include <cstdint>
+
+#include "core/EntityRegistry.h"
+#include "world/Block.h"
+
+// Components of the simulated entities, plain data stored by EntityRegistry.
+// Positions are in blocks; yaw is in radians and never wrapped, so blending two ticks never spins the long way.
+
+enum EntityMesh : uint8_t {
+    // Standing box, origin at the feet
+    ENTITY_MESH_MOB,
+    // Small cube, origin at its centre
+    ENTITY_MESH_ITEM,
+    ENTITY_MESH_COUNT
+};
+
+struct Transform {
+    float x = 0.f, y = 0.f, z = 0.f;
+    float yaw = 0.f;
+};
+
+// Transform at the start of the tick, frames blend from it to Transform
+struct PreviousTransform {
+    Transform value;
+};
+
+struct Velocity {
+    float x = 0.f, y = 0.f, z = 0.f;
+};
+
+// Box standing on the entity's origin, moved through the blocks by the physics step: falls, floats up in water
+// and is pushed apart from the other colliders
+struct Collider {
+    float halfWidth = 0.3f;
+    float height = 1.8f;
+    bool onGround = false;
+};
+
+// Walks around its home, picking a new heading and speed now and then
+struct Wander {
+    float homeX = 0.f, homeZ = 0.f;
+    float targetYaw = 0.f;
+    float speed = 0.f;
+    uint64_t nextTurnTick = 0;
+};
+
+// A dropped block, spinning and bobbing until it despawns
+struct ItemDrop {
+    // Negative for items that existed before the first tick
+    int64_t spawnTick = 0;
+    float baseY = 0.f;
+};
+
+// Placeholder art until there are entity models: every mesh is a box textured like the block
+struct Renderable {
+    EntityMesh mesh = ENTITY_MESH_MOB;
+    BlockId block = BLOCK_STONE;
+};
+
+// What the renderer and the network get of every entity: its transform before and after the last tick
+struct EntityInstance {
+    Entity entity;
+    Transform from, to;
+    EntityMesh mesh;
+    BlockId block;
+};
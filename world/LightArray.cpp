@@ -0,0 +1,37 @@
+#include "world/LightArray.h"
+
+namespace {
+    // Never destroyed, like the section pool
+    ObjectPool<std::array<uint8_t, ChunkSection::VOLUME / 2>> &GetNibblesPool() {
+        static auto *pPool = new ObjectPool<std::array<uint8_t, ChunkSection::VOLUME / 2>>("Light arrays", 512);
+        return *pPool;
+    }
+}
+
+void LightArray::NibblesDeleter::operator()(Nibbles *pNibbles) const {
+    GetNibblesPool().Destroy(pNibbles);
+}
+
+bool LightArray::Set(const int index, const uint8_t level) {
+    if (!m_pNibbles) {
+        if (level == m_uniform)
+            return false;
+        m_pNibbles.reset(GetNibblesPool().Create());
+        m_pNibbles->fill(static_cast<uint8_t>(m_uniform | (m_uniform << 4)));
+    }
+    uint8_t &pair = (*m_pNibbles)[index >> 1];
+    const int shift = (index & 1) * 4;
+    if (((pair >> shift) & 15) == level)
+        return false;
+    pair = static_cast<uint8_t>((pair & ~(15 << shift)) | (level << shift));
+    return true;
+}
+
+void LightArray::Fill(const uint8_t level) {
+    m_pNibbles.reset();
+    m_uniform = level;
+}
+
+FixedPool::Stats LightArray::GetPoolStats() {
+    return GetNibblesPool().GetStats();
+}
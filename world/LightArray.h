@@ -0,0 +1,57 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+#include "core/ObjectPool.h"
+#include "world/ChunkSection.h"
+
+constexpr uint8_t MAX_LIGHT = 15;
+
+// Sky light comes down from above the world, block light from emitting blocks (see LightEngine)
+enum LightChannel {
+    LIGHT_SKY = 0,
+    LIGHT_BLOCK,
+    LIGHT_CHANNEL_COUNT
+};
+
+// One channel of a section's light, 4 bits per block, in the section's index layout.
+// Most sections are lit uniformly, fully dark underground or fully lit above the terrain: those only store their
+// level, the nibbles are allocated from a shared pool on the first write of a different level.
+class LightArray {
+public:
+    explicit LightArray(uint8_t level = 0) : m_uniform(level) {}
+
+    uint8_t Get(const int index) const {
+        if (!m_pNibbles)
+            return m_uniform;
+        return ((*m_pNibbles)[index >> 1] >> ((index & 1) * 4)) & 15;
+    }
+    uint8_t Get(const int x, const int y, const int z) const { return Get(ChunkSection::Index(x, y, z)); }
+
+    // Returns whether the level changed
+    bool Set(int index, uint8_t level);
+    bool Set(const int x, const int y, const int z, const uint8_t level) {
+        return Set(ChunkSection::Index(x, y, z), level);
+    }
+
+    // Replaces the whole array, freeing the nibbles
+    void Fill(uint8_t level);
+
+    bool IsUniform() const { return !m_pNibbles; }
+    size_t GetMemoryUsage() const { return m_pNibbles ? sizeof(Nibbles) : 0; }
+
+    static FixedPool::Stats GetPoolStats();
+
+private:
+    using Nibbles = std::array<uint8_t, ChunkSection::VOLUME / 2>;
+
+    struct NibblesDeleter {
+        void operator()(Nibbles *pNibbles) const;
+    };
+
+    std::unique_ptr<Nibbles, NibblesDeleter> m_pNibbles;
+    uint8_t m_uniform;
+};
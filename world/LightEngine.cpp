@@ -0,0 +1,362 @@
+#include "world/LightEngine.h"
+
+#include <algorithm>
+#include <atomic>
+#include <memory_resource>
+#include <unordered_set>
+
+#include "core/LinearArena.h"
+#include "world/WorldTicker.h"
+
+namespace {
+    constexpr int S = ChunkSection::SIZE;
+
+    int FloorDiv(const int v, const int d) {
+        return v >= 0 ? v / d : -((-v + d - 1) / d);
+    }
+
+    // Flood fill entries take the level from the cell, removal ones carry the level the cell had
+    struct LightNode {
+        int32_t x = 0, y = 0, z = 0;
+        uint8_t level = 0;
+    };
+
+    using LightQueue = std::pmr::vector<LightNode>;
+
+    // +X, -X, +Y, -Y, +Z, -Z
+    constexpr int NEIGHBORS[6][3] = {{1, 0, 0}, {-1, 0, 0}, {0, 1, 0}, {0, -1, 0}, {0, 0, 1}, {0, 0, -1}};
+    constexpr int DOWN = 3;
+
+    // Light of a chunk on its own, in its local coordinates; around it there is nothing to light
+    class ChunkAccess {
+    public:
+        explicit ChunkAccess(Chunk &chunk) : m_chunk(chunk) {}
+
+        uint8_t GetLight(const LightChannel channel, const int x, const int y, const int z) const {
+            return Inside(x, z) ? m_chunk.GetLight(channel, x, y, z) : 0;
+        }
+
+        bool SetLight(const LightChannel channel, const int x, const int y, const int z, const uint8_t level) {
+            return Inside(x, z) && m_chunk.SetLight(channel, x, y, z, level);
+        }
+
+        BlockId GetBlock(const int x, const int y, const int z) const {
+            if (!Inside(x, z))
+                return BLOCK_AIR;
+            return m_chunk.GetBlock(x, y, z);
+        }
+
+    private:
+        static bool Inside(const int x, const int z) {
+            return static_cast<unsigned>(x) < S && static_cast<unsigned>(z) < S;
+        }
+
+        Chunk &m_chunk;
+    };
+
+    // Light of the loaded chunks, in block coordinates. Collects the sections of every level it changes,
+    // and the neighbours that copy the cell into their meshing border
+    class WorldAccess {
+    public:
+        using SectionSet = std::pmr::unordered_set<SectionPos, SectionPosHash>;
+
+        WorldAccess(const World &world, SectionSet &changed) : m_world(world), m_changed(changed) {}
+
+        bool IsLoaded(const ChunkPos pos) { return Find(pos) != nullptr; }
+
+        uint8_t GetLight(const LightChannel channel, const int x, const int y, const int z) {
+            const Chunk *chunk = Find(World::ToChunkPos(x, z));
+            return chunk ? chunk->GetLight(channel, World::ToLocal(x), y, World::ToLocal(z)) : 0;
+        }
+
+        bool SetLight(const LightChannel channel, const int x, const int y, const int z, const uint8_t level) {
+            Chunk *chunk = Find(World::ToChunkPos(x, z));
+            if (!chunk || !chunk->SetLight(channel, World::ToLocal(x), y, World::ToLocal(z), level))
+                return false;
+            Record(x, y, z);
+            return true;
+        }
+
+        BlockId GetBlock(const int x, const int y, const int z) {
+            const Chunk *chunk = Find(World::ToChunkPos(x, z));
+            if (!chunk)
+                return BLOCK_AIR;
+            return chunk->GetBlock(World::ToLocal(x), y, World::ToLocal(z));
+        }
+
+    private:
+        // Fills stay local, the last chunk looked up is nearly always the one asked for again
+        Chunk *Find(const ChunkPos pos) {
+            if (!m_cached || pos != m_cachedPos) {
+                // Only the chunks' light is written, never the map
+                m_pCached = const_cast<Chunk *>(m_world.GetChunk(pos));
+                m_cachedPos = pos;
+                m_cached = true;
+            }
+            return m_pCached;
+        }
+
+        void Record(const int x, const int y, const int z) {
+            const int lx = World::ToLocal(x), ly = y & (S - 1), lz = World::ToLocal(z);
+            const bool border = lx == 0 || lx == S - 1 || ly == 0 || ly == S - 1 || lz == 0 || lz == S - 1;
+            const SectionPos section{x >> 4, y >> 4, z >> 4};
+            if (!border) {
+                if (section == m_lastSection)
+                    return;
+                m_lastSection = section;
+                m_changed.insert(section);
+                return;
+            }
+            World::ForEachSectionSharing(x, y, z, [this](const SectionPos pos) { m_changed.insert(pos); });
+        }
+
+        const World &m_world;
+        SectionSet &m_changed;
+        bool m_cached = false;
+        ChunkPos m_cachedPos;
+        Chunk *m_pCached = nullptr;
+        SectionPos m_lastSection{INT32_MIN, INT32_MIN, INT32_MIN};
+    };
+
+    // Raises every cell the queued cells can reach to the level they would give it
+    template<typename Access>
+    void FloodFill(Access &access, const LightChannel channel, LightQueue &queue) {
+        for (size_t i = 0; i < queue.size(); ++i) {
+            const LightNode node = queue[i];
+            const uint8_t level = access.GetLight(channel, node.x, node.y, node.z);
+            if (level <= 1)
+                continue;
+            for (int n = 0; n < 6; ++n) {
+                const int x = node.x + NEIGHBORS[n][0], y = node.y + NEIGHBORS[n][1], z = node.z + NEIGHBORS[n][2];
+                const uint8_t opacity = GetLightOpacity(access.GetBlock(x, y, z));
+                if (opacity >= MAX_LIGHT)
+                    continue;
+                const bool skyColumn = channel == LIGHT_SKY && n == DOWN && level == MAX_LIGHT && opacity == 0;
+                const int spread = skyColumn ? MAX_LIGHT : level - 1 - opacity;
+                if (spread > access.GetLight(channel, x, y, z) &&
+                    access.SetLight(channel, x, y, z, static_cast<uint8_t>(spread)))
+                    queue.push_back({x, y, z});
+            }
+        }
+        queue.clear();
+    }
+
+    // Clears the light that came from the removed cells. Cells lit from elsewhere are where it floods back from,
+    // they are queued into relight; so are emitting blocks, which keep their own level
+    template<typename Access>
+    void Unlight(Access &access, const LightChannel channel, LightQueue &removed, LightQueue &relight) {
+        for (size_t i = 0; i < removed.size(); ++i) {
+            const LightNode node = removed[i];
+            for (int n = 0; n < 6; ++n) {
+                const int x = node.x + NEIGHBORS[n][0], y = node.y + NEIGHBORS[n][1], z = node.z + NEIGHBORS[n][2];
+                const uint8_t level = access.GetLight(channel, x, y, z);
+                if (level == 0)
+                    continue;
+                const bool skyColumn = channel == LIGHT_SKY && n == DOWN && node.level == MAX_LIGHT && level == MAX_LIGHT;
+                if (level >= node.level && !skyColumn) {
+                    relight.push_back({x, y, z});
+                    continue;
+                }
+                // The sky above the world stays lit
+                if (!access.SetLight(channel, x, y, z, 0))
+                    continue;
+                removed.push_back({x, y, z, level});
+                if (channel == LIGHT_BLOCK) {
+                    const uint8_t emission = GetLightEmission(access.GetBlock(x, y, z));
+                    if (emission > 0 && access.SetLight(channel, x, y, z, emission))
+                        relight.push_back({x, y, z});
+                }
+            }
+        }
+        removed.clear();
+    }
+
+    // The block at x, y, z changed: takes its old light back and lets light flood in again from around it
+    void RelightBlock(WorldAccess &access, const int x, const int y, const int z, LightQueue &removed,
+                      LightQueue &relight) {
+        const BlockId id = access.GetBlock(x, y, z);
+        for (const LightChannel channel: {LIGHT_SKY, LIGHT_BLOCK}) {
+            const uint8_t level = access.GetLight(channel, x, y, z);
+            if (level > 0 && access.SetLight(channel, x, y, z, 0))
+                removed.push_back({x, y, z, level});
+            for (const auto &offset: NEIGHBORS)
+                relight.push_back({x + offset[0], y + offset[1], z + offset[2]});
+            const uint8_t emission = channel == LIGHT_BLOCK ? GetLightEmission(id) : 0;
+            if (emission > 0 && access.SetLight(channel, x, y, z, emission))
+                relight.push_back({x, y, z});
+            Unlight(access, channel, removed, relight);
+            FloodFill(access, channel, relight);
+        }
+    }
+
+    // Both sides of the chunk's borders with its loaded neighbours were lit as if the other side was dark:
+    // light only has to flow across from the side that is brighter
+    void StitchChunk(WorldAccess &access, const ChunkPos pos, LightQueue &queue) {
+        if (!access.IsLoaded(pos))
+            return;
+        const int directions[4][2] = {{1, 0}, {-1, 0}, {0, 1}, {0, -1}};
+        for (const LightChannel channel: {LIGHT_SKY, LIGHT_BLOCK}) {
+            for (const auto &[dx, dz]: directions) {
+                if (!access.IsLoaded({pos.x + dx, pos.z + dz}))
+                    continue;
+                for (int t = 0; t < S; ++t) {
+                    const int lx = dx > 0 ? S - 1 : (dx < 0 ? 0 : t), lz = dz > 0 ? S - 1 : (dz < 0 ? 0 : t);
+                    const int ax = pos.x * S + lx, az = pos.z * S + lz, bx = ax + dx, bz = az + dz;
+                    for (int y = 0; y < Chunk::HEIGHT; ++y) {
+                        const uint8_t a = access.GetLight(channel, ax, y, az), b = access.GetLight(channel, bx, y, bz);
+                        if (a > b + 1)
+                            queue.push_back({ax, y, az});
+                        else if (b > a + 1)
+                            queue.push_back({bx, y, bz});
+                    }
+                }
+            }
+            FloodFill(access, channel, queue);
+        }
+    }
+}
+
+LightEngine::LightEngine(World &world, JobSystem &jobSystem) : m_world(world), m_jobSystem(jobSystem) {
+    m_world.SetTrackLight(true);
+}
+
+LightEngine::~LightEngine() {
+    m_world.SetTrackLight(false);
+}
+
+void LightEngine::LightChunk(Chunk &chunk) {
+    int topSection = -1;
+    for (int sy = 0; sy < Chunk::SECTION_COUNT; ++sy) {
+        if (chunk.GetSection(sy) && !chunk.GetSection(sy)->IsEmpty())
+            topSection = sy;
+    }
+
+    // Sky light falls straight down to the first block that is not clear
+    int heights[S * S];
+    int maxHeight = 0;
+    for (int z = 0; z < S; ++z) {
+        for (int x = 0; x < S; ++x) {
+            int height = 0;
+            for (int y = (topSection + 1) * S - 1; y >= 0; --y) {
+                if (GetLightOpacity(chunk.GetBlock(x, y, z)) != 0) {
+                    height = y + 1;
+                    break;
+                }
+            }
+            heights[z * S + x] = height;
+            maxHeight = std::max(maxHeight, height);
+        }
+    }
+    // Sections above every column stay uniformly lit
+    const int litTop = (maxHeight + S - 1) / S * S;
+    for (int sy = 0; sy < Chunk::SECTION_COUNT; ++sy) {
+        chunk.GetLight(LIGHT_SKY, sy).Fill(sy * S >= litTop ? MAX_LIGHT : 0);
+        chunk.GetLight(LIGHT_BLOCK, sy).Fill(0);
+    }
+    for (int z = 0; z < S; ++z)
+        for (int x = 0; x < S; ++x)
+            for (int y = heights[z * S + x]; y < litTop; ++y)
+                chunk.SetLight(LIGHT_SKY, x, y, z, MAX_LIGHT);
+
+    LinearArena &arena = GetThreadArena();
+    LinearArena::Scope scope(arena);
+    LightQueue queue(&arena);
+    ChunkAccess access(chunk);
+
+    // It spreads from the lowest lit cell of each column, into a partly clear block below,
+    // and from the lit cells next to a taller column, sideways under whatever shadows that one
+    for (int z = 0; z < S; ++z) {
+        for (int x = 0; x < S; ++x) {
+            const int height = heights[z * S + x];
+            int shadowed = height + 1;
+            for (const auto &offset: NEIGHBORS) {
+                const int nx = x + offset[0], nz = z + offset[2];
+                if (offset[1] == 0 && nx >= 0 && nx < S && nz >= 0 && nz < S)
+                    shadowed = std::max(shadowed, heights[nz * S + nx]);
+            }
+            for (int y = height; y < std::min(shadowed, Chunk::HEIGHT); ++y)
+                queue.push_back({x, y, z});
+        }
+    }
+    FloodFill(access, LIGHT_SKY, queue);
+
+    BlockId *blocks = arena.AllocateArray<BlockId>(ChunkSection::VOLUME);
+    for (int sy = 0; sy <= topSection; ++sy) {
+        const ChunkSection *section = chunk.GetSection(sy);
+        if (!section)
+            continue;
+        section->Decode(blocks);
+        for (int i = 0; i < ChunkSection::VOLUME; ++i) {
+            const uint8_t emission = GetLightEmission(blocks[i]);
+            if (emission > 0 && chunk.GetLight(LIGHT_BLOCK, sy).Set(i, emission))
+                queue.push_back({i & (S - 1), sy * S + i / ChunkSection::AREA, (i / S) & (S - 1)});
+        }
+    }
+    FloodFill(access, LIGHT_BLOCK, queue);
+}
+
+void LightEngine::QueueChunk(const ChunkPos pos) {
+    m_queuedChunks.push_back(pos);
+}
+
+void LightEngine::Update() {
+    m_world.TakeLightChanges(m_changes);
+    m_stats = {};
+    if (m_queuedChunks.empty() && m_changes.empty())
+        return;
+
+    for (auto &[pos, batch]: m_batches) {
+        batch.chunks.clear();
+        batch.changes.clear();
+    }
+    for (const ChunkPos pos: m_queuedChunks)
+        m_batches[{FloorDiv(pos.x, WorldTicker::REGION_SIZE), FloorDiv(pos.z, WorldTicker::REGION_SIZE)}].chunks.push_back(pos);
+    for (const BlockChange &change: m_changes) {
+        const ChunkPos pos = World::ToChunkPos(change.x, change.z);
+        m_batches[{FloorDiv(pos.x, WorldTicker::REGION_SIZE), FloorDiv(pos.z, WorldTicker::REGION_SIZE)}].changes.push_back(change);
+    }
+    m_stats.chunks = static_cast<uint32_t>(m_queuedChunks.size());
+    m_stats.changes = static_cast<uint32_t>(m_changes.size());
+    m_queuedChunks.clear();
+    m_changes.clear();
+
+    for (auto &phase: m_phases)
+        phase.clear();
+    for (auto it = m_batches.begin(); it != m_batches.end();) {
+        const auto &[pos, batch] = *it;
+        if (batch.IsEmpty()) {
+            it = m_batches.erase(it);
+            continue;
+        }
+        m_phases[(pos.x & 1) | ((pos.z & 1) << 1)].push_back(&batch);
+        ++it;
+    }
+
+    std::atomic<uint32_t> changedSections{0};
+    for (const auto &phase: m_phases) {
+        m_jobSystem.ParallelFor(static_cast<uint32_t>(phase.size()), 1, [&](const uint32_t begin, const uint32_t end) {
+            uint32_t sections = 0;
+            for (uint32_t i = begin; i < end; ++i)
+                sections += UpdateRegion(*phase[i]);
+            changedSections.fetch_add(sections, std::memory_order_relaxed);
+        });
+    }
+    m_stats.changedSections = changedSections.load(std::memory_order_relaxed);
+}
+
+uint32_t LightEngine::UpdateRegion(const Batch &batch) {
+    LinearArena &arena = GetThreadArena();
+    LinearArena::Scope scope(arena);
+    WorldAccess::SectionSet changed(&arena);
+    WorldAccess access(m_world, changed);
+    LightQueue removed(&arena), relight(&arena);
+
+    for (const ChunkPos pos: batch.chunks)
+        StitchChunk(access, pos, relight);
+    for (const BlockChange &change: batch.changes)
+        RelightBlock(access, change.x, change.y, change.z, removed, relight);
+
+    std::pmr::vector<SectionPos> sections(changed.begin(), changed.end(), &arena);
+    m_world.MarkSectionsChanged(sections);
+    return static_cast<uint32_t>(sections.size());
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include "core/JobSystem.h"
+#include "world/World.h"
+
+// Keeps the sky and block light of the world's chunks up to date.
+// Light spreads as a flood fill, losing one level per block plus the opacity of the blocks it passes through; sky
+// light keeps its full level straight down through clear blocks. Changes are applied incrementally: a block change
+// first takes back the light that went through it, breadth first while levels keep decreasing, then floods again
+// from the brightest cells around what was removed.
+// Chunks are lit on their own when they are built (LightChunk), and exchange light with their neighbours once they
+// are added to the world. Only sections where a level changed are recorded as changed in the world, to be remeshed.
+//
+// Work is batched per Update and spread over the job system by region, in the same four phases as WorldTicker:
+// light never travels more than two chunks from where it starts, well within the regions around.
+// Must be called from the thread that owns the world, while nothing else touches it.
+class LightEngine {
+public:
+    struct Stats {
+        // Of the last Update
+        uint32_t chunks = 0;
+        uint32_t changes = 0;
+        uint32_t changedSections = 0;
+    };
+
+    // Turns on light tracking in the world until destroyed
+    LightEngine(World &world, JobSystem &jobSystem);
+    ~LightEngine();
+
+    LightEngine(const LightEngine &) = delete;
+    LightEngine &operator=(const LightEngine &) = delete;
+
+    // Lights a standalone chunk as if nothing was around it; runs on any thread, e.g. in the chunk's generation job
+    static void LightChunk(Chunk &chunk);
+
+    // The chunk was just added to the world: its light is exchanged with the loaded neighbours on the next Update
+    void QueueChunk(ChunkPos pos);
+
+    // Propagates the light of the chunks queued and of the blocks changed since the last call
+    void Update();
+
+    const Stats &GetStats() const { return m_stats; }
+
+private:
+    struct RegionPos {
+        int32_t x = 0, z = 0;
+        bool operator==(const RegionPos &) const = default;
+    };
+
+    struct RegionPosHash {
+        size_t operator()(const RegionPos &pos) const noexcept { return ChunkPosHash{}({pos.x, pos.z}); }
+    };
+
+    struct Batch {
+        std::vector<ChunkPos> chunks;
+        std::vector<BlockChange> changes;
+
+        bool IsEmpty() const { return chunks.empty() && changes.empty(); }
+    };
+
+    // Returns the number of sections changed
+    uint32_t UpdateRegion(const Batch &batch);
+
+    World &m_world;
+    JobSystem &m_jobSystem;
+    Stats m_stats;
+
+    std::vector<ChunkPos> m_queuedChunks;
+    std::vector<BlockChange> m_changes;
+    // Rebuilt every update, the vectors keep their capacity
+    std::unordered_map<RegionPos, Batch, RegionPosHash> m_batches;
+    std::vector<const Batch *> m_phases[4];
+};
@@ -0,0 +1,101 @@
+#include "world/Noise.h"
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#include <immintrin.h>
+#endif
+
+#include "world/NoiseKernels.inl"
+
+// Defined in the per-instruction-set translation units, null when compiled out
+const NoiseKernels *GetNoiseKernelsSSE4();
+const NoiseKernels *GetNoiseKernelsAVX2();
+const NoiseKernels *GetNoiseKernelsNEON();
+
+namespace {
+    constexpr NoiseKernels SCALAR_KERNELS = MakeNoiseKernels<TailOps>();
+
+    struct CpuFeatures {
+        bool sse41 = false;
+        bool avx2 = false;
+    };
+
+    CpuFeatures DetectCpuFeatures() {
+        CpuFeatures features;
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#    if defined(_MSC_VER)
+        int info[4];
+        __cpuid(info, 0);
+        const int maxLeaf = info[0];
+        __cpuid(info, 1);
+        features.sse41 = (info[2] & (1 << 19)) != 0;
+        // AVX registers must also be enabled by the OS
+        const bool osAvx = (info[2] & (1 << 27)) != 0 && (info[2] & (1 << 28)) != 0 && (_xgetbv(0) & 6) == 6;
+        if (maxLeaf >= 7 && osAvx) {
+            __cpuidex(info, 7, 0);
+            features.avx2 = (info[1] & (1 << 5)) != 0;
+        }
+#    else
+        __builtin_cpu_init();
+        features.sse41 = __builtin_cpu_supports("sse4.1");
+        features.avx2 = __builtin_cpu_supports("avx2");
+#    endif
+#endif
+        return features;
+    }
+
+    const CpuFeatures &GetCpuFeatures() {
+        static const CpuFeatures features = DetectCpuFeatures();
+        return features;
+    }
+
+    // Widest level this CPU and build can run, falling back one level at a time
+    NoiseSimdLevel DetectSimdLevel() {
+        for (const NoiseSimdLevel level: {NOISE_SIMD_NEON, NOISE_SIMD_AVX2, NOISE_SIMD_SSE4}) {
+            if (GetNoiseKernels(level))
+                return level;
+        }
+        return NOISE_SIMD_SCALAR;
+    }
+
+    const NoiseKernels &GetActiveKernels() {
+        static const NoiseKernels *kernels = GetNoiseKernels(GetNoiseSimdLevel());
+        return *kernels;
+    }
+}
+
+NoiseSimdLevel GetNoiseSimdLevel() {
+    static const NoiseSimdLevel level = DetectSimdLevel();
+    return level;
+}
+
+const char *GetNoiseSimdLevelName(const NoiseSimdLevel level) {
+    switch (level) {
+        case NOISE_SIMD_SSE4: return "SSE4.1";
+        case NOISE_SIMD_AVX2: return "AVX2";
+        case NOISE_SIMD_NEON: return "NEON";
+        default: return "scalar";
+    }
+}
+
+const NoiseKernels *GetNoiseKernels(const NoiseSimdLevel level) {
+    switch (level) {
+        case NOISE_SIMD_SCALAR: return &SCALAR_KERNELS;
+        // The kernels are compiled in whenever the compiler targets x86, the CPU may still lack the instructions
+        case NOISE_SIMD_SSE4: return GetCpuFeatures().sse41 ? GetNoiseKernelsSSE4() : nullptr;
+        case NOISE_SIMD_AVX2: return GetCpuFeatures().avx2 ? GetNoiseKernelsAVX2() : nullptr;
+        // NEON is mandatory on AArch64, the only target it is compiled for
+        case NOISE_SIMD_NEON: return GetNoiseKernelsNEON();
+        default: return nullptr;
+    }
+}
+
+void Noise2DGrid(const NoiseSettings &settings, const int x0, const int z0, const int sizeX, const int sizeZ,
+                 float *out) {
+    GetActiveKernels().grid2D(settings, x0, z0, sizeX, sizeZ, out);
+}
+
+void Noise3DGrid(const NoiseSettings &settings, const int x0, const int y0, const int z0,
+                 const int sizeX, const int sizeY, const int sizeZ, float *out) {
+    GetActiveKernels().grid3D(settings, x0, y0, z0, sizeX, sizeY, sizeZ, out);
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstdint>
+
+// Fractal gradient noise evaluated over whole grids at once.
+// Every grid call runs through the widest SIMD kernel the CPU supports (selected once at runtime).
+// All kernels perform the same float operations in the same order without fused multiply-add,
+// so results are bit-identical across instruction sets and a server and its clients generate the same world.
+enum NoiseSimdLevel {
+    NOISE_SIMD_SCALAR,
+    NOISE_SIMD_SSE4,
+    NOISE_SIMD_AVX2,
+    NOISE_SIMD_NEON
+};
+
+struct NoiseSettings {
+    int32_t seed = 0;
+    // Of the first octave, in cycles per block
+    float frequency = 0.01f;
+    int octaves = 4;
+    float lacunarity = 2.f;
+    float gain = 0.5f;
+};
+
+// Kernel entry points, one table per instruction set
+struct NoiseKernels {
+    // out[z * sizeX + x], sample at (x0 + x, z0 + z)
+    void (*grid2D)(const NoiseSettings &settings, int x0, int z0, int sizeX, int sizeZ, float *out);
+    // out[(y * sizeZ + z) * sizeX + x], the section index layout for 16^3 grids
+    void (*grid3D)(const NoiseSettings &settings, int x0, int y0, int z0, int sizeX, int sizeY, int sizeZ,
+                   float *out);
+};
+
+NoiseSimdLevel GetNoiseSimdLevel();
+const char *GetNoiseSimdLevelName(NoiseSimdLevel level);
+// Null when the instruction set is unavailable in this build or on this CPU
+const NoiseKernels *GetNoiseKernels(NoiseSimdLevel level);
+
+// Values are roughly in [-1, 1]
+void Noise2DGrid(const NoiseSettings &settings, int x0, int z0, int sizeX, int sizeZ, float *out);
+void Noise3DGrid(const NoiseSettings &settings, int x0, int y0, int z0, int sizeX, int sizeY, int sizeZ, float *out);
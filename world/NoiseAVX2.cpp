@@ -0,0 +1,52 @@
+#include "world/Noise.h"
+
+// Compiled with AVX2 enabled (but not FMA, see Noise.h), only called after the CPU check in Noise.cpp
+#if defined(__x86_64__) || defined(_M_X64)
+
+#include <immintrin.h>
+
+#include "world/NoiseKernels.inl"
+
+namespace {
+    struct AVX2Ops {
+        using F = __m256;
+        using I = __m256i;
+        static constexpr int WIDTH = 8;
+
+        static F Set(const float v) { return _mm256_set1_ps(v); }
+        static I SetI(const int32_t v) { return _mm256_set1_epi32(v); }
+        static F Load(const float *p) { return _mm256_loadu_ps(p); }
+        static void Store(float *p, const F v) { _mm256_storeu_ps(p, v); }
+        static F Add(const F a, const F b) { return _mm256_add_ps(a, b); }
+        static F Sub(const F a, const F b) { return _mm256_sub_ps(a, b); }
+        static F Mul(const F a, const F b) { return _mm256_mul_ps(a, b); }
+        static F Floor(const F v) { return _mm256_floor_ps(v); }
+        static I ToInt(const F v) { return _mm256_cvttps_epi32(v); }
+        static F ToFloat(const I v) { return _mm256_cvtepi32_ps(v); }
+        static I AddI(const I a, const I b) { return _mm256_add_epi32(a, b); }
+        static I MulI(const I a, const I b) { return _mm256_mullo_epi32(a, b); }
+        static I XorI(const I a, const I b) { return _mm256_xor_si256(a, b); }
+        static I AndI(const I a, const I b) { return _mm256_and_si256(a, b); }
+        static I ShlI(const I a, const int n) { return _mm256_sll_epi32(a, _mm_cvtsi32_si128(n)); }
+        static I ShrI(const I a, const int n) { return _mm256_srl_epi32(a, _mm_cvtsi32_si128(n)); }
+        static F CmpEqI(const I a, const I b) { return _mm256_castsi256_ps(_mm256_cmpeq_epi32(a, b)); }
+        static F XorSign(const F v, const I bits) {
+            return _mm256_xor_ps(v, _mm256_castsi256_ps(_mm256_and_si256(bits, _mm256_set1_epi32(INT32_MIN))));
+        }
+        static F Select(const F mask, const F a, const F b) { return _mm256_blendv_ps(b, a, mask); }
+    };
+
+    constexpr NoiseKernels AVX2_KERNELS = MakeNoiseKernels<AVX2Ops>();
+}
+
+const NoiseKernels *GetNoiseKernelsAVX2() {
+    return &AVX2_KERNELS;
+}
+
+#else
+
+const NoiseKernels *GetNoiseKernelsAVX2() {
+    return nullptr;
+}
+
+#endif
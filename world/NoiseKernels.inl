@@ -0,0 +1,252 @@
+// Noise kernels shared by every instruction set.
+// Included by one translation unit per instruction set after it defines its Ops struct:
+//   using F / I          float and int32 vectors, masks are F with all bits set
+//   WIDTH                lanes
+//   Set, SetI, Load, Store, Add, Sub, Mul, Floor (exact), ToInt (of floored values), ToFloat,
+//   AddI, MulI (low 32 bits), XorI, AndI, ShlI, ShrI (logical), CmpEqI (mask), XorSign (F ^ I bits),
+//   Select (mask ? a : b), CastF, CastI
+// Everything lives in an anonymous namespace: the same template instantiated with different compiler
+// target flags must never be merged by the linker.
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+namespace {
+    constexpr float LANE_OFFSETS[16] = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15};
+
+    // Hash constants, large odd multipliers
+    constexpr int32_t HASH_X = 0x27d4eb2d;
+    constexpr int32_t HASH_Y = 0x165667b1;
+    constexpr int32_t HASH_Z = 0x1b873593;
+    constexpr int32_t HASH_MIX = 0x2c1b3c6d;
+
+    // Keeps fractal sums inside about [-1, 1]
+    constexpr float SCALE_2D = 1.0f;
+    constexpr float SCALE_3D = 1.1f;
+
+    float FractalNormalization(const NoiseSettings &settings) {
+        float amplitude = 1.f, total = 0.f;
+        for (int i = 0; i < settings.octaves; ++i) {
+            total += amplitude;
+            amplitude *= settings.gain;
+        }
+        return total > 0.f ? 1.f / total : 0.f;
+    }
+
+    template<typename Ops>
+    typename Ops::I Hash(typename Ops::I h) {
+        h = Ops::XorI(h, Ops::ShrI(h, 15));
+        h = Ops::MulI(h, Ops::SetI(HASH_MIX));
+        return Ops::XorI(h, Ops::ShrI(h, 12));
+    }
+
+    // 6t^5 - 15t^4 + 10t^3
+    template<typename Ops>
+    typename Ops::F Fade(const typename Ops::F t) {
+        auto f = Ops::Sub(Ops::Mul(t, Ops::Set(6.f)), Ops::Set(15.f));
+        f = Ops::Add(Ops::Mul(t, f), Ops::Set(10.f));
+        return Ops::Mul(Ops::Mul(Ops::Mul(t, t), t), f);
+    }
+
+    template<typename Ops>
+    typename Ops::F Lerp(const typename Ops::F a, const typename Ops::F b, const typename Ops::F t) {
+        return Ops::Add(a, Ops::Mul(t, Ops::Sub(b, a)));
+    }
+
+    // Gradients (+-1, +-1), (+-1, 0) and (0, +-1): bits 0-1 flip the signs, bits 2-3 may zero one axis
+    template<typename Ops>
+    typename Ops::F Gradient2D(const typename Ops::I h, const typename Ops::F x, const typename Ops::F y) {
+        const auto gx = Ops::XorSign(x, Ops::ShlI(h, 31));
+        const auto gy = Ops::XorSign(y, Ops::ShlI(Ops::ShrI(h, 1), 31));
+        const auto axis = Ops::AndI(Ops::ShrI(h, 2), Ops::SetI(3));
+        const auto zero = Ops::Set(0.f);
+        return Ops::Add(Ops::Select(Ops::CmpEqI(axis, Ops::SetI(0)), zero, gx),
+                        Ops::Select(Ops::CmpEqI(axis, Ops::SetI(1)), zero, gy));
+    }
+
+    // Edge gradients of a cube with the odd corner one: bits 0-2 flip the signs, bits 3-4 zero one axis or none
+    template<typename Ops>
+    typename Ops::F Gradient3D(const typename Ops::I h, const typename Ops::F x, const typename Ops::F y,
+                               const typename Ops::F z) {
+        const auto gx = Ops::XorSign(x, Ops::ShlI(h, 31));
+        const auto gy = Ops::XorSign(y, Ops::ShlI(Ops::ShrI(h, 1), 31));
+        const auto gz = Ops::XorSign(z, Ops::ShlI(Ops::ShrI(h, 2), 31));
+        const auto axis = Ops::AndI(Ops::ShrI(h, 3), Ops::SetI(3));
+        const auto zero = Ops::Set(0.f);
+        const auto sum = Ops::Add(Ops::Select(Ops::CmpEqI(axis, Ops::SetI(0)), zero, gx),
+                                  Ops::Select(Ops::CmpEqI(axis, Ops::SetI(1)), zero, gy));
+        return Ops::Add(sum, Ops::Select(Ops::CmpEqI(axis, Ops::SetI(2)), zero, gz));
+    }
+
+    template<typename Ops>
+    typename Ops::F Gradient2DAt(const typename Ops::I seed, const typename Ops::I hx, const typename Ops::I hy,
+                                 const typename Ops::F x, const typename Ops::F y) {
+        return Gradient2D<Ops>(Hash<Ops>(Ops::XorI(seed, Ops::XorI(hx, hy))), x, y);
+    }
+
+    template<typename Ops>
+    typename Ops::F Noise2D(const typename Ops::I seed, const typename Ops::F x, const typename Ops::F y) {
+        const auto x0 = Ops::Floor(x), y0 = Ops::Floor(y);
+        const auto fx = Ops::Sub(x, x0), fy = Ops::Sub(y, y0);
+        const auto one = Ops::Set(1.f);
+        const auto fx1 = Ops::Sub(fx, one), fy1 = Ops::Sub(fy, one);
+
+        const auto hx0 = Ops::MulI(Ops::ToInt(x0), Ops::SetI(HASH_X));
+        const auto hy0 = Ops::MulI(Ops::ToInt(y0), Ops::SetI(HASH_Y));
+        const auto hx1 = Ops::AddI(hx0, Ops::SetI(HASH_X));
+        const auto hy1 = Ops::AddI(hy0, Ops::SetI(HASH_Y));
+
+        const auto n00 = Gradient2DAt<Ops>(seed, hx0, hy0, fx, fy);
+        const auto n10 = Gradient2DAt<Ops>(seed, hx1, hy0, fx1, fy);
+        const auto n01 = Gradient2DAt<Ops>(seed, hx0, hy1, fx, fy1);
+        const auto n11 = Gradient2DAt<Ops>(seed, hx1, hy1, fx1, fy1);
+
+        const auto u = Fade<Ops>(fx), v = Fade<Ops>(fy);
+        return Lerp<Ops>(Lerp<Ops>(n00, n10, u), Lerp<Ops>(n01, n11, u), v);
+    }
+
+    template<typename Ops>
+    typename Ops::F Noise3D(const typename Ops::I seed, const typename Ops::F x, const typename Ops::F y,
+                            const typename Ops::F z) {
+        const auto x0 = Ops::Floor(x), y0 = Ops::Floor(y), z0 = Ops::Floor(z);
+        const auto fx = Ops::Sub(x, x0), fy = Ops::Sub(y, y0), fz = Ops::Sub(z, z0);
+        const auto one = Ops::Set(1.f);
+        const auto fx1 = Ops::Sub(fx, one), fy1 = Ops::Sub(fy, one), fz1 = Ops::Sub(fz, one);
+
+        const auto hx0 = Ops::MulI(Ops::ToInt(x0), Ops::SetI(HASH_X));
+        const auto hy0 = Ops::MulI(Ops::ToInt(y0), Ops::SetI(HASH_Y));
+        const auto hz0 = Ops::MulI(Ops::ToInt(z0), Ops::SetI(HASH_Z));
+        const auto hx1 = Ops::AddI(hx0, Ops::SetI(HASH_X));
+        const auto hy1 = Ops::AddI(hy0, Ops::SetI(HASH_Y));
+        const auto hz1 = Ops::AddI(hz0, Ops::SetI(HASH_Z));
+
+        const auto corner = [&](const typename Ops::I hx, const typename Ops::I hy, const typename Ops::I hz,
+                                const typename Ops::F px, const typename Ops::F py, const typename Ops::F pz) {
+            const auto h = Hash<Ops>(Ops::XorI(seed, Ops::XorI(hx, Ops::XorI(hy, hz))));
+            return Gradient3D<Ops>(h, px, py, pz);
+        };
+
+        const auto u = Fade<Ops>(fx), v = Fade<Ops>(fy), w = Fade<Ops>(fz);
+        const auto nz0 = Lerp<Ops>(Lerp<Ops>(corner(hx0, hy0, hz0, fx, fy, fz), corner(hx1, hy0, hz0, fx1, fy, fz), u),
+                                   Lerp<Ops>(corner(hx0, hy1, hz0, fx, fy1, fz), corner(hx1, hy1, hz0, fx1, fy1, fz), u),
+                                   v);
+        const auto nz1 = Lerp<Ops>(Lerp<Ops>(corner(hx0, hy0, hz1, fx, fy, fz1), corner(hx1, hy0, hz1, fx1, fy, fz1), u),
+                                   Lerp<Ops>(corner(hx0, hy1, hz1, fx, fy1, fz1), corner(hx1, hy1, hz1, fx1, fy1, fz1), u),
+                                   v);
+        return Lerp<Ops>(nz0, nz1, w);
+    }
+
+    template<typename Ops>
+    typename Ops::F Fractal2D(const NoiseSettings &settings, const float normalization,
+                              const typename Ops::F x, const typename Ops::F y) {
+        auto sum = Ops::Set(0.f);
+        float frequency = settings.frequency, amplitude = normalization * SCALE_2D;
+        for (int octave = 0; octave < settings.octaves; ++octave) {
+            const auto seed = Ops::SetI(settings.seed + octave * 0x3c6ef372);
+            const auto f = Ops::Set(frequency);
+            sum = Ops::Add(sum, Ops::Mul(Ops::Set(amplitude), Noise2D<Ops>(seed, Ops::Mul(x, f), Ops::Mul(y, f))));
+            frequency *= settings.lacunarity;
+            amplitude *= settings.gain;
+        }
+        return sum;
+    }
+
+    template<typename Ops>
+    typename Ops::F Fractal3D(const NoiseSettings &settings, const float normalization,
+                              const typename Ops::F x, const typename Ops::F y, const typename Ops::F z) {
+        auto sum = Ops::Set(0.f);
+        float frequency = settings.frequency, amplitude = normalization * SCALE_3D;
+        for (int octave = 0; octave < settings.octaves; ++octave) {
+            const auto seed = Ops::SetI(settings.seed + octave * 0x3c6ef372);
+            const auto f = Ops::Set(frequency);
+            const auto n = Noise3D<Ops>(seed, Ops::Mul(x, f), Ops::Mul(y, f), Ops::Mul(z, f));
+            sum = Ops::Add(sum, Ops::Mul(Ops::Set(amplitude), n));
+            frequency *= settings.lacunarity;
+            amplitude *= settings.gain;
+        }
+        return sum;
+    }
+
+    // Scalar lanes for row tails, identical math
+    struct TailOps {
+        using F = float;
+        using I = int32_t;
+        static constexpr int WIDTH = 1;
+
+        static F Set(const float v) { return v; }
+        static I SetI(const int32_t v) { return v; }
+        static F Load(const float *p) { return *p; }
+        static void Store(float *p, const F v) { *p = v; }
+        static F Add(const F a, const F b) { return a + b; }
+        static F Sub(const F a, const F b) { return a - b; }
+        static F Mul(const F a, const F b) { return a * b; }
+        static F Floor(const F v) { return std::floor(v); }
+        static I ToInt(const F v) { return static_cast<I>(v); }
+        static F ToFloat(const I v) { return static_cast<F>(v); }
+        static I AddI(const I a, const I b) { return static_cast<I>(static_cast<uint32_t>(a) + static_cast<uint32_t>(b)); }
+        static I MulI(const I a, const I b) { return static_cast<I>(static_cast<uint32_t>(a) * static_cast<uint32_t>(b)); }
+        static I XorI(const I a, const I b) { return a ^ b; }
+        static I AndI(const I a, const I b) { return a & b; }
+        static I ShlI(const I a, const int n) { return static_cast<I>(static_cast<uint32_t>(a) << n); }
+        static I ShrI(const I a, const int n) { return static_cast<I>(static_cast<uint32_t>(a) >> n); }
+        static bool CmpEqI(const I a, const I b) { return a == b; }
+        static F XorSign(const F v, const I bits) {
+            uint32_t u;
+            std::memcpy(&u, &v, sizeof(u));
+            u ^= static_cast<uint32_t>(bits) & 0x80000000u;
+            F result;
+            std::memcpy(&result, &u, sizeof(result));
+            return result;
+        }
+        static F Select(const bool mask, const F a, const F b) { return mask ? a : b; }
+    };
+
+    template<typename Ops>
+    void Grid2D(const NoiseSettings &settings, const int x0, const int z0, const int sizeX, const int sizeZ,
+                float *out) {
+        const float normalization = FractalNormalization(settings);
+        const auto lanes = Ops::Load(LANE_OFFSETS);
+        for (int z = 0; z < sizeZ; ++z) {
+            const auto pz = Ops::Set(static_cast<float>(z0 + z));
+            const auto tz = TailOps::Set(static_cast<float>(z0 + z));
+            float *row = out + z * sizeX;
+            int x = 0;
+            for (; x + Ops::WIDTH <= sizeX; x += Ops::WIDTH) {
+                const auto px = Ops::Add(Ops::Set(static_cast<float>(x0 + x)), lanes);
+                Ops::Store(row + x, Fractal2D<Ops>(settings, normalization, px, pz));
+            }
+            for (; x < sizeX; ++x)
+                row[x] = Fractal2D<TailOps>(settings, normalization, static_cast<float>(x0 + x), tz);
+        }
+    }
+
+    template<typename Ops>
+    void Grid3D(const NoiseSettings &settings, const int x0, const int y0, const int z0,
+                const int sizeX, const int sizeY, const int sizeZ, float *out) {
+        const float normalization = FractalNormalization(settings);
+        const auto lanes = Ops::Load(LANE_OFFSETS);
+        for (int y = 0; y < sizeY; ++y) {
+            const auto py = Ops::Set(static_cast<float>(y0 + y));
+            for (int z = 0; z < sizeZ; ++z) {
+                const auto pz = Ops::Set(static_cast<float>(z0 + z));
+                float *row = out + (y * sizeZ + z) * sizeX;
+                int x = 0;
+                for (; x + Ops::WIDTH <= sizeX; x += Ops::WIDTH) {
+                    const auto px = Ops::Add(Ops::Set(static_cast<float>(x0 + x)), lanes);
+                    Ops::Store(row + x, Fractal3D<Ops>(settings, normalization, px, py, pz));
+                }
+                for (; x < sizeX; ++x) {
+                    row[x] = Fractal3D<TailOps>(settings, normalization, static_cast<float>(x0 + x),
+                                                static_cast<float>(y0 + y), static_cast<float>(z0 + z));
+                }
+            }
+        }
+    }
+
+    template<typename Ops>
+    constexpr NoiseKernels MakeNoiseKernels() {
+        return {&Grid2D<Ops>, &Grid3D<Ops>};
+    }
+}
@@ -0,0 +1,54 @@
+#include "world/Noise.h"
+
+#if defined(__aarch64__) || defined(_M_ARM64)
+
+#include <arm_neon.h>
+
+#include "world/NoiseKernels.inl"
+
+namespace {
+    struct NEONOps {
+        using F = float32x4_t;
+        using I = int32x4_t;
+        static constexpr int WIDTH = 4;
+
+        static F Set(const float v) { return vdupq_n_f32(v); }
+        static I SetI(const int32_t v) { return vdupq_n_s32(v); }
+        static F Load(const float *p) { return vld1q_f32(p); }
+        static void Store(float *p, const F v) { vst1q_f32(p, v); }
+        static F Add(const F a, const F b) { return vaddq_f32(a, b); }
+        static F Sub(const F a, const F b) { return vsubq_f32(a, b); }
+        static F Mul(const F a, const F b) { return vmulq_f32(a, b); }
+        static F Floor(const F v) { return vrndmq_f32(v); }
+        static I ToInt(const F v) { return vcvtq_s32_f32(v); }
+        static F ToFloat(const I v) { return vcvtq_f32_s32(v); }
+        static I AddI(const I a, const I b) { return vaddq_s32(a, b); }
+        static I MulI(const I a, const I b) { return vmulq_s32(a, b); }
+        static I XorI(const I a, const I b) { return veorq_s32(a, b); }
+        static I AndI(const I a, const I b) { return vandq_s32(a, b); }
+        static I ShlI(const I a, const int n) { return vshlq_s32(a, vdupq_n_s32(n)); }
+        static I ShrI(const I a, const int n) {
+            return vreinterpretq_s32_u32(vshlq_u32(vreinterpretq_u32_s32(a), vdupq_n_s32(-n)));
+        }
+        static uint32x4_t CmpEqI(const I a, const I b) { return vceqq_s32(a, b); }
+        static F XorSign(const F v, const I bits) {
+            const uint32x4_t sign = vandq_u32(vreinterpretq_u32_s32(bits), vdupq_n_u32(0x80000000u));
+            return vreinterpretq_f32_u32(veorq_u32(vreinterpretq_u32_f32(v), sign));
+        }
+        static F Select(const uint32x4_t mask, const F a, const F b) { return vbslq_f32(mask, a, b); }
+    };
+
+    constexpr NoiseKernels NEON_KERNELS = MakeNoiseKernels<NEONOps>();
+}
+
+const NoiseKernels *GetNoiseKernelsNEON() {
+    return &NEON_KERNELS;
+}
+
+#else
+
+const NoiseKernels *GetNoiseKernelsNEON() {
+    return nullptr;
+}
+
+#endif
@@ -0,0 +1,52 @@
+#include "world/Noise.h"
+
+// Compiled with SSE4.1 enabled, only called after the CPU check in Noise.cpp
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+
+#include <smmintrin.h>
+
+#include "world/NoiseKernels.inl"
+
+namespace {
+    struct SSE4Ops {
+        using F = __m128;
+        using I = __m128i;
+        static constexpr int WIDTH = 4;
+
+        static F Set(const float v) { return _mm_set1_ps(v); }
+        static I SetI(const int32_t v) { return _mm_set1_epi32(v); }
+        static F Load(const float *p) { return _mm_loadu_ps(p); }
+        static void Store(float *p, const F v) { _mm_storeu_ps(p, v); }
+        static F Add(const F a, const F b) { return _mm_add_ps(a, b); }
+        static F Sub(const F a, const F b) { return _mm_sub_ps(a, b); }
+        static F Mul(const F a, const F b) { return _mm_mul_ps(a, b); }
+        static F Floor(const F v) { return _mm_floor_ps(v); }
+        static I ToInt(const F v) { return _mm_cvttps_epi32(v); }
+        static F ToFloat(const I v) { return _mm_cvtepi32_ps(v); }
+        static I AddI(const I a, const I b) { return _mm_add_epi32(a, b); }
+        static I MulI(const I a, const I b) { return _mm_mullo_epi32(a, b); }
+        static I XorI(const I a, const I b) { return _mm_xor_si128(a, b); }
+        static I AndI(const I a, const I b) { return _mm_and_si128(a, b); }
+        static I ShlI(const I a, const int n) { return _mm_sll_epi32(a, _mm_cvtsi32_si128(n)); }
+        static I ShrI(const I a, const int n) { return _mm_srl_epi32(a, _mm_cvtsi32_si128(n)); }
+        static F CmpEqI(const I a, const I b) { return _mm_castsi128_ps(_mm_cmpeq_epi32(a, b)); }
+        static F XorSign(const F v, const I bits) {
+            return _mm_xor_ps(v, _mm_castsi128_ps(_mm_and_si128(bits, _mm_set1_epi32(INT32_MIN))));
+        }
+        static F Select(const F mask, const F a, const F b) { return _mm_blendv_ps(b, a, mask); }
+    };
+
+    constexpr NoiseKernels SSE4_KERNELS = MakeNoiseKernels<SSE4Ops>();
+}
+
+const NoiseKernels *GetNoiseKernelsSSE4() {
+    return &SSE4_KERNELS;
+}
+
+#else
+
+const NoiseKernels *GetNoiseKernelsSSE4() {
+    return nullptr;
+}
+
+#endif
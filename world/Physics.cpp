@@ -0,0 +1,77 @@
+#include "world/Physics.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+    // Boxes resting exactly on a block boundary count as touching, not overlapping, the blocks on the other side
+    constexpr float EPSILON = 1e-4f;
+
+    int FloorToInt(const float v) {
+        return static_cast<int>(std::floor(v));
+    }
+
+    // Whether any block of the box's cross-section on the other two axes at layer c of axis is solid
+    bool IsLayerSolid(BlockReader &reader, const Aabb &box, const int axis, const int c) {
+        const int u = (axis + 1) % 3, v = (axis + 2) % 3;
+        const int u0 = FloorToInt(box.min[u] + EPSILON), u1 = FloorToInt(box.max[u] - EPSILON);
+        const int v0 = FloorToInt(box.min[v] + EPSILON), v1 = FloorToInt(box.max[v] - EPSILON);
+        for (int j = v0; j <= v1; ++j) {
+            for (int i = u0; i <= u1; ++i) {
+                int p[3];
+                p[axis] = c, p[u] = i, p[v] = j;
+                if (IsSolid(reader.Get(p[0], p[1], p[2])))
+                    return true;
+            }
+        }
+        return false;
+    }
+
+    // Returns the part of delta the box can move along axis
+    float Sweep(BlockReader &reader, const Aabb &box, const int axis, float delta) {
+        if (delta > 0.f) {
+            // Layers whose near side lies between the box's far side and where it would end up
+            const int first = static_cast<int>(std::ceil(box.max[axis] - EPSILON));
+            const int last = FloorToInt(box.max[axis] + delta);
+            for (int c = first; c <= last; ++c) {
+                if (static_cast<float>(c) < box.max[axis] + delta && IsLayerSolid(reader, box, axis, c)) {
+                    delta = std::max(0.f, static_cast<float>(c) - box.max[axis]);
+                    break;
+                }
+            }
+        } else if (delta < 0.f) {
+            const int first = FloorToInt(box.min[axis] + EPSILON) - 1;
+            const int last = FloorToInt(box.min[axis] + delta);
+            for (int c = first; c >= last; --c) {
+                if (static_cast<float>(c + 1) > box.min[axis] + delta && IsLayerSolid(reader, box, axis, c)) {
+                    delta = std::min(0.f, static_cast<float>(c + 1) - box.min[axis]);
+                    break;
+                }
+            }
+        }
+        return delta;
+    }
+}
+
+uint32_t MoveAabb(BlockReader &reader, Aabb &box, float (&motion)[3]) {
+    uint32_t collided = 0;
+    for (const int axis: {1, 0, 2}) {
+        const float delta = Sweep(reader, box, axis, motion[axis]);
+        if (delta != motion[axis])
+            collided |= 1u << axis;
+        motion[axis] = delta;
+        box.min[axis] += delta;
+        box.max[axis] += delta;
+    }
+    return collided;
+}
+
+void Broadphase::Build(const std::span<const Aabb> boxes) {
+    m_boxes.assign(boxes.begin(), boxes.end());
+    m_order.resize(m_boxes.size());
+    for (uint32_t i = 0; i < m_order.size(); ++i)
+        m_order[i] = i;
+    std::sort(m_order.begin(), m_order.end(), [this](const uint32_t a, const uint32_t b) {
+        return m_boxes[a].min[0] != m_boxes[b].min[0] ? m_boxes[a].min[0] < m_boxes[b].min[0] : a < b;
+    });
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include "world/BlockReader.h"
+
+// Axis-aligned box in blocks
+struct Aabb {
+    float min[3] = {0.f, 0.f, 0.f};
+    float max[3] = {0.f, 0.f, 0.f};
+
+    bool Overlaps(const Aabb &other) const {
+        return min[0] < other.max[0] && other.min[0] < max[0] && min[1] < other.max[1] && other.min[1] < max[1] &&
+               min[2] < other.max[2] && other.min[2] < max[2];
+    }
+};
+
+enum CollisionAxis : uint32_t {
+    COLLISION_X = 1u << 0,
+    COLLISION_Y = 1u << 1,
+    COLLISION_Z = 1u << 2
+};
+
+// Sweeps the box through the solid blocks by motion, one axis at a time, Y first so boxes slide along the ground.
+// On each axis the motion is cut short at the first solid block the box would enter; the box ends up touching it.
+// motion is left holding the distance actually moved. Returns the CollisionAxis bits of the axes that were cut.
+// A box already inside solid blocks can move out of them, never further in.
+uint32_t MoveAabb(BlockReader &reader, Aabb &box, float (&motion)[3]);
+
+// Sort and sweep on X: boxes are sorted by where they start on X, each is only tested against those starting before
+// it ends. Close to linear for entities spread over the ground; rebuilt every tick.
+class Broadphase {
+public:
+    // Keeps a copy, pairs are reported for the boxes as built
+    void Build(std::span<const Aabb> boxes);
+
+    // fn(i, j) for every pair of overlapping boxes, indices into the boxes built from, with i before j on X.
+    // The order only depends on the boxes
+    template<typename Fn>
+    void ForEachPair(Fn &&fn) const {
+        for (size_t a = 0; a < m_order.size(); ++a) {
+            const Aabb &box = m_boxes[m_order[a]];
+            for (size_t b = a + 1; b < m_order.size(); ++b) {
+                const Aabb &other = m_boxes[m_order[b]];
+                if (other.min[0] >= box.max[0])
+                    break;
+                if (box.Overlaps(other))
+                    fn(m_order[a], m_order[b]);
+            }
+        }
+    }
+
+private:
+    std::vector<Aabb> m_boxes;
+    std::vector<uint32_t> m_order;
+};
@@ -0,0 +1,61 @@
+#include "world/Raycast.h"
+
+#include <cmath>
+#include <limits>
+
+#include "world/BlockReader.h"
+
+void RaycastHit::GetAdjacent(int32_t &ax, int32_t &ay, int32_t &az) const {
+    int32_t cell[3] = {x, y, z};
+    if (face >= 0)
+        cell[face / 2] += (face & 1) == 0 ? 1 : -1;
+    ax = cell[0], ay = cell[1], az = cell[2];
+}
+
+bool Raycast(const World &world, const float (&origin)[3], const float (&direction)[3], const float maxDistance,
+             RaycastHit &hit) {
+    const float length = std::sqrt(direction[0] * direction[0] + direction[1] * direction[1] +
+                                   direction[2] * direction[2]);
+    if (length < 1e-6f)
+        return false;
+
+    // Per axis: the block stepped into next, the distance along the ray to the next boundary and between two
+    int cell[3], step[3];
+    float tMax[3], tDelta[3];
+    for (int axis = 0; axis < 3; ++axis) {
+        const float d = direction[axis] / length;
+        cell[axis] = static_cast<int>(std::floor(origin[axis]));
+        if (d == 0.f) {
+            step[axis] = 0;
+            tMax[axis] = tDelta[axis] = std::numeric_limits<float>::infinity();
+            continue;
+        }
+        step[axis] = d > 0.f ? 1 : -1;
+        tDelta[axis] = std::abs(1.f / d);
+        const float boundary = static_cast<float>(cell[axis] + (d > 0.f ? 1 : 0));
+        tMax[axis] = (boundary - origin[axis]) / d;
+    }
+
+    BlockReader reader(world);
+    int face = -1;
+    float t = 0.f;
+    while (t <= maxDistance) {
+        const BlockId block = reader.Get(cell[0], cell[1], cell[2]);
+        if (IsSolid(block)) {
+            hit = {cell[0], cell[1], cell[2], face, t, block};
+            return true;
+        }
+
+        const int axis = tMax[0] < tMax[1] ? (tMax[0] < tMax[2] ? 0 : 2) : (tMax[1] < tMax[2] ? 1 : 2);
+        t = tMax[axis];
+        cell[axis] += step[axis];
+        tMax[axis] += tDelta[axis];
+        // Entered through the face looking back along the step
+        face = axis * 2 + (step[axis] > 0 ? 1 : 0);
+
+        // Nothing above or below the world to hit
+        if ((cell[1] < 0 && step[1] <= 0) || (cell[1] >= Chunk::HEIGHT && step[1] >= 0))
+            return false;
+    }
+    return false;
+}
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <cstdint>
+
+#include "world/World.h"
+
+struct RaycastHit {
+    int32_t x = 0, y = 0, z = 0;
+    // Face the ray entered the block through, 0 +X, 1 -X, 2 +Y, 3 -Y, 4 +Z, 5 -Z; -1 when it started inside it
+    int face = -1;
+    // Along the ray, in blocks
+    float distance = 0.f;
+    BlockId block = BLOCK_AIR;
+
+    // Block in front of the hit face, where a block placed against it goes
+    void GetAdjacent(int32_t &ax, int32_t &ay, int32_t &az) const;
+};
+
+// First solid block along the ray from origin in direction (need not be normalized), at most maxDistance away.
+// Amanatides-Woo traversal: steps from block boundary to block boundary, visiting every block the ray passes
+// through exactly once, reading them through a BlockReader.
+bool Raycast(const World &world, const float (&origin)[3], const float (&direction)[3], float maxDistance,
+             RaycastHit &hit);
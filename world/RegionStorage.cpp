@@ -0,0 +1,332 @@
+#include "world/RegionStorage.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <filesystem>
+
+#include <spdlog/spdlog.h>
+
+#include "world/ChunkSerializer.h"
+
+namespace {
+    constexpr uint32_t REGION_MAGIC = 0x47524350; // "PCRG"
+    constexpr uint32_t REGION_VERSION = 1;
+
+}
+
+struct RegionStorage::FileHeader {
+    uint32_t magic;
+    uint32_t version;
+    std::array<TableEntry, CHUNKS_PER_REGION> table;
+};
+
+RegionStorage::RegionStorage(std::string directory) : m_directory(std::move(directory)) {
+    std::error_code error;
+    std::filesystem::create_directories(m_directory, error);
+    if (error)
+        spdlog::error("Failed to create save directory {}: {}", m_directory, error.message());
+    m_thread = std::thread(&RegionStorage::IoThread, this);
+}
+
+RegionStorage::~RegionStorage() {
+    {
+        std::lock_guard lock(m_queueMutex);
+        m_stop = true;
+    }
+    m_queueCondition.notify_one();
+    m_thread.join();
+}
+
+void RegionStorage::SaveChunk(const Chunk &chunk) {
+    std::vector<uint8_t> data;
+    SerializeChunk(chunk, data);
+    {
+        std::lock_guard lock(m_queueMutex);
+        // A newer save of the same chunk replaces one that was not written yet
+        m_queued[chunk.GetPos()] = std::move(data);
+    }
+    m_queueCondition.notify_one();
+}
+
+bool RegionStorage::LoadChunk(Chunk &chunk) {
+    const ChunkPos pos = chunk.GetPos();
+    {
+        std::unique_lock lock(m_queueMutex);
+        const std::vector<uint8_t> *pQueued = nullptr;
+        if (const auto it = m_queued.find(pos); it != m_queued.end())
+            pQueued = &it->second;
+        else if (const auto writing = m_writing.find(pos); writing != m_writing.end())
+            pQueued = &writing->second;
+        if (pQueued) {
+            const std::vector<uint8_t> data = *pQueued;
+            lock.unlock();
+            if (!DeserializeChunk(data.data(), data.size(), chunk))
+                return false;
+            chunk.SetDirty(false);
+            return true;
+        }
+    }
+
+    thread_local std::vector<uint8_t> payload, data;
+    if (!ReadPayload(pos, payload))
+        return false;
+    if (!DecompressChunkPayload(payload.data(), payload.size(), data) ||
+        !DeserializeChunk(data.data(), data.size(), chunk)) {
+        spdlog::warn("Chunk {}, {} in {} is damaged, regenerating it", pos.x, pos.z,
+                     GetRegionPath(ToRegionPos(pos)));
+        return false;
+    }
+    chunk.SetDirty(false);
+    return true;
+}
+
+bool RegionStorage::ReadStoredPayload(const ChunkPos pos, std::vector<uint8_t> &out) {
+    {
+        // What is on disk is stale while a save is pending
+        std::lock_guard lock(m_queueMutex);
+        if (m_queued.contains(pos) || m_writing.contains(pos))
+            return false;
+    }
+    return ReadPayload(pos, out);
+}
+
+bool RegionStorage::ReadPayload(const ChunkPos pos, std::vector<uint8_t> &out) {
+    Region *region = GetRegion(ToRegionPos(pos), false);
+    if (!region)
+        return false;
+
+    std::shared_lock lock(region->lock);
+    const TableEntry entry = region->table[ToTableIndex(pos)];
+    if (entry.sectorOffset == 0)
+        return false;
+
+    const uint64_t offset = static_cast<uint64_t>(entry.sectorOffset) * SECTOR_SIZE;
+    if (offset + entry.byteSize > region->file.GetMappedSize())
+        return false;
+    const uint8_t *payload = region->file.GetData() + offset;
+    const size_t size = GetChunkPayloadSize(payload, entry.byteSize);
+    if (size == 0)
+        return false;
+    out.assign(payload, payload + size);
+    return true;
+}
+
+void RegionStorage::Flush() {
+    std::unique_lock lock(m_queueMutex);
+    m_idleCondition.wait(lock, [this] { return m_queued.empty() && m_writing.empty(); });
+}
+
+size_t RegionStorage::GetQueuedCount() const {
+    std::lock_guard lock(m_queueMutex);
+    return m_queued.size() + m_writing.size();
+}
+
+RegionStorage::RegionPos RegionStorage::ToRegionPos(const ChunkPos pos) {
+    return {pos.x >> 5, pos.z >> 5};
+}
+
+uint32_t RegionStorage::ToTableIndex(const ChunkPos pos) {
+    return static_cast<uint32_t>((pos.z & (REGION_SIZE - 1)) * REGION_SIZE + (pos.x & (REGION_SIZE - 1)));
+}
+
+std::string RegionStorage::GetRegionPath(const RegionPos pos) const {
+    return (std::filesystem::path(m_directory) / ("r." + std::to_string(pos.x) + "." + std::to_string(pos.z) + ".pcr"))
+        .string();
+}
+
+RegionStorage::Region *RegionStorage::GetRegion(const RegionPos pos, const bool create) {
+    std::lock_guard lock(m_regionsMutex);
+    if (const auto it = m_regions.find(pos); it != m_regions.end())
+        return it->second.get();
+
+    const std::string path = GetRegionPath(pos);
+    std::error_code error;
+    if (!create && !std::filesystem::exists(path, error))
+        return nullptr;
+
+    auto region = std::make_unique<Region>();
+    if (!OpenRegion(*region, path)) {
+        // Remembered as unusable, so a broken file is neither retried nor overwritten
+        m_regions.emplace(pos, nullptr);
+        return nullptr;
+    }
+    return m_regions.emplace(pos, std::move(region)).first->second.get();
+}
+
+bool RegionStorage::OpenRegion(Region &region, const std::string &path) {
+    static_assert(sizeof(FileHeader) <= HEADER_SECTORS * SECTOR_SIZE);
+    if (!region.file.Open(path)) {
+        spdlog::error("Failed to open region file {}", path);
+        return false;
+    }
+
+    if (region.file.GetFileSize() == 0) {
+        FileHeader header{REGION_MAGIC, REGION_VERSION, {}};
+        if (!region.file.Write(0, &header, sizeof(header))) {
+            spdlog::error("Failed to write region file {}", path);
+            return false;
+        }
+    }
+    if (!region.file.Remap() || region.file.GetMappedSize() < sizeof(FileHeader)) {
+        spdlog::error("Failed to map region file {}", path);
+        return false;
+    }
+
+    FileHeader header;
+    std::memcpy(&header, region.file.GetData(), sizeof(header));
+    if (header.magic != REGION_MAGIC || header.version != REGION_VERSION) {
+        spdlog::error("{} is not a version {} region file", path, REGION_VERSION);
+        return false;
+    }
+
+    const uint64_t fileSize = region.file.GetMappedSize();
+    region.sectorCount = std::max(HEADER_SECTORS, static_cast<uint32_t>((fileSize + SECTOR_SIZE - 1) / SECTOR_SIZE));
+    region.usedSectors.assign((region.sectorCount + 63) / 64, 0);
+    region.table = {};
+    SetSectorsUsed(region, 0, HEADER_SECTORS, true);
+
+    uint32_t dropped = 0;
+    for (uint32_t i = 0; i < CHUNKS_PER_REGION; ++i) {
+        const TableEntry &entry = header.table[i];
+        if (entry.sectorOffset == 0)
+            continue;
+        const uint64_t end = static_cast<uint64_t>(entry.sectorOffset) * SECTOR_SIZE + entry.byteSize;
+        if (entry.sectorOffset < HEADER_SECTORS || entry.byteSize == 0 || end > fileSize) {
+            ++dropped;
+            continue;
+        }
+        region.table[i] = entry;
+        SetSectorsUsed(region, entry.sectorOffset,
+                       (entry.byteSize + SECTOR_SIZE - 1) / SECTOR_SIZE, true);
+    }
+    if (dropped > 0)
+        spdlog::warn("Dropped {} chunks pointing past the end of {}", dropped, path);
+    return true;
+}
+
+uint32_t RegionStorage::AllocateSectors(Region &region, const uint32_t count) {
+    // First fit; a free run reaching the end of the file is extended past it
+    uint32_t first = HEADER_SECTORS, run = 0;
+    for (uint32_t sector = HEADER_SECTORS; sector < region.sectorCount && run < count; ++sector) {
+        if (region.usedSectors[sector / 64] & (1ull << (sector % 64))) {
+            first = sector + 1;
+            run = 0;
+        } else {
+            ++run;
+        }
+    }
+    SetSectorsUsed(region, first, count, true);
+    return first;
+}
+
+void RegionStorage::SetSectorsUsed(Region &region, const uint32_t first, const uint32_t count, const bool used) {
+    region.sectorCount = std::max(region.sectorCount, first + count);
+    if (region.usedSectors.size() * 64 < region.sectorCount)
+        region.usedSectors.resize((region.sectorCount + 63) / 64, 0);
+    for (uint32_t sector = first; sector < first + count; ++sector) {
+        if (used)
+            region.usedSectors[sector / 64] |= 1ull << (sector % 64);
+        else
+            region.usedSectors[sector / 64] &= ~(1ull << (sector % 64));
+    }
+}
+
+void RegionStorage::IoThread() {
+    std::unique_lock lock(m_queueMutex);
+    while (true) {
+        m_queueCondition.wait(lock, [this] { return m_stop || !m_queued.empty(); });
+        if (m_queued.empty())
+            break;
+
+        m_writing.swap(m_queued);
+        lock.unlock();
+        WriteBatch();
+        lock.lock();
+        m_writing.clear();
+        m_idleCondition.notify_all();
+    }
+}
+
+void RegionStorage::WriteBatch() {
+    m_batch.clear();
+    for (const auto &[pos, data]: m_writing)
+        m_batch.push_back({pos, &data});
+    std::sort(m_batch.begin(), m_batch.end(), [](const PendingSave &a, const PendingSave &b) {
+        const RegionPos ra = ToRegionPos(a.pos), rb = ToRegionPos(b.pos);
+        return ra.x != rb.x ? ra.x < rb.x : ra.z < rb.z;
+    });
+
+    for (size_t begin = 0; begin < m_batch.size();) {
+        const RegionPos regionPos = ToRegionPos(m_batch[begin].pos);
+        size_t end = begin + 1;
+        while (end < m_batch.size() && ToRegionPos(m_batch[end].pos) == regionPos)
+            ++end;
+
+        if (Region *region = GetRegion(regionPos, true))
+            WriteRegion(*region, m_batch.data() + begin, end - begin);
+        else
+            spdlog::error("Dropped {} chunk saves for {}", end - begin, GetRegionPath(regionPos));
+        begin = end;
+    }
+}
+
+void RegionStorage::WriteRegion(Region &region, const PendingSave *saves, const size_t count) {
+    struct Commit {
+        uint32_t index;
+        TableEntry entry;
+    };
+    std::vector<Commit> commits;
+    commits.reserve(count);
+
+    // Payloads go to sectors no table entry points to, readers cannot see them until the commit below
+    for (size_t i = 0; i < count; ++i) {
+        const std::vector<uint8_t> &data = *saves[i].data;
+        CompressChunkPayload(data.data(), data.size(), m_payload);
+
+        const auto byteSize = static_cast<uint32_t>(m_payload.size());
+        const uint32_t sectors = (byteSize + SECTOR_SIZE - 1) / SECTOR_SIZE;
+        const uint32_t first = AllocateSectors(region, sectors);
+        if (!region.file.Write(static_cast<uint64_t>(first) * SECTOR_SIZE, m_payload.data(), byteSize)) {
+            spdlog::error("Failed to save chunk {}, {}", saves[i].pos.x, saves[i].pos.z);
+            SetSectorsUsed(region, first, sectors, false);
+            continue;
+        }
+        commits.push_back({ToTableIndex(saves[i].pos), {first, byteSize}});
+    }
+    if (commits.empty())
+        return;
+
+    // Payloads must be on disk before a table that points to them
+    region.file.Sync();
+
+    std::unique_lock lock(region.lock);
+    if (region.file.GetFileSize() > region.file.GetMappedSize() && !region.file.Remap()) {
+        spdlog::error("Failed to remap region file, {} chunk saves lost", commits.size());
+        for (const Commit &commit: commits)
+            SetSectorsUsed(region, commit.entry.sectorOffset, (commit.entry.byteSize + SECTOR_SIZE - 1) / SECTOR_SIZE,
+                           false);
+        return;
+    }
+
+    std::vector<TableEntry> previous;
+    previous.reserve(commits.size());
+    for (const Commit &commit: commits) {
+        if (region.table[commit.index].sectorOffset != 0)
+            previous.push_back(region.table[commit.index]);
+        region.table[commit.index] = commit.entry;
+    }
+    const bool written = region.file.Write(offsetof(FileHeader, table), region.table.data(), sizeof(region.table));
+    // Readers of the previous payloads held the region lock, none are left once we release it
+    lock.unlock();
+    if (!written) {
+        // The table on disk may still point to the previous payloads, their sectors stay used until a restart
+        spdlog::error("Failed to write region table, the last {} chunk saves may be lost", commits.size());
+        return;
+    }
+
+    // The previous payloads may only be overwritten once no table on disk points to them any more
+    region.file.Sync();
+    for (const TableEntry &entry: previous)
+        SetSectorsUsed(region, entry.sectorOffset, (entry.byteSize + SECTOR_SIZE - 1) / SECTOR_SIZE, false);
+}
@@ -0,0 +1,126 @@
+#pragma once
+
+#include <array>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "core/MappedFile.h"
+#include "world/Chunk.h"
+
+// Persists chunks in region files of REGION_SIZE x REGION_SIZE chunks, "r.<rx>.<rz>.pcr" in the save directory.
+// A file starts with an offset table naming the sectors that hold each chunk, followed by LZ4 compressed chunk
+// payloads in whole sectors. Files are mapped, so loading a chunk is a table lookup, the page faults for its
+// sectors and a decompress.
+// Saving only serializes on the calling thread; compression and writes happen on an I/O thread, which takes
+// everything queued at once and updates each region's table once per batch. A payload is always written to free
+// sectors before the table points to it, so a crash loses at most the latest batch of saves.
+// All methods are thread-safe; loads see saves that have not reached the disk yet.
+class RegionStorage {
+public:
+    static constexpr int REGION_SIZE = 32;
+    static constexpr uint32_t SECTOR_SIZE = 4096;
+
+    // Creates the directory when missing
+    explicit RegionStorage(std::string directory);
+    // Writes everything still queued
+    ~RegionStorage();
+
+    RegionStorage(const RegionStorage &) = delete;
+    RegionStorage &operator=(const RegionStorage &) = delete;
+
+    void SaveChunk(const Chunk &chunk);
+    // Fills the chunk at its position; false when it was never saved or its data is unreadable
+    bool LoadChunk(Chunk &chunk);
+    // Copies the chunk's payload as stored (see CompressChunkPayload), without decompressing it; false when the
+    // chunk was never saved or a newer save has not reached the disk yet
+    bool ReadStoredPayload(ChunkPos pos, std::vector<uint8_t> &out);
+    // Blocks until every save queued so far is on disk
+    void Flush();
+
+    size_t GetQueuedCount() const;
+
+private:
+    static constexpr uint32_t CHUNKS_PER_REGION = REGION_SIZE * REGION_SIZE;
+
+    // Precedes the sectors, one table entry per chunk in row-major z, x order
+    struct FileHeader;
+
+    struct TableEntry {
+        // In sectors, 0 when the chunk is absent
+        uint32_t sectorOffset = 0;
+        // Of the payload including its header
+        uint32_t byteSize = 0;
+    };
+
+    static constexpr uint32_t HEADER_SECTORS =
+        (2 * sizeof(uint32_t) + CHUNKS_PER_REGION * sizeof(TableEntry) + SECTOR_SIZE - 1) / SECTOR_SIZE;
+
+    struct RegionPos {
+        int32_t x = 0, z = 0;
+
+        bool operator==(const RegionPos &) const = default;
+    };
+
+    struct RegionPosHash {
+        size_t operator()(const RegionPos &pos) const noexcept { return ChunkPosHash()({pos.x, pos.z}); }
+    };
+
+    struct Region {
+        MappedFile file;
+        // Shared while reading payloads and the table, exclusive while the table or the mapping changes
+        std::shared_mutex lock;
+        std::array<TableEntry, CHUNKS_PER_REGION> table{};
+        // One bit per sector, only touched by the I/O thread
+        std::vector<uint64_t> usedSectors;
+        uint32_t sectorCount = 0;
+    };
+
+    struct PendingSave {
+        ChunkPos pos;
+        const std::vector<uint8_t> *data;
+    };
+
+    static RegionPos ToRegionPos(ChunkPos pos);
+    static uint32_t ToTableIndex(ChunkPos pos);
+
+    std::string GetRegionPath(RegionPos pos) const;
+    // nullptr when the file does not exist and create is false, or on errors
+    Region *GetRegion(RegionPos pos, bool create);
+    static bool OpenRegion(Region &region, const std::string &path);
+    // Payload in the region file, ignoring queued saves
+    bool ReadPayload(ChunkPos pos, std::vector<uint8_t> &out);
+
+    static uint32_t AllocateSectors(Region &region, uint32_t count);
+    static void SetSectorsUsed(Region &region, uint32_t first, uint32_t count, bool used);
+
+    void IoThread();
+    // Writes m_writing, which only changes while the I/O thread is idle
+    void WriteBatch();
+    void WriteRegion(Region &region, const PendingSave *saves, size_t count);
+
+    std::string m_directory;
+
+    std::mutex m_regionsMutex;
+    std::unordered_map<RegionPos, std::unique_ptr<Region>, RegionPosHash> m_regions;
+
+    // Serialized chunks waiting for the I/O thread, and the batch it is writing; both are searched by loads
+    mutable std::mutex m_queueMutex;
+    std::condition_variable m_queueCondition;
+    std::condition_variable m_idleCondition;
+    std::unordered_map<ChunkPos, std::vector<uint8_t>, ChunkPosHash> m_queued;
+    std::unordered_map<ChunkPos, std::vector<uint8_t>, ChunkPosHash> m_writing;
+    bool m_stop = false;
+
+    // I/O thread only
+    std::vector<PendingSave> m_batch;
+    std::vector<uint8_t> m_payload;
+
+    std::thread m_thread;
+};
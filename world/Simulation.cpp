@@ -0,0 +1,347 @@
+#include "world/Simulation.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <memory>
+#include <numbers>
+
+#include "world/BlockReader.h"
+
+namespace {
+    // Radians per second of the test orbit
+    constexpr double ORBIT_SPEED = 1.0 / 8.0;
+
+    // Blocks per second
+    constexpr float MOB_SPEED = 1.5f;
+    // Radians per second
+    constexpr float MOB_TURN_RATE = 4.f;
+    // Mobs farther than this from home head back
+    constexpr float MOB_LEASH = 24.f;
+
+    constexpr float ITEM_SPIN = 1.5f;
+    constexpr float ITEM_BOB = 0.1f;
+    constexpr float ITEM_HOVER = 0.35f;
+    // Seconds until an item despawns, a new one drops elsewhere
+    constexpr float ITEM_LIFETIME = 60.f;
+
+    // Blocks per second squared, and per second
+    constexpr float GRAVITY = 24.f;
+    // At most a block per tick at 20 ticks per second, so a fall never tunnels through the ground
+    constexpr float TERMINAL_SPEED = 20.f;
+    constexpr float BUOYANCY = 30.f;
+    constexpr float SWIM_SPEED = 1.5f;
+    // Clears a one block step
+    constexpr float JUMP_SPEED = 8.f;
+    // How fast overlapping colliders drift apart
+    constexpr float PUSH_SPEED = 2.f;
+
+    constexpr BlockId MOB_LOOKS[] = {BLOCK_GRASS, BLOCK_LOG, BLOCK_LEAVES, BLOCK_SAND};
+    constexpr BlockId ITEM_LOOKS[] = {BLOCK_STONE, BLOCK_DIRT, BLOCK_GRASS, BLOCK_SAND, BLOCK_GRAVEL, BLOCK_LOG};
+
+    uint32_t Hash(uint32_t a, const uint32_t b, const uint32_t c) {
+        a ^= b * 0x27d4eb2du;
+        a ^= c * 0x165667b1u;
+        a ^= a >> 15;
+        a *= 0x2c1b3c6du;
+        a ^= a >> 12;
+        a *= 0x297a2d39u;
+        a ^= a >> 15;
+        return a;
+    }
+
+    float HashUnit(const uint32_t h) {
+        return static_cast<float>(h >> 8) / static_cast<float>(1u << 24);
+    }
+
+    int FloorToInt(const float v) {
+        return static_cast<int>(std::floor(v));
+    }
+
+    Aabb GetColliderBox(const Transform &transform, const Collider &collider) {
+        return {{transform.x - collider.halfWidth, transform.y, transform.z - collider.halfWidth},
+                {transform.x + collider.halfWidth, transform.y + collider.height, transform.z + collider.halfWidth}};
+    }
+}
+
+Simulation::Simulation(const Settings &settings, JobSystem &jobSystem, const TerrainGenerator &terrain)
+    : m_settings(settings),
+      m_tickInterval(std::chrono::duration_cast<Clock::duration>(
+          std::chrono::duration<double>(1.0 / std::max(1u, settings.tickRate)))),
+      m_jobSystem(jobSystem), m_terrain(terrain) {
+    m_settings.tickRate = std::max(1u, m_settings.tickRate);
+    m_settings.maxCatchUpTicks = std::max(1u, m_settings.maxCatchUpTicks);
+
+    for (uint32_t i = 0; i < m_settings.mobCount; ++i)
+        SpawnMob(i);
+    for (uint32_t i = 0; i < m_settings.itemCount; ++i)
+        SpawnItem(i, 0);
+
+    m_published[0] = m_published[1] = m_state;
+    Publish(m_state);
+    m_publishedTime = Clock::now();
+    m_thread = std::thread(&Simulation::SimulationThread, this);
+}
+
+Simulation::~Simulation() {
+    {
+        std::lock_guard lock(m_stopMutex);
+        m_stop = true;
+    }
+    m_stopCondition.notify_one();
+    m_thread.join();
+}
+
+void Simulation::GetSnapshot(Snapshot &snapshot) const {
+    Clock::time_point publishedTime;
+    {
+        std::lock_guard lock(m_publishMutex);
+        snapshot.previous = m_published[0];
+        snapshot.current = m_published[1];
+        snapshot.entities.assign(m_publishedInstances.begin(), m_publishedInstances.end());
+        publishedTime = m_publishedTime;
+    }
+    // Frames show the simulation one tick late: previous at the time current became due, current a tick later,
+    // when the next pair is due. That way there is always a known state to blend towards.
+    const double elapsed = std::chrono::duration<double>(Clock::now() - publishedTime).count();
+    const double interval = std::chrono::duration<double>(m_tickInterval).count();
+    snapshot.alpha = static_cast<float>(std::clamp(elapsed / interval, 0.0, 1.0));
+}
+
+void Simulation::SimulationThread() {
+    // Time of the next tick; the accumulator is the real time past it
+    Clock::time_point nextTick = Clock::now() + m_tickInterval;
+
+    std::unique_lock lock(m_stopMutex);
+    while (!m_stopCondition.wait_until(lock, nextTick, [this] { return m_stop; })) {
+        lock.unlock();
+
+        const Clock::time_point now = Clock::now();
+        SimulationState previous = m_state;
+        uint32_t ticks = 0;
+        while (nextTick <= now && ticks < m_settings.maxCatchUpTicks) {
+            previous = m_state;
+            Tick(m_state);
+            nextTick += m_tickInterval;
+            ++ticks;
+        }
+        // Too far behind: the backlog is dropped rather than simulated in ever longer bursts
+        if (nextTick <= now)
+            nextTick = now + m_tickInterval;
+
+        if (ticks > 0) {
+            Publish(previous);
+            std::lock_guard publishLock(m_publishMutex);
+            m_publishedTime = nextTick - m_tickInterval;
+        }
+
+        lock.lock();
+    }
+}
+
+void Simulation::Tick(SimulationState &state) {
+    const uint64_t tick = ++state.tick;
+    const float dt = 1.f / static_cast<float>(m_settings.tickRate);
+    const double seconds = static_cast<double>(tick) / m_settings.tickRate;
+    state.orbitYaw = static_cast<float>(seconds * ORBIT_SPEED);
+
+    m_entities.ParallelForEach<Transform, PreviousTransform>(m_jobSystem,
+        [](Entity, const Transform &transform, PreviousTransform &previous) {
+            previous.value = transform;
+        });
+
+    const uint32_t seed = m_settings.seed;
+    m_entities.ParallelForEach<Wander, Transform, Velocity>(m_jobSystem,
+        [tick, dt, seed](const Entity entity, Wander &wander, Transform &transform, Velocity &velocity) {
+            if (tick >= wander.nextTurnTick) {
+                const uint32_t h = Hash(seed ^ entity.index, static_cast<uint32_t>(tick), entity.generation);
+                const float dx = wander.homeX - transform.x, dz = wander.homeZ - transform.z;
+                if (dx * dx + dz * dz > MOB_LEASH * MOB_LEASH) {
+                    wander.targetYaw = std::atan2(dx, dz);
+                    wander.speed = MOB_SPEED;
+                } else {
+                    wander.targetYaw = HashUnit(h) * 2.f * std::numbers::pi_v<float>;
+                    // A third of the time standing still
+                    wander.speed = (h & 3u) == 0u ? 0.f : MOB_SPEED;
+                }
+                wander.nextTurnTick = tick + 40 + (h >> 4) % 80;
+            }
+
+            // Turn the short way towards the target; yaw itself keeps counting so blending stays continuous
+            const float turn = std::remainder(wander.targetYaw - transform.yaw, 2.f * std::numbers::pi_v<float>);
+            transform.yaw += std::clamp(turn, -MOB_TURN_RATE * dt, MOB_TURN_RATE * dt);
+            velocity.x = std::sin(transform.yaw) * wander.speed;
+            velocity.z = std::cos(transform.yaw) * wander.speed;
+        });
+
+    LoadCollisionChunks();
+    const World &blocks = m_blocks;
+    m_entities.ParallelForEach<Transform, Velocity, Collider>(m_jobSystem,
+        [&blocks, dt](Entity, Transform &transform, Velocity &velocity, Collider &collider) {
+            BlockReader reader(blocks);
+            // Floats up while half under water, falls anywhere else
+            const int waterY = FloorToInt(transform.y + collider.height * 0.5f);
+            if (reader.Get(FloorToInt(transform.x), waterY, FloorToInt(transform.z)) == BLOCK_WATER)
+                velocity.y = std::min(velocity.y + BUOYANCY * dt, SWIM_SPEED);
+            else
+                velocity.y = std::max(velocity.y - GRAVITY * dt, -TERMINAL_SPEED);
+
+            Aabb box = GetColliderBox(transform, collider);
+            float motion[3] = {velocity.x * dt, velocity.y * dt, velocity.z * dt};
+            const uint32_t collided = MoveAabb(reader, box, motion);
+            transform.x += motion[0];
+            transform.y += motion[1];
+            transform.z += motion[2];
+
+            collider.onGround = (collided & COLLISION_Y) != 0 && velocity.y < 0.f;
+            if (collided & COLLISION_Y)
+                velocity.y = 0.f;
+            // Walked into a wall: jumps, so mobs get up steps
+            if ((collided & (COLLISION_X | COLLISION_Z)) != 0 && collider.onGround)
+                velocity.y = JUMP_SPEED;
+        });
+    SeparateColliders(dt);
+
+    m_despawned.clear();
+    const uint32_t tickRate = m_settings.tickRate;
+    m_entities.ForEach<Transform, ItemDrop>([&](const Entity entity, Transform &transform, const ItemDrop &item) {
+        const float age = static_cast<float>(static_cast<int64_t>(tick) - item.spawnTick) /
+                          static_cast<float>(tickRate);
+        if (age > ITEM_LIFETIME) {
+            m_despawned.push_back(entity);
+            return;
+        }
+        transform.yaw = age * ITEM_SPIN;
+        transform.y = item.baseY + ITEM_BOB * std::sin(age * 2.f);
+    });
+    for (const Entity entity: m_despawned) {
+        m_entities.Destroy(entity);
+        SpawnItem(entity.index ^ static_cast<uint32_t>(tick), tick);
+    }
+}
+
+void Simulation::SpawnMob(const uint32_t index) {
+    const uint32_t h = Hash(m_settings.seed, index, 0x6d6f62u);
+    const float angle = HashUnit(h) * 2.f * std::numbers::pi_v<float>;
+    const float distance = std::sqrt(HashUnit(Hash(h, 1, 0))) * m_settings.spawnRadius;
+    Transform transform;
+    transform.x = std::sin(angle) * distance;
+    transform.z = std::cos(angle) * distance;
+    transform.y = GetGroundHeight(transform.x, transform.z);
+    transform.yaw = angle;
+
+    Wander wander;
+    wander.homeX = transform.x;
+    wander.homeZ = transform.z;
+    wander.targetYaw = angle;
+    wander.nextTurnTick = h % 40;
+    const Renderable renderable{ENTITY_MESH_MOB, MOB_LOOKS[h % std::size(MOB_LOOKS)]};
+    m_entities.Create(transform, PreviousTransform{transform}, Velocity{}, Collider{}, wander, renderable);
+}
+
+void Simulation::SpawnItem(const uint32_t index, const uint64_t tick) {
+    const uint32_t h = Hash(m_settings.seed, index, static_cast<uint32_t>(tick) ^ 0x6974656du);
+    const float angle = HashUnit(h) * 2.f * std::numbers::pi_v<float>;
+    const float distance = std::sqrt(HashUnit(Hash(h, 2, 0))) * m_settings.spawnRadius;
+    Transform transform;
+    transform.x = std::sin(angle) * distance;
+    transform.z = std::cos(angle) * distance;
+    transform.y = GetGroundHeight(transform.x, transform.z) + ITEM_HOVER;
+
+    // The initial batch gets random ages, so it does not despawn all at once
+    const int64_t age = tick == 0 ? Hash(h, 3, 0) % static_cast<uint32_t>(ITEM_LIFETIME * m_settings.tickRate) : 0;
+    const ItemDrop item{static_cast<int64_t>(tick) - age, transform.y};
+    const Renderable renderable{ENTITY_MESH_ITEM, ITEM_LOOKS[h % std::size(ITEM_LOOKS)]};
+    m_entities.Create(transform, PreviousTransform{transform}, item, renderable);
+}
+
+void Simulation::LoadCollisionChunks() {
+    // A block of margin covers the next move
+    constexpr float MARGIN = 1.f;
+    m_missingChunks.clear();
+    m_entities.ForEach<Transform, Collider>([this](Entity, const Transform &transform, const Collider &collider) {
+        const float reach = collider.halfWidth + MARGIN;
+        const ChunkPos first = World::ToChunkPos(FloorToInt(transform.x - reach), FloorToInt(transform.z - reach));
+        const ChunkPos last = World::ToChunkPos(FloorToInt(transform.x + reach), FloorToInt(transform.z + reach));
+        for (int32_t z = first.z; z <= last.z; ++z)
+            for (int32_t x = first.x; x <= last.x; ++x)
+                if (!m_blocks.GetChunk({x, z}))
+                    m_missingChunks.push_back({x, z});
+    });
+    if (m_missingChunks.empty())
+        return;
+
+    std::sort(m_missingChunks.begin(), m_missingChunks.end(), [](const ChunkPos a, const ChunkPos b) {
+        return a.z != b.z ? a.z < b.z : a.x < b.x;
+    });
+    m_missingChunks.erase(std::unique(m_missingChunks.begin(), m_missingChunks.end()), m_missingChunks.end());
+
+    std::vector<std::unique_ptr<Chunk>> chunks(m_missingChunks.size());
+    const std::atomic<bool> cancelled{false};
+    m_jobSystem.ParallelFor(static_cast<uint32_t>(chunks.size()), 1, [&](const uint32_t begin, const uint32_t end) {
+        for (uint32_t i = begin; i < end; ++i) {
+            chunks[i] = std::make_unique<Chunk>(m_missingChunks[i]);
+            m_terrain.Generate(*chunks[i], cancelled);
+        }
+    });
+    for (auto &chunk: chunks)
+        m_blocks.InsertChunk(std::move(chunk));
+}
+
+void Simulation::SeparateColliders(const float dt) {
+    m_colliderBoxes.clear();
+    m_colliders.clear();
+    m_entities.ForEach<Transform, Collider>([this](const Entity entity, const Transform &transform,
+                                                   const Collider &collider) {
+        m_colliderBoxes.push_back(GetColliderBox(transform, collider));
+        m_colliders.push_back(entity);
+    });
+    m_broadphase.Build(m_colliderBoxes);
+
+    // Both sides of a pair move apart along the axis they overlap least on, around the ground, never into blocks.
+    // Boxes are updated as pairs are resolved, a pair an earlier push already separated is skipped
+    BlockReader reader(m_blocks);
+    const float maxPush = PUSH_SPEED * dt;
+    m_broadphase.ForEachPair([&](const uint32_t a, const uint32_t b) {
+        Aabb &boxA = m_colliderBoxes[a];
+        Aabb &boxB = m_colliderBoxes[b];
+        if (!boxA.Overlaps(boxB))
+            return;
+        const float overlapX = std::min(boxA.max[0], boxB.max[0]) - std::max(boxA.min[0], boxB.min[0]);
+        const float overlapZ = std::min(boxA.max[2], boxB.max[2]) - std::max(boxA.min[2], boxB.min[2]);
+        const int axis = overlapX < overlapZ ? 0 : 2;
+        const float push = std::min(std::min(overlapX, overlapZ) * 0.5f, maxPush);
+        const bool aFirst = boxA.min[axis] + boxA.max[axis] <= boxB.min[axis] + boxB.max[axis];
+        float motionA[3] = {0.f, 0.f, 0.f}, motionB[3] = {0.f, 0.f, 0.f};
+        motionA[axis] = aFirst ? -push : push;
+        motionB[axis] = -motionA[axis];
+        MoveAabb(reader, boxA, motionA);
+        MoveAabb(reader, boxB, motionB);
+    });
+
+    for (size_t i = 0; i < m_colliders.size(); ++i) {
+        Transform *transform = m_entities.Get<Transform>(m_colliders[i]);
+        const Aabb &box = m_colliderBoxes[i];
+        transform->x = (box.min[0] + box.max[0]) * 0.5f;
+        transform->z = (box.min[2] + box.max[2]) * 0.5f;
+    }
+}
+
+void Simulation::Publish(const SimulationState &previous) {
+    m_instances.clear();
+    m_entities.ForEach<Transform, PreviousTransform, Renderable>(
+        [this](const Entity entity, const Transform &transform, const PreviousTransform &from,
+               const Renderable &renderable) {
+            m_instances.push_back({entity, from.value, transform, renderable.mesh, renderable.block});
+        });
+
+    std::lock_guard lock(m_publishMutex);
+    m_published[0] = previous;
+    m_published[1] = m_state;
+    m_publishedInstances.swap(m_instances);
+}
+
+float Simulation::GetGroundHeight(const float x, const float z) const {
+    const int surface = m_terrain.GetSurfaceHeight(static_cast<int>(std::floor(x)), static_cast<int>(std::floor(z)));
+    return static_cast<float>(std::max(surface, TerrainGenerator::SEA_LEVEL) + 1);
+}
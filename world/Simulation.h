@@ -0,0 +1,115 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "core/EntityRegistry.h"
+#include "core/JobSystem.h"
+#include "world/Entities.h"
+#include "world/Physics.h"
+#include "world/TerrainGenerator.h"
+#include "world/World.h"
+
+// Everything the game steps at a fixed rate besides the entities. A tick only reads the previous state and the
+// tick counter, never the wall clock, so a replay of the same ticks gives the same states.
+struct SimulationState {
+    uint64_t tick = 0;
+    // Camera orbiting the test world, in radians
+    float orbitYaw = 0.f;
+};
+
+// Runs the simulation on its own thread at a fixed tick rate, independent of the frame rate.
+// Real time is collected in an accumulator and spent in whole ticks; after a stall at most maxCatchUpTicks
+// are run back to back and the rest of the backlog is dropped, so the game slows down instead of spiralling.
+//
+// Ticks write a private state. Once a tick is done, it is published together with the one before it;
+// the renderer takes that pair with GetSnapshot() and blends them by how far real time is into the next tick.
+//
+// Entities live in an EntityRegistry only the simulation thread touches. Systems run over it in a fixed order,
+// those touching nothing but their own entity spread over the job system; each entity only depends on its own
+// components and the tick, so the order the jobs run in does not matter.
+//
+// Colliders move through a private copy of the terrain, generated from the same seed chunk by chunk as entities
+// get near. It never touches the world the renderer owns, and gives the same blocks on every machine; edits
+// made to that world are not seen. Block ticks only turn grass into dirt and back, which changes nothing solid.
+// Overlapping colliders, found by a sort and sweep broadphase, are pushed apart after they moved.
+class Simulation {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    struct Settings {
+        uint32_t tickRate = 20;
+        uint32_t maxCatchUpTicks = 5;
+        // Test population around the world origin
+        uint32_t mobCount = 256;
+        uint32_t itemCount = 512;
+        float spawnRadius = 48.f;
+        uint32_t seed = 0;
+    };
+
+    struct Snapshot {
+        SimulationState previous, current;
+        // 0 shows previous, 1 current
+        float alpha = 1.f;
+        // Transforms at previous and current, blended with the same alpha
+        std::vector<EntityInstance> entities;
+    };
+
+    // Entities are placed on the terrain the generator produces
+    Simulation(const Settings &settings, JobSystem &jobSystem, const TerrainGenerator &terrain);
+    // Stops the thread after the tick it is running
+    ~Simulation();
+
+    Simulation(const Simulation &) = delete;
+    Simulation &operator=(const Simulation &) = delete;
+
+    // Thread-safe; reuses the snapshot's entity storage
+    void GetSnapshot(Snapshot &snapshot) const;
+
+    uint32_t GetTickRate() const { return m_settings.tickRate; }
+    Clock::duration GetTickInterval() const { return m_tickInterval; }
+
+private:
+    void SimulationThread();
+    void Tick(SimulationState &state);
+    void SpawnMob(uint32_t index);
+    void SpawnItem(uint32_t index, uint64_t tick);
+    void Publish(const SimulationState &previous);
+    // Generates the terrain around every collider that is not there yet
+    void LoadCollisionChunks();
+    void SeparateColliders(float dt);
+
+    // Surface an entity stands on, the sea counts as the surface where it covers the terrain
+    float GetGroundHeight(float x, float z) const;
+
+    // Simulation thread only, apart from construction
+    Settings m_settings;
+    Clock::duration m_tickInterval;
+    JobSystem &m_jobSystem;
+    TerrainGenerator m_terrain;
+    SimulationState m_state;
+    EntityRegistry m_entities;
+    std::vector<Entity> m_despawned;
+    World m_blocks;
+    std::vector<ChunkPos> m_missingChunks;
+    Broadphase m_broadphase;
+    std::vector<Aabb> m_colliderBoxes;
+    std::vector<Entity> m_colliders;
+    std::vector<EntityInstance> m_instances;
+
+    // Published pair, and the time current became due
+    mutable std::mutex m_publishMutex;
+    SimulationState m_published[2];
+    std::vector<EntityInstance> m_publishedInstances;
+    Clock::time_point m_publishedTime;
+
+    std::mutex m_stopMutex;
+    std::condition_variable m_stopCondition;
+    bool m_stop = false;
+
+    std::thread m_thread;
+};
@@ -0,0 +1,223 @@
+#include "world/TerrainGenerator.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+
+#include "core/LinearArena.h"
+
+namespace {
+    constexpr int COLUMN_COUNT = ChunkSection::AREA;
+    constexpr int MIN_HEIGHT = 4;
+    constexpr int MAX_HEIGHT = Chunk::HEIGHT - 24;
+    // Caves never open into the sea floor or cut the top soil
+    constexpr int CAVE_ROOF = 6;
+    constexpr float CAVERN_THRESHOLD = 0.32f;
+    constexpr float TUNNEL_WIDTH = 0.045f;
+
+    NoiseSettings MakeNoise(const int32_t seed, const float frequency, const int octaves) {
+        NoiseSettings settings;
+        settings.seed = seed;
+        settings.frequency = frequency;
+        settings.octaves = octaves;
+        return settings;
+    }
+
+    uint32_t HashColumn(const int32_t seed, const int x, const int z) {
+        uint32_t h = static_cast<uint32_t>(seed) ^ (static_cast<uint32_t>(x) * 0x27d4eb2du) ^
+                     (static_cast<uint32_t>(z) * 0x165667b1u);
+        h ^= h >> 15;
+        h *= 0x2c1b3c6du;
+        h ^= h >> 12;
+        return h;
+    }
+
+    float SmoothStep(const float edge0, const float edge1, const float v) {
+        const float t = std::clamp((v - edge0) / (edge1 - edge0), 0.f, 1.f);
+        return t * t * (3.f - 2.f * t);
+    }
+
+    int ColumnHeight(const float continents, const float detail, const float ridges) {
+        // Mountains rise from the inner parts of continents only
+        const float mountains = SmoothStep(0.1f, 0.35f, continents) * (1.f - std::abs(ridges));
+        const float height = static_cast<float>(TerrainGenerator::SEA_LEVEL) + continents * 48.f + detail * 8.f +
+                             mountains * mountains * 90.f;
+        return std::clamp(static_cast<int>(std::floor(height)), MIN_HEIGHT, MAX_HEIGHT);
+    }
+
+    // Blocks of the whole chunk, section after section in section index order
+    int BufferIndex(const int x, const int y, const int z) {
+        return (y >> 4) * ChunkSection::VOLUME + ChunkSection::Index(x, y & 15, z);
+    }
+
+    BlockId GetSurfaceBlock(const Biome biome, const int depth, const int y) {
+        switch (biome) {
+            case BIOME_OCEAN:
+                return depth < 3 ? (y < TerrainGenerator::SEA_LEVEL - 8 ? BLOCK_GRAVEL : BLOCK_SAND) : BLOCK_STONE;
+            case BIOME_BEACH:
+            case BIOME_DESERT:
+                return depth < 4 ? BLOCK_SAND : BLOCK_STONE;
+            case BIOME_MOUNTAINS:
+                return depth == 0 && y < TerrainGenerator::SEA_LEVEL + 70 ? BLOCK_GRAVEL : BLOCK_STONE;
+            default:
+                if (depth == 0)
+                    return BLOCK_GRASS;
+                return depth < 4 ? BLOCK_DIRT : BLOCK_STONE;
+        }
+    }
+}
+
+TerrainGenerator::TerrainGenerator(const int32_t seed)
+    : m_seed(seed),
+      m_continents(MakeNoise(seed, 1.f / 512.f, 4)),
+      m_detail(MakeNoise(seed + 1, 1.f / 96.f, 4)),
+      m_ridges(MakeNoise(seed + 2, 1.f / 256.f, 3)),
+      m_temperature(MakeNoise(seed + 3, 1.f / 1024.f, 2)),
+      m_humidity(MakeNoise(seed + 4, 1.f / 1024.f, 2)),
+      m_caverns(MakeNoise(seed + 5, 1.f / 48.f, 2)),
+      m_tunnelsA(MakeNoise(seed + 6, 1.f / 40.f, 2)),
+      m_tunnelsB(MakeNoise(seed + 7, 1.f / 40.f, 2)) {
+}
+
+int TerrainGenerator::GetSurfaceHeight(const int x, const int z) const {
+    float continents, detail, ridges;
+    Noise2DGrid(m_continents, x, z, 1, 1, &continents);
+    Noise2DGrid(m_detail, x, z, 1, 1, &detail);
+    Noise2DGrid(m_ridges, x, z, 1, 1, &ridges);
+    return ColumnHeight(continents, detail, ridges);
+}
+
+void TerrainGenerator::GenerateColumns(const ChunkPos pos, Column *columns) const {
+    const int x0 = pos.x * Chunk::SIZE, z0 = pos.z * Chunk::SIZE;
+    std::array<float, COLUMN_COUNT> continents, detail, ridges, temperature, humidity;
+    Noise2DGrid(m_continents, x0, z0, Chunk::SIZE, Chunk::SIZE, continents.data());
+    Noise2DGrid(m_detail, x0, z0, Chunk::SIZE, Chunk::SIZE, detail.data());
+    Noise2DGrid(m_ridges, x0, z0, Chunk::SIZE, Chunk::SIZE, ridges.data());
+    Noise2DGrid(m_temperature, x0, z0, Chunk::SIZE, Chunk::SIZE, temperature.data());
+    Noise2DGrid(m_humidity, x0, z0, Chunk::SIZE, Chunk::SIZE, humidity.data());
+
+    for (int i = 0; i < COLUMN_COUNT; ++i) {
+        Column &column = columns[i];
+        column.height = ColumnHeight(continents[i], detail[i], ridges[i]);
+
+        if (column.height < SEA_LEVEL - 1)
+            column.biome = BIOME_OCEAN;
+        else if (column.height <= SEA_LEVEL + 1)
+            column.biome = BIOME_BEACH;
+        else if (column.height > SEA_LEVEL + 40)
+            column.biome = BIOME_MOUNTAINS;
+        else if (temperature[i] > 0.2f && humidity[i] < 0.f)
+            column.biome = BIOME_DESERT;
+        else if (humidity[i] > 0.1f)
+            column.biome = BIOME_FOREST;
+        else
+            column.biome = BIOME_PLAINS;
+    }
+}
+
+void TerrainGenerator::CarveCaves(const ChunkPos pos, const int sy, const Column *columns, BlockId *blocks) const {
+    const int x0 = pos.x * Chunk::SIZE, y0 = sy * ChunkSection::SIZE, z0 = pos.z * Chunk::SIZE;
+    std::array<float, ChunkSection::VOLUME> caverns, tunnelsA, tunnelsB;
+    Noise3DGrid(m_caverns, x0, y0, z0, 16, 16, 16, caverns.data());
+    Noise3DGrid(m_tunnelsA, x0, y0, z0, 16, 16, 16, tunnelsA.data());
+    Noise3DGrid(m_tunnelsB, x0, y0, z0, 16, 16, 16, tunnelsB.data());
+
+    for (int index = 0; index < ChunkSection::VOLUME; ++index) {
+        const int y = y0 + (index >> 8);
+        const Column &column = columns[index & 255];
+        // Keep the bedrock floor and never flood caves from the sea
+        if (y < 2 || y > column.height - CAVE_ROOF || (column.height < SEA_LEVEL + 2 && y > column.height - 12))
+            continue;
+        const bool cavern = caverns[index] > CAVERN_THRESHOLD;
+        const bool tunnel = std::abs(tunnelsA[index]) < TUNNEL_WIDTH && std::abs(tunnelsB[index]) < TUNNEL_WIDTH;
+        if (cavern || tunnel)
+            blocks[index] = BLOCK_AIR;
+    }
+}
+
+void TerrainGenerator::PlaceTrees(const ChunkPos pos, const Column *columns, BlockId *blocks) const {
+    // Trees stay inside the chunk, so a chunk never has to write into its neighbours
+    for (int z = 2; z < Chunk::SIZE - 2; ++z) {
+        for (int x = 2; x < Chunk::SIZE - 2; ++x) {
+            const Column &column = columns[z * Chunk::SIZE + x];
+            if (column.biome != BIOME_FOREST && column.biome != BIOME_PLAINS)
+                continue;
+            const uint32_t h = HashColumn(m_seed, pos.x * Chunk::SIZE + x, pos.z * Chunk::SIZE + z);
+            const uint32_t chance = column.biome == BIOME_FOREST ? 40 : 400;
+            if (h % chance != 0)
+                continue;
+
+            const int ground = column.height;
+            const int trunk = 4 + static_cast<int>((h >> 16) % 3);
+            if (ground + trunk + 2 >= Chunk::HEIGHT || blocks[BufferIndex(x, ground, z)] != BLOCK_GRASS)
+                continue;
+
+            blocks[BufferIndex(x, ground, z)] = BLOCK_DIRT;
+            for (int dy = trunk - 2; dy <= trunk + 1; ++dy) {
+                const int radius = dy > trunk ? 1 : 2;
+                for (int dz = -radius; dz <= radius; ++dz) {
+                    for (int dx = -radius; dx <= radius; ++dx) {
+                        // Rounded corners
+                        if (radius == 2 && std::abs(dx) == 2 && std::abs(dz) == 2)
+                            continue;
+                        BlockId &block = blocks[BufferIndex(x + dx, ground + 1 + dy, z + dz)];
+                        if (block == BLOCK_AIR)
+                            block = BLOCK_LEAVES;
+                    }
+                }
+            }
+            for (int dy = 1; dy <= trunk; ++dy)
+                blocks[BufferIndex(x, ground + dy, z)] = BLOCK_LOG;
+        }
+    }
+}
+
+void TerrainGenerator::Generate(Chunk &chunk, const std::atomic<bool> &cancelled) const {
+    const ChunkPos pos = chunk.GetPos();
+    std::array<Column, COLUMN_COUNT> columns;
+    GenerateColumns(pos, columns.data());
+
+    int maxHeight = SEA_LEVEL;
+    for (const Column &column: columns)
+        maxHeight = std::max(maxHeight, column.height);
+    // Room for trees on the highest column
+    const int sectionCount = std::min(Chunk::SECTION_COUNT, (maxHeight + 8) / ChunkSection::SIZE + 1);
+
+    // Scratch of the generating job, on this thread's arena
+    LinearArena &arena = GetThreadArena();
+    const LinearArena::Scope scratch(arena);
+    const size_t blockCount = static_cast<size_t>(Chunk::SECTION_COUNT) * ChunkSection::VOLUME;
+    BlockId *blocks = arena.AllocateArray<BlockId>(blockCount);
+    std::fill_n(blocks, blockCount, BLOCK_AIR);
+
+    for (int sy = 0; sy < sectionCount; ++sy) {
+        if (cancelled.load(std::memory_order_relaxed))
+            return;
+
+        BlockId *section = blocks + sy * ChunkSection::VOLUME;
+        bool solid = false;
+        for (int index = 0; index < ChunkSection::VOLUME; ++index) {
+            const int y = sy * ChunkSection::SIZE + (index >> 8);
+            const Column &column = columns[index & 255];
+            BlockId id = BLOCK_AIR;
+            if (y == 0)
+                id = BLOCK_BEDROCK;
+            else if (y <= column.height) {
+                id = GetSurfaceBlock(column.biome, column.height - y, y);
+                solid = true;
+            } else if (y <= SEA_LEVEL)
+                id = BLOCK_WATER;
+            section[index] = id;
+        }
+        if (solid)
+            CarveCaves(pos, sy, columns.data(), section);
+    }
+
+    PlaceTrees(pos, columns.data(), blocks);
+
+    for (int sy = 0; sy < sectionCount; ++sy) {
+        const BlockId *section = blocks + sy * ChunkSection::VOLUME;
+        if (std::any_of(section, section + ChunkSection::VOLUME, [](const BlockId id) { return id != BLOCK_AIR; }))
+            chunk.GetOrCreateSection(sy).Assign(section);
+    }
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+#include "world/Chunk.h"
+#include "world/Noise.h"
+
+enum Biome : uint8_t {
+    BIOME_OCEAN,
+    BIOME_BEACH,
+    BIOME_PLAINS,
+    BIOME_FOREST,
+    BIOME_DESERT,
+    BIOME_MOUNTAINS,
+    BIOME_COUNT
+};
+
+// Layered noise terrain.
+// Per chunk, 2D noise grids give the height (continents + detail + mountain ridges) and the climate that picks
+// the biome of every column; per section, 3D noise grids carve caves: open caverns where one field is high and
+// tunnels where two others both cross zero. Blocks are built into a flat buffer and assigned section by section.
+// Output depends only on the seed and the chunk position, whatever the thread or the SIMD level.
+class TerrainGenerator {
+public:
+    static constexpr int SEA_LEVEL = 62;
+
+    explicit TerrainGenerator(int32_t seed);
+
+    // Thread-safe, usable directly as a ChunkStreamer::Generator
+    void Generate(Chunk &chunk, const std::atomic<bool> &cancelled) const;
+    void operator()(Chunk &chunk, const std::atomic<bool> &cancelled) const { Generate(chunk, cancelled); }
+
+    // Top terrain block of the column, before caves and trees; the sea may cover it. Thread-safe
+    int GetSurfaceHeight(int x, int z) const;
+
+    int32_t GetSeed() const { return m_seed; }
+
+private:
+    struct Column {
+        int height;
+        Biome biome;
+    };
+
+    void GenerateColumns(ChunkPos pos, Column *columns) const;
+    void CarveCaves(ChunkPos pos, int sy, const Column *columns, BlockId *blocks) const;
+    void PlaceTrees(ChunkPos pos, const Column *columns, BlockId *blocks) const;
+
+    int32_t m_seed;
+    NoiseSettings m_continents;
+    NoiseSettings m_detail;
+    NoiseSettings m_ridges;
+    NoiseSettings m_temperature;
+    NoiseSettings m_humidity;
+    NoiseSettings m_caverns;
+    NoiseSettings m_tunnelsA;
+    NoiseSettings m_tunnelsB;
+};
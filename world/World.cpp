@@ -0,0 +1,105 @@
+#include "world/World.h"
+
+Chunk *World::GetChunk(const ChunkPos pos) {
+    const auto it = m_chunks.find(pos);
+    return it != m_chunks.end() ? it->second.get() : nullptr;
+}
+
+const Chunk *World::GetChunk(const ChunkPos pos) const {
+    const auto it = m_chunks.find(pos);
+    return it != m_chunks.end() ? it->second.get() : nullptr;
+}
+
+Chunk &World::GetOrCreateChunk(const ChunkPos pos) {
+    auto &chunk = m_chunks[pos];
+    if (!chunk)
+        chunk = std::make_unique<Chunk>(pos);
+    return *chunk;
+}
+
+Chunk &World::InsertChunk(std::unique_ptr<Chunk> chunk) {
+    auto &slot = m_chunks[chunk->GetPos()];
+    slot = std::move(chunk);
+    return *slot;
+}
+
+bool World::RemoveChunk(const ChunkPos pos) {
+    return m_chunks.erase(pos) != 0;
+}
+
+const ChunkSection *World::GetSection(const int sx, const int sy, const int sz) const {
+    if (sy < 0 || sy >= Chunk::SECTION_COUNT)
+        return nullptr;
+    const Chunk *chunk = GetChunk({sx, sz});
+    return chunk ? chunk->GetSection(sy) : nullptr;
+}
+
+BlockId World::GetBlock(const int x, const int y, const int z) const {
+    const Chunk *chunk = GetChunk(ToChunkPos(x, z));
+    if (!chunk)
+        return BLOCK_AIR;
+    return chunk->GetBlock(ToLocal(x), y, ToLocal(z));
+}
+
+bool World::SetBlock(const int x, const int y, const int z, const BlockId id) {
+    Chunk *chunk = GetChunk(ToChunkPos(x, z));
+    if (!chunk || y < 0 || y >= Chunk::HEIGHT)
+        return false;
+    const BlockId previous = chunk->GetBlock(ToLocal(x), y, ToLocal(z));
+    if (previous == id)
+        return true;
+    chunk->SetBlock(ToLocal(x), y, ToLocal(z), id);
+
+    std::lock_guard lock(m_changedMutex);
+    if (m_recordBlockChanges)
+        m_blockChanges.push_back({x, y, z, id});
+    if (m_trackLight && (GetLightOpacity(previous) != GetLightOpacity(id) ||
+                         GetLightEmission(previous) != GetLightEmission(id)))
+        m_lightChanges.push_back({x, y, z, id});
+    ForEachSectionSharing(x, y, z, [this](const SectionPos pos) { m_changedSections.insert(pos); });
+    return true;
+}
+
+void World::TakeChangedSections(std::vector<SectionPos> &out) {
+    std::lock_guard lock(m_changedMutex);
+    out.insert(out.end(), m_changedSections.begin(), m_changedSections.end());
+    m_changedSections.clear();
+}
+
+void World::MarkSectionsChanged(const std::span<const SectionPos> sections) {
+    std::lock_guard lock(m_changedMutex);
+    m_changedSections.insert(sections.begin(), sections.end());
+}
+
+void World::SetRecordBlockChanges(const bool record) {
+    std::lock_guard lock(m_changedMutex);
+    m_recordBlockChanges = record;
+    if (!record)
+        m_blockChanges.clear();
+}
+
+void World::TakeBlockChanges(std::vector<BlockChange> &out) {
+    std::lock_guard lock(m_changedMutex);
+    out.insert(out.end(), m_blockChanges.begin(), m_blockChanges.end());
+    m_blockChanges.clear();
+}
+
+void World::SetTrackLight(const bool track) {
+    std::lock_guard lock(m_changedMutex);
+    m_trackLight = track;
+    if (!track)
+        m_lightChanges.clear();
+}
+
+void World::TakeLightChanges(std::vector<BlockChange> &out) {
+    std::lock_guard lock(m_changedMutex);
+    out.insert(out.end(), m_lightChanges.begin(), m_lightChanges.end());
+    m_lightChanges.clear();
+}
+
+size_t World::GetMemoryUsage() const {
+    size_t usage = sizeof(*this);
+    for (const auto &[pos, chunk]: m_chunks)
+        usage += chunk->GetMemoryUsage();
+    return usage;
+}
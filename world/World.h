@@ -0,0 +1,97 @@
+#pragma once
+
+#include <memory>
+#include <mutex>
+#include <span>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "world/Chunk.h"
+
+// Block coordinates and the block set there
+struct BlockChange {
+    int32_t x = 0, y = 0, z = 0;
+    BlockId id = BLOCK_AIR;
+};
+
+using ChunkMap = std::unordered_map<ChunkPos, std::unique_ptr<Chunk>, ChunkPosHash>;
+
+// Loaded chunks keyed by chunk coordinates. Block coordinates are global, Y is up.
+// Not thread-safe, except that GetBlock and SetBlock may run on several threads at once as long as no two of them
+// touch the same chunk and nobody adds or removes chunks meanwhile (see WorldTicker).
+class World {
+public:
+    static constexpr ChunkPos ToChunkPos(const int x, const int z) {
+        return {x >> 4, z >> 4};
+    }
+
+    static constexpr int ToLocal(const int v) {
+        return v & (Chunk::SIZE - 1);
+    }
+
+    // Calls fn(SectionPos) for the section of the block and every neighbour whose meshing border copy of it the
+    // block is in: blocks on a section border are corners of up to 8 sections
+    template<typename Fn>
+    static void ForEachSectionSharing(const int x, const int y, const int z, Fn &&fn) {
+        // Per axis: the section itself, plus the neighbour on the side the block touches
+        const int section[3] = {x >> 4, y >> 4, z >> 4};
+        const int local[3] = {ToLocal(x), y & (ChunkSection::SIZE - 1), ToLocal(z)};
+        int offsets[3][2], counts[3];
+        for (int axis = 0; axis < 3; ++axis) {
+            offsets[axis][0] = 0;
+            counts[axis] = 1;
+            if (local[axis] == 0)
+                offsets[axis][counts[axis]++] = -1;
+            else if (local[axis] == ChunkSection::SIZE - 1)
+                offsets[axis][counts[axis]++] = 1;
+        }
+        for (int iy = 0; iy < counts[1]; ++iy) {
+            const int sy = section[1] + offsets[1][iy];
+            if (sy < 0 || sy >= Chunk::SECTION_COUNT)
+                continue;
+            for (int iz = 0; iz < counts[2]; ++iz)
+                for (int ix = 0; ix < counts[0]; ++ix)
+                    fn(SectionPos{section[0] + offsets[0][ix], sy, section[2] + offsets[2][iz]});
+        }
+    }
+
+    Chunk *GetChunk(ChunkPos pos);
+    const Chunk *GetChunk(ChunkPos pos) const;
+    Chunk &GetOrCreateChunk(ChunkPos pos);
+    // Takes a chunk built outside the world, e.g. by a generation job; replaces any chunk at its position
+    Chunk &InsertChunk(std::unique_ptr<Chunk> chunk);
+    bool RemoveChunk(ChunkPos pos);
+
+    // Coordinates of the section, not of a block
+    const ChunkSection *GetSection(int sx, int sy, int sz) const;
+
+    BlockId GetBlock(int x, int y, int z) const;
+    // Records the section as changed, together with every neighbour whose border copy of it the block is in
+    bool SetBlock(int x, int y, int z, BlockId id);
+
+    // Moves the sections changed by SetBlock or MarkSectionsChanged since the last call into out
+    void TakeChangedSections(std::vector<SectionPos> &out);
+    // For changes made without SetBlock, e.g. to light; callable from several threads at once
+    void MarkSectionsChanged(std::span<const SectionPos> sections);
+    // Off by default. While on, SetBlock also logs every change in order, e.g. for sending them to clients
+    void SetRecordBlockChanges(bool record);
+    // Moves the changes logged since the last call into out
+    void TakeBlockChanges(std::vector<BlockChange> &out);
+    // Off by default, turned on by LightEngine. While on, SetBlock also logs the changes that affect light
+    void SetTrackLight(bool track);
+    void TakeLightChanges(std::vector<BlockChange> &out);
+
+    const ChunkMap &GetChunks() const { return m_chunks; }
+    size_t GetChunkCount() const { return m_chunks.size(); }
+    size_t GetMemoryUsage() const;
+
+private:
+    ChunkMap m_chunks;
+    std::mutex m_changedMutex;
+    std::unordered_set<SectionPos, SectionPosHash> m_changedSections;
+    bool m_recordBlockChanges = false;
+    std::vector<BlockChange> m_blockChanges;
+    bool m_trackLight = false;
+    std::vector<BlockChange> m_lightChanges;
+};
@@ -0,0 +1,102 @@
+#include "world/WorldTicker.h"
+
+#include <algorithm>
+#include <atomic>
+
+namespace {
+    uint32_t Hash(uint32_t a, const uint32_t b, const uint32_t c) {
+        a ^= b * 0x27d4eb2du;
+        a ^= c * 0x165667b1u;
+        a ^= a >> 15;
+        a *= 0x2c1b3c6du;
+        a ^= a >> 12;
+        a *= 0x297a2d39u;
+        a ^= a >> 15;
+        return a;
+    }
+
+    int FloorDiv(const int v, const int d) {
+        return v >= 0 ? v / d : -((-v + d - 1) / d);
+    }
+}
+
+WorldTicker::WorldTicker(World &world, JobSystem &jobSystem, const Settings &settings)
+    : m_world(world), m_jobSystem(jobSystem), m_settings(settings) {
+}
+
+void WorldTicker::Tick(const uint64_t tick) {
+    for (auto &[pos, chunks]: m_regions)
+        chunks.clear();
+    for (const auto &[pos, chunk]: m_world.GetChunks())
+        m_regions[{FloorDiv(pos.x, REGION_SIZE), FloorDiv(pos.z, REGION_SIZE)}].push_back(chunk.get());
+
+    for (auto &phase: m_phases)
+        phase.clear();
+    m_stats = {};
+    for (auto it = m_regions.begin(); it != m_regions.end();) {
+        auto &[pos, chunks] = *it;
+        // No chunk of the region is loaded anymore
+        if (chunks.empty()) {
+            it = m_regions.erase(it);
+            continue;
+        }
+        std::sort(chunks.begin(), chunks.end(), [](const Chunk *a, const Chunk *b) {
+            const ChunkPos pa = a->GetPos(), pb = b->GetPos();
+            return pa.z != pb.z ? pa.z < pb.z : pa.x < pb.x;
+        });
+        m_phases[(pos.x & 1) | ((pos.z & 1) << 1)].push_back(&chunks);
+        ++m_stats.regions;
+        m_stats.chunks += chunks.size();
+        ++it;
+    }
+
+    std::atomic<uint32_t> changes{0};
+    for (const auto &phase: m_phases) {
+        m_jobSystem.ParallelFor(static_cast<uint32_t>(phase.size()), 1, [&](const uint32_t begin, const uint32_t end) {
+            uint32_t regionChanges = 0;
+            for (uint32_t i = begin; i < end; ++i) {
+                for (Chunk *chunk: *phase[i])
+                    regionChanges += TickChunk(*chunk, tick);
+            }
+            changes.fetch_add(regionChanges, std::memory_order_relaxed);
+        });
+    }
+    m_stats.changes = changes.load(std::memory_order_relaxed);
+}
+
+uint32_t WorldTicker::TickChunk(Chunk &chunk, const uint64_t tick) {
+    const ChunkPos pos = chunk.GetPos();
+    const uint32_t chunkSeed = Hash(m_settings.seed, static_cast<uint32_t>(pos.x), static_cast<uint32_t>(pos.z));
+    uint32_t changes = 0;
+    for (int sy = 0; sy < Chunk::SECTION_COUNT; ++sy) {
+        if (!chunk.GetSection(sy))
+            continue;
+        for (uint32_t i = 0; i < m_settings.randomTicksPerSection; ++i) {
+            const uint32_t h = Hash(chunkSeed, static_cast<uint32_t>(tick), static_cast<uint32_t>(sy) * 64u + i);
+            const int x = static_cast<int>(h & 15), y = static_cast<int>((h >> 4) & 15), z = static_cast<int>((h >> 8) & 15);
+            // Re-fetched, an earlier tick of this chunk may have freed or created sections
+            const ChunkSection *section = chunk.GetSection(sy);
+            if (!section)
+                break;
+            const BlockId id = section->GetBlock(x, y, z);
+            if (!IsAir(id))
+                changes += RandomTick(pos.x * Chunk::SIZE + x, sy * ChunkSection::SIZE + y, pos.z * Chunk::SIZE + z, id,
+                                      h >> 12);
+        }
+    }
+    return changes;
+}
+
+uint32_t WorldTicker::RandomTick(const int x, const int y, const int z, const BlockId id, const uint32_t random) {
+    // Grass dies under opaque blocks and spreads to lit dirt next to it
+    if (id == BLOCK_GRASS) {
+        if (IsOpaque(m_world.GetBlock(x, y + 1, z)))
+            return m_world.SetBlock(x, y, z, BLOCK_DIRT) ? 1 : 0;
+        const int tx = x + static_cast<int>(random % 3) - 1;
+        const int ty = y + static_cast<int>((random >> 2) % 3) - 1;
+        const int tz = z + static_cast<int>((random >> 4) % 3) - 1;
+        if (m_world.GetBlock(tx, ty, tz) == BLOCK_DIRT && !IsOpaque(m_world.GetBlock(tx, ty + 1, tz)))
+            return m_world.SetBlock(tx, ty, tz, BLOCK_GRASS) ? 1 : 0;
+    }
+    return 0;
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include "core/JobSystem.h"
+#include "world/World.h"
+
+// Steps the blocks of every loaded chunk once per game tick, spread over the job system by region.
+// Regions are squares of REGION_SIZE x REGION_SIZE chunks (unrelated to the region files of RegionStorage).
+// A tick runs in four phases, one per parity of the region coordinates, so two regions ticking at the same time
+// are always a whole region apart: code ticking a chunk may read and write any chunk of its own region and of the
+// regions around it, and no lock is needed on the chunks. Every region's chunks are ticked in a fixed order and
+// the phases run one after another, so the result does not depend on the number of threads.
+//
+// Must be called from the thread that owns the world, while nothing else touches it.
+class WorldTicker {
+public:
+    static constexpr int REGION_SIZE = 8;
+
+    struct Settings {
+        // Blocks picked at random per non-empty section and tick
+        uint32_t randomTicksPerSection = 3;
+        uint32_t seed = 0;
+    };
+
+    struct Stats {
+        size_t regions = 0;
+        size_t chunks = 0;
+        // Blocks changed by the last tick
+        uint32_t changes = 0;
+    };
+
+    WorldTicker(World &world, JobSystem &jobSystem, const Settings &settings);
+
+    void Tick(uint64_t tick);
+
+    const Stats &GetStats() const { return m_stats; }
+
+private:
+    struct RegionPos {
+        int32_t x = 0, z = 0;
+        bool operator==(const RegionPos &) const = default;
+    };
+
+    struct RegionPosHash {
+        size_t operator()(const RegionPos &pos) const noexcept { return ChunkPosHash{}({pos.x, pos.z}); }
+    };
+
+    // Returns the number of blocks changed
+    uint32_t TickChunk(Chunk &chunk, uint64_t tick);
+    // random holds 20 random bits for the block's own use
+    uint32_t RandomTick(int x, int y, int z, BlockId id, uint32_t random);
+
+    World &m_world;
+    JobSystem &m_jobSystem;
+    Settings m_settings;
+    Stats m_stats;
+
+    // Rebuilt every tick, the vectors keep their capacity
+    std::unordered_map<RegionPos, std::vector<Chunk *>, RegionPosHash> m_regions;
+    std::vector<std::vector<Chunk *> *> m_phases[4];
+};